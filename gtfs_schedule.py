@@ -0,0 +1,411 @@
+"""
+Compile the WMATA static GTFS timetable for one station into flash.
+
+Runs before the build (as a PlatformIO extra script) and writes
+src/schedule_data.cpp, the table the display falls back to when live
+predictions are unavailable. Everything comes from a local GTFS zip, so
+the build never goes online.
+
+Usage:
+    1. Download the rail GTFS feed from the WMATA developer portal and
+       add its path to .env:
+       GTFS_ZIP=/path/to/google_transit.zip
+
+    2. Build as usual; STATION_CODE from .env picks the station.
+
+    Without GTFS_ZIP the table is empty and the fallback stays off.
+
+    It can also run on its own:
+       python gtfs_schedule.py google_transit.zip B35 -o src/schedule_data.cpp
+
+Table format (see include/schedule_table.h):
+    One table per service day type (weekday, Saturday, Sunday), each a run
+    of delta-encoded departures cut into blocks of SCHEDULE_BLOCK_SIZE with
+    an absolute start time per block.
+"""
+
+import csv
+import datetime
+import io
+import os
+import re
+import sys
+import zipfile
+
+# Must match include/schedule_table.h and include/train_tracker.h
+SCHEDULE_BLOCK_SIZE = 16
+DEST_MAX_LEN = 5
+LINE_MAX_LEN = 3
+
+DAY_TYPES = ("WEEKDAY", "SATURDAY", "SUNDAY")
+# Weekdays (Monday = 0) to sample for each day type, in order of preference
+DAY_TYPE_WEEKDAYS = ((2, 1, 3, 0, 4), (5,), (6,))
+CALENDAR_DAYS = ("monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday")
+
+# Line codes the live API uses, by the first word of the GTFS route name
+LINE_CODES = {
+    "RED": "RD",
+    "BLUE": "BL",
+    "ORANGE": "OR",
+    "SILVER": "SV",
+    "GREEN": "GR",
+    "YELLOW": "YL",
+}
+
+
+def load_env_file(env_path):
+    """
+    Parse a .env file and return a dictionary of key-value pairs.
+
+    :param str env_path: Path to the .env file
+    :return dict: Dictionary of environment variables
+    """
+    env_vars = {}
+    if not os.path.exists(env_path):
+        return env_vars
+
+    with open(env_path, 'r') as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            if '=' in line:
+                key, value = line.split('=', 1)
+                env_vars[key.strip()] = value.strip()
+    return env_vars
+
+
+def read_table(feed, name):
+    """
+    Iterate over the rows of one GTFS file.
+
+    :param zipfile.ZipFile feed: Open GTFS zip
+    :param str name: File name inside the zip, e.g. "stops.txt"
+    :return iterator: Rows as dictionaries; nothing if the file is missing
+    """
+    if name not in feed.namelist():
+        return
+    with feed.open(name) as raw:
+        yield from csv.DictReader(io.TextIOWrapper(raw, encoding="utf-8-sig"))
+
+
+def parse_gtfs_time(text):
+    """
+    Convert a GTFS time to seconds after the service day's midnight.
+
+    :param str text: "HH:MM:SS"; hours may be 24 or more for trips after midnight
+    :return int: Seconds, or None if the time is blank
+    """
+    text = text.strip()
+    if not text:
+        return None
+    hours, minutes, seconds = (int(part) for part in text.split(":"))
+    return hours * 3600 + minutes * 60 + seconds
+
+
+def line_code(route):
+    """
+    Get the live API's two-letter line code for a GTFS route.
+
+    :param dict route: Row from routes.txt
+    :return str: Line code, e.g. "RD"
+    """
+    for field in ("route_short_name", "route_long_name", "route_id"):
+        words = re.findall(r"[A-Za-z]+", route.get(field, ""))
+        if words and words[0].upper() in LINE_CODES:
+            return LINE_CODES[words[0].upper()]
+    name = route.get("route_short_name") or route.get("route_id", "")
+    return name[:LINE_MAX_LEN - 1].upper()
+
+
+def station_stops(feed, station_code):
+    """
+    Find the stops (platforms) that belong to a station.
+
+    WMATA stop and parent-station IDs embed the station code (e.g.
+    "PF_B35_C" under "STN_B35"), so any ID with the code as a token counts.
+
+    :param zipfile.ZipFile feed: Open GTFS zip
+    :param str station_code: Station code, e.g. "B35"
+    :return set: Matching stop_ids
+    """
+    code = station_code.upper()
+    stops = set()
+    for stop in read_table(feed, "stops.txt"):
+        ids = (stop.get("stop_id", ""), stop.get("parent_station", ""), stop.get("stop_code", ""))
+        if any(code in re.split(r"[^A-Za-z0-9]+", value.upper()) for value in ids):
+            stops.add(stop["stop_id"])
+    return stops
+
+
+def active_services(feed, start_date):
+    """
+    Pick the services that run on a typical day of each type.
+
+    For each day type, the first date on or after start_date that falls on
+    a matching weekday and has any service stands in for the whole type;
+    holidays only show up if calendar_dates.txt covers that date.
+
+    :param zipfile.ZipFile feed: Open GTFS zip
+    :param datetime.date start_date: First date to consider
+    :return list: One set of service_ids per day type
+    """
+    calendar = list(read_table(feed, "calendar.txt"))
+    exceptions = {}
+    for row in read_table(feed, "calendar_dates.txt"):
+        exceptions.setdefault(row["date"], []).append((row["service_id"], row["exception_type"].strip()))
+
+    def services_on(date):
+        stamp = date.strftime("%Y%m%d")
+        services = set()
+        for row in calendar:
+            if row["start_date"] <= stamp <= row["end_date"] and row[CALENDAR_DAYS[date.weekday()]].strip() == "1":
+                services.add(row["service_id"])
+        for service_id, exception_type in exceptions.get(stamp, []):
+            if exception_type == "1":
+                services.add(service_id)
+            elif exception_type == "2":
+                services.discard(service_id)
+        return services
+
+    result = []
+    for weekdays in DAY_TYPE_WEEKDAYS:
+        chosen = set()
+        for offset in range(0, 90):
+            date = start_date + datetime.timedelta(days=offset)
+            if date.weekday() in weekdays:
+                chosen = services_on(date)
+                if chosen:
+                    break
+        result.append(chosen)
+    return result
+
+
+def collect_departures(feed, station_code, start_date):
+    """
+    Gather the station's departures for each day type.
+
+    Trips that end at the station are arrivals, not departures, and are left
+    out. The track group is the GTFS direction_id plus one.
+
+    :param zipfile.ZipFile feed: Open GTFS zip
+    :param str station_code: Station code, e.g. "B35"
+    :param datetime.date start_date: First date to sample service days from
+    :return tuple: (list of departure lists per day type, destinations, lines);
+                   each departure is (seconds, destination, line, group)
+    """
+    stops = station_stops(feed, station_code)
+    if not stops:
+        raise ValueError(f"no stops for station {station_code} in the feed")
+
+    routes = {route["route_id"]: line_code(route) for route in read_table(feed, "routes.txt")}
+    trips = {trip["trip_id"]: trip for trip in read_table(feed, "trips.txt")}
+
+    here = {}
+    last_stop = {}
+    for row in read_table(feed, "stop_times.txt"):
+        trip_id = row["trip_id"]
+        sequence = int(row["stop_sequence"])
+        if sequence > last_stop.get(trip_id, -1):
+            last_stop[trip_id] = sequence
+        if row["stop_id"] in stops:
+            seconds = parse_gtfs_time(row.get("departure_time", ""))
+            if seconds is None:
+                seconds = parse_gtfs_time(row.get("arrival_time", ""))
+            if seconds is not None:
+                here.setdefault(trip_id, []).append((sequence, seconds))
+
+    services = active_services(feed, start_date)
+    days = [[] for _ in DAY_TYPES]
+    destinations = []
+    lines = []
+    for trip_id, visits in here.items():
+        trip = trips.get(trip_id)
+        visits = [visit for visit in visits if visit[0] != last_stop[trip_id]]
+        if trip is None or not visits:
+            continue
+        destination = (trip.get("trip_headsign") or "").strip()[:DEST_MAX_LEN - 1]
+        line = routes.get(trip["route_id"], "")
+        group = int(trip.get("direction_id") or 0) + 1
+        if destination not in destinations:
+            destinations.append(destination)
+        if line not in lines:
+            lines.append(line)
+        for sequence, seconds in visits:
+            departure = (seconds, destinations.index(destination), lines.index(line), group)
+            for day, day_services in zip(days, services):
+                if trip["service_id"] in day_services:
+                    day.append(departure)
+
+    if len(destinations) > 256 or len(lines) > 32:
+        raise ValueError("too many destinations or lines for the table format")
+    for day in days:
+        day.sort()
+    return days, destinations, lines
+
+
+def encode_day(departures):
+    """
+    Delta-encode one day's sorted departures into blocks.
+
+    :param list departures: (seconds, destination, line, group) tuples, sorted
+    :return tuple: (list of (firstSec, offset) blocks, bytearray data)
+    """
+    blocks = []
+    data = bytearray()
+    previous = 0
+    for index, (seconds, destination, line, group) in enumerate(departures):
+        delta = seconds - previous
+        if index % SCHEDULE_BLOCK_SIZE == 0:
+            blocks.append((seconds, len(data)))
+            delta = 0
+        while True:
+            byte = delta & 0x7F
+            delta >>= 7
+            data.append(byte | 0x80 if delta else byte)
+            if not delta:
+                break
+        data.append(destination)
+        data.append(line | (group << 5))
+        previous = seconds
+
+    if len(data) > 0xFFFF or len(departures) > 0xFFFF:
+        raise ValueError("day too large for 16-bit block offsets")
+    return blocks, data
+
+
+def _wrap(items, per_line):
+    lines = []
+    for start in range(0, len(items), per_line):
+        lines.append("    " + ", ".join(items[start:start + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def render_source(days, destinations, lines, description):
+    """
+    Write the C++ source for a compiled timetable.
+
+    :param list days: Departure lists per day type
+    :param list destinations: Destination names, indexed by the departures
+    :param list lines: Line codes, indexed by the departures
+    :param str description: Where the table came from, for the header comment
+    :return str: Contents of src/schedule_data.cpp
+    """
+    out = [
+        "// Generated by gtfs_schedule.py; do not edit.",
+        f"// {description}",
+        "",
+        '#include "schedule_table.h"',
+        "",
+    ]
+
+    if destinations:
+        names = ", ".join('"' + name.replace('"', '') + '"' for name in destinations)
+        out.append(f"static const char DESTINATIONS[][DEST_MAX_LEN] = {{{names}}};")
+    if lines:
+        codes = ", ".join('"' + code + '"' for code in lines)
+        out.append(f"static const char LINES[][LINE_MAX_LEN] = {{{codes}}};")
+
+    entries = []
+    for name, departures in zip(DAY_TYPES, days):
+        if not departures:
+            entries.append("        {nullptr, nullptr, 0, 0},")
+            continue
+        blocks, data = encode_day(departures)
+        out.append("")
+        out.append(f"// {len(departures)} departures, {len(data)} bytes")
+        out.append(f"static const ScheduleBlock {name}_BLOCKS[] = {{")
+        out.append(_wrap([f"{{{first}, {offset}}}" for first, offset in blocks], 6))
+        out.append("};")
+        out.append(f"static const uint8_t {name}_DATA[] = {{")
+        out.append(_wrap([f"0x{byte:02X}" for byte in data], 16))
+        out.append("};")
+        entries.append(f"        {{{name}_BLOCKS, {name}_DATA, {len(blocks)}, {len(departures)}}},")
+
+    out.append("")
+    out.append("const ScheduleTable STATION_SCHEDULE = {")
+    out.append("    {")
+    out.extend(entries)
+    out.append("    },")
+    out.append(f"    {'DESTINATIONS' if destinations else 'nullptr'},")
+    out.append(f"    {'LINES' if lines else 'nullptr'},")
+    out.append(f"    {len(destinations)},")
+    out.append(f"    {len(lines)},")
+    out.append("};")
+    out.append("")
+    return "\n".join(out)
+
+
+def compile_schedule(gtfs_zip, station_code, output_path, start_date=None):
+    """
+    Compile a station's timetable, or an empty one without a feed.
+
+    The output is only rewritten when it changes, so an unchanged feed
+    does not trigger a rebuild.
+
+    :param str gtfs_zip: Path to the GTFS zip, or None
+    :param str station_code: Station code, e.g. "B35"
+    :param str output_path: Where to write the C++ source
+    :param datetime.date start_date: First date to sample service days from (default today)
+    :return int: Total departures compiled
+    """
+    days = [[] for _ in DAY_TYPES]
+    destinations = []
+    lines = []
+    if gtfs_zip:
+        with zipfile.ZipFile(gtfs_zip) as feed:
+            days, destinations, lines = collect_departures(feed, station_code, start_date or datetime.date.today())
+        description = f"Station {station_code} from {os.path.basename(gtfs_zip)}"
+    else:
+        description = "No GTFS_ZIP configured; the scheduled fallback is disabled."
+
+    source = render_source(days, destinations, lines, description)
+    existing = None
+    if os.path.exists(output_path):
+        with open(output_path, 'r') as f:
+            existing = f.read()
+    if source != existing:
+        with open(output_path, 'w') as f:
+            f.write(source)
+    return sum(len(day) for day in days)
+
+
+def main(argv):
+    import argparse
+
+    parser = argparse.ArgumentParser(description="Compile a station's GTFS timetable into C++")
+    parser.add_argument("gtfs_zip", help="Path to the static GTFS zip")
+    parser.add_argument("station_code", help="Station code, e.g. B35")
+    parser.add_argument("-o", "--output", default=os.path.join("src", "schedule_data.cpp"))
+    parser.add_argument("--date", help="First date to sample service days from (YYYY-MM-DD)")
+    args = parser.parse_args(argv)
+
+    start_date = datetime.date.fromisoformat(args.date) if args.date else None
+    count = compile_schedule(args.gtfs_zip, args.station_code, args.output, start_date)
+    print(f"{count} departures for {args.station_code} written to {args.output}")
+    return 0
+
+
+try:
+    Import("env")
+except NameError:
+    # Run directly, not from PlatformIO
+    if __name__ == "__main__":
+        sys.exit(main(sys.argv[1:]))
+else:
+    project_dir = env.get("PROJECT_DIR", ".")
+    env_vars = load_env_file(os.path.join(project_dir, ".env"))
+    station_code = env_vars.get("STATION_CODE", "B35")
+    gtfs_zip = env_vars.get("GTFS_ZIP")
+    if gtfs_zip and not os.path.isabs(gtfs_zip):
+        gtfs_zip = os.path.join(project_dir, gtfs_zip)
+    if gtfs_zip and not os.path.exists(gtfs_zip):
+        print(f"⚠ Warning: GTFS_ZIP not found at {gtfs_zip}; scheduled fallback disabled")
+        gtfs_zip = None
+
+    output_path = os.path.join(project_dir, "src", "schedule_data.cpp")
+    count = compile_schedule(gtfs_zip, station_code, output_path)
+    if gtfs_zip:
+        print(f"✓ {count} scheduled departures for {station_code} compiled from {os.path.basename(gtfs_zip)}")
+    else:
+        print("ℹ GTFS_ZIP not in .env, scheduled fallback disabled")
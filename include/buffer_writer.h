@@ -0,0 +1,98 @@
+#ifndef BUFFER_WRITER_H
+#define BUFFER_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Appends formatted text to a fixed, caller-owned buffer
+ *
+ * Used to pre-serialize responses without touching the heap. Output past
+ * the end of the buffer is dropped and remembered, and the buffer always
+ * stays null-terminated.
+ *
+ * Example usage:
+ * ```cpp
+ * char body[256];
+ * BufferWriter out(body, sizeof(body));
+ * out.print("{\"station\":");
+ * out.printJsonString(stationCode);
+ * out.printf(",\"trains\":%d}", count);
+ * if (out.overflowed()) { ... }
+ * ```
+ */
+class BufferWriter {
+public:
+    /**
+     * Constructor
+     *
+     * :param char* buffer: Output buffer
+     * :param size_t capacity: Size of output buffer (must be at least 1)
+     */
+    BufferWriter(char* buffer, size_t capacity);
+
+    /**
+     * Discard everything written so far
+     */
+    void reset();
+
+    /**
+     * Cut the text back to a length it had earlier, e.g. to drop a list
+     * item that didn't fit, and clear the overflow flag
+     *
+     * :param size_t length: Length from an earlier length() call
+     */
+    void truncate(size_t length);
+
+    /**
+     * Append a string
+     *
+     * :param const char* str: Text to append
+     */
+    void print(const char* str);
+
+    /**
+     * Append printf-style formatted text
+     *
+     * :param const char* format: printf format string
+     */
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    /**
+     * Append a string as a quoted, escaped JSON string
+     *
+     * :param const char* str: Text to append (nullptr writes null)
+     */
+    void printJsonString(const char* str);
+
+    /**
+     * Get the text written so far (null-terminated)
+     *
+     * :return const char*: The buffer
+     */
+    const char* c_str() const;
+
+    /**
+     * Get the number of characters written
+     *
+     * :return size_t: Length excluding the null terminator
+     */
+    size_t length() const;
+
+    /**
+     * Check whether any output was dropped for lack of space
+     *
+     * :return bool: True if the buffer overflowed
+     */
+    bool overflowed() const;
+
+private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflowed;
+
+    void _append(const char* data, size_t length);
+};
+
+#endif // BUFFER_WRITER_H
@@ -0,0 +1,49 @@
+#ifndef BUS_PREDICTIONS_H
+#define BUS_PREDICTIONS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "train_tracker.h"
+
+/**
+ * Most bus stops a panel follows; each gets its own bus page
+ */
+#define MAX_BUS_STOPS 3
+
+/**
+ * Buses kept per stop from each response (the soonest win)
+ *
+ * MAX_BUS_STOPS * MAX_BUS_PER_STOP stays within MAX_TRACKED_TRAINS, so every
+ * bus kept can be tracked.
+ */
+#define MAX_BUS_PER_STOP 4
+
+/**
+ * Normalize one WMATA bus prediction into the tracker's record
+ *
+ * The route ID takes the destination's place (truncated to fit), since a
+ * route is what a bus rider looks for; the line is left empty, and the track
+ * group is the stop's number, so each stop's buses are tracked and shown
+ * apart. 0 minutes means the bus is arriving.
+ *
+ * :param const char* routeId: "RouteID" field, e.g. "D4" or "X2"
+ * :param long minutes: "Minutes" field
+ * :param uint8_t stop: Stop number (1 to MAX_BUS_STOPS)
+ * :param TrainObservation& observation: Output record
+ * :return bool: False if the route is empty or the minutes are negative
+ */
+bool parseBusPrediction(const char* routeId, long minutes, uint8_t stop, TrainObservation& observation);
+
+/**
+ * Add a prediction to a list kept sorted soonest first, dropping the latest
+ * once the list is full
+ *
+ * :param TrainObservation* observations: Sorted list
+ * :param int count: Entries in the list
+ * :param int maxCount: Size of the list
+ * :param const TrainObservation& observation: Prediction to add
+ * :return int: New number of entries
+ */
+int keepSoonest(TrainObservation* observations, int count, int maxCount, const TrainObservation& observation);
+
+#endif // BUS_PREDICTIONS_H
@@ -0,0 +1,150 @@
+#ifndef COLOR_PALETTE_H
+#define COLOR_PALETTE_H
+
+#include <stdint.h>
+
+/**
+ * Number of dimming levels; level 0 is full brightness
+ */
+#define DIM_LEVELS 4
+
+/**
+ * Brightness of each dimming level, in percent of full
+ */
+#define DIM_LEVEL_PERCENTS {100, 50, 25, 10}
+
+/**
+ * Colors the panel draws with
+ */
+enum PaletteColor : uint8_t {
+    COLOR_BLACK,
+    COLOR_WHITE,
+    COLOR_RED,       // Errors, long gaps
+    COLOR_YELLOW,    // Stale data
+    COLOR_CYAN,      // Clock, normal gaps
+    COLOR_AMBER,     // Advisories, timetable departures
+    COLOR_LINE_RD,   // Red Line
+    COLOR_LINE_BL,   // Blue Line
+    COLOR_LINE_OR,   // Orange Line
+    COLOR_LINE_GR,   // Green Line
+    COLOR_LINE_YL,   // Yellow Line
+    COLOR_LINE_SV,   // Silver Line
+    PALETTE_SIZE
+};
+
+/**
+ * A color as it should look, 8 bits per channel
+ */
+struct Rgb888 {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+/**
+ * How each palette color should look, in PaletteColor order
+ */
+constexpr Rgb888 PALETTE_RGB[PALETTE_SIZE] = {
+    {0, 0, 0},
+    {255, 255, 255},
+    {255, 0, 0},
+    {255, 255, 0},
+    {0, 255, 255},
+    {255, 160, 0},
+    {255, 0, 0},
+    {0, 0, 255},
+    {255, 128, 0},
+    {0, 255, 0},
+    {255, 255, 0},
+    {192, 192, 192},
+};
+
+/**
+ * Light output for a channel value, from 0 to 1
+ *
+ * LED brightness is linear in the PWM duty, while color values are
+ * perceptual, so values are mapped through a gamma of about 2.2 (here
+ * x^2 * (0.8 + 0.2x), which is within 1% of it and works in constexpr).
+ * This is the only correction: the panel library's CIE1931 table is
+ * turned off with NO_CIE1931 in platformio.ini.
+ */
+constexpr float _gammaLinear(float x) {
+    return x * x * (0.8f + 0.2f * x);
+}
+
+/**
+ * Round a panel level, keeping anything lit at level 1 or above
+ */
+constexpr uint8_t _litLevel(float level) {
+    return level < 1.0f ? 1 : (uint8_t)(level + 0.5f);
+}
+
+/**
+ * Panel level for one channel of a color
+ *
+ * A channel that is lit stays at least at level 1, so dimmed text keeps
+ * its hue rather than losing its weaker channels.
+ *
+ * :param uint8_t value: Channel value (0-255)
+ * :param uint8_t percent: Brightness in percent
+ * :param uint8_t bits: Bits of the panel channel (5 or 6)
+ * :return uint8_t: Panel level (0 to 2^bits - 1)
+ */
+constexpr uint8_t gammaLevel(uint8_t value, uint8_t percent, uint8_t bits) {
+    return value == 0 ? 0 : _litLevel(_gammaLinear(value / 255.0f) * percent / 100.0f * ((1 << bits) - 1));
+}
+
+/**
+ * Gamma-corrected RGB565 color at a brightness
+ *
+ * :param Rgb888 rgb: Color as it should look
+ * :param uint8_t percent: Brightness in percent
+ * :return uint16_t: RGB565 color for the panel
+ */
+constexpr uint16_t correctedColor565(Rgb888 rgb, uint8_t percent) {
+    return (uint16_t)((gammaLevel(rgb.r, percent, 5) << 11) | (gammaLevel(rgb.g, percent, 6) << 5) |
+                      gammaLevel(rgb.b, percent, 5));
+}
+
+/**
+ * Panel levels for every channel value at one brightness
+ */
+struct GammaTable {
+    uint8_t red[256];    // Also used for blue (both 5 bits)
+    uint8_t green[256];  // 6 bits
+};
+
+/**
+ * Every palette color at one brightness, in PaletteColor order
+ */
+struct PaletteTable {
+    uint16_t color[PALETTE_SIZE];
+};
+
+/**
+ * Gamma tables and palettes for each dimming level, worked out at compile
+ * time (see color_palette.cpp)
+ */
+extern const GammaTable GAMMA_TABLES[DIM_LEVELS];
+extern const PaletteTable PALETTE_TABLES[DIM_LEVELS];
+
+/**
+ * Gamma-corrected RGB565 color through the tables
+ *
+ * :param uint8_t r: Red (0-255)
+ * :param uint8_t g: Green (0-255)
+ * :param uint8_t b: Blue (0-255)
+ * :param uint8_t level: Dimming level (0 is full brightness)
+ * :return uint16_t: RGB565 color for the panel
+ */
+uint16_t gammaColor565(uint8_t r, uint8_t g, uint8_t b, uint8_t level);
+
+/**
+ * Get the palette color of a Metro line
+ *
+ * :param const char* lineCode: Line code (RD, BL, OR, GR, YL, SV)
+ * :return PaletteColor: The line's color, or COLOR_WHITE for anything else
+ */
+PaletteColor lineColor(const char* lineCode);
+
+#endif // COLOR_PALETTE_H
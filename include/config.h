@@ -53,6 +53,9 @@
 /** Number of panels chained together */
 #define PANEL_CHAIN 1
 
+/** Dimming level at boot: 0 is full brightness, 3 the dimmest (see color_palette.h) */
+#define PANEL_DIM_LEVEL 0
+
 // =============================================================================
 // NTP Time Sync Configuration
 // =============================================================================
@@ -63,10 +66,29 @@
 /** Secondary NTP server (fallback) */
 #define NTP_SERVER_SECONDARY "time.nist.gov"
 
-/** Timezone offset in seconds (EST = UTC-5 = -18000) */
-#define TIMEZONE_OFFSET_SEC  -18000
+/**
+ * Local time zone as a POSIX TZ rule: US Eastern, UTC-5, with daylight
+ * time from the second Sunday in March to the first Sunday in November
+ * (both at 2:00). For another zone, e.g. US Pacific: "PST8PDT,M3.2.0,M11.1.0"
+ */
+#define TIMEZONE_RULE        "EST5EDT,M3.2.0,M11.1.0"
+
+/**
+ * How often SNTP re-syncs once the clock is set (ms); runs in the
+ * network stack's task, never in the display loop
+ */
+#define NTP_RESYNC_INTERVAL_MS 21600000UL  // 6 hours
 
-/** Daylight Saving Time offset in seconds (1 hour = 3600) */
-#define DST_OFFSET_SEC       3600
+// =============================================================================
+// Logging Configuration
+// =============================================================================
+
+/**
+ * Most verbose level compiled in (LOG_LEVEL_NONE .. LOG_LEVEL_DEBUG from
+ * log_ring.h); calls above it generate no code. Override with -DLOG_LEVEL=N.
+ */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
+#endif
 
 #endif // CONFIG_H
@@ -0,0 +1,48 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "device_config.h"
+
+/**
+ * NVS namespace and key the config blob is stored under
+ */
+#define CONFIG_STORE_NAMESPACE "wmata"
+#define CONFIG_STORE_KEY "config"
+
+/**
+ * Keeps the device config in NVS (non-volatile storage), so settings
+ * changed at runtime survive a restart
+ *
+ * The config is stored as one blob from encodeConfig(). NVS writes the new
+ * blob before dropping the old one, and the blob's checksum catches anything
+ * else, so a power cut mid-save leaves the old settings in place.
+ *
+ * Example usage:
+ * ```cpp
+ * DeviceConfig config;
+ * initConfig(config, STATION_CODE, WMATA_API_KEY, WIFI_SSID, WIFI_PASSWORD);
+ * ConfigStore store;
+ * store.load(config);   // Stored values override the build's defaults
+ * ```
+ */
+class ConfigStore {
+public:
+    /**
+     * Load the stored config over the given one
+     *
+     * :param DeviceConfig& config: Config to update; left alone if nothing
+     *     valid is stored
+     * :return bool: True if a stored config was loaded
+     */
+    bool load(DeviceConfig& config);
+
+    /**
+     * Store a config
+     *
+     * :param const DeviceConfig& config: Config to store
+     * :return bool: True if it was written
+     */
+    bool save(const DeviceConfig& config);
+};
+
+#endif // CONFIG_STORE_H
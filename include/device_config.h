@@ -0,0 +1,125 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer_writer.h"
+
+/**
+ * Version of the stored config layout; bumped only for changes older
+ * firmware can't read (new fields just get new tags)
+ */
+#define CONFIG_SCHEMA_VERSION 1
+
+/**
+ * Field sizes (including null terminator)
+ */
+#define CONFIG_STATION_MAX_LEN 8
+#define CONFIG_API_KEY_MAX_LEN 64
+#define CONFIG_SSID_MAX_LEN 33
+#define CONFIG_PASSWORD_MAX_LEN 64
+
+/**
+ * Largest encoded config: header, every field as a record, and the checksum
+ */
+#define CONFIG_BLOB_MAX_LEN 192
+
+/**
+ * Bits of configChanges(), one per part of the device a change touches
+ */
+#define CONFIG_CHANGED_STATION 0x01
+#define CONFIG_CHANGED_API_KEY 0x02
+#define CONFIG_CHANGED_WIFI 0x04
+
+/**
+ * Settings that can change without reflashing
+ */
+struct DeviceConfig {
+    char stationCode[CONFIG_STATION_MAX_LEN];
+    char apiKey[CONFIG_API_KEY_MAX_LEN];
+    char wifiSsid[CONFIG_SSID_MAX_LEN];
+    char wifiPassword[CONFIG_PASSWORD_MAX_LEN];
+};
+
+/**
+ * Fill a config with the build's defaults; values too long are truncated
+ *
+ * :param DeviceConfig& config: Config to fill
+ * :param const char* stationCode: Station code
+ * :param const char* apiKey: WMATA API key
+ * :param const char* wifiSsid: WiFi network name
+ * :param const char* wifiPassword: WiFi password
+ */
+void initConfig(DeviceConfig& config, const char* stationCode, const char* apiKey,
+                const char* wifiSsid, const char* wifiPassword);
+
+/**
+ * Encode a config for storage
+ *
+ * The blob is "WC", the schema version, one tag-length-value record per
+ * field and an FNV-1a checksum of everything before it, so a later version
+ * can add fields that this one skips, and a torn write is never loaded.
+ *
+ * :param const DeviceConfig& config: Config to encode
+ * :param uint8_t* buffer: Output buffer (CONFIG_BLOB_MAX_LEN always fits)
+ * :param size_t size: Size of the output buffer
+ * :return size_t: Blob length, or 0 if the buffer is too small
+ */
+size_t encodeConfig(const DeviceConfig& config, uint8_t* buffer, size_t size);
+
+/**
+ * Decode a stored config
+ *
+ * Fields missing from the blob keep the value config already has, and
+ * records with unknown tags are skipped. Nothing is changed unless the whole
+ * blob is valid.
+ *
+ * :param const uint8_t* data: Blob from encodeConfig()
+ * :param size_t length: Blob length
+ * :param DeviceConfig& config: Config to update
+ * :return bool: False for a bad header, version, checksum or record
+ */
+bool decodeConfig(const uint8_t* data, size_t length, DeviceConfig& config);
+
+/**
+ * Set one field by name, after checking the value
+ *
+ * :param DeviceConfig& config: Config to update
+ * :param const char* name: "station", "api_key", "wifi_ssid" or "wifi_password"
+ * :param const char* value: New value
+ * :param const char*& error: Set to what was wrong when false is returned
+ * :return bool: True if the field was set
+ */
+bool setConfigField(DeviceConfig& config, const char* name, const char* value, const char*& error);
+
+/**
+ * Apply a form-encoded update such as "station=A01&api_key=..."
+ *
+ * Values are URL-decoded in place. Either every field is set or, if any
+ * name or value is bad, none is.
+ *
+ * :param DeviceConfig& config: Config to update
+ * :param char* form: Form text (modified)
+ * :param const char*& error: Set to what was wrong when false is returned
+ * :return bool: True if the update was applied
+ */
+bool applyConfigForm(DeviceConfig& config, char* form, const char*& error);
+
+/**
+ * Find which parts of the device a config change touches
+ *
+ * :param const DeviceConfig& before: Config in use
+ * :param const DeviceConfig& after: New config
+ * :return uint8_t: CONFIG_CHANGED_* bits, 0 if nothing changed
+ */
+uint8_t configChanges(const DeviceConfig& before, const DeviceConfig& after);
+
+/**
+ * Write a config as JSON, with the API key and WiFi password masked
+ *
+ * :param const DeviceConfig& config: Config to write
+ * :param BufferWriter& out: Output
+ */
+void formatConfig(const DeviceConfig& config, BufferWriter& out);
+
+#endif // DEVICE_CONFIG_H
@@ -3,9 +3,46 @@
 
 #include <Arduino.h>
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+#include "config.h"
+#include "panel_config.h"
+#include "color_palette.h"
+#include "frame_buffer.h"
+
+/**
+ * Size of the whole display (all chained panels) in pixels
+ */
+#define DISPLAY_WIDTH DisplayLayout::WIDTH
+#define DISPLAY_HEIGHT DisplayLayout::HEIGHT
+
+/**
+ * Number of text rows (the third is the footer/advisory row)
+ */
+#define DISPLAY_ROWS 3
+
+/**
+ * Longest row text remembered for change detection (including terminator)
+ */
+#define DISPLAY_ROW_LEN 24
+
+class MirroredPanel;
 
 /**
  * Display class to manage the HUB75 LED matrix panel
+ * 
+ * Everything drawn is mirrored into a shadow FrameBuffer, so the current
+ * frame can be checked remotely (see getFrame()).
+ * 
+ * The pinout and row layout come from DisplayLayout and PANEL_PINS
+ * (panel_config.h), fixed at compile time for the panel in config.h.
+ * 
+ * Text screens are drawn as DISPLAY_ROWS rows through showRows(), which
+ * remembers what each row holds and repaints only the rows that changed.
+ * A countdown tick or a page change therefore touches one or two rows
+ * rather than the whole panel.
+ * 
+ * Colors are gamma corrected and dimmed through tables built at compile
+ * time (color_palette.h): color() looks up a palette color at the current
+ * dimming level, so changing the level costs nothing per pixel.
  */
 class Display {
 public:
@@ -34,6 +71,8 @@ public:
     /**
      * Display time in HH:MM:SS format with AM/PM indicator
      * 
+     * Drawn as rows, so each second repaints only the time's row.
+     * 
      * :param int hour: Hour in 12-hour format (1-12)
      * :param int minute: Minutes (0-59)
      * :param int second: Seconds (0-59)
@@ -63,23 +102,153 @@ public:
                            const char* train2Dest, const char* train2Min,
                            const char* lastUpdated, uint16_t lineColor);
     
+    /**
+     * Draw text rows, repainting only those that changed
+     * 
+     * A row is repainted when its text or color differs from what was last
+     * drawn there, or when something else has drawn over it since.
+     * 
+     * :param const char* const rows[]: Text of each row; "" blanks a row and
+     *     nullptr leaves it as it is (e.g., under the scrolling advisory)
+     * :param const uint16_t colors[]: Text color of each row
+     */
+    void showRows(const char* const rows[DISPLAY_ROWS], const uint16_t colors[DISPLAY_ROWS]);
+    
+    /**
+     * Format a train's row: "Glen - 5", or "Glen 12:41" when the arrival is
+     * a time of day, which needs the room the dash would take
+     * 
+     * :param const char* destination: Destination (up to 4 characters)
+     * :param const char* arrival: Minutes, "BRD"/"ARR"/"LFT", or a time of day
+     * :param char* buffer: Output buffer
+     * :param size_t bufferSize: Size of the output buffer
+     */
+    static void formatTrainRow(const char* destination, const char* arrival, char* buffer, size_t bufferSize);
+    
+    /**
+     * Display up to three plain text rows (e.g., the headway statistics page)
+     * 
+     * :param const char* row1: First row (or nullptr to leave blank)
+     * :param const char* row2: Second row (or nullptr)
+     * :param const char* row3: Third row (or nullptr)
+     * :param uint16_t color: Text color for the first two rows
+     * :param uint16_t row3Color: Text color for the third row
+     */
+    void showTextRows(const char* row1, const char* row2, const char* row3,
+                      uint16_t color, uint16_t row3Color);
+    
+    /**
+     * Draw scrolling advisory text over the bottom row
+     * 
+     * Only the bottom row is redrawn, so this can be called at the scroll
+     * rate without redrawing the train rows.
+     * 
+     * :param const char* text: Advisory text
+     * :param int offsetPx: Scroll position; 0 puts the text just off the right edge
+     */
+    void showAdvisory(const char* text, int offsetPx);
+    
     /**
      * Get the raw display pointer for advanced operations
      * 
+     * Drawing through it bypasses the shadow frame.
+     * 
      * :return MatrixPanel_I2S_DMA*: Pointer to the display object
      */
     MatrixPanel_I2S_DMA* getRaw();
     
-    // Color helper
-    uint16_t color565(uint8_t r, uint8_t g, uint8_t b);
+    /**
+     * Get the shadow copy of what is on the panel
+     * 
+     * :return const FrameBuffer&: Current frame
+     */
+    const FrameBuffer& getFrame() const;
+    
+    /**
+     * Get a palette color at the current dimming level
+     * 
+     * :param PaletteColor color: Palette color
+     * :return uint16_t: RGB565 color for the panel
+     */
+    uint16_t color(PaletteColor color) const;
+    
+    /**
+     * Get any color, gamma corrected at the current dimming level
+     * 
+     * :param uint8_t r: Red (0-255)
+     * :param uint8_t g: Green (0-255)
+     * :param uint8_t b: Blue (0-255)
+     * :return uint16_t: RGB565 color for the panel
+     */
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) const;
+    
+    /**
+     * Dim the whole panel (e.g., at night)
+     * 
+     * Rows are repainted in the new colors as they are next drawn.
+     * 
+     * :param uint8_t level: Dimming level, 0 (full) to DIM_LEVELS - 1
+     */
+    void setDimLevel(uint8_t level);
+    
+    /**
+     * Get the dimming level
+     * 
+     * :return uint8_t: Dimming level (0 is full brightness)
+     */
+    uint8_t getDimLevel() const;
+    
+    /**
+     * Blank the panel, e.g. while Metro is closed, or bring it back
+     * 
+     * While blank, every LED is off and drawing does nothing. With all
+     * pixels black the panel keeps no LED lit even if refresh pauses (light
+     * sleep). Rows are redrawn as they are next shown after unblanking.
+     * 
+     * :param bool blank: True to blank
+     */
+    void setBlank(bool blank);
+    
+    /**
+     * Check whether the panel is blanked
+     * 
+     * :return bool: True while blank
+     */
+    bool isBlank() const;
+    
+    /**
+     * Get the number of full-screen redraws since boot (every row changed)
+     * 
+     * :return unsigned long: Full redraw count
+     */
+    unsigned long getRedrawCount() const;
+    
+    /**
+     * Get the number of partial redraws (changed rows, advisory scroll steps) since boot
+     * 
+     * :return unsigned long: Partial redraw count
+     */
+    unsigned long getPartialRedrawCount() const;
 
 private:
     MatrixPanel_I2S_DMA* _display;
-    uint16_t _colorWhite;
-    uint16_t _colorBlack;
-    uint16_t _colorCyan;
+    MirroredPanel* _gfx;          // Draws to _display and _frame
+    uint16_t _framePixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+    FrameBuffer _frame;
+    uint8_t _dimLevel;
+    bool _blank;
+    unsigned long _redraws;
+    unsigned long _partialRedraws;
+    char _rowText[DISPLAY_ROWS][DISPLAY_ROW_LEN];
+    uint16_t _rowColor[DISPLAY_ROWS];
+    bool _rowValid[DISPLAY_ROWS];   // False once something else drew over the row
     
     void _setPinModes();
+    
+    /**
+     * Forget what the rows hold, after drawing that ignores them
+     */
+    void _invalidateRows();
 };
 
 #endif // DISPLAY_H
@@ -0,0 +1,171 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdint.h>
+
+/**
+ * Number of host names remembered
+ */
+#define DNS_CACHE_SLOTS 4
+
+/**
+ * Longest host name that can be cached (including terminator)
+ */
+#define DNS_CACHE_HOST_LEN 64
+
+/**
+ * Shortest time an address is trusted (ms), whatever TTL the resolver reports
+ *
+ * Keeps a zero or tiny TTL from turning every request back into a lookup.
+ */
+#define DNS_CACHE_MIN_TTL_MS 60000UL
+
+/**
+ * Longest time an address is trusted (ms) before it is looked up again
+ */
+#define DNS_CACHE_MAX_TTL_MS 3600000UL
+
+/**
+ * TTL used when the resolver doesn't report one (ms)
+ */
+#define DNS_CACHE_DEFAULT_TTL_MS 300000UL
+
+/**
+ * After a failed lookup, how long to keep serving the last known address
+ * before asking the resolver again (ms)
+ *
+ * Stops a dead resolver from adding its timeout to every request.
+ */
+#define DNS_CACHE_RETRY_MS 30000UL
+
+/**
+ * Resolve a host name to an IPv4 address
+ *
+ * :param const char* host: Host name
+ * :param uint32_t& address: Output address, in the same byte order IPAddress uses
+ * :param unsigned long& ttlMs: Output time to live (ms), 0 if unknown
+ * :param void* context: Context given to the cache
+ * :return bool: True if the host resolved
+ */
+typedef bool (*DnsResolver)(const char* host, uint32_t& address, unsigned long& ttlMs, void* context);
+
+/**
+ * Where an address came from
+ */
+enum DnsLookupResult {
+    DNS_HIT,        // Cached and still fresh
+    DNS_RESOLVED,   // Looked up just now
+    DNS_STALE,      // Lookup failed; last known good address
+    DNS_FAILED      // Lookup failed and nothing to fall back on
+};
+
+/**
+ * Small cache of resolved host names
+ *
+ * lookup() answers from the cache while an address is within its TTL
+ * (clamped to DNS_CACHE_MIN_TTL_MS..DNS_CACHE_MAX_TTL_MS) and asks the
+ * resolver otherwise. When the resolver fails, the last address that
+ * worked is returned instead, and the resolver is left alone for
+ * DNS_CACHE_RETRY_MS. If connecting to an address fails, invalidate()
+ * makes the next lookup ask again while keeping it as a fallback.
+ *
+ * The resolver is a plain function so tests can supply their own. When
+ * all slots are taken, the least recently used host is forgotten.
+ *
+ * All times are monoMillis() values.
+ *
+ * Example usage:
+ * ```cpp
+ * DnsCache dns(resolveWithWiFi);
+ * uint32_t address;
+ * if (dns.lookup("api.wmata.com", monoMillis(), address) != DNS_FAILED) {
+ *     if (!client.connect(IPAddress(address), 80)) dns.invalidate("api.wmata.com");
+ * }
+ * ```
+ */
+class DnsCache {
+public:
+    /**
+     * Constructor
+     *
+     * :param DnsResolver resolver: Function that performs real lookups
+     * :param void* context: Passed back to the resolver
+     */
+    DnsCache(DnsResolver resolver, void* context = nullptr);
+
+    /**
+     * Get the address of a host
+     *
+     * :param const char* host: Host name
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param uint32_t& address: Output address (left alone on DNS_FAILED)
+     * :return DnsLookupResult: Where the address came from
+     */
+    DnsLookupResult lookup(const char* host, uint64_t nowMs, uint32_t& address);
+
+    /**
+     * Mark a host's address as suspect so the next lookup asks the resolver
+     *
+     * The address is still used if that lookup fails.
+     *
+     * :param const char* host: Host name
+     */
+    void invalidate(const char* host);
+
+    /**
+     * Forget every host
+     */
+    void clear();
+
+    /**
+     * Get how many lookups were answered from the cache
+     */
+    unsigned long getHitCount() const;
+
+    /**
+     * Get how many lookups went to the resolver and succeeded
+     */
+    unsigned long getResolveCount() const;
+
+    /**
+     * Get how many lookups fell back to a last known good address
+     */
+    unsigned long getStaleCount() const;
+
+    /**
+     * Get how many lookups failed with nothing to fall back on
+     */
+    unsigned long getFailureCount() const;
+
+private:
+    struct Entry {
+        char host[DNS_CACHE_HOST_LEN];
+        uint32_t address;            // 0 if never resolved
+        uint64_t resolvedAt;
+        unsigned long ttlMs;
+        uint64_t failedAt;           // Last failed lookup, while failing
+        uint64_t lastUsed;
+        bool used;
+        bool expired;                // Invalidated; ask again before trusting
+        bool failing;                // Last lookup failed
+    };
+
+    DnsResolver _resolver;
+    void* _context;
+    Entry _entries[DNS_CACHE_SLOTS];
+    unsigned long _hits;
+    unsigned long _resolves;
+    unsigned long _stale;
+    unsigned long _failures;
+
+    /**
+     * Find a host's entry, or claim one for it
+     *
+     * :param const char* host: Host name
+     * :param bool create: Claim a slot (evicting the least recently used) if not found
+     * :return Entry*: The entry, or nullptr if not found and create is false
+     */
+    Entry* _find(const char* host, bool create);
+};
+
+#endif // DNS_CACHE_H
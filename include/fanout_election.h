@@ -0,0 +1,141 @@
+#ifndef FANOUT_ELECTION_H
+#define FANOUT_ELECTION_H
+
+#include <stdint.h>
+
+/**
+ * How often a leader re-sends its latest snapshot when it has nothing
+ * new, so followers know it is alive (ms)
+ */
+#define FANOUT_HEARTBEAT_MS 10000
+
+/**
+ * Followers take over when the leader has been silent this long (ms)
+ */
+#define FANOUT_LEADER_TIMEOUT_MS 35000
+
+/**
+ * How long a panel listens for an existing leader after boot before
+ * claiming leadership itself (ms)
+ */
+#define FANOUT_STARTUP_LISTEN_MS 12000
+
+/**
+ * Role of this panel in the group
+ */
+enum FanoutRole {
+    FANOUT_LISTENING,  // Just started; waiting to hear a leader
+    FANOUT_FOLLOWER,   // Rendering a leader's snapshots; no API calls
+    FANOUT_LEADER      // Fetching from WMATA and sending snapshots
+};
+
+/**
+ * Leader election for panels sharing one station's predictions
+ *
+ * Every panel listens first. If no leader is heard within
+ * FANOUT_STARTUP_LISTEN_MS, or the current leader goes quiet for
+ * FANOUT_LEADER_TIMEOUT_MS, the panel becomes leader. If two leaders hear
+ * each other, the one with the higher id steps down, so the group settles
+ * on the lowest id among panels that claimed leadership.
+ *
+ * All times are monoMillis() values.
+ *
+ * Example usage:
+ * ```cpp
+ * FanoutElection election(deviceId);
+ * election.begin(monoMillis());
+ * // for each valid snapshot received:
+ * if (election.onSnapshot(snapshot.leaderId, monoMillis())) { apply it }
+ * election.update(monoMillis());
+ * if (election.isLeader()) { fetch and send }
+ * ```
+ */
+class FanoutElection {
+public:
+    /**
+     * Constructor
+     *
+     * :param uint32_t deviceId: This panel's id (unique in the group, e.g. from the MAC)
+     */
+    explicit FanoutElection(uint32_t deviceId);
+
+    /**
+     * Start (or restart) listening for a leader
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void begin(uint64_t nowMs);
+
+    /**
+     * Handle a snapshot received from another panel
+     *
+     * :param uint32_t senderId: Device id in the snapshot
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if the snapshot comes from our leader and should be rendered
+     */
+    bool onSnapshot(uint32_t senderId, uint64_t nowMs);
+
+    /**
+     * Take over leadership if no leader has been heard recently
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if this call made us leader
+     */
+    bool update(uint64_t nowMs);
+
+    /**
+     * Check whether a leader should re-send its snapshot as a heartbeat
+     *
+     * :param uint64_t lastSentMs: When the last snapshot was sent
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if a heartbeat is due
+     */
+    bool isHeartbeatDue(uint64_t lastSentMs, uint64_t nowMs) const;
+
+    /**
+     * Get this panel's current role
+     *
+     * :return FanoutRole: Listening, follower or leader
+     */
+    FanoutRole getRole() const;
+
+    /**
+     * Check whether this panel should fetch from WMATA
+     *
+     * :return bool: True if leader
+     */
+    bool isLeader() const;
+
+    /**
+     * Get the id of the leader being followed (our own id when leading)
+     *
+     * :return uint32_t: Leader id (0 while listening)
+     */
+    uint32_t getLeaderId() const;
+
+    /**
+     * Get this panel's id
+     *
+     * :return uint32_t: Device id
+     */
+    uint32_t getDeviceId() const;
+
+    /**
+     * Get the number of times this panel changed role
+     *
+     * :return unsigned long: Role changes since begin()
+     */
+    unsigned long getRoleChangeCount() const;
+
+private:
+    uint32_t _deviceId;
+    FanoutRole _role;
+    uint32_t _leaderId;
+    uint64_t _sinceMs;           // When listening started
+    uint64_t _lastHeardMs;       // Last snapshot from the leader
+    unsigned long _roleChanges;
+
+    void _setRole(FanoutRole role, uint32_t leaderId);
+};
+
+#endif // FANOUT_ELECTION_H
@@ -0,0 +1,104 @@
+#ifndef FETCH_BUDGET_H
+#define FETCH_BUDGET_H
+
+#include <stdint.h>
+#include "fetch_phase.h"
+
+/**
+ * Latency budget of one API request, split by phase
+ *
+ * Each phase (DNS, connect, first byte, body, parse) has its own limit and
+ * the request as a whole has a cap. enter() starts a phase and returns how
+ * long it may take, which the caller uses as the socket timeout for the
+ * blocking call. check() afterwards tells whether the phase or the request
+ * ran over; the first overrun is recorded with the phase that caused it, so
+ * slow DNS and a stalled server show up separately in the metrics.
+ *
+ * A phase budget of 0 means the phase is limited only by the total cap.
+ *
+ * Example usage:
+ * ```cpp
+ * static const unsigned long PHASE_MS[FETCH_PHASE_COUNT] = {0, 2000, 3000, 5000, 5000, 1000};
+ * FetchBudget budget(PHASE_MS, 10000);
+ * budget.start(monoMillis());
+ * client.connect(address, 80, budget.enter(FETCH_PHASE_CONNECT, monoMillis()));
+ * if (!budget.check(monoMillis())) { abort(); }
+ * ```
+ */
+class FetchBudget {
+public:
+    /**
+     * Constructor
+     *
+     * :param const unsigned long phaseMs[]: Budget of each phase, indexed by FetchPhase (copied)
+     * :param unsigned long totalMs: Cap on the whole request
+     */
+    FetchBudget(const unsigned long phaseMs[FETCH_PHASE_COUNT], unsigned long totalMs);
+
+    /**
+     * Start timing a new request
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void start(uint64_t nowMs);
+
+    /**
+     * Enter a phase
+     *
+     * :param uint8_t phase: FetchPhase value
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return unsigned long: Time the phase may take: the smaller of its own
+     *     budget and what is left of the total (at least 1 ms)
+     */
+    unsigned long enter(uint8_t phase, uint64_t nowMs);
+
+    /**
+     * Check the current phase and the total against their budgets
+     *
+     * The first overrun of a request is counted against the current phase.
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if still within budget
+     */
+    bool check(uint64_t nowMs);
+
+    /**
+     * Get the absolute deadline of the current phase
+     *
+     * :return uint64_t: monoMillis() value at which the phase runs out
+     */
+    uint64_t getPhaseDeadline() const;
+
+    /**
+     * Get the phase that ran over in the current request
+     *
+     * :return uint8_t: FetchPhase value, FETCH_PHASE_IDLE if none
+     */
+    uint8_t getOverrunPhase() const;
+
+    /**
+     * Check whether the overrun was the total cap rather than the phase's own budget
+     */
+    bool wasTotalOverrun() const;
+
+    /**
+     * Get how many requests ran over in a phase
+     *
+     * :param uint8_t phase: FetchPhase value
+     * :return unsigned long: Overruns since boot
+     */
+    unsigned long getOverrunCount(uint8_t phase) const;
+
+private:
+    unsigned long _phaseMs[FETCH_PHASE_COUNT];
+    unsigned long _totalMs;
+    uint64_t _startMs;
+    uint64_t _phaseStartMs;
+    unsigned long _phaseAllowedMs;
+    uint8_t _phase;
+    uint8_t _overrunPhase;
+    bool _totalOverrun;
+    unsigned long _overruns[FETCH_PHASE_COUNT];
+};
+
+#endif // FETCH_BUDGET_H
@@ -0,0 +1,33 @@
+#ifndef FETCH_PHASE_H
+#define FETCH_PHASE_H
+
+#include <stdint.h>
+
+/**
+ * Stage of an API request, as reported by WmataClient
+ *
+ * Kept in the postmortem record, so after a watchdog reset we know
+ * whether the device was stuck on the network or in the parser.
+ */
+enum FetchPhase : uint8_t {
+    FETCH_PHASE_IDLE = 0,     // No request in progress
+    FETCH_PHASE_DNS,          // Resolving the API host
+    FETCH_PHASE_CONNECT,      // Opening the TCP connection
+    FETCH_PHASE_FIRST_BYTE,   // Sending the request, waiting for the status line
+    FETCH_PHASE_BODY,         // Reading the response body
+    FETCH_PHASE_PARSE,        // Parsing the JSON
+    FETCH_PHASE_COUNT
+};
+
+/**
+ * Get the name of a fetch phase
+ *
+ * :param uint8_t phase: FetchPhase value
+ * :return const char*: Lowercase name, "unknown" if out of range
+ */
+inline const char* fetchPhaseName(uint8_t phase) {
+    static const char* const NAMES[FETCH_PHASE_COUNT] = {"idle", "dns", "connect", "first_byte", "body", "parse"};
+    return phase < FETCH_PHASE_COUNT ? NAMES[phase] : "unknown";
+}
+
+#endif // FETCH_PHASE_H
@@ -0,0 +1,139 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bytes of raw PNG scanline data for a frame: a filter byte plus RGB per row
+ */
+#define FRAME_PNG_RAW_SIZE(width, height) ((size_t)(height) * (1 + 3 * (size_t)(width)))
+
+/**
+ * Exact size of encodeFramePng() output: signature, IHDR, IEND, the zlib
+ * wrapper and one 5-byte header per stored deflate block of up to 65535 bytes
+ */
+#define FRAME_PNG_SIZE(width, height) \
+    (63 + FRAME_PNG_RAW_SIZE(width, height) + 5 * (FRAME_PNG_RAW_SIZE(width, height) / 65535 + 1))
+
+/**
+ * Worst-case size of encodeFrameRle() output (every pixel its own run)
+ */
+#define FRAME_RLE_MAX_SIZE(width, height) (7 + 3 * (size_t)(width) * (size_t)(height))
+
+/**
+ * Shadow copy of what is on the panel, in RGB565
+ *
+ * Display mirrors every pixel it draws into one of these, so the frame can
+ * be inspected remotely. Writes are plain memory stores; the content hash
+ * used to detect changes is computed lazily, on the first getHash() after a
+ * write, so nothing extra happens while drawing.
+ *
+ * Example usage:
+ * ```cpp
+ * static uint16_t pixels[64 * 32];
+ * FrameBuffer frame(pixels, 64, 32);
+ * frame.fillRect(0, 22, 64, 10, 0);
+ * uint32_t hash = frame.getHash();
+ * ```
+ */
+class FrameBuffer {
+public:
+    /**
+     * Constructor; the frame starts black
+     *
+     * :param uint16_t* pixels: Storage for width * height pixels, row-major
+     * :param uint16_t width: Frame width in pixels
+     * :param uint16_t height: Frame height in pixels
+     */
+    FrameBuffer(uint16_t* pixels, uint16_t width, uint16_t height);
+
+    /**
+     * Fill the whole frame with one color
+     *
+     * :param uint16_t color: RGB565 color
+     */
+    void fill(uint16_t color);
+
+    /**
+     * Fill a rectangle, clipped to the frame
+     *
+     * :param int x: Left edge
+     * :param int y: Top edge
+     * :param int w: Width
+     * :param int h: Height
+     * :param uint16_t color: RGB565 color
+     */
+    void fillRect(int x, int y, int w, int h, uint16_t color);
+
+    /**
+     * Set one pixel; pixels outside the frame are ignored
+     *
+     * :param int x: Column
+     * :param int y: Row
+     * :param uint16_t color: RGB565 color
+     */
+    void setPixel(int x, int y, uint16_t color);
+
+    /**
+     * Get one pixel
+     *
+     * :param int x: Column
+     * :param int y: Row
+     * :return uint16_t: RGB565 color (0 outside the frame)
+     */
+    uint16_t getPixel(int x, int y) const;
+
+    /**
+     * Get the frame size
+     */
+    uint16_t getWidth() const;
+    uint16_t getHeight() const;
+
+    /**
+     * Get a hash of the frame contents
+     *
+     * Two identical frames have the same hash, however they were drawn.
+     *
+     * :return uint32_t: FNV-1a hash of the pixels
+     */
+    uint32_t getHash() const;
+
+private:
+    uint16_t* _pixels;
+    uint16_t _width;
+    uint16_t _height;
+    mutable uint32_t _hash;
+    mutable bool _hashValid;
+};
+
+/**
+ * Encode a frame as run-length encoded RGB565
+ *
+ * Layout (integers little-endian):
+ *   0  'F' 'R'        magic
+ *   2  u8 version (1)
+ *   3  u16 width, u16 height
+ *   7  runs, row-major: u8 count (1-255), u16 color
+ *
+ * :param const FrameBuffer& frame: Frame to encode
+ * :param uint8_t* buffer: Output buffer
+ * :param size_t bufferSize: Size of output buffer (FRAME_RLE_MAX_SIZE is always enough)
+ * :return size_t: Encoded length, or 0 if the buffer is too small
+ */
+size_t encodeFrameRle(const FrameBuffer& frame, uint8_t* buffer, size_t bufferSize);
+
+/**
+ * Encode a frame as an 8-bit RGB PNG a browser can show directly
+ *
+ * The image data uses stored (uncompressed) deflate blocks, so no
+ * compression library is needed and the cost is one pass over the pixels.
+ *
+ * :param const FrameBuffer& frame: Frame to encode
+ * :param uint8_t* buffer: Output buffer
+ * :param size_t bufferSize: Size of output buffer (needs FRAME_PNG_SIZE)
+ * :return size_t: Encoded length, or 0 if the buffer is too small
+ */
+size_t encodeFramePng(const FrameBuffer& frame, uint8_t* buffer, size_t bufferSize);
+
+#endif // FRAME_BUFFER_H
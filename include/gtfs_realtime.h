@@ -0,0 +1,253 @@
+#ifndef GTFS_REALTIME_H
+#define GTFS_REALTIME_H
+
+#include "prediction_provider.h"
+
+/**
+ * Longest stop or route ID compared (including terminator); longer IDs in
+ * the feed never match
+ */
+#define GTFS_RT_ID_MAX_LEN 32
+
+/**
+ * Deepest message nesting followed; FeedMessage > FeedEntity > TripUpdate >
+ * StopTimeUpdate > StopTimeEvent is 5
+ */
+#define GTFS_RT_MAX_DEPTH 6
+
+/**
+ * Most arrivals kept from one feed (the soonest win)
+ */
+#define GTFS_RT_MAX_ARRIVALS 16
+
+/**
+ * How long a train is shown as boarding after its arrival time when the
+ * feed gives no departure time (in seconds)
+ */
+#define GTFS_RT_DWELL_SEC 30
+
+/**
+ * How a GTFS route appears on the panel
+ */
+struct GtfsRtRoute {
+    const char* routeId;          // route_id in the feed
+    const char* line;             // Line code shown, e.g. "RD"
+    const char* destinations[2];  // Destination shown for direction_id 0 and 1
+};
+
+/**
+ * Predictions from a GTFS-realtime TripUpdates feed (protobuf)
+ *
+ * The feed is decoded as it streams in by a small protobuf state machine:
+ * only the fields a panel needs are looked at (header timestamp, each
+ * trip's route and direction, and the arrival and departure times at the
+ * configured stops), and everything else is skipped byte by byte. Memory is
+ * fixed no matter how big the feed is, and no message is ever held whole,
+ * so a whole agency's feed can be read on the ESP32.
+ *
+ * A trip becomes one TrainObservation for the first configured stop it
+ * serves: the line and destination come from its route's GtfsRtRoute
+ * (unknown routes show the route_id and no destination), the track group
+ * is direction_id + 1, and the ETA is the stop's arrival time (or departure
+ * time) against the wall clock, or the feed's own timestamp until NTP has
+ * set the clock. Trips that end at the stop, skipped stops and cancelled
+ * trips are left out.
+ *
+ * Example usage:
+ * ```cpp
+ * static const char* const STOPS[] = {"PF_B35_C"};
+ * static const GtfsRtRoute ROUTES[] = {{"RED", "RD", {"Glen", "Shad"}}};
+ * GtfsRtProvider provider("http://example.com/tripupdates.pb", STOPS, 1, ROUTES, 1);
+ * WmataClient client("B35", WMATA_API_KEY, &governor, &provider);
+ * ```
+ */
+class GtfsRtProvider : public PredictionProvider {
+public:
+    /**
+     * Constructor; nothing is copied, so every argument must outlive the provider
+     *
+     * :param const char* feedUrl: TripUpdates feed URL
+     * :param const char* const* stopIds: stop_ids of the station's platforms
+     * :param int stopCount: Number of stop IDs
+     * :param const GtfsRtRoute* routes: How each route is shown
+     * :param int routeCount: Number of routes
+     */
+    GtfsRtProvider(const char* feedUrl, const char* const* stopIds, int stopCount,
+                   const GtfsRtRoute* routes, int routeCount);
+
+    const char* getName() const override;
+    bool buildUrl(char* url, size_t size) const override;
+    void begin(time_t wallNow) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    bool finish(TrainObservation* observations, int maxCount, int& count, uint32_t& hash) override;
+    const char* getError() const override;
+
+    /**
+     * Get the number of trips seen in the last feed
+     *
+     * :return int: TripUpdate messages decoded
+     */
+    int getTripCount() const;
+
+    /**
+     * Get the feed's own timestamp
+     *
+     * :return time_t: FeedHeader timestamp of the last feed, 0 if none
+     */
+    time_t getFeedTime() const;
+
+private:
+    // Kinds of message being decoded, one per stack level
+    enum MessageKind : uint8_t {
+        MSG_FEED,
+        MSG_HEADER,
+        MSG_ENTITY,
+        MSG_TRIP_UPDATE,
+        MSG_TRIP,
+        MSG_STOP_TIME_UPDATE,
+        MSG_ARRIVAL,
+        MSG_DEPARTURE
+    };
+
+    // What the next bytes are
+    enum ReadState : uint8_t {
+        READ_KEY,
+        READ_VARINT,
+        READ_LENGTH,
+        READ_STRING,
+        READ_SKIP
+    };
+
+    // An arrival at one of the stops
+    struct Arrival {
+        char line[LINE_MAX_LEN];
+        char destination[DEST_MAX_LEN];
+        uint8_t group;
+        int64_t arrivalSec;
+        int64_t departureSec;   // 0 if the feed gives none
+    };
+
+    const char* _feedUrl;
+    const char* const* _stopIds;
+    int _stopCount;
+    const GtfsRtRoute* _routes;
+    int _routeCount;
+
+    // Decoder state
+    ReadState _state;
+    uint32_t _pos;                           // Bytes decoded so far
+    uint32_t _ends[GTFS_RT_MAX_DEPTH];       // Where each open message ends
+    uint8_t _kinds[GTFS_RT_MAX_DEPTH];       // MessageKind of each open message
+    int _depth;
+    uint32_t _field;
+    uint8_t _wireType;
+    uint64_t _varint;
+    uint8_t _shift;
+    uint32_t _remaining;                     // Bytes left in the string or skip
+    char* _string;                           // String field being read
+    uint8_t _stringLength;
+    bool _stringTooLong;
+    const char* _error;
+
+    // Current trip and stop
+    char _routeId[GTFS_RT_ID_MAX_LEN];
+    char _stopId[GTFS_RT_ID_MAX_LEN];
+    uint8_t _directionId;
+    bool _cancelled;
+    bool _stopSkipped;
+    int64_t _stopArrival;
+    int64_t _stopDeparture;
+    bool _hasMatch;
+    bool _tripContinues;                     // A stop follows the matched one
+    int64_t _matchArrival;
+    int64_t _matchDeparture;
+
+    // Results
+    time_t _wallNow;
+    time_t _feedTime;
+    int _tripCount;
+    Arrival _arrivals[GTFS_RT_MAX_ARRIVALS];
+    int _arrivalCount;
+
+    /**
+     * Decode one byte of a key, varint, length or string field
+     *
+     * :param uint8_t byte: Next body byte
+     * :return bool: False once the feed is found to be malformed
+     */
+    bool _decodeByte(uint8_t byte);
+
+    /**
+     * Handle a field key: note the field and what its value looks like
+     *
+     * :param uint64_t key: Field number << 3 | wire type
+     * :return bool: False for an invalid key
+     */
+    bool _onKey(uint64_t key);
+
+    /**
+     * Handle a varint field of the message being decoded
+     *
+     * :param uint64_t value: Field value
+     */
+    void _onVarint(uint64_t value);
+
+    /**
+     * Handle a length-delimited field: open it as a message, read it as an
+     * ID, or skip it
+     *
+     * :param uint64_t length: Field length in bytes
+     * :return bool: False if the field runs past its message
+     */
+    bool _onLength(uint64_t length);
+
+    /**
+     * Open a nested message
+     *
+     * :param uint8_t kind: MessageKind
+     * :param uint32_t length: Message length in bytes
+     */
+    void _push(uint8_t kind, uint32_t length);
+
+    /**
+     * Close every message that ends at the current position
+     */
+    void _popFinished();
+
+    /**
+     * Reset the trip or stop state when a message opens
+     *
+     * :param uint8_t kind: MessageKind
+     */
+    void _onStart(uint8_t kind);
+
+    /**
+     * Act on a message that was fully decoded
+     *
+     * :param uint8_t kind: MessageKind
+     */
+    void _onEnd(uint8_t kind);
+
+    /**
+     * Keep the current trip's arrival at the station
+     */
+    void _addArrival();
+
+    /**
+     * Check whether a stop is one of the station's
+     *
+     * :param const char* stopId: stop_id from the feed
+     * :return bool: True if configured
+     */
+    bool _isStop(const char* stopId) const;
+
+    /**
+     * Record the first decoding error
+     *
+     * :param const char* error: What went wrong
+     * :return bool: Always false
+     */
+    bool _fail(const char* error);
+};
+
+#endif // GTFS_REALTIME_H
@@ -0,0 +1,105 @@
+#ifndef HANG_MONITOR_H
+#define HANG_MONITOR_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * What the watchdog should do about a request that has not finished
+ */
+enum HangAction {
+    HANG_NONE,       // Nothing in progress, or still within limits
+    HANG_RECOVER,    // Stuck: tear down the connection so the request fails
+    HANG_RESET_NETWORK,  // Still stuck: reset the Wi-Fi connection
+    HANG_RESTART     // Still stuck after that: restart the device
+};
+
+/**
+ * Software watchdog for blocking network requests
+ *
+ * The fetching task arms the monitor when a request starts and disarms it
+ * when the request ends. A separate, higher-priority task calls check()
+ * periodically. If a request is still running after recoverAfterMs, check()
+ * returns HANG_RECOVER once, so the watchdog can abort the socket and let
+ * the request fail like any other network error; the display keeps
+ * running. If a network reset stage is given and the request is still
+ * running after resetNetworkAfterMs, check() returns HANG_RESET_NETWORK
+ * once, for a Wi-Fi reconnect that still spares the display. If it is
+ * still running after restartAfterMs, check() returns HANG_RESTART once,
+ * as a last resort.
+ *
+ * arm() and disarm() may be called from one task while check() runs in
+ * another.
+ *
+ * Example usage:
+ * ```cpp
+ * HangMonitor monitor(15000, 60000, 30000);
+ * monitor.arm(monoMillis());           // Fetching task
+ * http.GET();
+ * monitor.disarm();
+ *
+ * switch (monitor.check(monoMillis())) {  // Watchdog task
+ *     case HANG_RECOVER: client.abortRequest(); break;
+ *     case HANG_RESET_NETWORK: WiFi.reconnect(); break;
+ *     case HANG_RESTART: ESP.restart(); break;
+ *     default: break;
+ * }
+ * ```
+ */
+class HangMonitor {
+public:
+    /**
+     * Constructor
+     *
+     * :param unsigned long recoverAfterMs: Request age at which to abort it
+     * :param unsigned long restartAfterMs: Request age at which to restart
+     * :param unsigned long resetNetworkAfterMs: Request age at which to reset the
+     *     network (0 to go straight from recovery to restart)
+     */
+    HangMonitor(unsigned long recoverAfterMs, unsigned long restartAfterMs, unsigned long resetNetworkAfterMs = 0);
+
+    /**
+     * Start watching a request
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void arm(uint64_t nowMs);
+
+    /**
+     * Stop watching; the request finished
+     */
+    void disarm();
+
+    /**
+     * Check whether a request is being watched
+     */
+    bool isArmed() const;
+
+    /**
+     * Decide what to do about the request being watched
+     *
+     * Each action is returned at most once per request.
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return HangAction: Action to take
+     */
+    HangAction check(uint64_t nowMs);
+
+    /**
+     * Get how many requests were aborted as hung
+     *
+     * :return unsigned long: Recoveries since boot
+     */
+    unsigned long getRecoveryCount() const;
+
+private:
+    unsigned long _recoverAfterMs;
+    unsigned long _restartAfterMs;
+    unsigned long _resetNetworkAfterMs;
+    std::atomic<bool> _armed;
+    std::atomic<uint64_t> _armedAt;
+    std::atomic<uint8_t> _stage;          // Actions already taken for this request
+    std::atomic<unsigned long> _recoveries;
+};
+
+#endif // HANG_MONITOR_H
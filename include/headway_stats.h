@@ -0,0 +1,152 @@
+#ifndef HEADWAY_STATS_H
+#define HEADWAY_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "train_tracker.h"
+
+/**
+ * Number of (line, group) streams tracked; the least recently used is
+ * recycled when a new one appears
+ */
+#define HEADWAY_MAX_STREAMS 6
+
+/**
+ * Headways kept per stream (rolling window)
+ */
+#define HEADWAY_WINDOW 32
+
+/**
+ * Histogram bin width (seconds) and bin count for percentile queries;
+ * the last bin also collects everything longer
+ */
+#define HEADWAY_BIN_SEC 30
+#define HEADWAY_BINS 60
+
+/**
+ * Gaps longer than this (seconds) are service breaks, not headways
+ */
+#define HEADWAY_MAX_SEC 3600
+
+/**
+ * Headways needed before percentiles and gap alerts are reported
+ */
+#define HEADWAY_MIN_SAMPLES 4
+
+/**
+ * A gap alert is raised when the time since the last departure exceeds
+ * the 90th percentile headway by this factor (as a fraction)
+ */
+#define HEADWAY_GAP_FACTOR_NUM 3
+#define HEADWAY_GAP_FACTOR_DEN 2
+
+/**
+ * Upper bound on the statistics' memory, checked at compile time
+ */
+#define HEADWAY_MEMORY_CEILING 1024
+
+/**
+ * Snapshot of one stream's rolling statistics
+ */
+struct HeadwaySummary {
+    char line[LINE_MAX_LEN];
+    uint8_t group;
+    uint8_t samples;         // Headways in the window
+    uint16_t meanSec;        // Mean headway
+    uint16_t p50Sec;         // Median headway (0 until HEADWAY_MIN_SAMPLES)
+    uint16_t p90Sec;         // 90th percentile headway (0 until HEADWAY_MIN_SAMPLES)
+    uint32_t sinceLastSec;   // Time since the last departure
+    bool gapAlert;           // Current gap is unusually long
+};
+
+/**
+ * Rolling headway and reliability statistics per line and direction
+ * 
+ * Departures (a tracked train going BRD -> gone) are recorded per
+ * (line, group). Each stream keeps a fixed ring of headways plus a running
+ * sum and a coarse histogram, both updated incrementally as headways enter
+ * and leave the window, so adding a departure and querying mean or
+ * percentiles cost the same no matter how long the device has been up.
+ * 
+ * Example usage:
+ * ```cpp
+ * HeadwayStats stats;
+ * stats.recordDeparture("RD", 1, monoMillis());
+ * HeadwaySummary summary;
+ * if (stats.getSummary(0, monoMillis(), summary)) {
+ *     Serial.printf("RD%d mean %u s\n", summary.group, summary.meanSec);
+ * }
+ * ```
+ */
+class HeadwayStats {
+public:
+    HeadwayStats();
+    
+    /**
+     * Forget all streams
+     */
+    void reset();
+    
+    /**
+     * Record a departure and update the stream's rolling statistics
+     * 
+     * :param const char* line: Line code (RD, BL, etc.)
+     * :param uint8_t group: Track group
+     * :param uint64_t nowMs: monoMillis() when the train left
+     */
+    void recordDeparture(const char* line, uint8_t group, uint64_t nowMs);
+    
+    /**
+     * Get the number of streams with at least one departure
+     * 
+     * :return int: Stream count (0 to HEADWAY_MAX_STREAMS)
+     */
+    int getStreamCount() const;
+    
+    /**
+     * Get a stream's statistics
+     * 
+     * :param int index: Stream index from 0 to getStreamCount() - 1
+     * :param uint64_t nowMs: Current monoMillis() value (for gap detection)
+     * :param HeadwaySummary& summary: Output statistics
+     * :return bool: False if the index is out of range
+     */
+    bool getSummary(int index, uint64_t nowMs, HeadwaySummary& summary) const;
+    
+    /**
+     * Write a one-line-per-stream text report (for serial or HTTP)
+     * 
+     * Format per stream: "RD1 n=12 mean=360 p50=330 p90=540 last=120 GAP\n"
+     * 
+     * :param char* buffer: Output buffer
+     * :param size_t bufferSize: Size of the output buffer
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return size_t: Characters written (excluding the terminator)
+     */
+    size_t formatReport(char* buffer, size_t bufferSize, uint64_t nowMs) const;
+
+private:
+    /**
+     * Ring of headways for one (line, group), with incremental aggregates
+     */
+    struct Stream {
+        char line[LINE_MAX_LEN];
+        uint8_t group;
+        uint8_t count;                      // Headways in the ring
+        uint8_t head;                       // Next slot to write
+        bool hasDeparture;
+        uint32_t lastDepartureMs;
+        uint32_t lastUsedMs;                // For least-recently-used recycling
+        uint32_t sumSec;                    // Sum of headways in the ring
+        uint16_t headways[HEADWAY_WINDOW];  // Seconds
+        uint8_t histogram[HEADWAY_BINS];    // Count of ring headways per bin
+    };
+    
+    Stream _streams[HEADWAY_MAX_STREAMS];
+    int _streamCount;
+    
+    Stream& _findOrCreate(const char* line, uint8_t group, uint64_t nowMs);
+    static uint16_t _percentile(const Stream& stream, int percent);
+};
+
+#endif // HEADWAY_STATS_H
@@ -0,0 +1,99 @@
+#ifndef HEAP_WATERMARKS_H
+#define HEAP_WATERMARKS_H
+
+#include <stdint.h>
+#include "buffer_writer.h"
+
+/**
+ * Most steps whose heap use is tracked
+ */
+#define HEAP_MAX_STEPS 12
+
+/**
+ * Heap state at one moment
+ */
+struct HeapSample {
+    uint32_t freeBytes;     // Free heap now
+    uint32_t minFreeBytes;  // Lowest free heap since boot
+};
+
+/**
+ * Heap use of one step (e.g. display init, a predictions fetch)
+ */
+struct HeapStep {
+    const char* name;
+    unsigned long runs;
+    int32_t heldBytes;    // Still allocated after the last run (negative if it freed more than it took)
+    uint32_t peakBytes;   // Most the step was seen to take at once, over all runs
+};
+
+/**
+ * Heap high-water marks per step, from samples taken around each step
+ *
+ * The heap only reports how much is free now and the lowest it has been
+ * since boot, so a step's peak is only seen when it sets a new low. Each
+ * new low is charged to the step that caused it: the steps that brought
+ * the heap closest to running out show up with their peaks, and the others
+ * show at least what they kept.
+ *
+ * Names are kept as pointers, so they must be string literals.
+ *
+ * Example usage:
+ * ```cpp
+ * HeapWatermarks heap;
+ * HeapSample before = {ESP.getFreeHeap(), ESP.getMinFreeHeap()};
+ * display.init();
+ * HeapSample after = {ESP.getFreeHeap(), ESP.getMinFreeHeap()};
+ * heap.record("display", before, after);
+ * ```
+ */
+class HeapWatermarks {
+public:
+    HeapWatermarks();
+
+    /**
+     * Record one run of a step
+     *
+     * :param const char* name: Step name (a string literal)
+     * :param const HeapSample& before: Heap just before the step
+     * :param const HeapSample& after: Heap just after it
+     * :return bool: False if the table is full and the step is new
+     */
+    bool record(const char* name, const HeapSample& before, const HeapSample& after);
+
+    /**
+     * Get the number of steps recorded
+     */
+    int getCount() const;
+
+    /**
+     * Get a step, in the order they were first recorded
+     *
+     * :param int index: Step index (0 to getCount() - 1)
+     * :return const HeapStep&: The step
+     */
+    const HeapStep& getStep(int index) const;
+
+    /**
+     * Find a step by name
+     *
+     * :param const char* name: Step name
+     * :return const HeapStep*: The step, or nullptr if it hasn't run
+     */
+    const HeapStep* find(const char* name) const;
+
+    /**
+     * Write one line per step: "display: peak 61440, held 61440 bytes (1 run)"
+     *
+     * :param BufferWriter& out: Output
+     */
+    void format(BufferWriter& out) const;
+
+private:
+    HeapStep _steps[HEAP_MAX_STEPS];
+    int _count;
+
+    int _indexOf(const char* name) const;
+};
+
+#endif // HEAP_WATERMARKS_H
@@ -0,0 +1,97 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * Number of finite histogram buckets; one more catches everything slower
+ */
+#define LATENCY_BUCKET_COUNT 10
+
+/**
+ * Fixed-bucket histogram of request latencies
+ *
+ * Buckets run from 50 ms to 10 s, which covers a good fetch on a strong
+ * signal through a slow one just inside the HTTP timeout. Memory is
+ * constant however many samples are recorded. Percentiles are estimated by
+ * interpolating within a bucket; the exact counts are exported so a
+ * dashboard can compute its own across a fleet.
+ *
+ * Example usage:
+ * ```cpp
+ * LatencyHistogram latency;
+ * latency.record(monoMillis() - start);
+ * Serial.printf("p90 %lu ms\n", latency.estimatePercentile(90));
+ * ```
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    /**
+     * Forget every sample
+     */
+    void reset();
+
+    /**
+     * Record one latency
+     *
+     * :param unsigned long latencyMs: Latency in milliseconds
+     */
+    void record(unsigned long latencyMs);
+
+    /**
+     * Get the number of samples recorded
+     *
+     * :return unsigned long: Sample count
+     */
+    unsigned long getCount() const;
+
+    /**
+     * Get the sum of all recorded latencies
+     *
+     * :return uint64_t: Sum in milliseconds
+     */
+    uint64_t getSumMs() const;
+
+    /**
+     * Get the largest latency recorded
+     *
+     * :return unsigned long: Maximum in milliseconds (0 if none)
+     */
+    unsigned long getMaxMs() const;
+
+    /**
+     * Get the number of samples in one bucket (not cumulative)
+     *
+     * :param int bucket: 0 to LATENCY_BUCKET_COUNT; the last is the overflow bucket
+     * :return unsigned long: Samples in the bucket
+     */
+    unsigned long getBucketCount(int bucket) const;
+
+    /**
+     * Get the inclusive upper bound of a finite bucket
+     *
+     * :param int bucket: 0 to LATENCY_BUCKET_COUNT - 1
+     * :return unsigned long: Upper bound in milliseconds
+     */
+    static unsigned long getBucketBound(int bucket);
+
+    /**
+     * Estimate a percentile by linear interpolation within its bucket
+     *
+     * Samples past the last bound are placed between it and the maximum seen.
+     *
+     * :param int percent: Percentile, 1-100
+     * :return unsigned long: Estimated latency in milliseconds (0 if no samples)
+     */
+    unsigned long estimatePercentile(int percent) const;
+
+private:
+    unsigned long _buckets[LATENCY_BUCKET_COUNT + 1];
+    unsigned long _count;
+    uint64_t _sumMs;
+    unsigned long _maxMs;
+};
+
+#endif // LATENCY_HISTOGRAM_H
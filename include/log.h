@@ -0,0 +1,120 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "config.h"
+#include "log_ring.h"
+
+class PostmortemLog;
+
+/**
+ * Logging macros
+ *
+ * Each takes a subsystem tag and a printf format (both string literals):
+ * ```cpp
+ * LOG_INFO("WMATA", "Parsed %d predictions", count);
+ * ```
+ * Levels above LOG_LEVEL compile to nothing, arguments included. Enabled
+ * calls only copy their arguments into a ring buffer; a low-priority task
+ * formats them and writes them to Serial, so the loop never waits on the
+ * UART.
+ */
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(tag, ...) logWrite(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOG_ERROR(tag, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(tag, ...) logWrite(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOG_WARN(tag, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(tag, ...) logWrite(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOG_INFO(tag, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(tag, ...) logWrite(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOG_DEBUG(tag, ...) do {} while (0)
+#endif
+
+/**
+ * Start the task that drains the log ring to Serial
+ *
+ * Call once, after Serial.begin(). Records logged before this are kept in
+ * the ring and printed once the task starts.
+ *
+ * :return bool: True if the task was created
+ */
+bool logBegin();
+
+/**
+ * Register a secret (API key, password) to be redacted from every line
+ *
+ * Call again after changing the secret in place, in case it was too short
+ * to register before.
+ *
+ * :param const char* secret: Secret text (must stay valid for the program's lifetime)
+ */
+void logRedact(const char* secret);
+
+/**
+ * Change the most verbose level that is logged, up to the compiled LOG_LEVEL
+ *
+ * Calls above it return straight away, without touching the ring.
+ *
+ * :param uint8_t level: LOG_LEVEL_*
+ */
+void logSetLevel(uint8_t level);
+
+/**
+ * Get the most verbose level that is logged
+ *
+ * :return uint8_t: LOG_LEVEL_*
+ */
+uint8_t logGetLevel();
+
+/**
+ * Stop or restart printing, so other output can have the UART
+ *
+ * Records logged meanwhile wait in the ring (or are counted as dropped
+ * once it fills).
+ *
+ * :param bool held: True to stop printing, false to carry on
+ */
+void logHold(bool held);
+
+/**
+ * Also copy every printed line into a reset-surviving postmortem log
+ *
+ * Lines tagged POSTMORTEM_LOG_TAG are not copied.
+ *
+ * :param PostmortemLog* postmortem: Postmortem log, or nullptr to stop
+ */
+void logSetPostmortem(PostmortemLog* postmortem);
+
+/**
+ * Append a record; use the LOG_* macros instead
+ */
+void logWrite(uint8_t level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * Print everything still in the ring, from the calling task
+ *
+ * For use before a deliberate restart, when the flush task may not get
+ * another chance to run.
+ */
+void logFlush();
+
+/**
+ * Get the number of records dropped because the ring was full
+ *
+ * :return unsigned long: Dropped records since boot
+ */
+unsigned long logGetDroppedCount();
+
+#endif // LOG_H
@@ -0,0 +1,151 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Log levels, most severe first
+ */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+/**
+ * Size of the record ring (bytes); must be a power of two
+ */
+#define LOG_RING_SIZE 8192
+
+/**
+ * Largest single record (bytes); long string arguments are cut to fit
+ */
+#define LOG_RECORD_MAX 512
+
+/**
+ * Maximum number of secrets redacted from formatted lines
+ */
+#define LOG_MAX_SECRETS 4
+
+/**
+ * Text written in place of a secret
+ */
+#define LOG_REDACTED "***"
+
+/**
+ * Metadata of a record read back from the ring
+ */
+struct LogEntry {
+    uint8_t level;            // LOG_LEVEL_*
+    uint32_t timestampMs;     // monoMillis() when the record was written (low 32 bits)
+    const char* tag;          // Subsystem tag, e.g. "WMATA"
+};
+
+/**
+ * Lock-free ring of binary log records with deferred formatting
+ *
+ * write() stores only the format string pointer and the raw argument values
+ * (strings are copied, since they may not outlive the call), so logging
+ * costs a few memcpy()s on the caller's path. readNext() does the printf
+ * formatting and secret redaction later, on the consumer's time.
+ *
+ * One producer and one consumer at a time: writers from several tasks
+ * must take a lock (logWrite() does), and a low-priority task reads. When the ring is full, new records are dropped and counted
+ * rather than blocking the writer.
+ *
+ * Format strings and tags must be string literals (or otherwise outlive the
+ * record). Supported conversions are those of printf except %n; width and
+ * precision may be given with *.
+ *
+ * Example usage:
+ * ```cpp
+ * LogRing ring;
+ * ring.addSecret(apiKey);
+ * ring.write(LOG_LEVEL_INFO, "WMATA", (uint32_t)monoMillis(), "Fetched %d trains from %s", args);
+ * char line[256];
+ * LogEntry entry;
+ * while (ring.readNext(line, sizeof(line), entry)) { Serial.println(line); }
+ * ```
+ */
+class LogRing {
+public:
+    LogRing();
+
+    /**
+     * Register a secret to be replaced by LOG_REDACTED in formatted lines
+     *
+     * Secrets shorter than 4 characters are ignored. The buffer is read at
+     * each format, so a secret can be changed in place; adding the same
+     * buffer again is a no-op.
+     *
+     * :param const char* secret: Secret text (must outlive the ring)
+     * :return bool: True if registered
+     */
+    bool addSecret(const char* secret);
+
+    /**
+     * Append a record
+     *
+     * :param uint8_t level: LOG_LEVEL_*
+     * :param const char* tag: Subsystem tag (string literal)
+     * :param uint32_t timestampMs: Current monoMillis() value (low 32 bits)
+     * :param const char* format: printf format (string literal)
+     * :param va_list args: Format arguments
+     * :return bool: False if the ring was full and the record was dropped
+     */
+    bool write(uint8_t level, const char* tag, uint32_t timestampMs, const char* format, va_list args);
+
+    /**
+     * Format and remove the oldest record
+     *
+     * :param char* out: Output buffer for the message text (null-terminated)
+     * :param size_t outSize: Size of output buffer; longer messages are cut off
+     * :param LogEntry& entry: Output record metadata
+     * :return bool: False if the ring is empty
+     */
+    bool readNext(char* out, size_t outSize, LogEntry& entry);
+
+    /**
+     * Get the number of records dropped because the ring was full
+     *
+     * :return unsigned long: Dropped records since construction
+     */
+    unsigned long getDroppedCount() const;
+
+    /**
+     * Replace every registered secret in a string, in place
+     *
+     * :param char* text: Null-terminated text
+     * :param size_t size: Size of the text's buffer
+     */
+    void redact(char* text, size_t size) const;
+
+private:
+    uint8_t _data[LOG_RING_SIZE];
+    std::atomic<uint32_t> _head;      // Total bytes written (producer)
+    std::atomic<uint32_t> _tail;      // Total bytes consumed (consumer)
+    std::atomic<unsigned long> _dropped;
+    const char* _secrets[LOG_MAX_SECRETS];
+    int _secretCount;
+};
+
+/**
+ * Get the one-letter name of a log level
+ *
+ * :param uint8_t level: LOG_LEVEL_*
+ * :return char: 'E', 'W', 'I' or 'D'
+ */
+char logLevelLetter(uint8_t level);
+
+/**
+ * Parse a log level name
+ *
+ * :param const char* name: "none", "error", "warn", "info" or "debug"
+ * :return int: LOG_LEVEL_*, or -1 for anything else
+ */
+int parseLogLevel(const char* name);
+
+#endif // LOG_RING_H
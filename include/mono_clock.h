@@ -0,0 +1,112 @@
+#ifndef MONO_CLOCK_H
+#define MONO_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Read a monotonic time source
+ *
+ * :param void* context: Context given to setClockSource()
+ * :return uint64_t: Microseconds since an arbitrary start; never goes backwards
+ */
+typedef uint64_t (*ClockSource)(void* context);
+
+/**
+ * Replace the time source behind monoMicros() and monoMillis()
+ *
+ * Meant for tests and simulations; the firmware never calls it.
+ *
+ * :param ClockSource source: New time source, nullptr for the system clock
+ * :param void* context: Passed back to the source
+ */
+void setClockSource(ClockSource source, void* context = nullptr);
+
+/**
+ * Get monotonic time in microseconds
+ *
+ * On the device this is esp_timer's 64-bit count since boot; natively it
+ * is the host's steady clock. 64 bits of microseconds outlast any panel,
+ * where the 32-bit millis() wraps after 49.7 days, and unlike the wall
+ * clock it is never stepped by NTP.
+ *
+ * :return uint64_t: Microseconds since boot
+ */
+uint64_t monoMicros();
+
+/**
+ * Get monotonic time in milliseconds
+ *
+ * All timing, scheduling and relative-time code takes its "now" from here
+ * and keeps timestamps as uint64_t, so nothing wraps while a panel is up.
+ *
+ * :return uint64_t: Milliseconds since boot
+ */
+uint64_t monoMillis();
+
+/**
+ * Clock that only moves when told to
+ *
+ * Lets tests run hours or weeks of operation in a few milliseconds, either
+ * by passing nowMs() into a module directly or by installing the fake as
+ * the clock source so monoMillis() reads it.
+ *
+ * Example usage:
+ * ```cpp
+ * FakeClock clock(0xFFFFFFF0UL);   // Just before millis() would wrap
+ * clock.install();
+ * carousel.update(monoMillis(), available);
+ * clock.advanceMs(10000);
+ * carousel.update(monoMillis(), available);
+ * clock.uninstall();
+ * ```
+ */
+class FakeClock {
+public:
+    /**
+     * Constructor
+     *
+     * :param uint64_t startMs: Initial time in milliseconds
+     */
+    explicit FakeClock(uint64_t startMs = 0);
+
+    /**
+     * Make this clock the source of monoMicros() and monoMillis()
+     */
+    void install();
+
+    /**
+     * Go back to the system clock
+     */
+    void uninstall();
+
+    /**
+     * Set the time
+     *
+     * :param uint64_t nowMs: New time in milliseconds (may not go backwards)
+     */
+    void setMs(uint64_t nowMs);
+
+    /**
+     * Move time forward
+     *
+     * :param uint64_t deltaMs: Milliseconds to add
+     */
+    void advanceMs(uint64_t deltaMs);
+
+    /**
+     * Move time forward
+     *
+     * :param uint64_t deltaUs: Microseconds to add
+     */
+    void advanceUs(uint64_t deltaUs);
+
+    uint64_t nowUs() const;
+    uint64_t nowMs() const;
+
+private:
+    uint64_t _nowUs;
+
+    static uint64_t _read(void* context);
+};
+
+#endif // MONO_CLOCK_H
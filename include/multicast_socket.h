@@ -0,0 +1,74 @@
+#ifndef MULTICAST_SOCKET_H
+#define MULTICAST_SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Non-blocking UDP multicast socket on plain BSD sockets
+ *
+ * Joins a group, sends datagrams to it and receives datagrams from it.
+ * The TTL is 1, so snapshots never leave the local network. Loopback is
+ * left on, so a sender also receives its own datagrams; callers filter by
+ * sender id. Runs on the ESP32 (lwIP with IGMP) and on Linux for tests.
+ *
+ * Example usage:
+ * ```cpp
+ * MulticastSocket socket;
+ * socket.begin("239.255.43.21", 43210);
+ * socket.send(packet, length);
+ * int received = socket.receive(buffer, sizeof(buffer));  // -1 if none waiting
+ * ```
+ */
+class MulticastSocket {
+public:
+    MulticastSocket();
+    ~MulticastSocket();
+
+    /**
+     * Open the socket and join the group
+     *
+     * :param const char* group: Multicast group address, e.g. "239.255.43.21"
+     * :param uint16_t port: UDP port
+     * :param const char* interfaceAddr: Local interface address ("0.0.0.0" for the default)
+     * :return bool: True if the group was joined
+     */
+    bool begin(const char* group, uint16_t port, const char* interfaceAddr = "0.0.0.0");
+
+    /**
+     * Leave the group and close the socket
+     */
+    void stop();
+
+    /**
+     * Send a datagram to the group
+     *
+     * :param const uint8_t* data: Datagram contents
+     * :param size_t length: Datagram length
+     * :return bool: True if sent
+     */
+    bool send(const uint8_t* data, size_t length);
+
+    /**
+     * Receive one waiting datagram, if any
+     *
+     * :param uint8_t* buffer: Output buffer
+     * :param size_t size: Size of output buffer; longer datagrams are cut off
+     * :return int: Datagram length, or -1 if nothing is waiting
+     */
+    int receive(uint8_t* buffer, size_t size);
+
+    /**
+     * Check whether the socket is open
+     *
+     * :return bool: True after a successful begin()
+     */
+    bool isOpen() const;
+
+private:
+    int _fd;
+    uint32_t _group;     // Network byte order
+    uint16_t _port;
+};
+
+#endif // MULTICAST_SOCKET_H
@@ -0,0 +1,124 @@
+#ifndef PAGE_CAROUSEL_H
+#define PAGE_CAROUSEL_H
+
+#include <stdint.h>
+
+/**
+ * Most pages a carousel can hold
+ */
+#define CAROUSEL_MAX_PAGES 8
+
+/**
+ * What a page shows
+ */
+enum PageKind : uint8_t {
+    PAGE_SUMMARY,    // Next train in each direction, last update / advisory row
+    PAGE_GROUP,      // Next few trains in one direction
+    PAGE_CLOCK,      // Time of day
+    PAGE_ADVISORY,   // Incidents affecting the station, one per row
+    PAGE_HEADWAYS,   // Headway statistics
+    PAGE_BUS         // Next few buses at one bus stop
+};
+
+/**
+ * One entry of the page rotation
+ */
+struct CarouselPage {
+    uint8_t kind;              // PageKind
+    uint8_t group;             // Track group for PAGE_GROUP, stop number (from 1) for PAGE_BUS
+    unsigned long durationMs;  // How long the page stays up; 0 disables it
+};
+
+/**
+ * Cycles through a fixed list of pages
+ *
+ * Each page stays up for its duration, then the next page with something
+ * to show takes over. What is available is passed in on every update as a
+ * bitmask (bit i for page i), so an advisory page only appears while there
+ * are incidents, a direction's page only while it has trains, and so on.
+ * If the page on screen runs out of content it is left straight away.
+ * When only one page is available it simply stays up.
+ *
+ * The carousel only decides which page is up; the caller draws it, and
+ * redraws only when update() reports a change or the content changes.
+ *
+ * All times are monoMillis() values.
+ *
+ * Example usage:
+ * ```cpp
+ * static const CarouselPage PAGES[] = {
+ *     {PAGE_SUMMARY, 0, 10000},
+ *     {PAGE_GROUP, 1, 5000},
+ *     {PAGE_GROUP, 2, 5000},
+ * };
+ * PageCarousel carousel(PAGES, 3);
+ * if (carousel.update(monoMillis(), available)) {
+ *     drawPage(carousel.getPage());
+ * }
+ * ```
+ */
+class PageCarousel {
+public:
+    /**
+     * Constructor
+     *
+     * :param const CarouselPage* pages: Page rotation (copied; extra pages beyond CAROUSEL_MAX_PAGES are ignored)
+     * :param int count: Number of pages
+     */
+    PageCarousel(const CarouselPage* pages, int count);
+
+    /**
+     * Advance to the next page when the current one's time is up or it has
+     * nothing left to show
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param uint32_t available: Bit i set if page i has something to show
+     * :return bool: True if a different page is now up (including the first)
+     */
+    bool update(uint64_t nowMs, uint32_t available);
+
+    /**
+     * Go back to the first available page on the next update()
+     */
+    void reset();
+
+    /**
+     * Put a page up now; it stays for its full duration, then the rotation
+     * carries on from it
+     *
+     * :param int index: Index into the rotation
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param uint32_t available: Bit i set if page i has something to show
+     * :return bool: False if the page doesn't exist or has nothing to show
+     */
+    bool show(int index, uint64_t nowMs, uint32_t available);
+
+    /**
+     * Get the page that is up
+     *
+     * :return const CarouselPage&: Current page (the first page before any update)
+     */
+    const CarouselPage& getPage() const;
+
+    /**
+     * Get the position of the page that is up
+     *
+     * :return int: Index into the rotation, -1 before the first update
+     */
+    int getIndex() const;
+
+    /**
+     * Get the number of pages in the rotation
+     */
+    int getCount() const;
+
+private:
+    CarouselPage _pages[CAROUSEL_MAX_PAGES];
+    int _count;
+    int _current;
+    uint64_t _shownAt;
+
+    bool _isShowable(int index, uint32_t available) const;
+};
+
+#endif // PAGE_CAROUSEL_H
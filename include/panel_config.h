@@ -0,0 +1,151 @@
+#ifndef PANEL_CONFIG_H
+#define PANEL_CONFIG_H
+
+#include <stdint.h>
+#include "config.h"
+
+/**
+ * HUB75 signals, in the order the DMA driver takes them
+ */
+enum PanelPin : uint8_t {
+    PIN_R1, PIN_G1, PIN_B1,
+    PIN_R2, PIN_G2, PIN_B2,
+    PIN_A, PIN_B, PIN_C, PIN_D, PIN_E,
+    PIN_LAT, PIN_OE, PIN_CLK,
+    PANEL_PIN_COUNT
+};
+
+/**
+ * GPIO of each HUB75 signal (-1 for an unused address line)
+ */
+struct PanelPins {
+    int8_t gpio[PANEL_PIN_COUNT];
+};
+
+/**
+ * Check that an ESP32 GPIO can drive a panel signal
+ *
+ * GPIO 6-11 belong to the flash chip, 1 and 3 to the serial console, and
+ * 34-39 are inputs only.
+ *
+ * :param int pin: GPIO number
+ * :return bool: True if the pin can be used
+ */
+constexpr bool isPanelOutputPin(int pin) {
+    return pin >= 0 && pin <= 33 && !(pin >= 6 && pin <= 11) && pin != 1 && pin != 3;
+}
+
+/**
+ * Check whether a signal's pin is used again by a later signal
+ */
+constexpr bool _panelPinRepeated(const PanelPins& pins, int signal, int other) {
+    return other >= PANEL_PIN_COUNT
+        ? false
+        : (pins.gpio[signal] >= 0 && pins.gpio[signal] == pins.gpio[other]) ||
+              _panelPinRepeated(pins, signal, other + 1);
+}
+
+/**
+ * Check that no two signals share a pin
+ *
+ * :param const PanelPins& pins: Pinout
+ * :param int signal: First signal to check (leave out)
+ * :return bool: True if every pin in use is used once
+ */
+constexpr bool panelPinsDistinct(const PanelPins& pins, int signal = 0) {
+    return signal >= PANEL_PIN_COUNT
+        ? true
+        : !_panelPinRepeated(pins, signal, signal + 1) && panelPinsDistinct(pins, signal + 1);
+}
+
+/**
+ * Check that every signal has a usable pin; E may be unused (-1) when the
+ * panel is too short to need it
+ *
+ * :param const PanelPins& pins: Pinout
+ * :param bool needsE: True for panels 64 pixels high (1/32 scan)
+ * :param int signal: First signal to check (leave out)
+ * :return bool: True if all pins can drive the panel
+ */
+constexpr bool panelPinsUsable(const PanelPins& pins, bool needsE, int signal = 0) {
+    return signal >= PANEL_PIN_COUNT
+        ? true
+        : (isPanelOutputPin(pins.gpio[signal]) || (signal == PIN_E && !needsE && pins.gpio[signal] == -1)) &&
+              panelPinsUsable(pins, needsE, signal + 1);
+}
+
+/**
+ * Where the text rows go on a panel of a given size, worked out at compile time
+ *
+ * The layout is drawn for 32-pixel-high panels; a 64-pixel-high panel gets
+ * the same layout at twice the size, with the font doubled. Only those two
+ * heights are accepted, and the panel must be a whole number of 32-pixel
+ * modules wide.
+ *
+ * Example usage:
+ * ```cpp
+ * typedef PanelLayout<64, 32, 1> Layout;
+ * gfx->setTextSize(Layout::TEXT_SIZE);
+ * gfx->setCursor(1, Layout::textY(row));
+ * ```
+ */
+template <uint16_t ResX, uint16_t ResY, uint8_t Chain>
+struct PanelLayout {
+    static_assert(ResY == 32 || ResY == 64, "PANEL_RES_Y must be 32 or 64");
+    static_assert(ResX >= 32 && ResX % 32 == 0, "PANEL_RES_X must be a multiple of 32");
+    static_assert(Chain >= 1, "PANEL_CHAIN must be at least 1");
+
+    /** Size of the whole display (all chained panels) in pixels */
+    static constexpr int16_t WIDTH = ResX * Chain;
+    static constexpr int16_t HEIGHT = ResY;
+
+    /** Font scale: 1 is the 6x8 built-in font */
+    static constexpr uint8_t TEXT_SIZE = ResY / 32;
+    static constexpr int16_t CHAR_WIDTH = 6 * TEXT_SIZE;
+    static constexpr int16_t CHAR_HEIGHT = 8 * TEXT_SIZE;
+
+    /** Characters that fit across the display */
+    static constexpr int COLUMNS = WIDTH / CHAR_WIDTH;
+
+    /** Whether the panel needs the E address line (1/32 scan) */
+    static constexpr bool NEEDS_E = ResY == 64;
+
+    /**
+     * Top of a row's band; bands tile the panel, so clearing one never
+     * touches its neighbours, and the bottom band is the advisory row
+     *
+     * :param int row: Row (0-2), or 3 for the bottom of the panel
+     */
+    static constexpr int16_t rowTop(int row) {
+        return row >= 3 ? HEIGHT : (row == 0 ? 0 : row == 1 ? 11 : 22) * TEXT_SIZE;
+    }
+
+    /**
+     * Top of a row's text
+     *
+     * :param int row: Row (0-2)
+     */
+    static constexpr int16_t textY(int row) {
+        return (row == 0 ? 2 : row == 1 ? 12 : 24) * TEXT_SIZE;
+    }
+
+    static_assert(textY(2) + CHAR_HEIGHT <= HEIGHT, "Bottom row doesn't fit the panel");
+};
+
+/**
+ * The pinout and layout this build is for, from config.h
+ */
+constexpr PanelPins PANEL_PINS = {{
+    R1_PIN, G1_PIN, B1_PIN,
+    R2_PIN, G2_PIN, B2_PIN,
+    A_PIN, B_PIN, C_PIN, D_PIN, E_PIN,
+    LAT_PIN, OE_PIN, CLK_PIN
+}};
+
+typedef PanelLayout<PANEL_RES_X, PANEL_RES_Y, PANEL_CHAIN> DisplayLayout;
+
+static_assert(panelPinsDistinct(PANEL_PINS), "Two HUB75 signals share a GPIO in config.h");
+static_assert(panelPinsUsable(PANEL_PINS, DisplayLayout::NEEDS_E),
+              "A HUB75 pin in config.h is not a free output GPIO (or E_PIN is missing for a 64-high panel)");
+
+#endif // PANEL_CONFIG_H
@@ -0,0 +1,183 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * Poll interval used while learning the upstream update cadence (ms)
+ */
+#define POLL_LEARN_INTERVAL_MS 5000
+
+/**
+ * Number of consecutive update intervals observed before locking
+ */
+#define POLL_LEARN_SAMPLES 4
+
+/**
+ * Give up learning if no usable update interval is seen within this time (ms)
+ */
+#define POLL_LEARN_TIMEOUT_MS ((POLL_LEARN_SAMPLES + 1) * POLL_MAX_PERIOD_MS)
+
+/**
+ * Retry learning this long after falling back to fixed-interval polling (ms)
+ */
+#define POLL_RELEARN_AFTER_MS 900000
+
+/**
+ * Shortest and longest upstream update periods we are willing to lock onto (ms)
+ */
+#define POLL_MIN_PERIOD_MS 10000
+#define POLL_MAX_PERIOD_MS 60000
+
+/**
+ * Delay after the expected upstream update before polling (ms)
+ */
+#define POLL_GUARD_MS 1500
+
+/**
+ * Every Nth aligned poll is preceded by an extra poll just before the
+ * expected update, so the pair brackets the update and re-measures phase
+ */
+#define POLL_VERIFY_EVERY 6
+
+/**
+ * Delay between follow-up polls when an expected update has not arrived (ms)
+ */
+#define POLL_PROBE_STEP_MS 2000
+
+/**
+ * Follow-up polls made after a bracket that missed the update
+ */
+#define POLL_MAX_PROBES 3
+
+/**
+ * Consecutive missed brackets before the lock is considered lost
+ */
+#define POLL_MAX_MISSES 3
+
+/**
+ * Scheduler state
+ */
+enum PollState {
+    POLL_FREE_RUNNING,  // Fixed-interval polling (no cadence model)
+    POLL_LEARNING,      // Fast polling to measure the upstream update period
+    POLL_LOCKED         // Polls aligned just after each expected update
+};
+
+/**
+ * Schedules API polls in phase with the upstream feed's update cadence
+ *
+ * WMATA refreshes its prediction feed periodically. Polling at a random
+ * phase means the data we fetch is on average half an update period old.
+ * The scheduler learns the update period from observed changes in the
+ * responses, then places each poll just after the expected update.
+ *
+ * All times are monoMillis() values.
+ *
+ * Example usage:
+ * ```cpp
+ * PollScheduler scheduler(REFRESH_INTERVAL_MS);
+ * if (scheduler.isDue(monoMillis())) {
+ *     if (client.fetchPredictions()) {
+ *         scheduler.onPollResult(monoMillis(), client.hasDataChanged());
+ *     } else {
+ *         scheduler.onPollFailed(monoMillis());
+ *     }
+ * }
+ * ```
+ */
+class PollScheduler {
+public:
+    /**
+     * Constructor
+     *
+     * :param unsigned long minIntervalMs: Shortest allowed gap between polls once locked
+     */
+    explicit PollScheduler(unsigned long minIntervalMs);
+
+    /**
+     * Forget the learned cadence and start learning again at the next poll
+     */
+    void reset();
+
+    /**
+     * Check whether a poll should be made now
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if the next scheduled poll time has been reached
+     */
+    bool isDue(uint64_t nowMs) const;
+
+    /**
+     * Record the outcome of a successful poll and schedule the next one
+     *
+     * :param uint64_t nowMs: monoMillis() value when the response arrived
+     * :param bool dataChanged: True if the response differs from the previous one
+     */
+    void onPollResult(uint64_t nowMs, bool dataChanged);
+
+    /**
+     * Record a failed poll; retries after the minimum interval
+     *
+     * :param uint64_t nowMs: monoMillis() value when the poll failed
+     */
+    void onPollFailed(uint64_t nowMs);
+
+    /**
+     * Get the monoMillis() value at which the next poll is due
+     *
+     * :return uint64_t: Scheduled poll time
+     */
+    uint64_t getNextPollTime() const;
+
+    /**
+     * Get the current scheduler state
+     *
+     * :return PollState: Free-running, learning or locked
+     */
+    PollState getState() const;
+
+    /**
+     * Get the learned upstream update period
+     *
+     * :return unsigned long: Period in ms (0 if not locked)
+     */
+    unsigned long getPeriodMs() const;
+
+private:
+    unsigned long _minIntervalMs;
+    PollState _state;
+    uint64_t _stateSinceMs;
+    uint64_t _nextPollMs;
+
+    bool _hasPoll;
+    uint64_t _lastPollMs;
+
+    // Learning
+    bool _hasLearnRef;
+    uint64_t _learnFirstMs;
+    uint64_t _learnRefMs;
+    unsigned long _learnMinMs;
+    unsigned long _learnMaxMs;
+    int _learnSamples;
+
+    // Locked
+    unsigned long _periodMs;
+    uint64_t _anchorMs;            // Reference upstream update for scheduling
+    uint64_t _expectedMs;          // Upstream update the next poll is aimed at
+    uint64_t _baseMs;              // First update of the period baseline
+    unsigned long _baseCycles;     // Update periods spanned by the baseline
+    uint64_t _measuredMs;          // Most recent bracketed update
+    int _lockStep;                 // Where we are in the aligned/bracket cycle
+    int _cycles;
+    int _probes;
+    int _misses;
+
+    void _enterState(PollState state, uint64_t nowMs);
+    void _onLearningResult(uint64_t nowMs, unsigned long windowMs, bool dataChanged);
+    void _onLockedResult(uint64_t nowMs, unsigned long windowMs, bool dataChanged);
+    bool _registerMeasurement(uint64_t updateMs);
+    void _scheduleAligned(uint64_t nowMs, bool verify);
+};
+
+#endif // POLL_SCHEDULER_H
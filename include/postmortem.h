@@ -0,0 +1,208 @@
+#ifndef POSTMORTEM_H
+#define POSTMORTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer_writer.h"
+
+/**
+ * Number of records kept across resets
+ */
+#define POSTMORTEM_RECORDS 32
+
+/**
+ * Text stored per record, including the null terminator; longer lines are cut
+ */
+#define POSTMORTEM_TEXT_SIZE 54
+
+/**
+ * Tag stored per record, including the null terminator
+ */
+#define POSTMORTEM_TAG_SIZE 8
+
+/**
+ * Marks a store laid out by this version of the code
+ */
+#define POSTMORTEM_MAGIC 0x504D5231u  // "PMR1"
+
+/**
+ * Log tag used when the postmortem is printed at boot; lines with this tag
+ * are not recorded again, so printing the dump doesn't overwrite it
+ */
+#define POSTMORTEM_LOG_TAG "PM"
+
+/**
+ * Record kinds
+ */
+#define POSTMORTEM_KIND_LOG 0      // A log line
+#define POSTMORTEM_KIND_SAMPLE 1   // A periodic health sample
+#define POSTMORTEM_KIND_BOOT 2     // Start of a boot, with the reset reason
+
+/**
+ * One record, checksummed on its own so a reset mid-write loses only it
+ */
+struct PostmortemRecord {
+    uint32_t sequence;                    // Position in the stream of records, across boots
+    uint32_t boot;                        // Boot number that wrote it
+    uint32_t uptimeMs;                    // monoMillis() when written (low 32 bits)
+    uint8_t kind;                         // POSTMORTEM_KIND_*
+    uint8_t level;                        // LOG_LEVEL_* for log lines
+    char tag[POSTMORTEM_TAG_SIZE];
+    char text[POSTMORTEM_TEXT_SIZE];
+    uint32_t checksum;                    // FNV-1a of everything above
+};
+
+/**
+ * What the device was doing; overwritten in place as it changes
+ */
+struct PostmortemState {
+    uint32_t uptimeMs;                    // monoMillis() at the last update (low 32 bits)
+    uint32_t phaseSinceMs;                // monoMillis() when the phase was entered (low 32 bits)
+    uint32_t freeHeap;                    // Bytes
+    uint32_t minFreeHeap;                 // Low-water mark since boot (bytes)
+    int8_t rssi;                          // dBm, 0 when disconnected
+    uint8_t phase;                        // FetchPhase
+    uint8_t wifiConnected;
+    uint8_t reserved;
+    uint32_t checksum;                    // FNV-1a of everything above
+};
+
+/**
+ * Reset-surviving storage; on the ESP32 this lives in RTC_NOINIT memory
+ */
+struct PostmortemStore {
+    uint32_t magic;                       // POSTMORTEM_MAGIC
+    uint32_t bootCount;
+    uint32_t headerChecksum;              // FNV-1a of magic and bootCount
+    uint32_t nextSequence;                // Recovered from the records at begin()
+    PostmortemState state;
+    PostmortemRecord records[POSTMORTEM_RECORDS];
+};
+
+/**
+ * Flight recorder kept in memory that survives watchdog resets and panics
+ *
+ * The most recent POSTMORTEM_RECORDS log lines and health samples are
+ * kept in a ring, alongside the current fetch phase, heap and Wi-Fi state.
+ * At boot, begin() checks everything left by the previous run: the header,
+ * each record and the state are checksummed separately, so a reset that
+ * tore one write only loses that piece. The previous run's last state is
+ * kept aside and both it and the ring can be formatted for the log and the
+ * /postmortem endpoint.
+ *
+ * RTC memory is cleared on power loss, so after a cold boot or a brownout
+ * the store is simply reinitialized.
+ *
+ * Records may be added from two tasks (the log task and the main loop);
+ * slots are claimed atomically.
+ *
+ * Example usage:
+ * ```cpp
+ * RTC_NOINIT_ATTR PostmortemStore store;
+ * PostmortemLog postmortem(&store);
+ * postmortem.begin("task watchdog", monoMillis());
+ * postmortem.setPhase(FETCH_PHASE_BODY, monoMillis());
+ * postmortem.addLog(LOG_LEVEL_WARN, "WMATA", "HTTP error: -11", monoMillis());
+ * ```
+ */
+class PostmortemLog {
+public:
+    /**
+     * Constructor
+     *
+     * :param PostmortemStore* store: Storage, left as found until begin()
+     */
+    explicit PostmortemLog(PostmortemStore* store);
+
+    /**
+     * Validate what the previous run left and start a new boot
+     *
+     * :param const char* resetReason: Why the chip reset, recorded with the boot
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if a valid store from a previous run was found
+     */
+    bool begin(const char* resetReason, uint64_t nowMs);
+
+    /**
+     * Record a log line
+     *
+     * :param uint8_t level: LOG_LEVEL_*
+     * :param const char* tag: Subsystem tag
+     * :param const char* text: Formatted message
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void addLog(uint8_t level, const char* tag, const char* text, uint64_t nowMs);
+
+    /**
+     * Update the health state and record it as a sample
+     *
+     * :param uint32_t freeHeap: Free heap (bytes)
+     * :param uint32_t minFreeHeap: Lowest free heap since boot (bytes)
+     * :param bool wifiConnected: Wi-Fi link state
+     * :param int rssi: Signal strength (dBm)
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void addSample(uint32_t freeHeap, uint32_t minFreeHeap, bool wifiConnected, int rssi, uint64_t nowMs);
+
+    /**
+     * Update the current fetch phase
+     *
+     * Only the state is rewritten, not the ring, so this is cheap enough
+     * to call at every phase change.
+     *
+     * :param uint8_t phase: FetchPhase value
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void setPhase(uint8_t phase, uint64_t nowMs);
+
+    /**
+     * Get the current boot number (1 after the first cold boot)
+     */
+    uint32_t getBootCount() const;
+
+    /**
+     * Check whether the previous run's final state survived
+     *
+     * :return bool: True if getPreviousState() is valid
+     */
+    bool hasPreviousState() const;
+
+    /**
+     * Get the state as the previous run left it
+     *
+     * :return const PostmortemState&: Last state before the reset
+     */
+    const PostmortemState& getPreviousState() const;
+
+    /**
+     * Get the number of records that failed their checksum at begin()
+     */
+    int getCorruptCount() const;
+
+    /**
+     * Write the previous state and every valid record, oldest first, one per line
+     *
+     * :param BufferWriter& out: Output
+     */
+    void formatDump(BufferWriter& out) const;
+
+private:
+    PostmortemStore* _store;
+    PostmortemState _previous;
+    bool _hasPrevious;
+    int _corrupt;
+
+    /**
+     * Claim the next slot and fill it
+     */
+    void _add(uint8_t kind, uint8_t level, const char* tag, const char* text, uint64_t nowMs);
+
+    /**
+     * Fetch the record with a sequence number, if it is still intact
+     */
+    const PostmortemRecord* _find(uint32_t sequence) const;
+
+    void _sealState();
+};
+
+#endif // POSTMORTEM_H
@@ -0,0 +1,180 @@
+#ifndef POWER_SCHEDULE_H
+#define POWER_SCHEDULE_H
+
+#include <stdint.h>
+#include "frame_buffer.h"
+
+/**
+ * Seconds in a day
+ */
+#define POWER_DAY_SEC 86400UL
+
+/**
+ * Hours the trains run on one day of the week
+ *
+ * Times are seconds after local midnight. Service that runs past midnight
+ * closes after POWER_DAY_SEC (e.g. 1 AM is 90000).
+ */
+struct ServiceHours {
+    uint32_t openSec;
+    uint32_t closeSec;
+};
+
+/**
+ * Weekly service hours, for powering the panel down while Metro is closed
+ *
+ * The panel counts as in service from leadSec before opening, so
+ * predictions are up when the first trains leave, until tailSec after
+ * closing, so the last trains are still shown.
+ *
+ * Example usage:
+ * ```cpp
+ * static const ServiceHours HOURS[7] = {...};  // Sunday first, as tm_wday
+ * ServiceSchedule schedule(HOURS, 15 * 60, 30 * 60);
+ * if (!schedule.isInService(local.tm_wday, secondsSinceMidnight)) { powerDown(); }
+ * ```
+ */
+class ServiceSchedule {
+public:
+    /**
+     * Constructor
+     *
+     * :param const ServiceHours hours[7]: Hours for each weekday, Sunday first (copied)
+     * :param uint32_t leadSec: Time in service before opening
+     * :param uint32_t tailSec: Time in service after closing
+     */
+    ServiceSchedule(const ServiceHours hours[7], uint32_t leadSec, uint32_t tailSec);
+
+    /**
+     * Check whether the panel should be in service
+     *
+     * :param uint8_t weekday: Day of the week (0 is Sunday)
+     * :param uint32_t secOfDay: Seconds since local midnight
+     * :return bool: True from leadSec before opening to tailSec after closing
+     */
+    bool isInService(uint8_t weekday, uint32_t secOfDay) const;
+
+    /**
+     * Get the time until the panel is next in service
+     *
+     * :param uint8_t weekday: Day of the week (0 is Sunday)
+     * :param uint32_t secOfDay: Seconds since local midnight
+     * :return uint32_t: Seconds (0 while in service)
+     */
+    uint32_t secondsUntilService(uint8_t weekday, uint32_t secOfDay) const;
+
+private:
+    ServiceHours _hours[7];
+    uint32_t _leadSec;
+    uint32_t _tailSec;
+
+    bool _inDay(uint8_t weekday, uint32_t secOfDay) const;
+};
+
+/**
+ * What the board and panel draw, for estimating energy use
+ *
+ * There is no current sensor, so power is estimated from what the panel
+ * shows: a base for the panel's drivers plus a share of fullWhiteMw in
+ * proportion to how much light the frame gives.
+ */
+struct PowerModel {
+    uint32_t boardMw;        // ESP32 with Wi-Fi, in service
+    uint32_t boardClosedMw;  // ESP32 while closed (modem and light sleep)
+    uint32_t panelIdleMw;    // Panel drivers with every LED off
+    uint32_t fullWhiteMw;    // Extra for every LED at full white
+};
+
+/**
+ * Get how much of the panel's full light a frame gives
+ *
+ * :param const FrameBuffer& frame: Frame on the panel
+ * :return uint16_t: Average channel duty over the frame, in permille
+ */
+uint16_t frameDutyPermille(const FrameBuffer& frame);
+
+/**
+ * Estimate the power drawn
+ *
+ * :param const PowerModel& model: Power figures for the hardware
+ * :param uint16_t dutyPermille: frameDutyPermille() of what is on the panel
+ * :param bool closed: True while powered down outside service hours
+ * :return uint32_t: Estimated power in milliwatts
+ */
+uint32_t estimatePowerMw(const PowerModel& model, uint16_t dutyPermille, bool closed);
+
+/**
+ * Energy, API calls and closed time of one day
+ */
+struct PowerDay {
+    uint64_t energyMj;       // Estimated energy (millijoules)
+    unsigned long apiCalls;  // API requests made
+    uint32_t closedSec;      // Time spent powered down
+};
+
+/**
+ * Daily totals of energy use, API calls and time powered down
+ *
+ * update() is called regularly with the power drawn since the last call,
+ * the running total of API calls and the local day. When the day changes
+ * the totals so far become yesterday's. Until the clock is set the day is
+ * unknown (-1) and everything counts towards the first day.
+ *
+ * Example usage:
+ * ```cpp
+ * PowerLedger ledger;
+ * if (ledger.update(monoMillis(), powerMw, closed, governor.getAllowedCount(), day)) {
+ *     report(ledger.getYesterday());
+ * }
+ * ```
+ */
+class PowerLedger {
+public:
+    PowerLedger();
+
+    /**
+     * Account for the time since the last update
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param uint32_t milliwatts: Power drawn since the last update
+     * :param bool closed: True if powered down since the last update
+     * :param unsigned long apiCallTotal: API calls since boot
+     * :param long day: Local day (any number that changes at midnight), or -1 if unknown
+     * :return bool: True if a day just ended and getYesterday() holds it
+     */
+    bool update(uint64_t nowMs, uint32_t milliwatts, bool closed, unsigned long apiCallTotal, long day);
+
+    /**
+     * Get today's totals so far
+     *
+     * :return const PowerDay&: Totals since midnight (or boot)
+     */
+    const PowerDay& getToday() const;
+
+    /**
+     * Get the last whole day's totals
+     *
+     * :return const PowerDay&: Yesterday's totals (all 0 until a day has ended)
+     */
+    const PowerDay& getYesterday() const;
+
+    /**
+     * Get the estimated energy used since boot
+     *
+     * :return uint64_t: Energy in millijoules
+     */
+    uint64_t getTotalEnergyMj() const;
+
+private:
+    PowerDay _today;
+    PowerDay _yesterday;
+    uint64_t _totalEnergyMj;
+    uint64_t _lastUpdateMs;
+    uint32_t _energyRemainder;     // Microjoules not yet a whole millijoule
+    uint32_t _closedRemainderMs;   // Closed time not yet a whole second
+    unsigned long _dayStartCalls;  // apiCallTotal when today started
+    long _day;
+    bool _started;
+};
+
+#endif // POWER_SCHEDULE_H
@@ -0,0 +1,85 @@
+#ifndef PREDICTION_PROVIDER_H
+#define PREDICTION_PROVIDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "train_tracker.h"
+
+/**
+ * Longest request URL a provider may build (including terminator)
+ */
+#define PROVIDER_URL_MAX_LEN 256
+
+/**
+ * A source of arrival predictions in some agency's format
+ *
+ * WmataClient owns the connection, the rate governor and the request
+ * budget; a provider only says what to ask for and decodes the answer
+ * into TrainObservations, the records the tracker and the snapshots work
+ * with. The response body is handed over as it arrives, so a provider can
+ * decode it on the fly instead of holding all of it.
+ *
+ * A fetch is buildUrl(), then begin(), write() for each piece of the body,
+ * and finish().
+ *
+ * Implementations: WmataJsonProvider (WMATA's StationPrediction JSON) and
+ * GtfsRtProvider (GTFS-realtime TripUpdates).
+ */
+class PredictionProvider {
+public:
+    virtual ~PredictionProvider() {}
+
+    /**
+     * Get a short name for logs
+     *
+     * :return const char*: Provider name, e.g. "WMATA"
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * Build the request URL (http only)
+     *
+     * :param char* url: Output buffer
+     * :param size_t size: Size of the buffer (PROVIDER_URL_MAX_LEN is enough)
+     * :return bool: False if the URL does not fit
+     */
+    virtual bool buildUrl(char* url, size_t size) const = 0;
+
+    /**
+     * Start decoding a new response
+     *
+     * :param time_t wallNow: Current wall-clock time, 0 if the clock isn't set
+     */
+    virtual void begin(time_t wallNow) = 0;
+
+    /**
+     * Decode the next piece of the response body
+     *
+     * :param const uint8_t* data: Body bytes
+     * :param size_t length: Number of bytes
+     * :return size_t: Bytes taken; less than length stops the transfer
+     */
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * Finish decoding and hand over the predictions
+     *
+     * :param TrainObservation* observations: Output predictions
+     * :param int maxCount: Size of observations
+     * :param int& count: Set to the number of predictions
+     * :param uint32_t& hash: Set to a fingerprint of the response, which
+     *     changes when the feed does
+     * :return bool: False if the response could not be decoded (see getError())
+     */
+    virtual bool finish(TrainObservation* observations, int maxCount, int& count, uint32_t& hash) = 0;
+
+    /**
+     * Get why the last finish() failed
+     *
+     * :return const char*: Error description, "" if none
+     */
+    virtual const char* getError() const = 0;
+};
+
+#endif // PREDICTION_PROVIDER_H
@@ -0,0 +1,92 @@
+#ifndef PREDICTION_SNAPSHOT_H
+#define PREDICTION_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "train_tracker.h"
+#include "rail_incidents.h"
+
+/**
+ * Wire format version written by encodeSnapshot(); decoders reject
+ * versions they don't know
+ */
+#define SNAPSHOT_VERSION 1
+
+/**
+ * Largest encoded snapshot (bytes); fits one unfragmented UDP datagram
+ */
+#define SNAPSHOT_MAX_SIZE 1400
+
+/**
+ * Maximum trains carried in a snapshot
+ */
+#define SNAPSHOT_MAX_TRAINS 16
+
+/**
+ * Station code field size (including null terminator)
+ */
+#define SNAPSHOT_STATION_LEN 8
+
+/**
+ * Snapshot flags
+ */
+#define SNAPSHOT_FLAG_CHANGED 0x01    // Predictions changed since the leader's previous fetch
+#define SNAPSHOT_FLAG_TRUNCATED 0x02  // Some incidents did not fit
+
+/**
+ * One leader fetch, as fanned out to follower panels
+ *
+ * Trains are the normalized observations from the fetch, so followers
+ * run them through their own TrainTracker exactly as if they had fetched.
+ */
+struct PredictionSnapshot {
+    uint32_t leaderId;                            // Device id of the sender
+    uint32_t sequence;                            // Increments on every new fetch
+    uint32_t responseHash;                        // Fingerprint of the WMATA response
+    uint32_t ageMs;                               // Time from the fetch to sending
+    uint8_t flags;                                // SNAPSHOT_FLAG_*
+    char station[SNAPSHOT_STATION_LEN];           // Station code
+    uint8_t stationLines;                         // Lines serving the station
+    int trainCount;
+    TrainObservation trains[SNAPSHOT_MAX_TRAINS];
+    IncidentList incidents;
+};
+
+/**
+ * Encode a snapshot into the versioned binary wire format
+ *
+ * Layout (all integers little-endian):
+ *   0  'W' 'M'             magic
+ *   2  u8 version
+ *   3  u8 flags
+ *   4  u32 leader id
+ *   8  u32 sequence
+ *  12  u32 response hash
+ *  16  u32 age (ms)
+ *  20  char[8] station code, null-padded
+ *  28  u8 station lines, u8 train count, u8 incident count
+ *  31  trains, 13 bytes each: line[2] dest[4] group cars status i32 eta (ms)
+ *  ..  incidents: u8 lines, u8 type length, type, u8 text length, text
+ *  ..  u32 FNV-1a checksum of everything before it
+ *
+ * Incidents that don't fit in SNAPSHOT_MAX_SIZE are dropped and
+ * SNAPSHOT_FLAG_TRUNCATED is set.
+ *
+ * :param const PredictionSnapshot& snapshot: Snapshot to encode
+ * :param uint8_t* buffer: Output buffer
+ * :param size_t bufferSize: Size of output buffer (SNAPSHOT_MAX_SIZE is always enough)
+ * :return size_t: Encoded length, or 0 if the buffer is too small
+ */
+size_t encodeSnapshot(const PredictionSnapshot& snapshot, uint8_t* buffer, size_t bufferSize);
+
+/**
+ * Decode and validate a snapshot
+ *
+ * :param const uint8_t* data: Received datagram
+ * :param size_t length: Datagram length
+ * :param PredictionSnapshot& snapshot: Output snapshot
+ * :return bool: True if the magic, version, lengths and checksum are all valid
+ */
+bool decodeSnapshot(const uint8_t* data, size_t length, PredictionSnapshot& snapshot);
+
+#endif // PREDICTION_SNAPSHOT_H
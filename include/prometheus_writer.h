@@ -0,0 +1,99 @@
+#ifndef PROMETHEUS_WRITER_H
+#define PROMETHEUS_WRITER_H
+
+#include "buffer_writer.h"
+#include "latency_histogram.h"
+
+/**
+ * Content-Type of the Prometheus text exposition format
+ */
+#define PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+/**
+ * Writes metrics in the Prometheus text exposition format
+ *
+ * Each metric family is written straight into a BufferWriter as it is
+ * produced, so a scrape needs no heap and no intermediate copies. Integral
+ * values are written without a decimal point; label values are escaped.
+ *
+ * Example usage:
+ * ```cpp
+ * BufferWriter out(body, sizeof(body));
+ * PrometheusWriter metrics(out);
+ * metrics.gauge("uptime_seconds", "Time since boot", monoMillis() / 1000);
+ * metrics.family("fetches_total", "counter", "Prediction fetches by result");
+ * metrics.sample("fetches_total", "result", "ok", okCount);
+ * metrics.sample("fetches_total", "result", "error", errorCount);
+ * ```
+ */
+class PrometheusWriter {
+public:
+    /**
+     * Constructor
+     *
+     * :param BufferWriter& out: Writer the metrics are appended to
+     */
+    explicit PrometheusWriter(BufferWriter& out);
+
+    /**
+     * Start a metric family: its HELP and TYPE lines
+     *
+     * :param const char* name: Metric name
+     * :param const char* type: "counter", "gauge" or "histogram"
+     * :param const char* help: One-line description
+     */
+    void family(const char* name, const char* type, const char* help);
+
+    /**
+     * Write an unlabelled sample
+     *
+     * :param const char* name: Metric name
+     * :param double value: Sample value
+     */
+    void sample(const char* name, double value);
+
+    /**
+     * Write a sample with one label
+     *
+     * :param const char* name: Metric name
+     * :param const char* label: Label name
+     * :param const char* labelValue: Label value (escaped as needed)
+     * :param double value: Sample value
+     */
+    void sample(const char* name, const char* label, const char* labelValue, double value);
+
+    /**
+     * Write a counter family with a single sample
+     *
+     * :param const char* name: Metric name (by convention ending in _total)
+     * :param const char* help: One-line description
+     * :param double value: Counter value
+     */
+    void counter(const char* name, const char* help, double value);
+
+    /**
+     * Write a gauge family with a single sample
+     *
+     * :param const char* name: Metric name
+     * :param const char* help: One-line description
+     * :param double value: Gauge value
+     */
+    void gauge(const char* name, const char* help, double value);
+
+    /**
+     * Write a histogram family with cumulative buckets, in seconds
+     *
+     * :param const char* name: Metric name (by convention ending in _seconds)
+     * :param const char* help: One-line description
+     * :param const LatencyHistogram& histogram: Recorded latencies
+     */
+    void histogram(const char* name, const char* help, const LatencyHistogram& histogram);
+
+private:
+    BufferWriter& _out;
+
+    void _printValue(double value);
+    void _printLabelValue(const char* value);
+};
+
+#endif // PROMETHEUS_WRITER_H
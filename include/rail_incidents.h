@@ -0,0 +1,156 @@
+#ifndef RAIL_INCIDENTS_H
+#define RAIL_INCIDENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum number of incidents kept after filtering
+ */
+#define MAX_INCIDENTS 4
+
+/**
+ * Maximum incident description length (including null terminator)
+ */
+#define INCIDENT_TEXT_MAX_LEN 192
+
+/**
+ * Maximum incident type length, e.g. "Delay" or "Alert" (including null terminator)
+ */
+#define INCIDENT_TYPE_MAX_LEN 12
+
+/**
+ * Bit per metro line, so the lines serving a station or affected by an
+ * incident fit in one byte
+ */
+#define LINE_MASK_RD 0x01
+#define LINE_MASK_BL 0x02
+#define LINE_MASK_OR 0x04
+#define LINE_MASK_GR 0x08
+#define LINE_MASK_YL 0x10
+#define LINE_MASK_SV 0x20
+
+/**
+ * Get the mask bit for a two-letter line code
+ *
+ * :param const char* code: Line code (RD, BL, OR, GR, YL, SV); only the first two characters are read
+ * :return uint8_t: The line's mask bit, or 0 if not a known line
+ */
+uint8_t lineMaskFromCode(const char* code);
+
+/**
+ * Parse a WMATA line list such as "RD;" or "BL; OR; SV;"
+ *
+ * :param const char* text: Semicolon-separated line codes
+ * :return uint8_t: Mask of the lines listed (unknown codes are ignored)
+ */
+uint8_t parseLineList(const char* text);
+
+/**
+ * Write a line mask as codes joined by '/', e.g. "BL/OR"
+ *
+ * :param uint8_t mask: Line mask
+ * :param char* buffer: Output buffer
+ * :param size_t bufferSize: Size of output buffer (7 bytes fits two lines)
+ * :return size_t: Characters written (excluding null terminator)
+ */
+size_t formatLineMask(uint8_t mask, char* buffer, size_t bufferSize);
+
+/**
+ * Find the array stored under a key in a JSON text
+ *
+ * This is a plain text search for "key" followed by ':' and '['; it is
+ * meant for picking the top-level array out of an API response.
+ *
+ * :param const char* json: Null-terminated JSON text
+ * :param const char* key: Key to look for
+ * :return const char*: Pointer just past the '[', or nullptr if not found
+ */
+const char* jsonFindArray(const char* json, const char* key);
+
+/**
+ * Step to the next object element of a JSON array
+ *
+ * Skips whitespace and commas, then finds the matching '}' while ignoring
+ * braces inside strings. Lets a response be parsed one element at a time,
+ * so parse memory is bounded by the largest element rather than the
+ * whole response. A truncated last element is reported as the end.
+ *
+ * :param const char*& cursor: Position inside the array; advanced past the element
+ * :param const char* end: End of the JSON text
+ * :param const char*& objectStart: Output start of the element ('{')
+ * :param size_t& objectLen: Output length of the element including braces
+ * :return bool: True if a complete object was found, false at ']' or end of text
+ */
+bool jsonNextObject(const char*& cursor, const char* end, const char*& objectStart, size_t& objectLen);
+
+/**
+ * A service incident affecting one or more lines
+ */
+struct RailIncident {
+    uint8_t lines;                             // Mask of affected lines
+    char type[INCIDENT_TYPE_MAX_LEN];          // "Delay", "Alert", ...
+    char description[INCIDENT_TEXT_MAX_LEN];   // Truncated description
+};
+
+/**
+ * Fixed-size list of rail incidents relevant to one station
+ *
+ * Example usage:
+ * ```cpp
+ * IncidentList incidents;
+ * incidents.add(parseLineList("RD;"), "Delay", "Red Line trains single tracking...");
+ * char advisory[256];
+ * incidents.formatAdvisory(advisory, sizeof(advisory));
+ * ```
+ */
+class IncidentList {
+public:
+    IncidentList();
+
+    /**
+     * Remove all incidents
+     */
+    void reset();
+
+    /**
+     * Add an incident; text longer than the field sizes is truncated
+     *
+     * :param uint8_t lines: Mask of affected lines
+     * :param const char* type: Incident type
+     * :param const char* description: Incident description
+     * :return bool: True if stored, false if the list is full
+     */
+    bool add(uint8_t lines, const char* type, const char* description);
+
+    /**
+     * Get the number of incidents stored
+     *
+     * :return int: Incident count (0 to MAX_INCIDENTS)
+     */
+    int getCount() const;
+
+    /**
+     * Get an incident by index
+     *
+     * :param int index: Index (0 to getCount() - 1)
+     * :return const RailIncident&: The incident
+     */
+    const RailIncident& get(int index) const;
+
+    /**
+     * Format every incident as one line of scrolling text, e.g.
+     * "RD: Trains single tracking...   BL/OR: Delays..."
+     *
+     * :param char* buffer: Output buffer
+     * :param size_t bufferSize: Size of output buffer
+     * :return size_t: Characters written (excluding null terminator)
+     */
+    size_t formatAdvisory(char* buffer, size_t bufferSize) const;
+
+private:
+    RailIncident _incidents[MAX_INCIDENTS];
+    int _count;
+};
+
+#endif // RAIL_INCIDENTS_H
@@ -0,0 +1,192 @@
+#ifndef RATE_GOVERNOR_H
+#define RATE_GOVERNOR_H
+
+#include <stdint.h>
+
+/**
+ * Sustained request rate (tokens added per second)
+ *
+ * Half of WMATA's free-tier limit of 10 calls/s, leaving headroom for
+ * other devices using the same API key.
+ */
+#define RATE_TOKENS_PER_SEC 5
+
+/**
+ * Bucket size: the most requests that can be made back to back
+ */
+#define RATE_BURST 5
+
+/**
+ * Tokens held back for high-priority requests; background requests are
+ * throttled when the bucket is this low
+ */
+#define RATE_HIGH_PRIORITY_RESERVE 2
+
+/**
+ * WMATA's free-tier daily call quota per API key
+ */
+#define RATE_DAILY_QUOTA 50000
+
+/**
+ * Length of a quota day (ms); counted from the first request since there
+ * is no wall clock
+ */
+#define RATE_DAY_MS 86400000UL
+
+/**
+ * Recent-rate history used for the daily projection (one slot per minute)
+ */
+#define RATE_HISTORY_MINUTES 60
+
+/**
+ * Upper bound on how far intervals are stretched (percent, 100 = no stretch)
+ */
+#define RATE_MAX_STRETCH_PERCENT 800
+
+/**
+ * Request priority; lower values win
+ */
+enum RequestPriority {
+    PRIORITY_HIGH,        // Predictions
+    PRIORITY_BACKGROUND   // Incidents, station info
+};
+
+/**
+ * Token-bucket request governor shared by every API request
+ *
+ * Each request takes a token; tokens refill at RATE_TOKENS_PER_SEC up to
+ * RATE_BURST. Background requests may not take the last
+ * RATE_HIGH_PRIORITY_RESERVE tokens, so predictions always win.
+ *
+ * The governor also projects the day's usage from the last hour's request
+ * rate. If the projection exceeds the daily budget, getStretchPercent()
+ * grows above 100 and callers stretch their poll intervals by it.
+ *
+ * All times are monoMillis() values.
+ *
+ * Example usage:
+ * ```cpp
+ * RateGovernor governor(RATE_DAILY_QUOTA);
+ * if (governor.tryAcquire(PRIORITY_HIGH, monoMillis())) {
+ *     http.GET();
+ * }
+ * unsigned long interval = governor.stretchInterval(REFRESH_INTERVAL_MS, monoMillis());
+ * ```
+ */
+class RateGovernor {
+public:
+    /**
+     * Constructor
+     *
+     * :param unsigned long dailyBudget: Requests this device may make per day
+     */
+    explicit RateGovernor(unsigned long dailyBudget);
+
+    /**
+     * Take a token for a request, if the priority allows it
+     *
+     * :param RequestPriority priority: Request priority
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if the request may be made; false counts as throttled
+     */
+    bool tryAcquire(RequestPriority priority, uint64_t nowMs);
+
+    /**
+     * Get how long until a request of this priority could be made
+     *
+     * :param RequestPriority priority: Request priority
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return unsigned long: Wait in ms (0 if a token is available now)
+     */
+    unsigned long getWaitMs(RequestPriority priority, uint64_t nowMs);
+
+    /**
+     * Record that the server rejected a request for rate limiting (HTTP 429);
+     * empties the bucket so the next requests back off
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void onRateLimited(uint64_t nowMs);
+
+    /**
+     * Get the interval stretch needed to stay within the daily budget
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return unsigned int: Percent (100 = on budget, up to RATE_MAX_STRETCH_PERCENT)
+     */
+    unsigned int getStretchPercent(uint64_t nowMs);
+
+    /**
+     * Stretch a poll interval by the current daily-budget factor
+     *
+     * :param unsigned long intervalMs: Normal interval
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return unsigned long: Interval to use
+     */
+    unsigned long stretchInterval(unsigned long intervalMs, uint64_t nowMs);
+
+    /**
+     * Check whether a poll that is due should wait for the stretched interval
+     *
+     * Never defers while on budget. Each postponed poll (identified by
+     * lastPollMs) is counted as deferred once.
+     *
+     * :param uint64_t lastPollMs: monoMillis() of the previous poll
+     * :param unsigned long intervalMs: Normal interval
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return bool: True if the poll should be deferred
+     */
+    bool shouldDefer(uint64_t lastPollMs, unsigned long intervalMs, uint64_t nowMs);
+
+    /**
+     * Counters since boot
+     */
+    unsigned long getAllowedCount() const;
+    unsigned long getThrottledCount() const;
+    unsigned long getDeferredCount() const;
+    unsigned long getRateLimitedCount() const;
+
+    /**
+     * Get the number of requests made in the current quota day
+     *
+     * :return unsigned long: Requests today
+     */
+    unsigned long getDailyCount() const;
+
+    /**
+     * Get the daily request budget
+     *
+     * :return unsigned long: Budget passed to the constructor
+     */
+    unsigned long getDailyBudget() const;
+
+private:
+    unsigned long _dailyBudget;
+    bool _started;
+    uint64_t _startMs;
+
+    // Token bucket (in thousandths of a token)
+    unsigned long _tokensMilli;
+    uint64_t _refillMs;
+
+    // Daily projection
+    uint64_t _dayStartMs;
+    unsigned long _dayCount;
+    uint16_t _minuteCounts[RATE_HISTORY_MINUTES];
+    uint64_t _minuteStartMs;
+    int _minuteIndex;
+    unsigned long _hourCount;
+
+    // Counters
+    unsigned long _allowed;
+    unsigned long _throttled;
+    unsigned long _deferred;
+    unsigned long _rateLimited;
+    bool _hasDeferredPoll;
+    uint64_t _deferredPollMs;
+
+    void _advance(uint64_t nowMs);
+    unsigned long _reserveMilli(RequestPriority priority) const;
+};
+
+#endif // RATE_GOVERNOR_H
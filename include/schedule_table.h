@@ -0,0 +1,145 @@
+#ifndef SCHEDULE_TABLE_H
+#define SCHEDULE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "train_tracker.h"
+
+/**
+ * Kinds of service day, each with its own table
+ */
+enum ScheduleDayType : uint8_t {
+    SCHEDULE_WEEKDAY,
+    SCHEDULE_SATURDAY,
+    SCHEDULE_SUNDAY,
+    SCHEDULE_DAY_TYPES
+};
+
+/**
+ * Departures per block; each block starts with an absolute time, so a
+ * lookup binary-searches the blocks and then decodes at most one block
+ * to reach its position
+ */
+#define SCHEDULE_BLOCK_SIZE 16
+
+/**
+ * Seconds in a day; GTFS times run past it for trips after midnight
+ */
+#define SCHEDULE_DAY_SEC 86400UL
+
+/**
+ * First departure of a block
+ */
+struct ScheduleBlock {
+    uint32_t firstSec;   // Seconds after the service day's midnight
+    uint16_t offset;     // Byte offset of the block's first departure in the day's data
+};
+
+/**
+ * One service day's departures, sorted by time
+ *
+ * Each departure in data is:
+ * - the seconds since the previous departure as a varint (7 bits per
+ *   byte, low bits first, high bit set on all but the last byte); 0 for
+ *   the first departure of a block, whose time is in the block
+ * - the destination's index in the table's destination list
+ * - the line's index in the table's line list, plus the track group
+ *   shifted left by 5
+ */
+struct ScheduleDay {
+    const ScheduleBlock* blocks;
+    const uint8_t* data;
+    uint16_t blockCount;
+    uint16_t departureCount;
+};
+
+/**
+ * A station's compiled timetable
+ *
+ * Generated by gtfs_schedule.py from a static GTFS feed and kept in flash.
+ */
+struct ScheduleTable {
+    ScheduleDay days[SCHEDULE_DAY_TYPES];
+    const char (*destinations)[DEST_MAX_LEN];
+    const char (*lines)[LINE_MAX_LEN];
+    uint8_t destinationCount;
+    uint8_t lineCount;
+};
+
+/**
+ * The configured station's timetable (src/schedule_data.cpp, generated at build time)
+ */
+extern const ScheduleTable STATION_SCHEDULE;
+
+/**
+ * A departure from the timetable
+ */
+struct ScheduledDeparture {
+    char line[LINE_MAX_LEN];
+    char destination[DEST_MAX_LEN];
+    uint8_t group;
+    long departSec;      // Seconds after today's midnight; negative for yesterday's late trains
+};
+
+/**
+ * Get the kind of service day for a day of the week
+ *
+ * :param int weekday: Day of the week, 0 = Sunday (struct tm's tm_wday)
+ * :return uint8_t: ScheduleDayType
+ */
+uint8_t scheduleDayType(int weekday);
+
+/**
+ * Lookups in a compiled timetable
+ *
+ * Finding where "now" falls in a day is a binary search over the blocks
+ * followed by decoding at most SCHEDULE_BLOCK_SIZE departures; nothing is
+ * allocated, and the table itself is never copied out of flash.
+ *
+ * Trips that run past midnight belong to the previous service day in GTFS
+ * (a 00:20 departure on Saturday is listed as 24:20 in Friday's table), so
+ * findNext() looks there first.
+ *
+ * Example usage:
+ * ```cpp
+ * Schedule schedule(STATION_SCHEDULE);
+ * ScheduledDeparture next[3];
+ * int count = schedule.findNext(local.tm_wday, secondsOfDay, 1, next, 3);
+ * ```
+ */
+class Schedule {
+public:
+    /**
+     * Constructor
+     *
+     * :param const ScheduleTable& table: Compiled timetable
+     */
+    explicit Schedule(const ScheduleTable& table);
+
+    /**
+     * Find the next departures at or after a time
+     *
+     * :param int weekday: Day of the week, 0 = Sunday
+     * :param uint32_t nowSec: Seconds after midnight (local time)
+     * :param uint8_t group: Track group, 0 for any
+     * :param ScheduledDeparture* departures: Output, soonest first
+     * :param int maxCount: Size of departures
+     * :return int: Number of departures found
+     */
+    int findNext(int weekday, uint32_t nowSec, uint8_t group, ScheduledDeparture* departures, int maxCount) const;
+
+    /**
+     * Check whether the timetable has any departures at all
+     *
+     * :return bool: False if the build had no GTFS feed for the station
+     */
+    bool isEmpty() const;
+
+private:
+    const ScheduleTable& _table;
+
+    int _findInDay(uint8_t dayType, uint32_t fromSec, long shiftSec, uint8_t group,
+                   ScheduledDeparture* departures, int count, int maxCount) const;
+};
+
+#endif // SCHEDULE_TABLE_H
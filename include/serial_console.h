@@ -0,0 +1,160 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer_writer.h"
+
+/**
+ * Longest command line, including arguments (characters)
+ *
+ * Sized for "replay" with a full snapshot in hex (2 x SNAPSHOT_MAX_SIZE).
+ */
+#define CONSOLE_LINE_MAX_LEN 2832
+
+/**
+ * Most commands a console can hold (besides the built-in "help")
+ */
+#define CONSOLE_MAX_COMMANDS 16
+
+/**
+ * Runs one command, writing its answer
+ *
+ * :param char* args: Everything after the command name, trimmed ("" if none; may be modified)
+ * :param BufferWriter& out: Answer text
+ * :param void* context: Context pointer given to the console
+ */
+typedef void (*ConsoleHandler)(char* args, BufferWriter& out, void* context);
+
+/**
+ * One console command
+ */
+struct ConsoleCommand {
+    const char* name;       // What is typed, e.g. "heap"
+    const char* usage;      // Arguments, e.g. "<level>" ("" if none)
+    const char* help;       // One line for "help"
+    ConsoleHandler handler;
+};
+
+/**
+ * Line-oriented command console, fed one character at a time
+ *
+ * The caller passes in whatever characters have arrived, so nothing ever
+ * waits for input. When a line is complete its command runs straight away
+ * and the answer goes into the output buffer. The caller then sends the
+ * output as the line has room (see getOutput()/consumeOutput()) and stops
+ * feeding input until it has all gone, so a long answer never blocks the
+ * caller either.
+ *
+ * Backspace edits the line; other control characters are ignored. Lines
+ * longer than CONSOLE_LINE_MAX_LEN are discarded with an error. "help"
+ * lists the commands.
+ *
+ * Example usage:
+ * ```cpp
+ * static const ConsoleCommand COMMANDS[] = {
+ *     {"heap", "", "Show free heap", printHeap},
+ * };
+ * static char output[1024];
+ * SerialConsole console(COMMANDS, 1, output, sizeof(output), nullptr);
+ *
+ * while (!console.hasOutput() && Serial.available() > 0) {
+ *     console.feed((char)Serial.read());
+ * }
+ * size_t length;
+ * const char* text = console.getOutput(length);
+ * console.consumeOutput(Serial.write(text, min(length, Serial.availableForWrite())));
+ * ```
+ */
+class SerialConsole {
+public:
+    /**
+     * Constructor
+     *
+     * :param const ConsoleCommand* commands: Command table (copied; extra
+     *     commands beyond CONSOLE_MAX_COMMANDS are ignored)
+     * :param int count: Number of commands
+     * :param char* output: Buffer for answers
+     * :param size_t outputSize: Size of the output buffer
+     * :param void* context: Passed to every handler
+     */
+    SerialConsole(const ConsoleCommand* commands, int count, char* output, size_t outputSize, void* context);
+
+    /**
+     * Take one input character, running the command if it ends a line
+     *
+     * :param char c: Character received
+     * :return bool: True if a command ran (or a line was refused) and
+     *     there is output to send
+     */
+    bool feed(char c);
+
+    /**
+     * Check whether an answer is still being sent
+     *
+     * :return bool: True while there is output left
+     */
+    bool hasOutput() const;
+
+    /**
+     * Get the part of the answer not sent yet
+     *
+     * :param size_t& length: Set to the number of characters left
+     * :return const char*: Next character to send
+     */
+    const char* getOutput(size_t& length) const;
+
+    /**
+     * Mark part of the answer as sent
+     *
+     * :param size_t length: Characters sent
+     */
+    void consumeOutput(size_t length);
+
+    /**
+     * Get the number of command lines run (including unknown commands)
+     *
+     * :return unsigned long: Command count
+     */
+    unsigned long getCommandCount() const;
+
+private:
+    ConsoleCommand _commands[CONSOLE_MAX_COMMANDS];
+    int _commandCount;
+    void* _context;
+
+    char _line[CONSOLE_LINE_MAX_LEN + 1];
+    size_t _lineLength;
+    bool _lineTooLong;
+
+    char* _output;
+    size_t _outputSize;
+    size_t _outputLength;
+    size_t _outputSent;
+    unsigned long _commandsRun;
+
+    void _runLine();
+    void _printHelp(BufferWriter& out) const;
+};
+
+/**
+ * Write bytes as lowercase hex
+ *
+ * :param const uint8_t* data: Bytes to write
+ * :param size_t length: Number of bytes
+ * :param BufferWriter& out: Output
+ */
+void formatHex(const uint8_t* data, size_t length, BufferWriter& out);
+
+/**
+ * Parse hex text back into bytes
+ *
+ * :param const char* text: Hex digits, either case, no separators
+ * :param uint8_t* buffer: Output buffer
+ * :param size_t size: Size of the output buffer
+ * :return int: Number of bytes, or -1 for an odd length, a non-hex
+ *     character or too many bytes
+ */
+int parseHex(const char* text, uint8_t* buffer, size_t size);
+
+#endif // SERIAL_CONSOLE_H
@@ -0,0 +1,292 @@
+#ifndef STATUS_SERVER_H
+#define STATUS_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum number of endpoints the server can serve
+ */
+#define STATUS_MAX_ENDPOINTS 8
+
+/**
+ * Maximum request header size read from a client (bytes); longer
+ * requests are answered with 431
+ */
+#define STATUS_REQUEST_MAX_LEN 512
+
+/**
+ * Longest a client may take to send its request, or to take the response
+ * (ms); the connection is dropped after that. poll() never waits for a
+ * client, so this only bounds how long a slot stays taken.
+ */
+#define STATUS_IO_TIMEOUT_MS 3000
+
+/**
+ * New connections accepted per poll() call
+ */
+#define STATUS_MAX_CLIENTS_PER_POLL 2
+
+/**
+ * Connections open at once, long polls included; more wait in the listen
+ * backlog
+ */
+#define STATUS_MAX_CONNECTIONS 4
+
+/**
+ * Long-poll requests held open at once; further ones are answered at once
+ */
+#define STATUS_MAX_PARKED 2
+
+/**
+ * Longest a long-poll request is held before answering 304 (ms)
+ */
+#define STATUS_LONG_POLL_TIMEOUT_MS 25000
+
+/**
+ * Fills an endpoint's buffer with its response body
+ *
+ * :param char* buffer: Endpoint buffer
+ * :param size_t capacity: Size of the buffer
+ * :param void* context: Context pointer given to addEndpoint()
+ * :return size_t: Body length written
+ */
+typedef size_t (*StatusBuilder)(char* buffer, size_t capacity, void* context);
+
+/**
+ * Handles a POST to an endpoint and writes the response body
+ *
+ * :param char* form: Request body, null-terminated (may be modified)
+ * :param char* buffer: Endpoint buffer for the response body
+ * :param size_t capacity: Size of the buffer
+ * :param size_t& length: Set to the response body length
+ * :param void* context: Context pointer given to addEndpoint()
+ * :return int: HTTP status code to answer with (200, 400, ...)
+ */
+typedef int (*StatusAction)(char* form, char* buffer, size_t capacity, size_t& length, void* context);
+
+/**
+ * Returns a value that changes whenever an endpoint's content changes
+ *
+ * :param void* context: Context pointer given to addEndpoint()
+ * :return uint32_t: Content version, sent as the ETag
+ */
+typedef uint32_t (*StatusVersion)(void* context);
+
+/**
+ * Tiny HTTP/1.1 server for status endpoints, on plain BSD sockets
+ *
+ * Every endpoint's response body is pre-serialized into its own buffer by
+ * rebuild(), which the application calls when its data changes. Requests
+ * only copy that buffer to the socket, so clients polling the server never
+ * cause JSON building or touch the fetch path. An Age header tells clients
+ * how old the cached body is. Endpoints marked live instead rebuild their
+ * body into the same fixed buffer for every request.
+ *
+ * Endpoints with a version function support long polling: a request with
+ * ?since=<ETag> matching the current version is held open until the
+ * version changes (answered with the new body) or
+ * STATUS_LONG_POLL_TIMEOUT_MS passes (answered 304).
+ *
+ * Endpoints with an action also accept POST: the body (at most what fits
+ * in STATUS_REQUEST_MAX_LEN with the headers) is handed to the action,
+ * which answers in the endpoint's buffer. Other endpoints answer POST
+ * with 405.
+ *
+ * The server is non-blocking and single-threaded: call poll() from the
+ * main loop. Each connection keeps its own state, and every poll() only
+ * reads and writes what the socket takes right away, so a slow client
+ * holds a connection slot, never the loop. While a response is being
+ * sent from an endpoint's buffer, the buffer is left alone: rebuilds wait
+ * until it has gone out. It uses only BSD sockets, so it runs unchanged
+ * on the ESP32 (lwIP) and on a Linux host for tests.
+ *
+ * Example usage:
+ * ```cpp
+ * static char healthBody[256];
+ * StatusServer server;
+ * server.addEndpoint("/health", "application/json", healthBody, sizeof(healthBody), buildHealth, nullptr);
+ * server.begin(80);
+ * server.rebuild(monoMillis());      // after each fetch
+ * server.poll(monoMillis());         // every loop
+ * ```
+ */
+class StatusServer {
+public:
+    StatusServer();
+    ~StatusServer();
+
+    /**
+     * Register an endpoint
+     *
+     * :param const char* path: Request path, e.g. "/health" (must outlive the server)
+     * :param const char* contentType: Content-Type header value
+     * :param char* buffer: Buffer the body is built into
+     * :param size_t capacity: Size of the buffer
+     * :param StatusBuilder builder: Function that fills the buffer
+     * :param void* context: Passed to the builder
+     * :return int: Endpoint index, or -1 if the table is full
+     */
+    int addEndpoint(const char* path, const char* contentType, char* buffer, size_t capacity,
+                    StatusBuilder builder, void* context);
+
+    /**
+     * Rebuild an endpoint's body for every request instead of caching it
+     *
+     * For cheap bodies that should always be current, such as metrics.
+     *
+     * :param int endpoint: Endpoint index from addEndpoint()
+     * :param bool live: True to rebuild per request
+     */
+    void setLive(int endpoint, bool live);
+
+    /**
+     * Enable long polling and ETags for an endpoint
+     *
+     * :param int endpoint: Endpoint index from addEndpoint()
+     * :param StatusVersion version: Returns the current content version
+     */
+    void setLongPoll(int endpoint, StatusVersion version);
+
+    /**
+     * Accept POST requests on an endpoint
+     *
+     * The action writes its response into the endpoint's buffer, so a
+     * cached body is rebuilt after each POST.
+     *
+     * :param int endpoint: Endpoint index from addEndpoint()
+     * :param StatusAction action: Handles the request body
+     */
+    void setAction(int endpoint, StatusAction action);
+
+    /**
+     * Require a shared secret on every POST
+     *
+     * A POST must then carry "Authorization: Bearer <token>", or it is
+     * answered 401 without running the action. Without a token, POSTs are
+     * not checked.
+     *
+     * :param const char* token: Secret (must outlive the server), or nullptr for none
+     */
+    void setActionToken(const char* token);
+
+    /**
+     * Start listening on all interfaces
+     *
+     * :param uint16_t port: TCP port (0 picks a free port, for tests)
+     * :return bool: True if the socket is listening
+     */
+    bool begin(uint16_t port);
+
+    /**
+     * Stop listening and close the socket
+     */
+    void stop();
+
+    /**
+     * Get the port the server is listening on
+     *
+     * :return uint16_t: Port number (0 if not listening)
+     */
+    uint16_t getPort() const;
+
+    /**
+     * Rebuild every endpoint's cached body (live endpoints are left alone)
+     *
+     * :param uint64_t nowMs: Current monoMillis() value (for the Age header)
+     */
+    void rebuild(uint64_t nowMs);
+
+    /**
+     * Rebuild one endpoint's cached body
+     *
+     * :param int endpoint: Endpoint index from addEndpoint()
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void rebuild(int endpoint, uint64_t nowMs);
+
+    /**
+     * Accept connections and move each one along as far as it can go
+     * without waiting
+     *
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return int: Number of requests answered
+     */
+    int poll(uint64_t nowMs);
+
+    /**
+     * Counters since boot
+     */
+    unsigned long getRequestCount() const;   // Requests answered with 200
+    unsigned long getErrorCount() const;     // Requests answered with 4xx or dropped
+    unsigned long getRebuildCount() const;   // Endpoint bodies built
+    int getParkedCount() const;              // Long-poll requests waiting now
+
+private:
+    struct Endpoint {
+        const char* path;
+        const char* contentType;
+        char* buffer;
+        size_t capacity;
+        size_t length;
+        StatusBuilder builder;
+        void* context;
+        bool built;
+        bool live;
+        StatusVersion version;
+        StatusAction action;
+        uint64_t builtMs;
+        int senders;          // Responses still being sent from the buffer
+        bool rebuildPending;  // Rebuild once the last of them is out
+    };
+
+    enum ConnectionState : uint8_t {
+        CONN_FREE,
+        CONN_READING,   // Receiving the request
+        CONN_READY,     // Request read; waiting for its endpoint's buffer
+        CONN_PARKED,    // Long poll waiting for a change
+        CONN_WRITING    // Sending the response
+    };
+
+    struct Connection {
+        int fd;
+        ConnectionState state;
+        char buffer[STATUS_REQUEST_MAX_LEN + 1];  // The request, then the response header
+        size_t length;        // Bytes of request read, or of response header to send
+        size_t headerLength;  // Request header size once complete (0 before)
+        size_t bodyLength;    // POST body to read, or endpoint body to send
+        size_t sent;          // Response bytes sent (header, then body)
+        int endpoint;         // Endpoint whose buffer follows the header (or long-polled), or -1
+        uint32_t since;       // Version a long poll waits to change
+        bool success;         // The response counts as a request answered
+        uint64_t startedMs;   // When the current state began
+    };
+
+    Endpoint _endpoints[STATUS_MAX_ENDPOINTS];
+    int _endpointCount;
+    Connection _connections[STATUS_MAX_CONNECTIONS];
+    int _answered;  // Responses started during the current poll()
+    int _listenFd;
+    uint16_t _port;
+    unsigned long _requests;
+    unsigned long _errors;
+    unsigned long _rebuilds;
+    const char* _actionToken;
+
+    void _step(Connection& c, uint64_t nowMs);
+    void _read(Connection& c, uint64_t nowMs);
+    bool _checkHeaders(Connection& c, uint64_t nowMs);
+    void _respond(Connection& c, uint64_t nowMs);
+    void _pollParked(Connection& c, uint64_t nowMs);
+    void _write(Connection& c, uint64_t nowMs);
+    void _startWriting(Connection& c, size_t headerLength, int endpoint, size_t bodyLength, bool success,
+                       uint64_t nowMs);
+    void _finish(Connection& c, uint64_t nowMs);
+    void _sendBody(Connection& c, int index, bool head, uint64_t nowMs);
+    void _runAction(Connection& c, int index, char* body, uint64_t nowMs);
+    void _sendStatus(Connection& c, int code, const char* reason, uint64_t nowMs);
+    bool _authorized(const char* request, size_t headerLength) const;
+    int _findEndpoint(const char* path, size_t pathLen) const;
+};
+
+#endif // STATUS_SERVER_H
@@ -2,6 +2,12 @@
 #define TIME_UTILS_H
 
 #include <Arduino.h>
+#include <time.h>
+
+/**
+ * Clock readings before this (2020-01-01 UTC) mean the clock was never set
+ */
+#define TIME_VALID_AFTER_SEC 1577836800L
 
 /**
  * Structure to hold formatted time data
@@ -14,18 +20,72 @@ struct TimeData {
     bool isValid;  // True if time was retrieved successfully
 };
 
+/**
+ * Check whether a wall-clock reading comes from a set clock
+ * 
+ * :param time_t now: Value from time()
+ * :return bool: True once NTP (or anything else) has set the clock
+ */
+inline bool isClockSet(time_t now) {
+    return now >= TIME_VALID_AFTER_SEC;
+}
+
 /**
  * TimeManager class to handle NTP sync and time formatting
+ * 
+ * begin() starts SNTP with the servers and TIMEZONE_RULE from config.h.
+ * The first sync and every resync (NTP_RESYNC_INTERVAL_MS) happen in the
+ * network stack's own task, so nothing here blocks the display loop, and
+ * none of the getters wait for the clock to be set.
+ * 
+ * Wall-clock time is for showing times of day only. Elapsed times keep
+ * using monoMillis(), which never jumps when a sync corrects the clock.
+ * 
+ * Example usage:
+ * ```cpp
+ * TimeManager timeManager;
+ * timeManager.begin();   // After Wi-Fi connects
+ * TimeData now = timeManager.getCurrentTime();
+ * if (now.isValid) display.showTime(now.hour, now.minute, now.second, now.isPM);
+ * ```
  */
 class TimeManager {
 public:
     TimeManager();
     
+    /**
+     * Start SNTP and set the time zone rule
+     */
+    void begin();
+    
     /**
      * Synchronize time with NTP servers
+     * 
+     * Kept for compatibility; same as begin().
      */
     void syncNTP();
     
+    /**
+     * Check whether the clock has been set
+     * 
+     * :return bool: True once the first sync completed
+     */
+    bool isSynced() const;
+    
+    /**
+     * Get the number of completed NTP syncs since boot
+     * 
+     * :return unsigned long: Sync count
+     */
+    unsigned long getSyncCount() const;
+    
+    /**
+     * Get when the last NTP sync completed
+     * 
+     * :return uint64_t: monoMillis() value of the last sync, 0 if none
+     */
+    uint64_t getLastSyncMs() const;
+    
     /**
      * Get the current time formatted for display
      * 
@@ -41,6 +101,16 @@ public:
      * :return bool: True if time was formatted successfully
      */
     bool getFormattedTime(char* buffer, size_t bufferSize);
+    
+    /**
+     * Format a wall-clock time as a 12-hour "H:MM" (e.g., "12:41")
+     * 
+     * :param time_t when: Time to format
+     * :param char* buffer: Output buffer (min 6 chars)
+     * :param size_t bufferSize: Size of the buffer
+     * :return bool: True if formatted (false if the clock isn't set)
+     */
+    static bool formatClockTime(time_t when, char* buffer, size_t bufferSize);
 };
 
 #endif // TIME_UTILS_H
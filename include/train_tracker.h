@@ -0,0 +1,260 @@
+#ifndef TRAIN_TRACKER_H
+#define TRAIN_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum length for destination name (first 4 letters only for LED display)
+ */
+#define DEST_MAX_LEN 5
+
+/**
+ * Maximum length for minutes string ("ARR", "BRD", or number)
+ */
+#define MIN_MAX_LEN 4
+
+/**
+ * Maximum length for line code (e.g., "RD", "BL")
+ */
+#define LINE_MAX_LEN 3
+
+/**
+ * Maximum number of trains tracked across polls
+ */
+#define MAX_TRACKED_TRAINS 12
+
+/**
+ * Polls a train may be missing from the feed before it is dropped
+ */
+#define TRACK_MISS_LIMIT 2
+
+/**
+ * Largest ETA difference (ms) at which an observation still matches a track
+ */
+#define TRACK_MATCH_WINDOW_MS 180000
+
+/**
+ * Difference (ms) above which a track jumps to the new ETA instead of filtering
+ */
+#define TRACK_RESYNC_MS 120000
+
+/**
+ * Weight of a new observation in the filtered ETA, as a fraction
+ */
+#define TRACK_GAIN_NUM 1
+#define TRACK_GAIN_DEN 2
+
+/**
+ * How long a departed train is reported as "just left" (ms)
+ */
+#define TRACK_DEPARTED_HOLD_MS 20000
+
+/**
+ * Number of recent departures remembered
+ */
+#define TRACK_DEPARTURE_HISTORY 4
+
+/**
+ * ETA assumed for a train reported as "ARR" (ms)
+ */
+#define ARRIVING_ETA_MS 15000
+
+/**
+ * Train status as reported by WMATA's "Min" field
+ */
+enum TrainStatus {
+    TRAIN_MOVING,    // Numeric minutes
+    TRAIN_ARRIVING,  // "ARR"
+    TRAIN_BOARDING   // "BRD"
+};
+
+/**
+ * One prediction from a single poll, normalized for tracking
+ */
+struct TrainObservation {
+    char line[LINE_MAX_LEN];         // Line code (RD, BL, OR, etc.)
+    char destination[DEST_MAX_LEN];  // Truncated destination name
+    uint8_t group;                   // Track group (1 or 2), 0 if unknown
+    uint8_t cars;                    // Train length, 0 if unknown
+    uint8_t status;                  // TrainStatus
+    long etaMs;                      // Time until arrival
+};
+
+/**
+ * A train followed across polls with a filtered ETA
+ */
+struct TrackedTrain {
+    char line[LINE_MAX_LEN];
+    char destination[DEST_MAX_LEN];
+    uint8_t group;
+    uint8_t cars;
+    uint8_t status;
+    uint8_t misses;           // Consecutive polls without a matching observation
+    uint16_t id;              // Stable identifier while the train is tracked
+    long etaMs;               // Filtered ETA as of updatedMs
+    uint64_t updatedMs;       // monoMillis() of the last filter update
+};
+
+/**
+ * A train that was boarding and then left the feed
+ */
+struct DepartureEvent {
+    char line[LINE_MAX_LEN];
+    char destination[DEST_MAX_LEN];
+    uint8_t group;
+    uint16_t id;
+    uint64_t departedMs;
+};
+
+/**
+ * Parse WMATA's "Min" field into a status and an ETA
+ * 
+ * Numeric values are taken as the middle of the reported minute so the
+ * countdown rounds down to what WMATA shows.
+ * 
+ * :param const char* minutes: "BRD", "ARR", or a number of minutes
+ * :param uint8_t& status: Output TrainStatus
+ * :param long& etaMs: Output time until arrival
+ * :return bool: False if the value is empty or not understood (e.g., "---")
+ */
+bool parseTrainMinutes(const char* minutes, uint8_t& status, long& etaMs);
+
+/**
+ * Associates predictions across polls and smooths their ETAs
+ * 
+ * WMATA's minute values jitter between polls (4 -> 5 -> 3) and trains can
+ * briefly vanish from the feed. The tracker matches each observation to a
+ * known train by line, destination, group and car count (closest ETA wins),
+ * blends the new ETA into a running estimate that counts down between polls,
+ * and keeps missing trains alive for a few polls. A train that disappears
+ * after boarding is recorded as a departure.
+ * 
+ * Example usage:
+ * ```cpp
+ * TrainTracker tracker;
+ * tracker.update(observations, count, monoMillis());
+ * int index = tracker.findNext(1, monoMillis());
+ * if (index >= 0) {
+ *     char minutes[MIN_MAX_LEN];
+ *     tracker.formatMinutes(tracker.getTrain(index), monoMillis(), minutes, sizeof(minutes));
+ * }
+ * ```
+ */
+class TrainTracker {
+public:
+    TrainTracker();
+    
+    /**
+     * Drop all tracked trains and departure history
+     */
+    void reset();
+    
+    /**
+     * Fold one poll's observations into the tracked trains
+     * 
+     * :param const TrainObservation* observations: Predictions from the poll
+     * :param int count: Number of observations
+     * :param uint64_t nowMs: monoMillis() when the poll completed
+     */
+    void update(const TrainObservation* observations, int count, uint64_t nowMs);
+    
+    /**
+     * Get the number of tracked trains
+     * 
+     * :return int: Tracked train count (0 to MAX_TRACKED_TRAINS)
+     */
+    int getCount() const;
+    
+    /**
+     * Get a tracked train by slot index
+     * 
+     * :param int index: Index from 0 to getCount() - 1
+     * :return const TrackedTrain&: The tracked train
+     */
+    const TrackedTrain& getTrain(int index) const;
+    
+    /**
+     * Find the next train to arrive in a group
+     * 
+     * :param uint8_t group: Track group to search
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return int: Index of the train, or -1 if none
+     */
+    int findNext(uint8_t group, uint64_t nowMs) const;
+    
+    /**
+     * Find the next few trains to arrive in a group, soonest first
+     * 
+     * Keeps only the best maxCount while scanning, so the work and the
+     * output stay bounded however many trains are tracked. The order is the
+     * same as findNext()'s, and holds until the next update() since every
+     * ETA counts down at the same rate.
+     * 
+     * :param uint8_t group: Track group to search
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param TrackedTrain* trains: Output copies of the trains
+     * :param int maxCount: Size of the output array
+     * :return int: Number of trains written (0 to maxCount)
+     */
+    int findUpcoming(uint8_t group, uint64_t nowMs, TrackedTrain* trains, int maxCount) const;
+    
+    /**
+     * Get a train's ETA projected to the given time
+     * 
+     * :param const TrackedTrain& train: The tracked train
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :return long: Time until arrival in ms (never negative)
+     */
+    long getEtaMs(const TrackedTrain& train, uint64_t nowMs) const;
+    
+    /**
+     * Format a train's arrival as shown on the panel ("BRD", "ARR" or minutes)
+     * 
+     * :param const TrackedTrain& train: The tracked train
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param char* buffer: Output buffer
+     * :param size_t bufferSize: Size of the output buffer (MIN_MAX_LEN recommended)
+     */
+    void formatMinutes(const TrackedTrain& train, uint64_t nowMs, char* buffer, size_t bufferSize) const;
+    
+    /**
+     * Get the most recent departure in a group, if it was recent
+     * 
+     * :param uint8_t group: Track group to search
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param DepartureEvent& event: Output departure
+     * :return bool: True if a train left within TRACK_DEPARTED_HOLD_MS
+     */
+    bool getRecentDeparture(uint8_t group, uint64_t nowMs, DepartureEvent& event) const;
+    
+    /**
+     * Get the number of remembered departures
+     * 
+     * :return int: Departure count (0 to TRACK_DEPARTURE_HISTORY)
+     */
+    int getDepartureCount() const;
+    
+    /**
+     * Get a remembered departure, newest first
+     * 
+     * :param int n: 0 for the most recent departure
+     * :return const DepartureEvent&: The departure
+     */
+    const DepartureEvent& getDeparture(int n) const;
+
+private:
+    TrackedTrain _trains[MAX_TRACKED_TRAINS];
+    int _count;
+    uint16_t _nextId;
+    DepartureEvent _departures[TRACK_DEPARTURE_HISTORY];
+    int _departureCount;
+    int _departureHead;
+    
+    bool _arrivesBefore(const TrackedTrain& a, const TrackedTrain& b, uint64_t nowMs) const;
+    int _findMatch(const TrainObservation& observation, uint64_t nowMs, const bool* matched) const;
+    void _recordDeparture(const TrackedTrain& train, uint64_t nowMs);
+    void _remove(int index);
+};
+
+#endif // TRAIN_TRACKER_H
@@ -5,19 +5,36 @@
 
 /**
  * WifiManager class to handle WiFi connection
+ * 
+ * The ESP32 core reconnects on its own after a drop; update() watches the
+ * link so drops and recoveries can be counted for monitoring.
  */
 class WifiManager {
 public:
     WifiManager();
     
     /**
-     * Connect to WiFi network using credentials from config
+     * Use other credentials than the ones from config
+     * 
+     * :param const char* ssid: Network name (must stay valid)
+     * :param const char* password: Password, empty for an open network (must stay valid)
+     */
+    void setCredentials(const char* ssid, const char* password);
+    
+    /**
+     * Connect to WiFi network using the current credentials
      * 
      * :param unsigned long timeoutMs: Connection timeout in milliseconds
      * :return bool: True if connected successfully
      */
     bool connect(unsigned long timeoutMs = 30000);
     
+    /**
+     * Drop the link and join again with the current credentials, without
+     * waiting; update() reports when the link comes back
+     */
+    void reconnect();
+    
     /**
      * Check if WiFi is currently connected
      * 
@@ -31,6 +48,39 @@ public:
      * :return String: The IP address
      */
     String getIPAddress();
+    
+    /**
+     * Track the link state; call from the main loop
+     */
+    void update();
+    
+    /**
+     * Get the signal strength of the current connection
+     * 
+     * :return int: RSSI in dBm (0 when disconnected)
+     */
+    int getRssi();
+    
+    /**
+     * Get the number of times the connection dropped since boot
+     * 
+     * :return unsigned long: Disconnect count
+     */
+    unsigned long getDisconnectCount() const;
+    
+    /**
+     * Get the number of times the connection came back after a drop
+     * 
+     * :return unsigned long: Reconnect count
+     */
+    unsigned long getReconnectCount() const;
+
+private:
+    const char* _ssid;
+    const char* _password;
+    bool _connected;
+    unsigned long _disconnects;
+    unsigned long _reconnects;
 };
 
 #endif // WIFI_MANAGER_H
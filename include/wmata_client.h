@@ -2,6 +2,19 @@
 #define WMATA_CLIENT_H
 
 #include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include "train_tracker.h"
+#include "rail_incidents.h"
+#include "rate_governor.h"
+#include "prediction_snapshot.h"
+#include "latency_histogram.h"
+#include "fetch_budget.h"
+#include "dns_cache.h"
+#include "time_utils.h"
+#include "prediction_provider.h"
+#include "wmata_json_provider.h"
+#include "bus_predictions.h"
 
 /**
  * Maximum number of trains to store/display
@@ -9,32 +22,124 @@
 #define MAX_TRAINS 2
 
 /**
- * Maximum length for destination name (first 4 letters only for LED display)
+ * Trains kept per direction for the carousel's group pages
  */
-#define DEST_MAX_LEN 5
+#define MAX_TRAINS_PER_GROUP 3
 
 /**
- * Maximum length for minutes string ("ARR", "BRD", or number)
+ * Maximum number of predictions read from a single response
  */
-#define MIN_MAX_LEN 4
+#define MAX_OBSERVATIONS 16
 
 /**
- * Maximum length for line code (e.g., "RD", "BL")
+ * Longest a prediction request waits for a rate governor token (ms)
  */
-#define LINE_MAX_LEN 3
+#define WMATA_MAX_TOKEN_WAIT_MS 1000
+
+/**
+ * Returned by _get() in place of an HTTP code when the rate governor
+ * refused the request
+ */
+#define WMATA_ERROR_THROTTLED -100
+
+/**
+ * Returned by _get() when a phase of the request ran over its budget
+ */
+#define WMATA_ERROR_TIMEOUT -101
+
+/**
+ * Latency budget of each request phase (ms); see FetchBudget
+ * 
+ * A half-open connection or a stalled server fails the request after
+ * these instead of holding the loop until TCP gives up.
+ */
+#define WMATA_DNS_BUDGET_MS 2000
+#define WMATA_CONNECT_BUDGET_MS 3000
+#define WMATA_FIRST_BYTE_BUDGET_MS 5000
+#define WMATA_BODY_BUDGET_MS 4000
+#define WMATA_PARSE_BUDGET_MS 1000
+
+/**
+ * Cap on a whole request, from DNS lookup to parsed response (ms)
+ */
+#define WMATA_TOTAL_BUDGET_MS 10000
+
+/**
+ * Size of the buffer responses are read into
+ * 
+ * Longer responses are cut off: predictions then fail, and for incidents
+ * the ones that arrived complete are kept.
+ */
+#define WMATA_BODY_BUFFER_SIZE 8192
+
+/**
+ * How long bus predictions stay on the panel without a successful bus
+ * fetch (ms); after that the bus pages are skipped
+ */
+#define WMATA_BUS_STALE_MS 300000
+
+/**
+ * Called when a request moves to another phase
+ * 
+ * :param uint8_t phase: FetchPhase value
+ * :param void* context: Context given to setPhaseListener()
+ */
+typedef void (*FetchPhaseListener)(uint8_t phase, void* context);
+
+class DeadlineStream;
 
 /**
  * Structure to hold a single train prediction
  */
 struct TrainPrediction {
     char destination[DEST_MAX_LEN];  // Truncated destination name
-    char minutes[MIN_MAX_LEN];       // Minutes until arrival ("ARR", "BRD", or number)
+    char minutes[MIN_MAX_LEN];       // Minutes until arrival ("ARR", "BRD", "LFT", or number)
     char line[LINE_MAX_LEN];         // Line code (RD, BL, OR, etc.)
+    time_t arrival;                  // Wall-clock arrival, 0 if the clock isn't set (or "LFT")
+};
+
+/**
+ * The next trains in one direction, chosen once per fetch
+ * 
+ * The trains are copies, so they count down with TrainTracker::getEtaMs()
+ * and formatMinutes() until the next fetch replaces them. Their arrivals
+ * are also kept as wall-clock times, which stay put between fetches.
+ */
+struct GroupBoard {
+    uint8_t group;                              // Track group
+    uint8_t count;                              // Trains in trains[]
+    TrackedTrain trains[MAX_TRAINS_PER_GROUP];  // Soonest first
+    time_t arrivals[MAX_TRAINS_PER_GROUP];      // Wall-clock arrival of each, 0 if the clock isn't set
 };
 
 /**
  * WMATA API client for fetching real-time train predictions
  * 
+ * What is fetched and how it is decoded is up to a PredictionProvider:
+ * WMATA's own JSON API by default, or any agency's GTFS-realtime feed
+ * (GtfsRtProvider). The client does the rest the same way for both.
+ * 
+ * Predictions are folded into a TrainTracker, so minute values count down
+ * smoothly between polls and don't jitter when WMATA's estimate wobbles.
+ * One train is shown per direction (Group), ordered by group so rows stay
+ * put. For a few seconds after a boarding train leaves, its row shows "LFT".
+ * The next MAX_TRAINS_PER_GROUP trains of each direction are picked once per
+ * fetch (see findBoard()), so nothing is re-sorted while the panel redraws.
+ * 
+ * Rail incidents are fetched separately (and much less often) over the same
+ * keep-alive connection, and only those affecting the station's lines are kept.
+ * 
+ * Bus predictions for nearby stops (see setBusStops()) are another separate
+ * fetch, on their own schedule. They are normalized into the same records
+ * as trains and followed by a tracker of their own, with one board per stop.
+ * 
+ * Every request goes through the RateGovernor, if one is given, which can be
+ * shared by clients for several stations using the same API key. Predictions
+ * are high priority; incidents and station info are background requests.
+ * 
+ * A client can also be fed from another panel's snapshot instead of the
+ * API (see applySnapshot()), so several panels can share one fetcher.
+ * 
  * Example usage:
  * ```cpp
  * WmataClient client("B35", WMATA_API_KEY);
@@ -51,37 +156,236 @@ public:
      * 
      * :param const char* stationCode: WMATA station code (e.g., "B35" for NoMA)
      * :param const char* apiKey: WMATA API key
+     * :param RateGovernor* governor: Shared request governor (nullptr for no limit)
+     * :param PredictionProvider* provider: Where predictions come from
+     *     (nullptr for WMATA's StationPrediction API)
      */
-    WmataClient(const char* stationCode, const char* apiKey);
+    WmataClient(const char* stationCode, const char* apiKey, RateGovernor* governor = nullptr,
+                PredictionProvider* provider = nullptr);
     
     /**
-     * Fetch train predictions from WMATA API
+     * Fetch train predictions from the provider's feed
      * 
      * :return bool: True if fetch was successful, false otherwise
      */
     bool fetchPredictions();
     
     /**
-     * Get the number of trains currently stored (max 2)
+     * Get the name of the provider predictions come from
+     * 
+     * :return const char*: Provider name, e.g. "WMATA" or "GTFS-rt"
+     */
+    const char* getProviderName() const;
+    
+    /**
+     * Fetch rail incidents and keep those affecting this station's lines
+     * 
+     * The station's lines come from WMATA's station info (fetched once)
+     * plus every line seen in predictions. The previous incidents are kept
+     * if the fetch fails.
+     * 
+     * :return bool: True if fetch was successful, false otherwise
+     */
+    bool fetchIncidents();
+    
+    /**
+     * Set the bus stops whose predictions fetchBusPredictions() gets
+     * 
+     * :param const char* const* stopIds: WMATA bus stop IDs; not copied, so
+     *     they must outlive the client
+     * :param int count: Number of stops (only the first MAX_BUS_STOPS are used)
+     */
+    void setBusStops(const char* const* stopIds, int count);
+    
+    /**
+     * Fetch bus predictions for every bus stop, one request per stop
+     * 
+     * Each stop's response is read one prediction at a time, keeping only
+     * its MAX_BUS_PER_STOP soonest buses, so parse memory stays the same
+     * however many routes serve the stop. The previous buses are kept if any
+     * stop's fetch fails.
+     * 
+     * :return bool: True if every stop was fetched, false otherwise (or if no stops are set)
+     */
+    bool fetchBusPredictions();
+    
+    /**
+     * Get the next buses at a stop, as of the last bus fetch
+     * 
+     * :param uint8_t stop: Stop number (1 for the first stop set)
+     * :return const GroupBoard*: The stop's buses, or nullptr if none or
+     *     older than WMATA_BUS_STALE_MS
+     */
+    const GroupBoard* findBusBoard(uint8_t stop) const;
+    
+    /**
+     * Get the tracker holding every bus seen across bus fetches
+     * 
+     * :return const TrainTracker&: The bus tracker
+     */
+    const TrainTracker& getBusTracker() const;
+    
+    /**
+     * Get the incidents affecting this station from the last successful fetch
+     * 
+     * :return const IncidentList&: Filtered incidents
+     */
+    const IncidentList& getIncidents() const;
+    
+    /**
+     * Get the lines known to serve this station
+     * 
+     * :return uint8_t: Mask of LINE_MASK_* bits (0 until known)
+     */
+    uint8_t getStationLines() const;
+    
+    /**
+     * Get the number of API requests made since boot
+     * 
+     * :return unsigned long: Request count (all endpoints)
+     */
+    unsigned long getRequestCount() const;
+    
+    /**
+     * Get the number of prediction fetches that succeeded
+     * 
+     * :return unsigned long: Successful fetches since boot
+     */
+    unsigned long getFetchSuccessCount() const;
+    
+    /**
+     * Get the number of prediction fetches that failed (network, HTTP
+     * or parse errors; throttled requests are not counted)
+     * 
+     * :return unsigned long: Failed fetches since boot
+     */
+    unsigned long getFetchFailureCount() const;
+    
+    /**
+     * Get the latencies of successful prediction fetches, from sending
+     * the request to the end of parsing
+     * 
+     * :return const LatencyHistogram&: Fetch latency histogram
+     */
+    const LatencyHistogram& getFetchLatency() const;
+    
+    /**
+     * Check whether the last fetch failed because the rate governor
+     * refused the request (rather than a network or API error)
+     * 
+     * :return bool: True if the last request was throttled
+     */
+    bool wasThrottled() const;
+    
+    /**
+     * Get notified whenever a request moves to another phase
+     * 
+     * Called on the fetching task, so the listener must be quick.
+     * 
+     * :param FetchPhaseListener listener: Callback, or nullptr to stop
+     * :param void* context: Passed back to the listener
+     */
+    void setPhaseListener(FetchPhaseListener listener, void* context);
+    
+    /**
+     * Get the phase of the request in progress
+     * 
+     * :return uint8_t: FetchPhase value (FETCH_PHASE_IDLE between requests)
+     */
+    uint8_t getPhase() const;
+    
+    /**
+     * Get the latency budget, with overruns counted per phase
+     * 
+     * :return const FetchBudget&: Request budget
+     */
+    const FetchBudget& getFetchBudget() const;
+    
+    /**
+     * Get the cache of the API host's address, with its hit and fallback counts
+     * 
+     * :return const DnsCache&: DNS cache
+     */
+    const DnsCache& getDnsCache() const;
+    
+    /**
+     * Abort the request in progress by shutting its socket down
+     * 
+     * The only method that may be called from another task: a watchdog
+     * uses it to unblock a request stuck in a socket call, which then
+     * fails like any other network error. Only the socket the client has
+     * published for the request is touched, never one that was closed
+     * and handed out again.
+     */
+    void abortRequest();
+    
+    /**
+     * Fill a snapshot with the last fetch, for sending to follower panels
+     * 
+     * The leader id and sequence are left for the caller to set.
+     * 
+     * :param PredictionSnapshot& snapshot: Output snapshot
+     * :param uint64_t nowMs: Current monoMillis() value, used for the snapshot age
+     */
+    void fillSnapshot(PredictionSnapshot& snapshot, uint64_t nowMs) const;
+    
+    /**
+     * Update from a leader's snapshot as if this client had fetched it
+     * 
+     * The fetch time is backdated by the snapshot's age, so countdowns
+     * match the leader's.
+     * 
+     * :param const PredictionSnapshot& snapshot: Snapshot received from the leader
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void applySnapshot(const PredictionSnapshot& snapshot, uint64_t nowMs);
+    
+    /**
+     * Get the number of trains currently shown (max 2, one per direction)
      * 
      * :return int: Number of trains (0-2)
      */
     int getTrainCount() const;
     
     /**
-     * Get a train prediction by index
+     * Get a train prediction by index, projected to the current time
      * 
      * :param int index: Train index (0 or 1)
      * :return TrainPrediction: The train prediction data
      */
     TrainPrediction getTrain(int index) const;
     
+    /**
+     * Get the next trains in a direction, as of the last fetch
+     * 
+     * :param uint8_t group: Track group
+     * :return const GroupBoard*: The direction's trains, or nullptr if none
+     */
+    const GroupBoard* findBoard(uint8_t group) const;
+    
+    /**
+     * Get the tracker holding every train seen across polls
+     * 
+     * :return const TrainTracker&: The train tracker
+     */
+    const TrainTracker& getTracker() const;
+    
+    /**
+     * Check whether the last successful fetch returned different data
+     * than the one before it
+     * 
+     * Used by PollScheduler to learn when WMATA refreshes its feed.
+     * 
+     * :return bool: True if the predictions changed (always true on first fetch)
+     */
+    bool hasDataChanged() const;
+    
     /**
      * Get the timestamp of the last successful fetch
      * 
-     * :return unsigned long: millis() value when last fetched, 0 if never
+     * :return uint64_t: monoMillis() value when last fetched, 0 if never
      */
-    unsigned long getLastFetchTime() const;
+    uint64_t getLastFetchTime() const;
     
     /**
      * Get the station code this client is configured for
@@ -89,21 +393,216 @@ public:
      * :return const char*: Station code string
      */
     const char* getStationCode() const;
+    
+    /**
+     * Switch to another station or API key without rebuilding the client
+     * 
+     * A new station drops everything learned about the old one (trains,
+     * boards, incidents, station info), so the next fetch starts fresh.
+     * The connection, DNS cache and fetch health are kept.
+     * 
+     * :param const char* stationCode: WMATA station code
+     * :param const char* apiKey: WMATA API key
+     */
+    void reconfigure(const char* stationCode, const char* apiKey);
 
 private:
     char _stationCode[8];
     char _apiKey[64];
-    TrainPrediction _trains[MAX_TRAINS];
-    int _trainCount;
-    unsigned long _lastFetchTime;
+    WmataJsonProvider _wmataProvider;
+    PredictionProvider* _provider;
+    TrainTracker _tracker;
+    GroupBoard _boards[MAX_TRAINS];   // One per direction, in group order
+    int _boardCount;
+    uint64_t _lastFetchTime;
+    uint32_t _responseHash;
+    bool _dataChanged;
+    
+    // Observations from the last fetch, kept for snapshots
+    TrainObservation _observations[MAX_OBSERVATIONS];
+    int _observationCount;
+    
+    // Shared connection and request budget
+    WiFiClient _wifiClient;
+    HTTPClient _http;
+    char _host[64];                  // Host the connection is open to
+    RateGovernor* _governor;
+    unsigned long _requestCount;
+    uint64_t _requestStartMs;        // When the last request was sent
+    bool _throttled;
+    uint8_t _phase;
+    SemaphoreHandle_t _socketLock;   // Held while _activeFd is changed or shut down
+    int _activeFd;                   // Socket abortRequest() may shut down, or -1
+    FetchBudget _budget;
+    DnsCache _dns;
+    FetchPhaseListener _phaseListener;
+    void* _phaseContext;
+    
+    // Fetch health
+    unsigned long _fetchSuccesses;
+    unsigned long _fetchFailures;
+    LatencyHistogram _fetchLatency;
+    
+    // Incidents
+    IncidentList _incidents;
+    bool _hasStationInfo;
+    uint8_t _infoLines;       // Lines from station info
+    uint8_t _observedLines;   // Lines seen in predictions
+    char _bodyBuffer[WMATA_BODY_BUFFER_SIZE];
+    
+    // Buses
+    const char* const* _busStopIds;
+    int _busStopCount;
+    TrainTracker _busTracker;
+    GroupBoard _busBoards[MAX_BUS_STOPS];   // One per stop, in stop order
+    uint64_t _lastBusFetchTime;
+    
+    // Soonest buses of each stop, stop after stop
+    TrainObservation _busObservations[MAX_BUS_STOPS * MAX_BUS_PER_STOP];
+    
+    /**
+     * Fetch and parse predictions; fetchPredictions() adds the bookkeeping
+     * 
+     * :return bool: True if fetch was successful, false otherwise
+     */
+    bool _fetchPredictions();
+    
+    /**
+     * Fetch and filter incidents; fetchIncidents() adds station info and bookkeeping
+     * 
+     * :return bool: True if fetch was successful, false otherwise
+     */
+    bool _fetchIncidents();
+    
+    /**
+     * Fetch one stop's bus predictions and append its soonest buses to
+     * _busObservations
+     * 
+     * :param int index: Stop index into _busStopIds
+     * :param int& count: Observations so far; advanced past the stop's buses
+     * :return bool: True if fetch was successful, false otherwise
+     */
+    bool _fetchBusStop(int index, int& count);
+    
+    /**
+     * Start a GET request on the shared connection, if the rate governor allows it
+     * 
+     * High-priority requests wait up to WMATA_MAX_TOKEN_WAIT_MS for a token.
+     * The host is resolved and connected to here, rather than inside
+     * HTTPClient, so DNS and connect each get their own deadline. A request
+     * to another host than the open connection's closes it first.
+     * The caller must call _endHttp() afterwards.
+     * 
+     * :param const String& url: Full request URL (http only)
+     * :param RequestPriority priority: Request priority
+     * :return int: HTTP status code, a negative HTTPClient error,
+     *     WMATA_ERROR_THROTTLED or WMATA_ERROR_TIMEOUT
+     */
+    int _get(const String& url, RequestPriority priority);
+    
+    /**
+     * Move to another request phase and tell the listener
+     * 
+     * The socket is published to abortRequest() while the request waits
+     * on it (first byte and body), and withdrawn in every other phase.
+     * 
+     * :param uint8_t phase: FetchPhase value
+     */
+    void _setPhase(uint8_t phase);
+    
+    /**
+     * Set the socket abortRequest() may shut down (-1 for none)
+     * 
+     * Once this returns, the watchdog is done with the previous socket, so
+     * it can be closed and its descriptor reused safely.
+     * 
+     * :param int fd: Socket of the request in progress
+     */
+    void _publishSocket(int fd);
+    
+    /**
+     * Withdraw the socket from abortRequest(), then end the HTTP request
+     */
+    void _endHttp();
+    
+    /**
+     * Read the response body into _bodyBuffer (null-terminated), within the body budget
+     * 
+     * :param size_t& length: Set to the bytes read
+     * :param bool& truncated: Set if the body did not fit
+     * :return bool: False if the body budget ran out (the connection is dropped)
+     */
+    bool _readBody(size_t& length, bool& truncated);
+    
+    /**
+     * Pass the response body to the provider as it arrives, within the body budget
+     * 
+     * :return bool: False if the body budget ran out (the connection is dropped)
+     */
+    bool _streamBody();
+    
+    /**
+     * Receive the response body into a stream, within the body budget
+     * 
+     * :param DeadlineStream& body: Where the body goes
+     * :return bool: False if the body budget ran out (the connection is dropped)
+     */
+    bool _receive(DeadlineStream& body);
+    
+    /**
+     * Drop the connection after a phase ran over its budget
+     * 
+     * :return int: WMATA_ERROR_TIMEOUT
+     */
+    int _abortOverBudget();
+    
+    /**
+     * Check the parse budget and return to FETCH_PHASE_IDLE at the end of a request
+     */
+    void _finishRequest();
+    
+    /**
+     * Fetch the lines serving the station from WMATA's station info
+     * 
+     * :return bool: True if fetch was successful, false otherwise
+     */
+    bool _fetchStationInfo();
+    
+    /**
+     * Pick the tracked train shown in each direction, in group order
+     * 
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param uint8_t groups[]: Output group of each selected train
+     * :return int: Number of directions with a train (0 to MAX_TRAINS)
+     */
+    int _selectGroups(uint64_t nowMs, uint8_t groups[MAX_TRAINS]) const;
+    
+    /**
+     * Pick each direction's next trains after the tracker was updated
+     * 
+     * :param uint64_t nowMs: Current monoMillis() value
+     */
+    void _buildBoards(uint64_t nowMs);
+    
+    /**
+     * Fill a board with a group's next trains (or a stop's next buses)
+     * 
+     * :param const TrainTracker& tracker: Tracker to pick from
+     * :param uint8_t group: Track group, or stop number for buses
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param GroupBoard& board: Output board
+     */
+    void _fillBoard(const TrainTracker& tracker, uint8_t group, uint64_t nowMs, GroupBoard& board) const;
     
     /**
-     * Parse a single train JSON object into TrainPrediction
+     * Get the boards that still have something to show: trains, or a
+     * train that just left
      * 
-     * :param JsonObject& trainObj: The JSON object for a train
-     * :param TrainPrediction& prediction: Output prediction struct
+     * :param uint64_t nowMs: Current monoMillis() value
+     * :param int indices[]: Output indices into _boards
+     * :return int: Number of boards (0 to MAX_TRAINS)
      */
-    void _parseTrainObject(const char* destination, const char* minutes, const char* line, TrainPrediction& prediction);
+    int _liveBoards(uint64_t nowMs, int indices[MAX_TRAINS]) const;
 };
 
 #endif // WMATA_CLIENT_H
@@ -0,0 +1,60 @@
+#ifndef WMATA_JSON_PROVIDER_H
+#define WMATA_JSON_PROVIDER_H
+
+#include "prediction_provider.h"
+
+/**
+ * Predictions from WMATA's StationPrediction API (JSON)
+ *
+ * The body is collected into a caller-supplied buffer and parsed with
+ * ArduinoJson once it is complete; a response that doesn't fit fails.
+ *
+ * Example usage:
+ * ```cpp
+ * static char body[8192];
+ * WmataJsonProvider provider("B35", WMATA_API_KEY, body, sizeof(body));
+ * WmataClient client("B35", WMATA_API_KEY, &governor, &provider);
+ * ```
+ */
+class WmataJsonProvider : public PredictionProvider {
+public:
+    /**
+     * Constructor
+     *
+     * :param const char* stationCode: WMATA station code (e.g., "B35"); not copied
+     * :param const char* apiKey: WMATA API key; not copied
+     * :param char* buffer: Buffer the body is collected in (may be shared
+     *     with other requests, as it is only used during a fetch)
+     * :param size_t size: Size of the buffer
+     */
+    WmataJsonProvider(const char* stationCode, const char* apiKey, char* buffer, size_t size);
+
+    const char* getName() const override;
+    bool buildUrl(char* url, size_t size) const override;
+    void begin(time_t wallNow) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    bool finish(TrainObservation* observations, int maxCount, int& count, uint32_t& hash) override;
+    const char* getError() const override;
+
+private:
+    const char* _stationCode;
+    const char* _apiKey;
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _truncated;
+    const char* _error;
+
+    /**
+     * Copy a train's identifying fields into a TrainObservation
+     *
+     * :param const char* destination: Destination name (truncated to fit LED display)
+     * :param const char* line: Line code
+     * :param const char* group: Track group ("1" or "2")
+     * :param const char* cars: Number of cars ("6", "8", or "-")
+     * :param TrainObservation& observation: Output observation struct
+     */
+    void _parseTrainObject(const char* destination, const char* line, const char* group, const char* cars, TrainObservation& observation);
+};
+
+#endif // WMATA_JSON_PROVIDER_H
@@ -100,6 +100,13 @@ else:
     print("⚠ Warning: WIFI_PASSWORD not found in .env file")
     print("  Add to .env: WIFI_PASSWORD=your_password")
 
+if "CONFIG_TOKEN" in env_vars and env_vars["CONFIG_TOKEN"]:
+    config_token = env_vars["CONFIG_TOKEN"]
+    build_flags.append(f'-DCONFIG_TOKEN=\\"{config_token}\\"')
+    print(f"✓ CONFIG_TOKEN loaded from .env; POST /config is on")
+else:
+    print("ℹ CONFIG_TOKEN not in .env, POST /config is off (the serial console can still change settings)")
+
 # Append build flags to the environment
 env.Append(CPPDEFINES=[])
 for flag in build_flags:
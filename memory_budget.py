@@ -0,0 +1,377 @@
+"""
+Report static RAM and flash use per module from the linker map, and check
+each module against its budget.
+
+Runs after the firmware is linked (as a PlatformIO extra script). It reads
+the GNU ld map, adds up every input section by the object or library it
+came from, prints the table and writes it to memory_report.txt in the build
+directory. Budgets are checked in as memory_budget.txt. A module over
+its RAM or flash budget, or without a budget, fails the build, so growth
+is a deliberate change to that file rather than a surprise on the device.
+custom_memory_budget_enforce = no in platformio.ini only reports them.
+
+Usage:
+    Build as usual; the report is printed after linking. To see it again:
+       pio run -t memory_budget
+
+    After a change that needs more room, raise the budgets from the last
+    build (with some headroom) and commit memory_budget.txt:
+       python memory_budget.py .pio/build/esp32dev/firmware.map --update
+
+    If memory_budget.txt is missing, the first firmware build writes it
+    this way and stops, so the generated budgets get reviewed and
+    committed before anything is checked against them.
+
+Budget format (memory_budget.txt):
+    One "module ram flash" row per line, in bytes; # starts a comment.
+    The "*" row applies to every module without a row of its own; with no
+    "*" row, a module needs its own.
+
+Modules:
+    Objects from src/ are named by their file (main.cpp.o is "main"),
+    libraries by their archive (libFrameworkArduino.a is "FrameworkArduino").
+
+Heap use at runtime isn't in the map; see the heap console command and
+the heap_step_* metrics for that.
+"""
+
+import os
+import re
+import sys
+
+BUDGET_FILE = "memory_budget.txt"
+REPORT_FILE = "memory_report.txt"
+DEFAULT_MODULE = "*"
+
+# Headroom added by --update, and what budgets are rounded up to
+UPDATE_HEADROOM = 0.10
+BUDGET_ROUNDING = 256
+
+# ESP32 output sections by where their contents live. Initialized data and
+# code that runs from RAM take both: flash for the image, RAM at runtime.
+RAM_AND_FLASH_SECTIONS = (
+    ".iram0.vectors", ".iram0.text", ".iram0.data",
+    ".dram0.data",
+    ".rtc.text", ".rtc.data", ".rtc.force_fast", ".rtc.force_slow",
+)
+RAM_SECTIONS = (".dram0.bss", ".iram0.bss", ".noinit", ".rtc.bss", ".rtc_noinit")
+FLASH_SECTIONS = (".flash.appdesc", ".flash.rodata", ".flash.text")
+
+# Any other toolchain (e.g. a host build of the native tests)
+GENERIC_RAM_AND_FLASH = (".data",)
+GENERIC_RAM = (".bss", ".tbss")
+GENERIC_FLASH = (".text", ".rodata", ".init_array", ".fini_array")
+
+INPUT_SECTION = re.compile(
+    r"^ (?P<name>\.\S+|COMMON)(?:\s+0x(?P<addr>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+)\s+(?P<obj>\S.*))?$")
+CONTINUATION = re.compile(r"^\s+0x(?P<addr>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+)\s+(?P<obj>\S.*)$")
+
+
+def section_kind(output_section):
+    """
+    Work out where an output section lives.
+
+    :param str output_section: Output section name from the map, e.g. .dram0.bss
+    :return tuple: (counts towards RAM, counts towards flash), or None to skip it
+    """
+    if output_section in RAM_AND_FLASH_SECTIONS:
+        return (True, True)
+    if output_section in RAM_SECTIONS:
+        return (True, False)
+    if output_section in FLASH_SECTIONS:
+        return (False, True)
+    if output_section.startswith((".iram0.", ".dram0.", ".rtc", ".flash")):
+        return None  # Placeholders and NOLOAD views of the sections above
+
+    if output_section in GENERIC_RAM_AND_FLASH:
+        return (True, True)
+    if output_section in GENERIC_RAM:
+        return (True, False)
+    if output_section in GENERIC_FLASH:
+        return (False, True)
+    return None  # Debug info, comments, /DISCARD/
+
+
+def module_name(obj):
+    """
+    Name the module an input section came from.
+
+    :param str obj: Object path from the map, e.g. .pio/build/esp32dev/src/main.cpp.o
+                    or /path/libfreertos.a(tasks.c.obj)
+    :return str: Module name, e.g. main or freertos
+    """
+    obj = obj.strip().replace("\\", "/")
+    archive = re.match(r"^(.*)\(([^()]*)\)$", obj)
+    if archive:
+        name = os.path.basename(archive.group(1))
+        if name.endswith(".a"):
+            name = name[:-2]
+        if name.startswith("lib"):
+            name = name[3:]
+    else:
+        name = os.path.basename(obj)
+        for suffix in (".obj", ".o"):
+            if name.endswith(suffix):
+                name = name[:-len(suffix)]
+                break
+        name = os.path.splitext(name)[0] if name.endswith((".cpp", ".c", ".S", ".cc")) else name
+    # Library names can have spaces; budget rows are split on whitespace
+    return name.replace(" ", "_") or "?"
+
+
+def parse_map(map_path):
+    """
+    Add up the static RAM and flash used by each module.
+
+    :param str map_path: GNU ld map file
+    :return dict: Module name -> [ram bytes, flash bytes]
+    """
+    usage = {}
+    kind = None
+    pending = None  # Input section whose address and size are on the next line
+    in_map = False
+
+    def add(obj, size):
+        if kind is None or size == 0:
+            return
+        entry = usage.setdefault(module_name(obj), [0, 0])
+        if kind[0]:
+            entry[0] += size
+        if kind[1]:
+            entry[1] += size
+
+    with open(map_path, 'r', errors='replace') as f:
+        for line in f:
+            line = line.rstrip("\r\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+            if not line.strip():
+                continue
+
+            if line[0] not in " \t":
+                # An output section (or a linker directive such as LOAD)
+                kind = section_kind(line.split()[0])
+                pending = None
+                continue
+
+            if pending is not None:
+                continuation = CONTINUATION.match(line)
+                pending = None
+                if continuation:
+                    add(continuation.group("obj"), int(continuation.group("size"), 16))
+                    continue
+
+            section = INPUT_SECTION.match(line)
+            if not section:
+                continue  # Symbols, *fill*, input section patterns
+            if section.group("obj") is None:
+                pending = section.group("name")
+            else:
+                add(section.group("obj"), int(section.group("size"), 16))
+    return usage
+
+
+def load_budgets(budget_path):
+    """
+    Read the budget file.
+
+    :param str budget_path: Path to memory_budget.txt
+    :return dict: Module name -> (ram budget, flash budget); may hold DEFAULT_MODULE
+    """
+    budgets = {}
+    if not os.path.exists(budget_path):
+        return budgets
+
+    with open(budget_path, 'r') as f:
+        for number, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            fields = line.split()
+            if len(fields) != 3 or not fields[1].isdigit() or not fields[2].isdigit():
+                raise ValueError(f"{budget_path}:{number}: expected 'module ram flash', got '{line}'")
+            budgets[fields[0]] = (int(fields[1]), int(fields[2]))
+    return budgets
+
+
+def budget_for(budgets, module):
+    """
+    Get a module's budget.
+
+    :param dict budgets: From load_budgets()
+    :param str module: Module name
+    :return tuple: (ram budget, flash budget), or None if the module isn't budgeted
+    """
+    return budgets.get(module, budgets.get(DEFAULT_MODULE))
+
+
+def check_budgets(usage, budgets):
+    """
+    Find the modules over budget.
+
+    :param dict usage: From parse_map()
+    :param dict budgets: From load_budgets()
+    :return list: (module, "ram" or "flash", bytes used, budget) for each overrun;
+        the budget is None for a module without one
+    """
+    overruns = []
+    for module in sorted(usage):
+        budget = budget_for(budgets, module)
+        if budget is None:
+            overruns.append((module, "ram", usage[module][0], None))
+            continue
+        ram, flash = usage[module]
+        if ram > budget[0]:
+            overruns.append((module, "ram", ram, budget[0]))
+        if flash > budget[1]:
+            overruns.append((module, "flash", flash, budget[1]))
+    return overruns
+
+
+def format_report(usage, budgets):
+    """
+    Lay out the per-module table, largest first.
+
+    :param dict usage: From parse_map()
+    :param dict budgets: From load_budgets()
+    :return str: The report
+    """
+    width = max([len(module) for module in usage] + [len("Module")])
+    lines = [f"{'Module':<{width}}  {'RAM':>8}  {'Flash':>8}  {'RAM budget':>10}  {'Flash budget':>12}"]
+    total_ram = 0
+    total_flash = 0
+    for module in sorted(usage, key=lambda name: (-sum(usage[name]), name)):
+        ram, flash = usage[module]
+        total_ram += ram
+        total_flash += flash
+        budget = budget_for(budgets, module)
+        if budget is None:
+            limits = f"{'-':>10}  {'-':>12}  no budget"
+        else:
+            limits = f"{budget[0]:>10}  {budget[1]:>12}"
+            if ram > budget[0] or flash > budget[1]:
+                limits += "  over budget"
+        lines.append(f"{module:<{width}}  {ram:>8}  {flash:>8}  {limits}")
+    lines.append(f"{'Total':<{width}}  {total_ram:>8}  {total_flash:>8}")
+    return "\n".join(lines) + "\n"
+
+
+def _round_budget(size):
+    size = int(size * (1 + UPDATE_HEADROOM))
+    return -(-size // BUDGET_ROUNDING) * BUDGET_ROUNDING
+
+
+def update_budgets(budget_path, usage, budgets):
+    """
+    Rewrite the budget file from a build, with headroom.
+
+    Modules that already have a row, and any module the default row no
+    longer covers, get a row sized to what they use now; the default row
+    is kept as it is.
+
+    :param str budget_path: Path to memory_budget.txt
+    :param dict usage: From parse_map()
+    :param dict budgets: From load_budgets()
+    """
+    default = budgets.get(DEFAULT_MODULE)
+    rows = {}
+    for module, (ram, flash) in usage.items():
+        over_default = default is not None and (ram > default[0] or flash > default[1])
+        if module in budgets or over_default or default is None:
+            rows[module] = (_round_budget(ram), _round_budget(flash))
+
+    width = max([len(module) for module in rows] + [len("# module")])
+    with open(budget_path, 'w') as f:
+        f.write("# Static memory budgets per module, in bytes (see memory_budget.py)\n")
+        f.write(f"# Written by --update from a firmware map: use plus {UPDATE_HEADROOM:.0%}, "
+                f"rounded up to {BUDGET_ROUNDING}.\n")
+        f.write("# Raise a budget on purpose, in the change that needs the room.\n")
+        f.write(f"{'# module':<{width}}  {'ram':>8}  {'flash':>8}\n")
+        for module in sorted(rows):
+            f.write(f"{module:<{width}}  {rows[module][0]:>8}  {rows[module][1]:>8}\n")
+        if default is not None:
+            f.write(f"{DEFAULT_MODULE:<{width}}  {default[0]:>8}  {default[1]:>8}\n")
+
+
+def run_report(map_path, budget_path, report_path=None, enforce=True):
+    """
+    Print the report and check the budgets.
+
+    :param str map_path: GNU ld map file
+    :param str budget_path: Path to memory_budget.txt
+    :param str report_path: Where to write the report as well (optional)
+    :param bool enforce: False to only warn about modules over budget
+    :return int: 1 if a module is over budget and enforce is set, or the
+        budgets had to be generated; 0 otherwise
+    """
+    usage = parse_map(map_path)
+    if not os.path.exists(budget_path):
+        update_budgets(budget_path, usage, {})
+        print(f"✗ No {os.path.basename(budget_path)} yet, so it was written from this build.")
+        print("  Review and commit it, then build again.")
+        return 1
+    budgets = load_budgets(budget_path)
+    report = format_report(usage, budgets)
+    print(report, end="")
+    if report_path:
+        with open(report_path, 'w') as f:
+            f.write(report)
+
+    overruns = check_budgets(usage, budgets)
+    mark = "✗" if enforce else "⚠"
+    for module, what, used, budget in overruns:
+        if budget is None:
+            print(f"{mark} {module} has no budget")
+        else:
+            print(f"{mark} {module} uses {used} bytes of {what}, over its budget of {budget} ({used - budget} more)")
+    if overruns:
+        print(f"  Trim the module, or add or raise its budget in {os.path.basename(budget_path)} "
+              "(python memory_budget.py <map> --update)")
+        return 1 if enforce else 0
+    print("✓ Every module is within its memory budget")
+    return 0
+
+
+def main(argv):
+    import argparse
+
+    parser = argparse.ArgumentParser(description="Per-module RAM/flash report and budget check from a linker map")
+    parser.add_argument("map", help="Linker map, e.g. .pio/build/esp32dev/firmware.map")
+    parser.add_argument("-b", "--budget", default=BUDGET_FILE, help="Budget file")
+    parser.add_argument("--update", action="store_true", help="Rewrite the budgets from this map, with headroom")
+    args = parser.parse_args(argv)
+
+    if args.update:
+        update_budgets(args.budget, parse_map(args.map), load_budgets(args.budget))
+        print(f"Budgets written to {args.budget}")
+        return 0
+    return run_report(args.map, args.budget)
+
+
+try:
+    Import("env")
+except NameError:
+    # Run directly, not from PlatformIO
+    if __name__ == "__main__":
+        sys.exit(main(sys.argv[1:]))
+else:
+    project_dir = env.get("PROJECT_DIR", ".")
+    map_path = env.subst("$BUILD_DIR/${PROGNAME}.map")
+    env.Append(LINKFLAGS=["-Wl,-Map," + map_path])
+
+    enforce = env.GetProjectOption("custom_memory_budget_enforce", "yes").strip().lower() in ("yes", "true", "1")
+
+    def report_memory(source, target, env):
+        return run_report(map_path, os.path.join(project_dir, BUDGET_FILE),
+                          env.subst(os.path.join("$BUILD_DIR", REPORT_FILE)), enforce)
+
+    # Unit test builds link a different program; only gate the firmware
+    if "__test" not in COMMAND_LINE_TARGETS:
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_memory)
+    env.AddCustomTarget(
+        name="memory_budget",
+        dependencies="$BUILD_DIR/${PROGNAME}.elf",
+        actions=[report_memory],
+        title="Memory budget",
+        description="Static RAM/flash per module from the linker map, checked against memory_budget.txt")
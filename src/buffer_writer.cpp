@@ -0,0 +1,89 @@
+#include "buffer_writer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+BufferWriter::BufferWriter(char* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {
+    reset();
+}
+
+void BufferWriter::reset() {
+    _length = 0;
+    _overflowed = false;
+    _buffer[0] = '\0';
+}
+
+void BufferWriter::truncate(size_t length) {
+    if (length > _length) return;
+    _length = length;
+    _overflowed = false;
+    _buffer[_length] = '\0';
+}
+
+void BufferWriter::print(const char* str) {
+    _append(str, strlen(str));
+}
+
+void BufferWriter::printf(const char* format, ...) {
+    size_t room = _capacity - _length;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(_buffer + _length, room, format, args);
+    va_end(args);
+
+    if (written < 0) return;
+    if ((size_t)written >= room) {
+        // vsnprintf wrote what fit; keep it and flag the rest as lost
+        _length = _capacity - 1;
+        _overflowed = true;
+    } else {
+        _length += (size_t)written;
+    }
+}
+
+void BufferWriter::printJsonString(const char* str) {
+    if (str == nullptr) {
+        print("null");
+        return;
+    }
+
+    _append("\"", 1);
+    for (const char* p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            char escaped[2] = {'\\', (char)c};
+            _append(escaped, 2);
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            _append(escaped, 6);
+        } else {
+            _append(p, 1);
+        }
+    }
+    _append("\"", 1);
+}
+
+const char* BufferWriter::c_str() const {
+    return _buffer;
+}
+
+size_t BufferWriter::length() const {
+    return _length;
+}
+
+bool BufferWriter::overflowed() const {
+    return _overflowed;
+}
+
+void BufferWriter::_append(const char* data, size_t length) {
+    size_t room = _capacity - 1 - _length;
+    if (length > room) {
+        length = room;
+        _overflowed = true;
+    }
+    memcpy(_buffer + _length, data, length);
+    _length += length;
+    _buffer[_length] = '\0';
+}
@@ -0,0 +1,41 @@
+#include "bus_predictions.h"
+#include <string.h>
+
+bool parseBusPrediction(const char* routeId, long minutes, uint8_t stop, TrainObservation& observation) {
+    if (routeId == nullptr || routeId[0] == '\0' || minutes < 0) {
+        return false;
+    }
+
+    strncpy(observation.destination, routeId, DEST_MAX_LEN - 1);
+    observation.destination[DEST_MAX_LEN - 1] = '\0';
+    observation.line[0] = '\0';
+    observation.group = stop;
+    observation.cars = 0;
+
+    if (minutes == 0) {
+        observation.status = TRAIN_ARRIVING;
+        observation.etaMs = ARRIVING_ETA_MS;
+    } else {
+        // Middle of the minute, as for trains
+        if (minutes > 999) minutes = 999;
+        observation.status = TRAIN_MOVING;
+        observation.etaMs = minutes * 60000L + 30000L;
+    }
+    return true;
+}
+
+int keepSoonest(TrainObservation* observations, int count, int maxCount, const TrainObservation& observation) {
+    // Insertion into the sorted top-K; later buses fall off the end
+    int position = count;
+    while (position > 0 && observation.etaMs < observations[position - 1].etaMs) {
+        position--;
+    }
+    if (position >= maxCount) return count;
+
+    int last = count < maxCount ? count : maxCount - 1;
+    for (int n = last; n > position; n--) {
+        observations[n] = observations[n - 1];
+    }
+    observations[position] = observation;
+    return count < maxCount ? count + 1 : count;
+}
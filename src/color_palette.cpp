@@ -0,0 +1,62 @@
+#include "color_palette.h"
+#include <string.h>
+
+/**
+ * The integers 0 to N - 1 as a template parameter pack, for filling tables
+ * at compile time
+ */
+template <int... I>
+struct IndexList {};
+
+template <int N, int... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeIndexList<0, I...> {
+    typedef IndexList<I...> type;
+};
+
+template <int... I>
+constexpr GammaTable makeGammaTable(uint8_t percent, IndexList<I...>) {
+    return GammaTable{{gammaLevel(I, percent, 5)...}, {gammaLevel(I, percent, 6)...}};
+}
+
+template <int... I>
+constexpr PaletteTable makePaletteTable(uint8_t percent, IndexList<I...>) {
+    return PaletteTable{{correctedColor565(PALETTE_RGB[I], percent)...}};
+}
+
+static constexpr uint8_t DIM_PERCENTS[DIM_LEVELS] = DIM_LEVEL_PERCENTS;
+static_assert(DIM_LEVELS == 4, "Add a table entry below for each dimming level");
+static_assert(DIM_PERCENTS[0] == 100, "Level 0 is full brightness");
+
+extern constexpr GammaTable GAMMA_TABLES[DIM_LEVELS] = {
+    makeGammaTable(DIM_PERCENTS[0], MakeIndexList<256>::type()),
+    makeGammaTable(DIM_PERCENTS[1], MakeIndexList<256>::type()),
+    makeGammaTable(DIM_PERCENTS[2], MakeIndexList<256>::type()),
+    makeGammaTable(DIM_PERCENTS[3], MakeIndexList<256>::type()),
+};
+
+extern constexpr PaletteTable PALETTE_TABLES[DIM_LEVELS] = {
+    makePaletteTable(DIM_PERCENTS[0], MakeIndexList<PALETTE_SIZE>::type()),
+    makePaletteTable(DIM_PERCENTS[1], MakeIndexList<PALETTE_SIZE>::type()),
+    makePaletteTable(DIM_PERCENTS[2], MakeIndexList<PALETTE_SIZE>::type()),
+    makePaletteTable(DIM_PERCENTS[3], MakeIndexList<PALETTE_SIZE>::type()),
+};
+
+static_assert(PALETTE_TABLES[0].color[COLOR_WHITE] == 0xFFFF, "Full-brightness white is full scale");
+static_assert(PALETTE_TABLES[0].color[COLOR_BLACK] == 0, "Black is off");
+
+uint16_t gammaColor565(uint8_t r, uint8_t g, uint8_t b, uint8_t level) {
+    if (level >= DIM_LEVELS) level = DIM_LEVELS - 1;
+    const GammaTable& table = GAMMA_TABLES[level];
+    return (uint16_t)((table.red[r] << 11) | (table.green[g] << 5) | table.red[b]);
+}
+
+PaletteColor lineColor(const char* lineCode) {
+    static const char* const CODES[] = {"RD", "BL", "OR", "GR", "YL", "SV"};
+    for (int i = 0; i < 6; i++) {
+        if (strcmp(lineCode, CODES[i]) == 0) return (PaletteColor)(COLOR_LINE_RD + i);
+    }
+    return COLOR_WHITE;
+}
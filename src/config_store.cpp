@@ -0,0 +1,41 @@
+#include "config_store.h"
+#include "log.h"
+#include <Preferences.h>
+
+bool ConfigStore::load(DeviceConfig& config) {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_STORE_NAMESPACE, true)) {
+        return false;  // Nothing stored yet
+    }
+
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    size_t length = prefs.getBytesLength(CONFIG_STORE_KEY);
+    bool loaded = length > 0 && length <= sizeof(blob) &&
+                  prefs.getBytes(CONFIG_STORE_KEY, blob, sizeof(blob)) == length &&
+                  decodeConfig(blob, length, config);
+    prefs.end();
+
+    if (length > 0 && !loaded) {
+        LOG_WARN("CONFIG", "Stored config unreadable (%u bytes), using defaults", (unsigned)length);
+    }
+    return loaded;
+}
+
+bool ConfigStore::save(const DeviceConfig& config) {
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    size_t length = encodeConfig(config, blob, sizeof(blob));
+    if (length == 0) return false;
+
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_STORE_NAMESPACE, false)) {
+        LOG_ERROR("CONFIG", "Can't open NVS");
+        return false;
+    }
+    bool saved = prefs.putBytes(CONFIG_STORE_KEY, blob, length) == length;
+    prefs.end();
+
+    if (!saved) {
+        LOG_ERROR("CONFIG", "Saving config failed");
+    }
+    return saved;
+}
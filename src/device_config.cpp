@@ -0,0 +1,294 @@
+#include "device_config.h"
+#include <stddef.h>
+#include <string.h>
+
+// Blob header: magic bytes, then the schema version
+static const uint8_t CONFIG_MAGIC[2] = {'W', 'C'};
+static const size_t CONFIG_HEADER_LEN = 3;
+static const size_t CONFIG_CHECKSUM_LEN = 4;
+
+// FNV-1a parameters used for the blob checksum
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+// Record tags; never reuse one for another field
+enum ConfigTag : uint8_t {
+    TAG_STATION = 1,
+    TAG_API_KEY = 2,
+    TAG_WIFI_SSID = 3,
+    TAG_WIFI_PASSWORD = 4
+};
+
+/**
+ * One stored field: its tag, name in forms and JSON, and place in DeviceConfig
+ */
+struct ConfigFieldInfo {
+    uint8_t tag;
+    const char* name;
+    size_t offset;
+    size_t size;
+    uint8_t changeBit;
+    bool secret;
+};
+
+static const ConfigFieldInfo FIELDS[] = {
+    {TAG_STATION, "station", offsetof(DeviceConfig, stationCode), CONFIG_STATION_MAX_LEN,
+     CONFIG_CHANGED_STATION, false},
+    {TAG_API_KEY, "api_key", offsetof(DeviceConfig, apiKey), CONFIG_API_KEY_MAX_LEN,
+     CONFIG_CHANGED_API_KEY, true},
+    {TAG_WIFI_SSID, "wifi_ssid", offsetof(DeviceConfig, wifiSsid), CONFIG_SSID_MAX_LEN,
+     CONFIG_CHANGED_WIFI, false},
+    {TAG_WIFI_PASSWORD, "wifi_password", offsetof(DeviceConfig, wifiPassword), CONFIG_PASSWORD_MAX_LEN,
+     CONFIG_CHANGED_WIFI, true},
+};
+static const int FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+/**
+ * Get a field's storage in a config
+ */
+static char* _field(DeviceConfig& config, const ConfigFieldInfo& info) {
+    return (char*)&config + info.offset;
+}
+
+static const char* _field(const DeviceConfig& config, const ConfigFieldInfo& info) {
+    return (const char*)&config + info.offset;
+}
+
+/**
+ * Copy a string into a fixed field, truncating and terminating
+ */
+static void _copyField(char* dest, const char* src, size_t size) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+/**
+ * FNV-1a hash of a byte range
+ */
+static uint32_t _checksum(const uint8_t* data, size_t length) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Check a value for a field
+ *
+ * :return const char*: What is wrong with it, or nullptr if it is fine
+ */
+static const char* _validate(const ConfigFieldInfo& info, const char* value) {
+    size_t length = strlen(value);
+    if (length >= info.size) return "value too long";
+
+    switch (info.tag) {
+        case TAG_STATION:
+            // WMATA station codes are a letter and two digits, e.g. "B35"
+            if (length != 3 || value[0] < 'A' || value[0] > 'Z' ||
+                value[1] < '0' || value[1] > '9' || value[2] < '0' || value[2] > '9') {
+                return "station must be a letter and two digits";
+            }
+            break;
+        case TAG_API_KEY:
+            if (length == 0) return "api_key is empty";
+            for (const char* p = value; *p != '\0'; p++) {
+                if (*p <= ' ' || *p > '~') return "api_key has spaces or control characters";
+            }
+            break;
+        case TAG_WIFI_SSID:
+            if (length == 0) return "wifi_ssid is empty";
+            break;
+        case TAG_WIFI_PASSWORD:
+            // Empty for an open network; WPA needs 8 to 63 characters
+            if (length > 0 && length < 8) return "wifi_password must be 8 to 63 characters";
+            break;
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+/**
+ * Find a field by name
+ */
+static const ConfigFieldInfo* _findField(const char* name) {
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(FIELDS[i].name, name) == 0) return &FIELDS[i];
+    }
+    return nullptr;
+}
+
+/**
+ * Value of a hex digit, or -1
+ */
+static int _hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * URL-decode a form name or value in place ("+" is a space)
+ *
+ * :return bool: False for a malformed %-escape
+ */
+static bool _urlDecode(char* text) {
+    char* out = text;
+    for (const char* p = text; *p != '\0'; p++) {
+        if (*p == '+') {
+            *out++ = ' ';
+        } else if (*p == '%') {
+            int high = _hexDigit(p[1]);
+            int low = high >= 0 ? _hexDigit(p[2]) : -1;
+            if (low < 0 || (high == 0 && low == 0)) return false;
+            *out++ = (char)(high * 16 + low);
+            p += 2;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+    return true;
+}
+
+void initConfig(DeviceConfig& config, const char* stationCode, const char* apiKey,
+                const char* wifiSsid, const char* wifiPassword) {
+    _copyField(config.stationCode, stationCode, sizeof(config.stationCode));
+    _copyField(config.apiKey, apiKey, sizeof(config.apiKey));
+    _copyField(config.wifiSsid, wifiSsid, sizeof(config.wifiSsid));
+    _copyField(config.wifiPassword, wifiPassword, sizeof(config.wifiPassword));
+}
+
+size_t encodeConfig(const DeviceConfig& config, uint8_t* buffer, size_t size) {
+    if (size < CONFIG_HEADER_LEN + CONFIG_CHECKSUM_LEN) return 0;
+
+    size_t length = 0;
+    buffer[length++] = CONFIG_MAGIC[0];
+    buffer[length++] = CONFIG_MAGIC[1];
+    buffer[length++] = CONFIG_SCHEMA_VERSION;
+
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        const char* value = _field(config, FIELDS[i]);
+        size_t valueLength = strnlen(value, FIELDS[i].size - 1);
+        if (length + 2 + valueLength + CONFIG_CHECKSUM_LEN > size) return 0;
+
+        buffer[length++] = FIELDS[i].tag;
+        buffer[length++] = (uint8_t)valueLength;
+        memcpy(buffer + length, value, valueLength);
+        length += valueLength;
+    }
+
+    uint32_t checksum = _checksum(buffer, length);
+    for (size_t i = 0; i < CONFIG_CHECKSUM_LEN; i++) {
+        buffer[length++] = (uint8_t)(checksum >> (8 * i));
+    }
+    return length;
+}
+
+bool decodeConfig(const uint8_t* data, size_t length, DeviceConfig& config) {
+    if (data == nullptr || length < CONFIG_HEADER_LEN + CONFIG_CHECKSUM_LEN) return false;
+    if (data[0] != CONFIG_MAGIC[0] || data[1] != CONFIG_MAGIC[1] || data[2] != CONFIG_SCHEMA_VERSION) {
+        return false;
+    }
+
+    size_t end = length - CONFIG_CHECKSUM_LEN;
+    uint32_t stored = 0;
+    for (size_t i = 0; i < CONFIG_CHECKSUM_LEN; i++) {
+        stored |= (uint32_t)data[end + i] << (8 * i);
+    }
+    if (stored != _checksum(data, end)) return false;
+
+    // Decode into a copy, so a bad record leaves the config alone
+    DeviceConfig decoded = config;
+    size_t pos = CONFIG_HEADER_LEN;
+    while (pos < end) {
+        if (pos + 2 > end) return false;
+        uint8_t tag = data[pos];
+        size_t valueLength = data[pos + 1];
+        pos += 2;
+        if (pos + valueLength > end) return false;
+
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            if (FIELDS[i].tag != tag) continue;
+            if (valueLength >= FIELDS[i].size) return false;
+            char* field = _field(decoded, FIELDS[i]);
+            memcpy(field, data + pos, valueLength);
+            field[valueLength] = '\0';
+        }
+        pos += valueLength;
+    }
+
+    config = decoded;
+    return true;
+}
+
+bool setConfigField(DeviceConfig& config, const char* name, const char* value, const char*& error) {
+    const ConfigFieldInfo* info = _findField(name);
+    if (info == nullptr) {
+        error = "unknown setting";
+        return false;
+    }
+
+    error = _validate(*info, value);
+    if (error != nullptr) return false;
+
+    _copyField(_field(config, *info), value, info->size);
+    return true;
+}
+
+bool applyConfigForm(DeviceConfig& config, char* form, const char*& error) {
+    DeviceConfig updated = config;
+    int fields = 0;
+
+    char* pair = form;
+    while (pair != nullptr && *pair != '\0') {
+        char* next = strchr(pair, '&');
+        if (next != nullptr) *next++ = '\0';
+
+        char* value = strchr(pair, '=');
+        if (value == nullptr) {
+            error = "expected name=value";
+            return false;
+        }
+        *value++ = '\0';
+        if (!_urlDecode(pair) || !_urlDecode(value)) {
+            error = "bad %-escape";
+            return false;
+        }
+        if (!setConfigField(updated, pair, value, error)) return false;
+
+        fields++;
+        pair = next;
+    }
+
+    if (fields == 0) {
+        error = "no settings given";
+        return false;
+    }
+    config = updated;
+    return true;
+}
+
+uint8_t configChanges(const DeviceConfig& before, const DeviceConfig& after) {
+    uint8_t changes = 0;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(_field(before, FIELDS[i]), _field(after, FIELDS[i])) != 0) {
+            changes |= FIELDS[i].changeBit;
+        }
+    }
+    return changes;
+}
+
+void formatConfig(const DeviceConfig& config, BufferWriter& out) {
+    out.printf("{\"version\":%d", CONFIG_SCHEMA_VERSION);
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        const char* value = _field(config, FIELDS[i]);
+        out.printf(",\"%s\":", FIELDS[i].name);
+        // Secrets only say whether they are set
+        out.printJsonString(FIELDS[i].secret && value[0] != '\0' ? "***" : value);
+    }
+    out.print("}");
+}
@@ -1,132 +1,245 @@
 #include "display.h"
 #include "config.h"
 
-Display::Display() : _display(nullptr) {}
+/**
+ * GFX target that draws on the panel and copies every pixel into the
+ * shadow frame
+ * 
+ * Text and shapes are rasterized once by Adafruit GFX and the resulting
+ * pixels go to both, so the shadow matches the panel exactly.
+ */
+class MirroredPanel : public Adafruit_GFX {
+public:
+    MirroredPanel(MatrixPanel_I2S_DMA* panel, FrameBuffer& frame)
+        : Adafruit_GFX(panel->width(), panel->height()), _panel(panel), _frame(frame) {}
+    
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        _panel->drawPixel(x, y, color);
+        _frame.setPixel(x, y, color);
+    }
+    
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        _panel->fillRect(x, y, w, h, color);
+        _frame.fillRect(x, y, w, h, color);
+    }
+    
+    void fillScreen(uint16_t color) override {
+        if (color == 0) {
+            _panel->clearScreen();
+        } else {
+            _panel->fillScreen(color);
+        }
+        _frame.fill(color);
+    }
+
+private:
+    MatrixPanel_I2S_DMA* _panel;
+    FrameBuffer& _frame;
+};
+
+Display::Display()
+    : _display(nullptr), _gfx(nullptr), _frame(_framePixels, DISPLAY_WIDTH, DISPLAY_HEIGHT),
+      _dimLevel(PANEL_DIM_LEVEL < DIM_LEVELS ? PANEL_DIM_LEVEL : DIM_LEVELS - 1),
+      _blank(false), _redraws(0), _partialRedraws(0) {
+    _invalidateRows();
+}
+
+static_assert(DISPLAY_ROWS == 3, "DisplayLayout places three rows");
 
 bool Display::init() {
     _setPinModes();
     
+    const int8_t* gpio = PANEL_PINS.gpio;
     HUB75_I2S_CFG::i2s_pins _pins = {
-        R1_PIN, G1_PIN, B1_PIN,
-        R2_PIN, G2_PIN, B2_PIN,
-        A_PIN, B_PIN, C_PIN, D_PIN, E_PIN,
-        LAT_PIN, OE_PIN, CLK_PIN
+        gpio[PIN_R1], gpio[PIN_G1], gpio[PIN_B1],
+        gpio[PIN_R2], gpio[PIN_G2], gpio[PIN_B2],
+        gpio[PIN_A], gpio[PIN_B], gpio[PIN_C], gpio[PIN_D], gpio[PIN_E],
+        gpio[PIN_LAT], gpio[PIN_OE], gpio[PIN_CLK]
     };
     
     HUB75_I2S_CFG mxconfig(PANEL_RES_X, PANEL_RES_Y, PANEL_CHAIN, _pins);
     
     _display = new MatrixPanel_I2S_DMA(mxconfig);
     _display->begin();
-    _display->clearScreen();
-    
-    // Initialize colors
-    _colorWhite = _display->color565(255, 255, 255);
-    _colorBlack = _display->color565(0, 0, 0);
-    _colorCyan = _display->color565(0, 255, 255);
+    _gfx = new MirroredPanel(_display, _frame);
+    _gfx->setTextSize(DisplayLayout::TEXT_SIZE);
+    _gfx->fillScreen(0);
     
     return true;
 }
 
 void Display::_setPinModes() {
-    pinMode(R1_PIN, OUTPUT);
-    pinMode(G1_PIN, OUTPUT);
-    pinMode(B1_PIN, OUTPUT);
-    pinMode(R2_PIN, OUTPUT);
-    pinMode(G2_PIN, OUTPUT);
-    pinMode(B2_PIN, OUTPUT);
-    pinMode(A_PIN, OUTPUT);
-    pinMode(B_PIN, OUTPUT);
-    pinMode(C_PIN, OUTPUT);
-    pinMode(D_PIN, OUTPUT);
-    pinMode(LAT_PIN, OUTPUT);
-    pinMode(OE_PIN, OUTPUT);
-    pinMode(CLK_PIN, OUTPUT);
+    // Checked at compile time: each is a free output, used once
+    for (int signal = 0; signal < PANEL_PIN_COUNT; signal++) {
+        if (PANEL_PINS.gpio[signal] >= 0) {
+            pinMode(PANEL_PINS.gpio[signal], OUTPUT);
+        }
+    }
 }
 
 void Display::clear() {
     if (_display) {
-        _display->clearScreen();
+        _gfx->fillScreen(color(COLOR_BLACK));
+        _invalidateRows();
     }
 }
 
 void Display::showMessage(const char* message, uint16_t color) {
-    if (!_display) return;
+    if (!_display || _blank) return;
     
-    _display->setTextColor(color);
-    _display->setCursor(0, 0);
-    _display->print(message);
+    _gfx->setTextColor(color);
+    _gfx->setCursor(0, 0);
+    _gfx->print(message);
+    _invalidateRows();
 }
 
 void Display::showTime(int hour, int minute, int second, bool isPM) {
-    if (!_display) return;
-    
     char timeStr[12];
-    snprintf(timeStr, sizeof(timeStr), "%02d:%02d:%02d", hour, minute, second);
-    
-    _display->clearScreen();
+    snprintf(timeStr, sizeof(timeStr), " %02d:%02d:%02d", hour, minute, second);
     
-    // Draw time in cyan
-    _display->setTextColor(_colorCyan);
-    _display->setCursor(5, 8);
-    _display->print(timeStr);
-    
-    // Draw AM/PM in white
-    _display->setTextColor(_colorWhite);
-    _display->setCursor(22, 20);
-    _display->print(isPM ? "PM" : "AM");
+    // Time in cyan, AM/PM in white below it
+    const char* rows[DISPLAY_ROWS] = {"", timeStr, isPM ? "   PM" : "   AM"};
+    const uint16_t colors[DISPLAY_ROWS] = {color(COLOR_BLACK), color(COLOR_CYAN), color(COLOR_WHITE)};
+    showRows(rows, colors);
 }
 
 MatrixPanel_I2S_DMA* Display::getRaw() {
     return _display;
 }
 
-uint16_t Display::color565(uint8_t r, uint8_t g, uint8_t b) {
-    if (_display) {
-        return _display->color565(r, g, b);
+const FrameBuffer& Display::getFrame() const {
+    return _frame;
+}
+
+unsigned long Display::getRedrawCount() const {
+    return _redraws;
+}
+
+unsigned long Display::getPartialRedrawCount() const {
+    return _partialRedraws;
+}
+
+uint16_t Display::color(PaletteColor color) const {
+    return PALETTE_TABLES[_dimLevel].color[color];
+}
+
+uint16_t Display::color565(uint8_t r, uint8_t g, uint8_t b) const {
+    return gammaColor565(r, g, b, _dimLevel);
+}
+
+void Display::setDimLevel(uint8_t level) {
+    _dimLevel = level < DIM_LEVELS ? level : DIM_LEVELS - 1;
+}
+
+uint8_t Display::getDimLevel() const {
+    return _dimLevel;
+}
+
+void Display::setBlank(bool blank) {
+    if (blank && !_blank && _display) {
+        _gfx->fillScreen(color(COLOR_BLACK));
+        _invalidateRows();
+    }
+    _blank = blank;
+}
+
+bool Display::isBlank() const {
+    return _blank;
+}
+
+void Display::showRows(const char* const rows[DISPLAY_ROWS], const uint16_t colors[DISPLAY_ROWS]) {
+    if (!_display || _blank) return;
+    
+    int repainted = 0;
+    _gfx->setTextWrap(false);  // A long row must not spill into the next
+    for (int row = 0; row < DISPLAY_ROWS; row++) {
+        if (rows[row] == nullptr) continue;
+        if (_rowValid[row] && _rowColor[row] == colors[row] &&
+            strncmp(_rowText[row], rows[row], DISPLAY_ROW_LEN - 1) == 0) {
+            continue;
+        }
+        
+        int16_t top = DisplayLayout::rowTop(row);
+        _gfx->fillRect(0, top, _gfx->width(), DisplayLayout::rowTop(row + 1) - top, color(COLOR_BLACK));
+        if (rows[row][0] != '\0') {
+            _gfx->setTextColor(colors[row]);
+            _gfx->setCursor(1, DisplayLayout::textY(row));
+            _gfx->print(rows[row]);
+        }
+        
+        strncpy(_rowText[row], rows[row], DISPLAY_ROW_LEN - 1);
+        _rowText[row][DISPLAY_ROW_LEN - 1] = '\0';
+        _rowColor[row] = colors[row];
+        _rowValid[row] = true;
+        repainted++;
+    }
+    _gfx->setTextWrap(true);
+    
+    if (repainted == DISPLAY_ROWS) {
+        _redraws++;
+    } else if (repainted > 0) {
+        _partialRedraws++;
     }
-    return 0;
 }
 
 void Display::showMetroArrivals(const char* train1Dest, const char* train1Min,
                                  const char* train2Dest, const char* train2Min,
                                  const char* lastUpdated, uint16_t lineColor) {
-    if (!_display) return;
-    
-    _display->clearScreen();
-    
-    // Row height spacing for 32-pixel tall display
-    // Line 1: y = 2
-    // Line 2: y = 12
-    // Line 3: y = 22
+    char line1[24];
+    char line2[24];
+    const char* rows[DISPLAY_ROWS] = {"No trains", "", lastUpdated};
+    uint16_t colors[DISPLAY_ROWS] = {color(COLOR_WHITE), lineColor, color(COLOR_WHITE)};
     
-    // Display first train (if available)
     if (train1Dest != nullptr && train1Min != nullptr) {
-        char line1[24];
-        snprintf(line1, sizeof(line1), "%s - %s", train1Dest, train1Min);
-        
-        _display->setTextColor(lineColor);
-        _display->setCursor(1, 2);
-        _display->print(line1);
-    } else {
-        _display->setTextColor(_colorWhite);
-        _display->setCursor(1, 2);
-        _display->print("No trains");
+        formatTrainRow(train1Dest, train1Min, line1, sizeof(line1));
+        rows[0] = line1;
+        colors[0] = lineColor;
     }
-    
-    // Display second train (if available)
     if (train2Dest != nullptr && train2Min != nullptr) {
-        char line2[24];
-        snprintf(line2, sizeof(line2), "%s - %s", train2Dest, train2Min);
-        
-        _display->setTextColor(lineColor);
-        _display->setCursor(1, 12);
-        _display->print(line2);
+        formatTrainRow(train2Dest, train2Min, line2, sizeof(line2));
+        rows[1] = line2;
     }
     
-    // Display last updated time at bottom
-    if (lastUpdated != nullptr) {
-        _display->setTextColor(_colorWhite);
-        _display->setCursor(1, 24);
-        _display->print(lastUpdated);
+    // A nullptr footer leaves the bottom row to the advisory
+    showRows(rows, colors);
+}
+
+void Display::formatTrainRow(const char* destination, const char* arrival, char* buffer, size_t bufferSize) {
+    bool timeOfDay = strchr(arrival, ':') != nullptr;
+    snprintf(buffer, bufferSize, timeOfDay ? "%s %s" : "%s - %s", destination, arrival);
+}
+
+void Display::showTextRows(const char* row1, const char* row2, const char* row3,
+                           uint16_t color, uint16_t row3Color) {
+    const char* rows[DISPLAY_ROWS] = {
+        row1 != nullptr ? row1 : "",
+        row2 != nullptr ? row2 : "",
+        row3 != nullptr ? row3 : ""
+    };
+    const uint16_t colors[DISPLAY_ROWS] = {color, color, row3Color};
+    showRows(rows, colors);
+}
+
+void Display::showAdvisory(const char* text, int offsetPx) {
+    if (!_display || _blank) return;
+    
+    // Clear the bottom row only
+    _gfx->fillRect(0, DisplayLayout::rowTop(2), _gfx->width(),
+                   DisplayLayout::rowTop(3) - DisplayLayout::rowTop(2), color(COLOR_BLACK));
+    _rowValid[2] = false;
+    _partialRedraws++;
+    
+    _gfx->setTextWrap(false);
+    _gfx->setTextColor(color(COLOR_AMBER));
+    _gfx->setCursor(_gfx->width() - offsetPx, DisplayLayout::textY(2));
+    _gfx->print(text);
+    _gfx->setTextWrap(true);
+}
+
+void Display::_invalidateRows() {
+    for (int row = 0; row < DISPLAY_ROWS; row++) {
+        _rowText[row][0] = '\0';
+        _rowColor[row] = 0;
+        _rowValid[row] = false;
     }
 }
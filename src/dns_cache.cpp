@@ -0,0 +1,107 @@
+#include "dns_cache.h"
+#include <string.h>
+
+DnsCache::DnsCache(DnsResolver resolver, void* context)
+    : _resolver(resolver), _context(context) {
+    clear();
+}
+
+DnsLookupResult DnsCache::lookup(const char* host, uint64_t nowMs, uint32_t& address) {
+    Entry* entry = _find(host, true);
+    entry->lastUsed = nowMs;
+
+    bool known = entry->address != 0;
+    if (known && !entry->expired && !entry->failing && nowMs - entry->resolvedAt < entry->ttlMs) {
+        address = entry->address;
+        _hits++;
+        return DNS_HIT;
+    }
+
+    // The resolver failed recently; don't wait on it again yet
+    if (known && entry->failing && nowMs - entry->failedAt < DNS_CACHE_RETRY_MS) {
+        address = entry->address;
+        _stale++;
+        return DNS_STALE;
+    }
+
+    uint32_t resolved = 0;
+    unsigned long ttlMs = 0;
+    if (_resolver != nullptr && _resolver(host, resolved, ttlMs, _context) && resolved != 0) {
+        if (ttlMs == 0) ttlMs = DNS_CACHE_DEFAULT_TTL_MS;
+        if (ttlMs < DNS_CACHE_MIN_TTL_MS) ttlMs = DNS_CACHE_MIN_TTL_MS;
+        if (ttlMs > DNS_CACHE_MAX_TTL_MS) ttlMs = DNS_CACHE_MAX_TTL_MS;
+
+        entry->address = resolved;
+        entry->resolvedAt = nowMs;
+        entry->ttlMs = ttlMs;
+        entry->expired = false;
+        entry->failing = false;
+        address = resolved;
+        _resolves++;
+        return DNS_RESOLVED;
+    }
+
+    entry->failing = true;
+    entry->failedAt = nowMs;
+    if (known) {
+        address = entry->address;
+        _stale++;
+        return DNS_STALE;
+    }
+    _failures++;
+    return DNS_FAILED;
+}
+
+void DnsCache::invalidate(const char* host) {
+    Entry* entry = _find(host, false);
+    if (entry != nullptr) {
+        entry->expired = true;
+        entry->failing = false;  // Worth asking the resolver straight away
+    }
+}
+
+void DnsCache::clear() {
+    memset(_entries, 0, sizeof(_entries));
+    _hits = 0;
+    _resolves = 0;
+    _stale = 0;
+    _failures = 0;
+}
+
+unsigned long DnsCache::getHitCount() const {
+    return _hits;
+}
+
+unsigned long DnsCache::getResolveCount() const {
+    return _resolves;
+}
+
+unsigned long DnsCache::getStaleCount() const {
+    return _stale;
+}
+
+unsigned long DnsCache::getFailureCount() const {
+    return _failures;
+}
+
+DnsCache::Entry* DnsCache::_find(const char* host, bool create) {
+    Entry* oldest = nullptr;
+    for (int i = 0; i < DNS_CACHE_SLOTS; i++) {
+        Entry* entry = &_entries[i];
+        if (entry->used && strncmp(entry->host, host, DNS_CACHE_HOST_LEN) == 0) {
+            return entry;
+        }
+        if (!create) continue;
+        if (!entry->used) {
+            if (oldest == nullptr || oldest->used) oldest = entry;
+        } else if (oldest == nullptr || (oldest->used && entry->lastUsed < oldest->lastUsed)) {
+            oldest = entry;
+        }
+    }
+    if (oldest == nullptr) return nullptr;
+
+    memset(oldest, 0, sizeof(*oldest));
+    strncpy(oldest->host, host, DNS_CACHE_HOST_LEN - 1);
+    oldest->used = true;
+    return oldest;
+}
@@ -0,0 +1,90 @@
+#include "fanout_election.h"
+
+FanoutElection::FanoutElection(uint32_t deviceId)
+    : _deviceId(deviceId), _role(FANOUT_LISTENING), _leaderId(0),
+      _sinceMs(0), _lastHeardMs(0), _roleChanges(0) {}
+
+void FanoutElection::begin(uint64_t nowMs) {
+    _setRole(FANOUT_LISTENING, 0);
+    _sinceMs = nowMs;
+    _lastHeardMs = nowMs;
+}
+
+bool FanoutElection::onSnapshot(uint32_t senderId, uint64_t nowMs) {
+    // Our own datagrams come back through multicast loopback
+    if (senderId == _deviceId) return false;
+
+    switch (_role) {
+        case FANOUT_LEADER:
+            if (senderId > _deviceId) {
+                // We outrank it; it steps down when it hears us
+                return false;
+            }
+            _setRole(FANOUT_FOLLOWER, senderId);
+            break;
+
+        case FANOUT_FOLLOWER:
+            if (senderId != _leaderId) {
+                // Switch only to a better leader, or if ours has gone quiet
+                bool leaderQuiet = (int64_t)(nowMs - _lastHeardMs) >= (int64_t)FANOUT_LEADER_TIMEOUT_MS;
+                if (senderId > _leaderId && !leaderQuiet) return false;
+                _setRole(FANOUT_FOLLOWER, senderId);
+            }
+            break;
+
+        case FANOUT_LISTENING:
+            _setRole(FANOUT_FOLLOWER, senderId);
+            break;
+    }
+
+    _lastHeardMs = nowMs;
+    return true;
+}
+
+bool FanoutElection::update(uint64_t nowMs) {
+    switch (_role) {
+        case FANOUT_LISTENING:
+            if ((int64_t)(nowMs - _sinceMs) < (int64_t)FANOUT_STARTUP_LISTEN_MS) return false;
+            break;
+        case FANOUT_FOLLOWER:
+            if ((int64_t)(nowMs - _lastHeardMs) < (int64_t)FANOUT_LEADER_TIMEOUT_MS) return false;
+            break;
+        case FANOUT_LEADER:
+            return false;
+    }
+
+    _setRole(FANOUT_LEADER, _deviceId);
+    return true;
+}
+
+bool FanoutElection::isHeartbeatDue(uint64_t lastSentMs, uint64_t nowMs) const {
+    return _role == FANOUT_LEADER && (int64_t)(nowMs - lastSentMs) >= (int64_t)FANOUT_HEARTBEAT_MS;
+}
+
+FanoutRole FanoutElection::getRole() const {
+    return _role;
+}
+
+bool FanoutElection::isLeader() const {
+    return _role == FANOUT_LEADER;
+}
+
+uint32_t FanoutElection::getLeaderId() const {
+    return _leaderId;
+}
+
+uint32_t FanoutElection::getDeviceId() const {
+    return _deviceId;
+}
+
+unsigned long FanoutElection::getRoleChangeCount() const {
+    return _roleChanges;
+}
+
+void FanoutElection::_setRole(FanoutRole role, uint32_t leaderId) {
+    if (role != _role || leaderId != _leaderId) {
+        _roleChanges++;
+    }
+    _role = role;
+    _leaderId = leaderId;
+}
@@ -0,0 +1,65 @@
+#include "fetch_budget.h"
+
+FetchBudget::FetchBudget(const unsigned long phaseMs[FETCH_PHASE_COUNT], unsigned long totalMs)
+    : _totalMs(totalMs), _startMs(0), _phaseStartMs(0), _phaseAllowedMs(totalMs),
+      _phase(FETCH_PHASE_IDLE), _overrunPhase(FETCH_PHASE_IDLE), _totalOverrun(false) {
+    for (int i = 0; i < FETCH_PHASE_COUNT; i++) {
+        _phaseMs[i] = phaseMs[i];
+        _overruns[i] = 0;
+    }
+}
+
+void FetchBudget::start(uint64_t nowMs) {
+    _startMs = nowMs;
+    _phaseStartMs = nowMs;
+    _phaseAllowedMs = _totalMs;
+    _phase = FETCH_PHASE_IDLE;
+    _overrunPhase = FETCH_PHASE_IDLE;
+    _totalOverrun = false;
+}
+
+unsigned long FetchBudget::enter(uint8_t phase, uint64_t nowMs) {
+    _phase = phase < FETCH_PHASE_COUNT ? phase : (uint8_t)FETCH_PHASE_IDLE;
+    _phaseStartMs = nowMs;
+
+    uint64_t elapsed = nowMs - _startMs;
+    unsigned long remaining = elapsed < _totalMs ? _totalMs - (unsigned long)elapsed : 0;
+    unsigned long own = _phaseMs[_phase];
+    _phaseAllowedMs = (own > 0 && own < remaining) ? own : remaining;
+    if (_phaseAllowedMs == 0) {
+        _phaseAllowedMs = 1;  // Socket calls treat 0 as "wait forever"
+    }
+    return _phaseAllowedMs;
+}
+
+bool FetchBudget::check(uint64_t nowMs) {
+    bool phaseOver = nowMs - _phaseStartMs > _phaseAllowedMs;
+    bool totalOver = nowMs - _startMs > _totalMs;
+    if (!phaseOver && !totalOver) return true;
+
+    // Count each request once, against the phase it was stuck in
+    if (_overrunPhase == FETCH_PHASE_IDLE) {
+        // The total is to blame when it, not the phase budget, set the limit
+        unsigned long own = _phaseMs[_phase];
+        _overrunPhase = _phase;
+        _totalOverrun = own == 0 || _phaseAllowedMs < own;
+        _overruns[_phase]++;
+    }
+    return false;
+}
+
+uint64_t FetchBudget::getPhaseDeadline() const {
+    return _phaseStartMs + _phaseAllowedMs;
+}
+
+uint8_t FetchBudget::getOverrunPhase() const {
+    return _overrunPhase;
+}
+
+bool FetchBudget::wasTotalOverrun() const {
+    return _totalOverrun;
+}
+
+unsigned long FetchBudget::getOverrunCount(uint8_t phase) const {
+    return phase < FETCH_PHASE_COUNT ? _overruns[phase] : 0;
+}
@@ -0,0 +1,245 @@
+#include "frame_buffer.h"
+#include <string.h>
+
+// FNV-1a parameters used to hash frames
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+// Largest stored deflate block
+static const size_t DEFLATE_STORED_MAX = 65535;
+
+FrameBuffer::FrameBuffer(uint16_t* pixels, uint16_t width, uint16_t height)
+    : _pixels(pixels), _width(width), _height(height), _hash(0), _hashValid(false) {
+    fill(0);
+}
+
+void FrameBuffer::fill(uint16_t color) {
+    size_t count = (size_t)_width * _height;
+    for (size_t i = 0; i < count; i++) {
+        _pixels[i] = color;
+    }
+    _hashValid = false;
+}
+
+void FrameBuffer::fillRect(int x, int y, int w, int h, uint16_t color) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > _width ? _width : x + w;
+    int y1 = y + h > _height ? _height : y + h;
+
+    for (int row = y0; row < y1; row++) {
+        uint16_t* line = _pixels + (size_t)row * _width;
+        for (int col = x0; col < x1; col++) {
+            line[col] = color;
+        }
+    }
+    _hashValid = false;
+}
+
+void FrameBuffer::setPixel(int x, int y, uint16_t color) {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    _pixels[(size_t)y * _width + x] = color;
+    _hashValid = false;
+}
+
+uint16_t FrameBuffer::getPixel(int x, int y) const {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return 0;
+    return _pixels[(size_t)y * _width + x];
+}
+
+uint16_t FrameBuffer::getWidth() const {
+    return _width;
+}
+
+uint16_t FrameBuffer::getHeight() const {
+    return _height;
+}
+
+uint32_t FrameBuffer::getHash() const {
+    if (!_hashValid) {
+        uint32_t hash = FNV_OFFSET_BASIS;
+        size_t count = (size_t)_width * _height;
+        for (size_t i = 0; i < count; i++) {
+            hash ^= _pixels[i] & 0xFF;
+            hash *= FNV_PRIME;
+            hash ^= _pixels[i] >> 8;
+            hash *= FNV_PRIME;
+        }
+        _hash = hash;
+        _hashValid = true;
+    }
+    return _hash;
+}
+
+// ============================================================================
+// RLE
+// ============================================================================
+
+/**
+ * Write a little-endian u16
+ */
+static void _putU16Le(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+size_t encodeFrameRle(const FrameBuffer& frame, uint8_t* buffer, size_t bufferSize) {
+    if (bufferSize < 7) return 0;
+
+    buffer[0] = 'F';
+    buffer[1] = 'R';
+    buffer[2] = 1;
+    _putU16Le(buffer + 3, frame.getWidth());
+    _putU16Le(buffer + 5, frame.getHeight());
+    size_t length = 7;
+
+    size_t count = (size_t)frame.getWidth() * frame.getHeight();
+    size_t i = 0;
+    while (i < count) {
+        uint16_t color = frame.getPixel((int)(i % frame.getWidth()), (int)(i / frame.getWidth()));
+        size_t run = 1;
+        while (run < 255 && i + run < count &&
+               frame.getPixel((int)((i + run) % frame.getWidth()), (int)((i + run) / frame.getWidth())) == color) {
+            run++;
+        }
+
+        if (length + 3 > bufferSize) return 0;
+        buffer[length] = (uint8_t)run;
+        _putU16Le(buffer + length + 1, color);
+        length += 3;
+        i += run;
+    }
+    return length;
+}
+
+// ============================================================================
+// PNG
+// ============================================================================
+
+/**
+ * Update a CRC-32 (as used by PNG) with a block of bytes, a nibble at a time
+ */
+static uint32_t _crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    static const uint32_t NIBBLE_TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+    }
+    return crc;
+}
+
+/**
+ * Write a big-endian u32
+ */
+static void _putU32Be(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+/**
+ * Write a chunk's CRC over its type and data, which start at typeStart
+ */
+static void _finishChunk(uint8_t* typeStart, size_t dataLength) {
+    uint32_t crc = _crc32(0xFFFFFFFFu, typeStart, 4 + dataLength) ^ 0xFFFFFFFFu;
+    _putU32Be(typeStart + 4 + dataLength, crc);
+}
+
+size_t encodeFramePng(const FrameBuffer& frame, uint8_t* buffer, size_t bufferSize) {
+    uint16_t width = frame.getWidth();
+    uint16_t height = frame.getHeight();
+    size_t rawSize = FRAME_PNG_RAW_SIZE(width, height);
+    size_t blockCount = rawSize / DEFLATE_STORED_MAX + 1;
+    if (bufferSize < FRAME_PNG_SIZE(width, height)) return 0;
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t* p = buffer;
+    memcpy(p, SIGNATURE, sizeof(SIGNATURE));
+    p += sizeof(SIGNATURE);
+
+    // IHDR: 8-bit truecolor, no interlace
+    _putU32Be(p, 13);
+    memcpy(p + 4, "IHDR", 4);
+    _putU32Be(p + 8, width);
+    _putU32Be(p + 12, height);
+    p[16] = 8;   // Bit depth
+    p[17] = 2;   // Color type: RGB
+    p[18] = 0;   // Compression
+    p[19] = 0;   // Filter method
+    p[20] = 0;   // Interlace
+    _finishChunk(p + 4, 13);
+    p += 12 + 13;
+
+    // IDAT: zlib header, stored deflate blocks, Adler-32
+    size_t idatLength = 2 + 5 * blockCount + rawSize + 4;
+    _putU32Be(p, (uint32_t)idatLength);
+    memcpy(p + 4, "IDAT", 4);
+    uint8_t* data = p + 8;
+    data[0] = 0x78;  // Deflate, 32K window
+    data[1] = 0x01;  // No preset dictionary; makes the header a multiple of 31
+    uint8_t* out = data + 2;
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+    size_t remainingInBlock = 0;
+    size_t remaining = rawSize;
+
+    for (uint16_t y = 0; y < height; y++) {
+        for (int x = -1; x < (int)width; x++) {
+            uint8_t bytes[3];
+            int byteCount;
+            if (x < 0) {
+                bytes[0] = 0;  // Filter type None
+                byteCount = 1;
+            } else {
+                uint16_t c = frame.getPixel(x, y);
+                uint8_t r = (c >> 11) & 0x1F;
+                uint8_t g = (c >> 5) & 0x3F;
+                uint8_t b = c & 0x1F;
+                bytes[0] = (uint8_t)((r << 3) | (r >> 2));
+                bytes[1] = (uint8_t)((g << 2) | (g >> 4));
+                bytes[2] = (uint8_t)((b << 3) | (b >> 2));
+                byteCount = 3;
+            }
+
+            for (int i = 0; i < byteCount; i++) {
+                if (remainingInBlock == 0) {
+                    size_t blockLength = remaining < DEFLATE_STORED_MAX ? remaining : DEFLATE_STORED_MAX;
+                    out[0] = remaining < DEFLATE_STORED_MAX ? 1 : 0;  // BFINAL, BTYPE stored
+                    _putU16Le(out + 1, (uint16_t)blockLength);
+                    _putU16Le(out + 3, (uint16_t)~blockLength);
+                    out += 5;
+                    remainingInBlock = blockLength;
+                }
+                *out++ = bytes[i];
+                remainingInBlock--;
+                remaining--;
+                adlerA = (adlerA + bytes[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+        }
+    }
+    // A frame whose raw size is an exact multiple of the block size ends with an empty final block
+    if (out < data + idatLength - 4) {
+        out[0] = 1;
+        _putU16Le(out + 1, 0);
+        _putU16Le(out + 3, 0xFFFF);
+        out += 5;
+    }
+    _putU32Be(out, (adlerB << 16) | adlerA);
+    _finishChunk(p + 4, idatLength);
+    p += 12 + idatLength;
+
+    // IEND
+    _putU32Be(p, 0);
+    memcpy(p + 4, "IEND", 4);
+    _finishChunk(p + 4, 0);
+    p += 12;
+
+    return (size_t)(p - buffer);
+}
@@ -0,0 +1,416 @@
+#include "gtfs_realtime.h"
+#include <string.h>
+
+// Protobuf wire types
+static const uint8_t WIRE_VARINT = 0;
+static const uint8_t WIRE_FIXED64 = 1;
+static const uint8_t WIRE_LENGTH = 2;
+static const uint8_t WIRE_FIXED32 = 5;
+
+// GTFS-realtime field numbers (gtfs-realtime.proto)
+static const uint32_t FEED_HEADER = 1;
+static const uint32_t FEED_ENTITY = 2;
+static const uint32_t HEADER_TIMESTAMP = 3;
+static const uint32_t ENTITY_IS_DELETED = 2;
+static const uint32_t ENTITY_TRIP_UPDATE = 3;
+static const uint32_t TRIP_UPDATE_TRIP = 1;
+static const uint32_t TRIP_UPDATE_STOP_TIME_UPDATE = 2;
+static const uint32_t TRIP_SCHEDULE_RELATIONSHIP = 4;
+static const uint32_t TRIP_ROUTE_ID = 5;
+static const uint32_t TRIP_DIRECTION_ID = 6;
+static const uint32_t STOP_TIME_ARRIVAL = 2;
+static const uint32_t STOP_TIME_DEPARTURE = 3;
+static const uint32_t STOP_TIME_STOP_ID = 4;
+static const uint32_t STOP_TIME_SCHEDULE_RELATIONSHIP = 5;
+static const uint32_t EVENT_TIME = 2;
+
+// Enum values
+static const uint64_t TRIP_CANCELED = 3;
+static const uint64_t STOP_SKIPPED = 1;
+
+// Longest ETA passed on (999 minutes, as much as the panel can show)
+static const int64_t MAX_ETA_SEC = 999L * 60;
+
+// FNV-1a parameters used to fingerprint the arrivals
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+/**
+ * Fold raw bytes into an FNV-1a hash
+ */
+static uint32_t _hashBytes(uint32_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+GtfsRtProvider::GtfsRtProvider(const char* feedUrl, const char* const* stopIds, int stopCount,
+                               const GtfsRtRoute* routes, int routeCount)
+    : _feedUrl(feedUrl), _stopIds(stopIds), _stopCount(stopCount),
+      _routes(routes), _routeCount(routeCount) {
+    begin(0);
+}
+
+const char* GtfsRtProvider::getName() const {
+    return "GTFS-rt";
+}
+
+bool GtfsRtProvider::buildUrl(char* url, size_t size) const {
+    size_t length = strlen(_feedUrl);
+    if (length >= size) return false;
+    memcpy(url, _feedUrl, length + 1);
+    return true;
+}
+
+void GtfsRtProvider::begin(time_t wallNow) {
+    _state = READ_KEY;
+    _pos = 0;
+    _depth = 1;
+    _kinds[0] = MSG_FEED;
+    _ends[0] = UINT32_MAX;
+    _field = 0;
+    _wireType = 0;
+    _varint = 0;
+    _shift = 0;
+    _remaining = 0;
+    _string = nullptr;
+    _stringLength = 0;
+    _stringTooLong = false;
+    _error = "";
+
+    _onStart(MSG_ENTITY);
+    _onStart(MSG_STOP_TIME_UPDATE);
+
+    _wallNow = wallNow;
+    _feedTime = 0;
+    _tripCount = 0;
+    _arrivalCount = 0;
+}
+
+size_t GtfsRtProvider::write(const uint8_t* data, size_t length) {
+    if (_error[0] != '\0') return 0;
+
+    size_t i = 0;
+    while (i < length) {
+        if (_state == READ_SKIP) {
+            // Skipped fields are passed over in one step
+            uint32_t step = (uint32_t)(length - i) < _remaining ? (uint32_t)(length - i) : _remaining;
+            _pos += step;
+            _remaining -= step;
+            i += step;
+            if (_remaining == 0) {
+                _state = READ_KEY;
+                _popFinished();
+            }
+            continue;
+        }
+        if (!_decodeByte(data[i++])) return i;
+    }
+    return length;
+}
+
+bool GtfsRtProvider::finish(TrainObservation* observations, int maxCount, int& count, uint32_t& hash) {
+    count = 0;
+    hash = FNV_OFFSET_BASIS;
+    if (_error[0] != '\0') return false;
+    if (_state != READ_KEY || _shift != 0 || _depth != 1) {
+        _fail("feed cut off");
+        return false;
+    }
+
+    time_t now = _wallNow != 0 ? _wallNow : _feedTime;
+    if (now == 0 && _arrivalCount > 0) {
+        _fail("no clock and no feed timestamp");
+        return false;
+    }
+
+    // Soonest first, like WMATA's own list
+    int order[GTFS_RT_MAX_ARRIVALS];
+    for (int i = 0; i < _arrivalCount; i++) {
+        int slot = i;
+        while (slot > 0 && _arrivals[order[slot - 1]].arrivalSec > _arrivals[i].arrivalSec) {
+            order[slot] = order[slot - 1];
+            slot--;
+        }
+        order[slot] = i;
+    }
+
+    for (int i = 0; i < _arrivalCount; i++) {
+        const Arrival& arrival = _arrivals[order[i]];
+        hash = _hashBytes(hash, arrival.line, sizeof(arrival.line));
+        hash = _hashBytes(hash, arrival.destination, sizeof(arrival.destination));
+        hash = _hashBytes(hash, &arrival.group, sizeof(arrival.group));
+        hash = _hashBytes(hash, &arrival.arrivalSec, sizeof(arrival.arrivalSec));
+        hash = _hashBytes(hash, &arrival.departureSec, sizeof(arrival.departureSec));
+
+        int64_t leavesSec = arrival.departureSec != 0 ? arrival.departureSec : arrival.arrivalSec + GTFS_RT_DWELL_SEC;
+        if (leavesSec < (int64_t)now || count >= maxCount) continue;
+
+        TrainObservation& observation = observations[count++];
+        memcpy(observation.line, arrival.line, LINE_MAX_LEN);
+        memcpy(observation.destination, arrival.destination, DEST_MAX_LEN);
+        observation.group = arrival.group;
+        observation.cars = 0;
+
+        int64_t etaSec = arrival.arrivalSec - (int64_t)now;
+        if (etaSec <= 0) {
+            observation.status = TRAIN_BOARDING;
+            observation.etaMs = 0;
+        } else {
+            observation.status = TRAIN_MOVING;
+            observation.etaMs = (long)(etaSec < MAX_ETA_SEC ? etaSec : MAX_ETA_SEC) * 1000L;
+        }
+    }
+    return true;
+}
+
+const char* GtfsRtProvider::getError() const {
+    return _error;
+}
+
+int GtfsRtProvider::getTripCount() const {
+    return _tripCount;
+}
+
+time_t GtfsRtProvider::getFeedTime() const {
+    return _feedTime;
+}
+
+bool GtfsRtProvider::_decodeByte(uint8_t byte) {
+    _pos++;
+
+    if (_state == READ_STRING) {
+        if (_stringLength < GTFS_RT_ID_MAX_LEN - 1) {
+            _string[_stringLength++] = (char)byte;
+        } else {
+            _stringTooLong = true;
+        }
+        if (--_remaining == 0) {
+            // Too long to compare; an empty ID matches nothing
+            _string[_stringTooLong ? 0 : _stringLength] = '\0';
+            _state = READ_KEY;
+            _popFinished();
+        }
+        return true;
+    }
+
+    // Keys, varint values and lengths are all varints
+    if (_shift >= 64) return _fail("varint too long");
+    _varint |= (uint64_t)(byte & 0x7F) << _shift;
+    _shift += 7;
+    if (byte & 0x80) return true;
+
+    uint64_t value = _varint;
+    _varint = 0;
+    _shift = 0;
+
+    switch (_state) {
+        case READ_KEY:
+            return _onKey(value);
+        case READ_VARINT:
+            _onVarint(value);
+            _state = READ_KEY;
+            _popFinished();
+            return true;
+        default:
+            return _onLength(value);
+    }
+}
+
+bool GtfsRtProvider::_onKey(uint64_t key) {
+    _field = (uint32_t)(key >> 3);
+    _wireType = (uint8_t)(key & 0x07);
+    if (_field == 0) return _fail("field number 0");
+
+    switch (_wireType) {
+        case WIRE_VARINT:
+            _state = READ_VARINT;
+            return true;
+        case WIRE_LENGTH:
+            _state = READ_LENGTH;
+            return true;
+        case WIRE_FIXED64:
+        case WIRE_FIXED32:
+            _remaining = _wireType == WIRE_FIXED64 ? 8 : 4;
+            if (_remaining > _ends[_depth - 1] - _pos) return _fail("field overruns its message");
+            _state = READ_SKIP;
+            return true;
+        default:
+            return _fail("unsupported wire type");
+    }
+}
+
+void GtfsRtProvider::_onVarint(uint64_t value) {
+    switch (_kinds[_depth - 1]) {
+        case MSG_HEADER:
+            if (_field == HEADER_TIMESTAMP) _feedTime = (time_t)value;
+            break;
+        case MSG_ENTITY:
+            if (_field == ENTITY_IS_DELETED && value != 0) _cancelled = true;
+            break;
+        case MSG_TRIP:
+            if (_field == TRIP_DIRECTION_ID) _directionId = (uint8_t)value;
+            if (_field == TRIP_SCHEDULE_RELATIONSHIP && value == TRIP_CANCELED) _cancelled = true;
+            break;
+        case MSG_STOP_TIME_UPDATE:
+            if (_field == STOP_TIME_SCHEDULE_RELATIONSHIP && value == STOP_SKIPPED) _stopSkipped = true;
+            break;
+        case MSG_ARRIVAL:
+            if (_field == EVENT_TIME) _stopArrival = (int64_t)value;
+            break;
+        case MSG_DEPARTURE:
+            if (_field == EVENT_TIME) _stopDeparture = (int64_t)value;
+            break;
+        default:
+            break;
+    }
+}
+
+bool GtfsRtProvider::_onLength(uint64_t length) {
+    if (length > _ends[_depth - 1] - _pos) return _fail("field overruns its message");
+
+    // Pick what to do with the field: open a message, read an ID, or skip it
+    int kind = -1;
+    char* string = nullptr;
+    switch (_kinds[_depth - 1]) {
+        case MSG_FEED:
+            if (_field == FEED_HEADER) kind = MSG_HEADER;
+            if (_field == FEED_ENTITY) kind = MSG_ENTITY;
+            break;
+        case MSG_ENTITY:
+            if (_field == ENTITY_TRIP_UPDATE) kind = MSG_TRIP_UPDATE;
+            break;
+        case MSG_TRIP_UPDATE:
+            if (_field == TRIP_UPDATE_TRIP) kind = MSG_TRIP;
+            if (_field == TRIP_UPDATE_STOP_TIME_UPDATE) kind = MSG_STOP_TIME_UPDATE;
+            break;
+        case MSG_TRIP:
+            if (_field == TRIP_ROUTE_ID) string = _routeId;
+            break;
+        case MSG_STOP_TIME_UPDATE:
+            if (_field == STOP_TIME_ARRIVAL) kind = MSG_ARRIVAL;
+            if (_field == STOP_TIME_DEPARTURE) kind = MSG_DEPARTURE;
+            if (_field == STOP_TIME_STOP_ID) string = _stopId;
+            break;
+        default:
+            break;
+    }
+
+    if (kind >= 0 && _depth < GTFS_RT_MAX_DEPTH) {
+        _push((uint8_t)kind, (uint32_t)length);
+    } else if (string != nullptr) {
+        string[0] = '\0';
+        _string = string;
+        _stringLength = 0;
+        _stringTooLong = false;
+        _remaining = (uint32_t)length;
+        _state = length > 0 ? READ_STRING : READ_KEY;
+    } else {
+        _remaining = (uint32_t)length;
+        _state = length > 0 ? READ_SKIP : READ_KEY;
+    }
+    if (_state == READ_KEY) _popFinished();
+    return true;
+}
+
+void GtfsRtProvider::_push(uint8_t kind, uint32_t length) {
+    _kinds[_depth] = kind;
+    _ends[_depth] = _pos + length;
+    _depth++;
+    _state = READ_KEY;
+    _onStart(kind);
+}
+
+void GtfsRtProvider::_popFinished() {
+    // The feed itself has no length; it ends when the body does
+    while (_depth > 1 && _pos == _ends[_depth - 1]) {
+        _depth--;
+        _onEnd(_kinds[_depth]);
+    }
+}
+
+void GtfsRtProvider::_onStart(uint8_t kind) {
+    if (kind == MSG_ENTITY) {
+        _routeId[0] = '\0';
+        _directionId = 0;
+        _cancelled = false;
+        _hasMatch = false;
+        _tripContinues = false;
+        _matchArrival = 0;
+        _matchDeparture = 0;
+    } else if (kind == MSG_STOP_TIME_UPDATE) {
+        _stopId[0] = '\0';
+        _stopSkipped = false;
+        _stopArrival = 0;
+        _stopDeparture = 0;
+    }
+}
+
+void GtfsRtProvider::_onEnd(uint8_t kind) {
+    if (kind == MSG_STOP_TIME_UPDATE) {
+        if (_stopSkipped) return;
+        if (_hasMatch) {
+            _tripContinues = true;
+        } else if (_isStop(_stopId) && (_stopArrival != 0 || _stopDeparture != 0)) {
+            _hasMatch = true;
+            _matchArrival = _stopArrival != 0 ? _stopArrival : _stopDeparture;
+            _matchDeparture = _stopDeparture;
+        }
+    } else if (kind == MSG_TRIP_UPDATE) {
+        _tripCount++;
+    } else if (kind == MSG_ENTITY) {
+        // A trip that ends here only arrives; one with no later stop and no
+        // departure time is taken to end here too
+        if (!_cancelled && _hasMatch && (_matchDeparture != 0 || _tripContinues)) {
+            _addArrival();
+        }
+    }
+}
+
+void GtfsRtProvider::_addArrival() {
+    int slot = _arrivalCount;
+    if (slot == GTFS_RT_MAX_ARRIVALS) {
+        // Full: replace the latest arrival if this one is sooner
+        slot = 0;
+        for (int i = 1; i < _arrivalCount; i++) {
+            if (_arrivals[i].arrivalSec > _arrivals[slot].arrivalSec) slot = i;
+        }
+        if (_arrivals[slot].arrivalSec <= _matchArrival) return;
+    } else {
+        _arrivalCount++;
+    }
+
+    Arrival& arrival = _arrivals[slot];
+    memset(&arrival, 0, sizeof(arrival));
+    arrival.group = (uint8_t)(_directionId + 1);
+    arrival.arrivalSec = _matchArrival;
+    arrival.departureSec = _matchDeparture;
+
+    const GtfsRtRoute* route = nullptr;
+    for (int i = 0; i < _routeCount; i++) {
+        if (strcmp(_routes[i].routeId, _routeId) == 0) {
+            route = &_routes[i];
+            break;
+        }
+    }
+    const char* line = route != nullptr ? route->line : _routeId;
+    const char* destination = route != nullptr && _directionId < 2 ? route->destinations[_directionId] : nullptr;
+    strncpy(arrival.line, line, LINE_MAX_LEN - 1);
+    if (destination != nullptr) strncpy(arrival.destination, destination, DEST_MAX_LEN - 1);
+}
+
+bool GtfsRtProvider::_isStop(const char* stopId) const {
+    if (stopId[0] == '\0') return false;
+    for (int i = 0; i < _stopCount; i++) {
+        if (strcmp(_stopIds[i], stopId) == 0) return true;
+    }
+    return false;
+}
+
+bool GtfsRtProvider::_fail(const char* error) {
+    if (_error[0] == '\0') _error = error;
+    return false;
+}
@@ -0,0 +1,46 @@
+#include "hang_monitor.h"
+
+HangMonitor::HangMonitor(unsigned long recoverAfterMs, unsigned long restartAfterMs,
+                         unsigned long resetNetworkAfterMs)
+    : _recoverAfterMs(recoverAfterMs), _restartAfterMs(restartAfterMs), _resetNetworkAfterMs(resetNetworkAfterMs),
+      _armed(false), _armedAt(0), _stage(HANG_NONE), _recoveries(0) {}
+
+void HangMonitor::arm(uint64_t nowMs) {
+    _armedAt.store(nowMs, std::memory_order_relaxed);
+    _stage.store(HANG_NONE, std::memory_order_relaxed);
+    _armed.store(true, std::memory_order_release);
+}
+
+void HangMonitor::disarm() {
+    _armed.store(false, std::memory_order_release);
+}
+
+bool HangMonitor::isArmed() const {
+    return _armed.load(std::memory_order_acquire);
+}
+
+HangAction HangMonitor::check(uint64_t nowMs) {
+    if (!_armed.load(std::memory_order_acquire)) return HANG_NONE;
+
+    uint64_t age = nowMs - _armedAt.load(std::memory_order_relaxed);
+    uint8_t stage = _stage.load(std::memory_order_relaxed);
+
+    if (stage < HANG_RESTART && age >= _restartAfterMs) {
+        _stage.store(HANG_RESTART, std::memory_order_relaxed);
+        return HANG_RESTART;
+    }
+    if (_resetNetworkAfterMs > 0 && stage < HANG_RESET_NETWORK && age >= _resetNetworkAfterMs) {
+        _stage.store(HANG_RESET_NETWORK, std::memory_order_relaxed);
+        return HANG_RESET_NETWORK;
+    }
+    if (stage < HANG_RECOVER && age >= _recoverAfterMs) {
+        _stage.store(HANG_RECOVER, std::memory_order_relaxed);
+        _recoveries.fetch_add(1, std::memory_order_relaxed);
+        return HANG_RECOVER;
+    }
+    return HANG_NONE;
+}
+
+unsigned long HangMonitor::getRecoveryCount() const {
+    return _recoveries.load(std::memory_order_relaxed);
+}
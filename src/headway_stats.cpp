@@ -0,0 +1,152 @@
+#include "headway_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(HeadwayStats) <= HEADWAY_MEMORY_CEILING,
+              "HeadwayStats exceeds HEADWAY_MEMORY_CEILING; shrink the window or stream count");
+static_assert(HEADWAY_WINDOW <= 255, "Histogram counts are 8-bit");
+
+/**
+ * Histogram bin for a headway
+ */
+static int _binFor(uint16_t headwaySec) {
+    int bin = headwaySec / HEADWAY_BIN_SEC;
+    return bin < HEADWAY_BINS ? bin : HEADWAY_BINS - 1;
+}
+
+HeadwayStats::HeadwayStats() {
+    reset();
+}
+
+void HeadwayStats::reset() {
+    memset(_streams, 0, sizeof(_streams));
+    _streamCount = 0;
+}
+
+void HeadwayStats::recordDeparture(const char* line, uint8_t group, uint64_t nowMs) {
+    Stream& stream = _findOrCreate(line, group, nowMs);
+    stream.lastUsedMs = (uint32_t)nowMs;
+    
+    if (!stream.hasDeparture) {
+        stream.hasDeparture = true;
+        stream.lastDepartureMs = (uint32_t)nowMs;
+        return;
+    }
+    
+    uint32_t headwaySec = ((uint32_t)nowMs - stream.lastDepartureMs) / 1000;
+    stream.lastDepartureMs = (uint32_t)nowMs;
+    if (headwaySec == 0 || headwaySec > HEADWAY_MAX_SEC) {
+        return;  // Duplicate report or a service break
+    }
+    
+    // Evict the oldest headway once the window is full
+    if (stream.count == HEADWAY_WINDOW) {
+        uint16_t evicted = stream.headways[stream.head];
+        stream.sumSec -= evicted;
+        stream.histogram[_binFor(evicted)]--;
+    } else {
+        stream.count++;
+    }
+    
+    stream.headways[stream.head] = (uint16_t)headwaySec;
+    stream.sumSec += headwaySec;
+    stream.histogram[_binFor((uint16_t)headwaySec)]++;
+    stream.head = (uint8_t)((stream.head + 1) % HEADWAY_WINDOW);
+}
+
+int HeadwayStats::getStreamCount() const {
+    return _streamCount;
+}
+
+bool HeadwayStats::getSummary(int index, uint64_t nowMs, HeadwaySummary& summary) const {
+    if (index < 0 || index >= _streamCount) {
+        return false;
+    }
+    
+    const Stream& stream = _streams[index];
+    memcpy(summary.line, stream.line, LINE_MAX_LEN);
+    summary.group = stream.group;
+    summary.samples = stream.count;
+    summary.meanSec = stream.count ? (uint16_t)(stream.sumSec / stream.count) : 0;
+    summary.sinceLastSec = ((uint32_t)nowMs - stream.lastDepartureMs) / 1000;
+    
+    if (stream.count >= HEADWAY_MIN_SAMPLES) {
+        summary.p50Sec = _percentile(stream, 50);
+        summary.p90Sec = _percentile(stream, 90);
+        summary.gapAlert = summary.sinceLastSec * HEADWAY_GAP_FACTOR_DEN >
+                           (uint32_t)summary.p90Sec * HEADWAY_GAP_FACTOR_NUM;
+    } else {
+        summary.p50Sec = 0;
+        summary.p90Sec = 0;
+        summary.gapAlert = false;
+    }
+    return true;
+}
+
+size_t HeadwayStats::formatReport(char* buffer, size_t bufferSize, uint64_t nowMs) const {
+    if (buffer == nullptr || bufferSize == 0) {
+        return 0;
+    }
+    
+    size_t length = 0;
+    buffer[0] = '\0';
+    
+    for (int i = 0; i < _streamCount; i++) {
+        HeadwaySummary summary;
+        getSummary(i, nowMs, summary);
+        
+        int written = snprintf(buffer + length, bufferSize - length,
+                               "%s%u n=%u mean=%u p50=%u p90=%u last=%lu%s\n",
+                               summary.line, summary.group, summary.samples,
+                               summary.meanSec, summary.p50Sec, summary.p90Sec,
+                               (unsigned long)summary.sinceLastSec,
+                               summary.gapAlert ? " GAP" : "");
+        if (written < 0 || (size_t)written >= bufferSize - length) {
+            buffer[length] = '\0';  // Drop the partial line
+            break;
+        }
+        length += (size_t)written;
+    }
+    return length;
+}
+
+HeadwayStats::Stream& HeadwayStats::_findOrCreate(const char* line, uint8_t group, uint64_t nowMs) {
+    for (int i = 0; i < _streamCount; i++) {
+        if (_streams[i].group == group && strncmp(_streams[i].line, line, LINE_MAX_LEN) == 0) {
+            return _streams[i];
+        }
+    }
+    
+    int index = _streamCount;
+    if (_streamCount < HEADWAY_MAX_STREAMS) {
+        _streamCount++;
+    } else {
+        // Recycle the stream that has gone longest without a departure
+        index = 0;
+        for (int i = 1; i < _streamCount; i++) {
+            if ((int32_t)(_streams[i].lastUsedMs - _streams[index].lastUsedMs) < 0) {
+                index = i;
+            }
+        }
+    }
+    
+    Stream& stream = _streams[index];
+    memset(&stream, 0, sizeof(stream));
+    strncpy(stream.line, line, LINE_MAX_LEN - 1);
+    stream.group = group;
+    stream.lastUsedMs = (uint32_t)nowMs;
+    return stream;
+}
+
+uint16_t HeadwayStats::_percentile(const Stream& stream, int percent) {
+    // Smallest bin whose cumulative count reaches the rank; report its midpoint
+    int rank = (stream.count * percent + 99) / 100;
+    int cumulative = 0;
+    for (int bin = 0; bin < HEADWAY_BINS; bin++) {
+        cumulative += stream.histogram[bin];
+        if (cumulative >= rank) {
+            return (uint16_t)(bin * HEADWAY_BIN_SEC + HEADWAY_BIN_SEC / 2);
+        }
+    }
+    return (uint16_t)(HEADWAY_BINS * HEADWAY_BIN_SEC);
+}
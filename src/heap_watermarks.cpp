@@ -0,0 +1,59 @@
+#include "heap_watermarks.h"
+#include <string.h>
+
+HeapWatermarks::HeapWatermarks() : _count(0) {}
+
+bool HeapWatermarks::record(const char* name, const HeapSample& before, const HeapSample& after) {
+    int index = _indexOf(name);
+    HeapStep* step;
+    if (index >= 0) {
+        step = &_steps[index];
+    } else {
+        if (_count >= HEAP_MAX_STEPS) return false;
+        step = &_steps[_count++];
+        step->name = name;
+        step->runs = 0;
+        step->heldBytes = 0;
+        step->peakBytes = 0;
+    }
+
+    step->runs++;
+    step->heldBytes = (int32_t)before.freeBytes - (int32_t)after.freeBytes;
+
+    // What it kept is a lower bound; a new low during the step shows more
+    uint32_t peak = step->heldBytes > 0 ? (uint32_t)step->heldBytes : 0;
+    if (after.minFreeBytes < before.minFreeBytes && before.freeBytes > after.minFreeBytes) {
+        uint32_t low = before.freeBytes - after.minFreeBytes;
+        if (low > peak) peak = low;
+    }
+    if (peak > step->peakBytes) step->peakBytes = peak;
+    return true;
+}
+
+int HeapWatermarks::getCount() const {
+    return _count;
+}
+
+const HeapStep& HeapWatermarks::getStep(int index) const {
+    return _steps[index];
+}
+
+const HeapStep* HeapWatermarks::find(const char* name) const {
+    int index = _indexOf(name);
+    return index >= 0 ? &_steps[index] : nullptr;
+}
+
+int HeapWatermarks::_indexOf(const char* name) const {
+    for (int i = 0; i < _count; i++) {
+        if (strcmp(_steps[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void HeapWatermarks::format(BufferWriter& out) const {
+    for (int i = 0; i < _count; i++) {
+        const HeapStep& step = _steps[i];
+        out.printf("%s: peak %lu, held %ld bytes (%lu run%s)\n", step.name, (unsigned long)step.peakBytes,
+                   (long)step.heldBytes, step.runs, step.runs == 1 ? "" : "s");
+    }
+}
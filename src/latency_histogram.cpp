@@ -0,0 +1,79 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+// Inclusive upper bound of each finite bucket (ms)
+static const unsigned long BUCKET_BOUNDS_MS[LATENCY_BUCKET_COUNT] = {
+    50, 100, 200, 300, 500, 750, 1000, 2000, 5000, 10000
+};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _sumMs = 0;
+    _maxMs = 0;
+}
+
+void LatencyHistogram::record(unsigned long latencyMs) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKET_COUNT && latencyMs > BUCKET_BOUNDS_MS[bucket]) {
+        bucket++;
+    }
+
+    _buckets[bucket]++;
+    _count++;
+    _sumMs += latencyMs;
+    if (latencyMs > _maxMs) _maxMs = latencyMs;
+}
+
+unsigned long LatencyHistogram::getCount() const {
+    return _count;
+}
+
+uint64_t LatencyHistogram::getSumMs() const {
+    return _sumMs;
+}
+
+unsigned long LatencyHistogram::getMaxMs() const {
+    return _maxMs;
+}
+
+unsigned long LatencyHistogram::getBucketCount(int bucket) const {
+    if (bucket < 0 || bucket > LATENCY_BUCKET_COUNT) return 0;
+    return _buckets[bucket];
+}
+
+unsigned long LatencyHistogram::getBucketBound(int bucket) {
+    if (bucket < 0 || bucket >= LATENCY_BUCKET_COUNT) return 0;
+    return BUCKET_BOUNDS_MS[bucket];
+}
+
+unsigned long LatencyHistogram::estimatePercentile(int percent) const {
+    if (_count == 0) return 0;
+    if (percent < 1) percent = 1;
+    if (percent > 100) percent = 100;
+
+    // Rank of the sample we want, 1-based (nearest-rank)
+    unsigned long rank = (unsigned long)(((uint64_t)_count * percent + 99) / 100);
+
+    unsigned long below = 0;
+    for (int bucket = 0; bucket <= LATENCY_BUCKET_COUNT; bucket++) {
+        unsigned long inBucket = _buckets[bucket];
+        if (below + inBucket < rank) {
+            below += inBucket;
+            continue;
+        }
+
+        unsigned long lower = bucket == 0 ? 0 : BUCKET_BOUNDS_MS[bucket - 1];
+        unsigned long upper = bucket < LATENCY_BUCKET_COUNT ? BUCKET_BOUNDS_MS[bucket] : _maxMs;
+        if (upper > _maxMs) upper = _maxMs;
+        if (upper < lower) return upper;
+
+        // Assume samples are spread evenly through the bucket
+        return lower + (unsigned long)((uint64_t)(upper - lower) * (rank - below) / inBucket);
+    }
+    return _maxMs;
+}
@@ -0,0 +1,120 @@
+#include "log.h"
+#include "postmortem.h"
+#include "mono_clock.h"
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+/** Stack size of the flush task (bytes) */
+#define LOG_TASK_STACK 4096
+
+/** Priority of the flush task; just above idle, below the Arduino loop */
+#define LOG_TASK_PRIORITY 1
+
+/** Core the flush task runs on; the Arduino loop has core 1 */
+#define LOG_TASK_CORE 0
+
+/** How long the flush task sleeps when the ring is empty (ms) */
+#define LOG_TASK_IDLE_MS 20
+
+static LogRing ring;
+
+// The ring takes one writer at a time; tasks other than the loop log too
+static SemaphoreHandle_t writeLock = nullptr;
+
+// Only one consumer may read the ring at a time (the task, or logFlush())
+static std::atomic<bool> draining(false);
+static unsigned long reportedDrops = 0;
+static std::atomic<uint8_t> runtimeLevel(LOG_LEVEL);
+static std::atomic<bool> held(false);
+static PostmortemLog* postmortemLog = nullptr;
+
+/**
+ * Print every record in the ring
+ *
+ * :return bool: True if anything was printed
+ */
+static bool _drain() {
+    if (draining.exchange(true, std::memory_order_acquire)) return false;
+
+    char message[256];
+    LogEntry entry;
+    bool printed = false;
+    while (!held.load(std::memory_order_relaxed) && ring.readNext(message, sizeof(message), entry)) {
+        Serial.printf("%lu.%03lu %c [%s] %s\n",
+                      (unsigned long)(entry.timestampMs / 1000), (unsigned long)(entry.timestampMs % 1000),
+                      logLevelLetter(entry.level), entry.tag, message);
+        if (postmortemLog != nullptr && strcmp(entry.tag, POSTMORTEM_LOG_TAG) != 0) {
+            postmortemLog->addLog(entry.level, entry.tag, message, entry.timestampMs);
+        }
+        printed = true;
+    }
+
+    unsigned long drops = ring.getDroppedCount();
+    if (drops != reportedDrops) {
+        Serial.printf("[LOG] %lu records dropped (ring full)\n", drops - reportedDrops);
+        reportedDrops = drops;
+    }
+
+    draining.store(false, std::memory_order_release);
+    return printed;
+}
+
+static void _flushTask(void* arg) {
+    for (;;) {
+        if (!_drain()) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_TASK_IDLE_MS));
+        }
+    }
+}
+
+bool logBegin() {
+    writeLock = xSemaphoreCreateMutex();
+    return xTaskCreatePinnedToCore(_flushTask, "log", LOG_TASK_STACK, nullptr,
+                                   LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE) == pdPASS;
+}
+
+void logRedact(const char* secret) {
+    ring.addSecret(secret);
+}
+
+void logSetLevel(uint8_t level) {
+    runtimeLevel.store(level < LOG_LEVEL ? level : LOG_LEVEL);
+}
+
+uint8_t logGetLevel() {
+    return runtimeLevel.load();
+}
+
+void logHold(bool hold) {
+    held.store(hold);
+}
+
+void logSetPostmortem(PostmortemLog* postmortem) {
+    postmortemLog = postmortem;
+}
+
+void logWrite(uint8_t level, const char* tag, const char* format, ...) {
+    if (level > runtimeLevel.load(std::memory_order_relaxed)) return;
+
+    va_list args;
+    va_start(args, format);
+    // Before logBegin() only setup() is running
+    if (writeLock != nullptr) xSemaphoreTake(writeLock, portMAX_DELAY);
+    ring.write(level, tag, (uint32_t)monoMillis(), format, args);
+    if (writeLock != nullptr) xSemaphoreGive(writeLock);
+    va_end(args);
+}
+
+void logFlush() {
+    // Let the task finish whatever it was printing, then take over
+    while (!_drain()) {
+        if (!draining.load(std::memory_order_acquire)) break;
+        delay(1);
+    }
+    Serial.flush();
+}
+
+unsigned long logGetDroppedCount() {
+    return ring.getDroppedCount();
+}
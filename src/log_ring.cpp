@@ -0,0 +1,420 @@
+#include "log_ring.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+// Record header: u16 length, u8 level, u8 flags, u32 timestamp, tag, format
+static const size_t HEADER_SIZE = 2 + 1 + 1 + 4 + 2 * sizeof(const char*);
+
+// Header flag: some arguments did not fit and were shortened or left out
+static const uint8_t FLAG_TRUNCATED = 0x01;
+
+// Longest formatted line before redaction
+static const size_t LINE_MAX = LOG_RECORD_MAX + 128;
+
+/**
+ * One printf conversion, as found in a format string
+ */
+struct FormatSpec {
+    const char* start;     // The '%'
+    size_t length;         // Through the conversion character
+    bool widthStar;
+    bool precisionStar;
+    char lengthMod;        // 0, 'H' (hh), 'h', 'l', 'L' (ll), 'z', 'j', 't' or 'D' (long double)
+    char conversion;
+};
+
+/**
+ * Find the next conversion in a format string
+ *
+ * "%%" and unsupported conversions are not reported; they are formatted as
+ * literal text.
+ *
+ * :return bool: True if a conversion was found
+ */
+static bool _nextSpec(const char* p, FormatSpec& spec) {
+    while ((p = strchr(p, '%')) != nullptr) {
+        const char* start = p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        spec.widthStar = false;
+        spec.precisionStar = false;
+        spec.lengthMod = 0;
+
+        while (*p && strchr("-+ #0", *p)) p++;
+        if (*p == '*') {
+            spec.widthStar = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                spec.precisionStar = true;
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') p++;
+            }
+        }
+
+        if (p[0] == 'h' && p[1] == 'h') { spec.lengthMod = 'H'; p += 2; }
+        else if (p[0] == 'l' && p[1] == 'l') { spec.lengthMod = 'L'; p += 2; }
+        else if (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't') { spec.lengthMod = *p++; }
+        else if (*p == 'L') { spec.lengthMod = 'D'; p++; }
+
+        if (*p == '\0') return false;
+        if (!strchr("diouxXcfFeEgGaAsp", *p)) continue;  // %n and unknowns stay literal
+
+        spec.start = start;
+        spec.conversion = *p;
+        spec.length = (size_t)(p + 1 - start);
+        return true;
+    }
+    return false;
+}
+
+static bool _isSigned(char c) { return c == 'd' || c == 'i'; }
+static bool _isUnsigned(char c) { return c == 'o' || c == 'u' || c == 'x' || c == 'X'; }
+static bool _isFloat(char c) { return strchr("fFeEgGaA", c) != nullptr; }
+
+/**
+ * Read one integer argument of the given length modifier, widened
+ */
+static int64_t _readSigned(char lengthMod, va_list& args) {
+    switch (lengthMod) {
+        case 'l': return va_arg(args, long);
+        case 'L': return va_arg(args, long long);
+        case 'z':
+        case 't': return va_arg(args, ptrdiff_t);
+        case 'j': return va_arg(args, intmax_t);
+        default: return va_arg(args, int);
+    }
+}
+
+static uint64_t _readUnsigned(char lengthMod, va_list& args) {
+    switch (lengthMod) {
+        case 'l': return va_arg(args, unsigned long);
+        case 'L': return va_arg(args, unsigned long long);
+        case 'z':
+        case 't': return va_arg(args, size_t);
+        case 'j': return va_arg(args, uintmax_t);
+        default: return va_arg(args, unsigned int);
+    }
+}
+
+/**
+ * Packs arguments into a record buffer; remembers if something didn't fit
+ */
+struct Packer {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+    bool full;          // An argument was left out
+    bool cut;           // A string argument was shortened
+
+    void put(const void* value, size_t size) {
+        if (full || length + size > capacity) {
+            full = true;
+            return;
+        }
+        memcpy(data + length, value, size);
+        length += size;
+    }
+
+    void putString(const char* str) {
+        if (str == nullptr) str = "(null)";
+        // Leave room for a few numeric arguments after the string
+        size_t room = capacity - length;
+        size_t limit = room > 2 + 32 ? room - 2 - 32 : 0;
+        size_t strLength = strlen(str);
+        if (strLength > limit) {
+            strLength = limit;
+            cut = true;
+        }
+        if (full || length + 2 > capacity) {
+            full = true;
+            return;
+        }
+        uint16_t stored = (uint16_t)strLength;
+        put(&stored, 2);
+        put(str, strLength);
+    }
+};
+
+/**
+ * Reads arguments back out of a record
+ */
+struct Unpacker {
+    const uint8_t* data;
+    size_t length;
+    size_t position;
+
+    bool get(void* value, size_t size) {
+        if (position + size > length) return false;
+        memcpy(value, data + position, size);
+        position += size;
+        return true;
+    }
+};
+
+LogRing::LogRing() : _head(0), _tail(0), _dropped(0), _secretCount(0) {}
+
+bool LogRing::addSecret(const char* secret) {
+    if (secret == nullptr || strlen(secret) < 4) return false;
+    for (int i = 0; i < _secretCount; i++) {
+        if (_secrets[i] == secret) return true;  // Same buffer, already watched
+    }
+    if (_secretCount >= LOG_MAX_SECRETS) return false;
+    _secrets[_secretCount++] = secret;
+    return true;
+}
+
+bool LogRing::write(uint8_t level, const char* tag, uint32_t timestampMs, const char* format, va_list args) {
+    uint8_t record[LOG_RECORD_MAX];
+    Packer packer = {record, HEADER_SIZE, sizeof(record), false, false};
+
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    FormatSpec spec;
+    const char* p = format;
+    while (_nextSpec(p, spec)) {
+        p = spec.start + spec.length;
+        if (spec.widthStar) {
+            int64_t width = va_arg(argsCopy, int);
+            packer.put(&width, sizeof(width));
+        }
+        if (spec.precisionStar) {
+            int64_t precision = va_arg(argsCopy, int);
+            packer.put(&precision, sizeof(precision));
+        }
+
+        char c = spec.conversion;
+        if (_isSigned(c)) {
+            int64_t value = _readSigned(spec.lengthMod, argsCopy);
+            packer.put(&value, sizeof(value));
+        } else if (_isUnsigned(c)) {
+            uint64_t value = _readUnsigned(spec.lengthMod, argsCopy);
+            packer.put(&value, sizeof(value));
+        } else if (c == 'c') {
+            int64_t value = va_arg(argsCopy, int);
+            packer.put(&value, sizeof(value));
+        } else if (_isFloat(c)) {
+            double value = spec.lengthMod == 'D' ? (double)va_arg(argsCopy, long double) : va_arg(argsCopy, double);
+            packer.put(&value, sizeof(value));
+        } else if (c == 's') {
+            packer.putString(va_arg(argsCopy, const char*));
+        } else if (c == 'p') {
+            uint64_t value = (uintptr_t)va_arg(argsCopy, void*);
+            packer.put(&value, sizeof(value));
+        }
+    }
+    va_end(argsCopy);
+
+    uint16_t length = (uint16_t)packer.length;
+    uint8_t flags = packer.full || packer.cut ? FLAG_TRUNCATED : 0;
+    memcpy(record, &length, 2);
+    record[2] = level;
+    record[3] = flags;
+    memcpy(record + 4, &timestampMs, 4);
+    memcpy(record + 8, &tag, sizeof(tag));
+    memcpy(record + 8 + sizeof(tag), &format, sizeof(format));
+
+    // Records never wrap; skip the end of the ring if this one doesn't fit there
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    uint32_t offset = head & (LOG_RING_SIZE - 1);
+    uint32_t toEnd = LOG_RING_SIZE - offset;
+    uint32_t skip = length > toEnd ? toEnd : 0;
+
+    if (skip + length > LOG_RING_SIZE - (head - tail)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (skip > 0) {
+        if (toEnd >= 2) {
+            memset(_data + offset, 0, 2);  // Wrap marker
+        }
+        head += skip;
+        offset = 0;
+    }
+
+    memcpy(_data + offset, record, length);
+    _head.store(head + length, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::readNext(char* out, size_t outSize, LogEntry& entry) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    if (tail == head) return false;
+
+    uint32_t offset = tail & (LOG_RING_SIZE - 1);
+    uint32_t toEnd = LOG_RING_SIZE - offset;
+    uint16_t length = 0;
+    if (toEnd >= 2) memcpy(&length, _data + offset, 2);
+    if (toEnd < 2 || length == 0) {
+        // Writer wrapped to the start
+        tail += toEnd;
+        offset = 0;
+        if (tail == head) {
+            _tail.store(tail, std::memory_order_release);
+            return false;
+        }
+        memcpy(&length, _data, 2);
+    }
+
+    const uint8_t* record = _data + offset;
+    const char* format;
+    uint8_t flags = record[3];
+    entry.level = record[2];
+    memcpy(&entry.timestampMs, record + 4, 4);
+    memcpy(&entry.tag, record + 8, sizeof(entry.tag));
+    memcpy(&format, record + 8 + sizeof(entry.tag), sizeof(format));
+
+    char line[LINE_MAX];
+    size_t lineLength = 0;
+    Unpacker unpacker = {record, length, HEADER_SIZE};
+    bool complete = true;
+
+    FormatSpec spec;
+    const char* p = format;
+    while (complete) {
+        bool found = _nextSpec(p, spec);
+        const char* literalEnd = found ? spec.start : p + strlen(p);
+
+        // Literal text up to the conversion, with %% collapsed
+        for (const char* q = p; q < literalEnd && lineLength < sizeof(line) - 1; q++) {
+            line[lineLength++] = *q;
+            if (q[0] == '%' && q + 1 < literalEnd && q[1] == '%') q++;
+        }
+        if (!found) break;
+        p = spec.start + spec.length;
+
+        // Rebuild the conversion with * replaced by the stored numbers
+        char specText[32];
+        size_t specLength = 0;
+        for (size_t i = 0; i < spec.length && specLength < sizeof(specText) - 12; i++) {
+            char c = spec.start[i];
+            if (c == '*') {
+                int64_t number;
+                if (!unpacker.get(&number, sizeof(number))) { complete = false; break; }
+                specLength += (size_t)snprintf(specText + specLength, 12, "%d", (int)number);
+            } else {
+                specText[specLength++] = c;
+            }
+        }
+        specText[specLength] = '\0';
+        if (!complete) break;
+
+        size_t room = sizeof(line) - lineLength;
+        int written = 0;
+        char c = spec.conversion;
+        if (_isSigned(c) || c == 'c') {
+            int64_t v;
+            if (!unpacker.get(&v, sizeof(v))) { complete = false; break; }
+            switch (spec.lengthMod) {
+                case 'l': written = snprintf(line + lineLength, room, specText, (long)v); break;
+                case 'L': written = snprintf(line + lineLength, room, specText, (long long)v); break;
+                case 'z':
+                case 't': written = snprintf(line + lineLength, room, specText, (ptrdiff_t)v); break;
+                case 'j': written = snprintf(line + lineLength, room, specText, (intmax_t)v); break;
+                default: written = snprintf(line + lineLength, room, specText, (int)v); break;
+            }
+        } else if (_isUnsigned(c)) {
+            uint64_t v;
+            if (!unpacker.get(&v, sizeof(v))) { complete = false; break; }
+            switch (spec.lengthMod) {
+                case 'l': written = snprintf(line + lineLength, room, specText, (unsigned long)v); break;
+                case 'L': written = snprintf(line + lineLength, room, specText, (unsigned long long)v); break;
+                case 'z':
+                case 't': written = snprintf(line + lineLength, room, specText, (size_t)v); break;
+                case 'j': written = snprintf(line + lineLength, room, specText, (uintmax_t)v); break;
+                default: written = snprintf(line + lineLength, room, specText, (unsigned int)v); break;
+            }
+        } else if (_isFloat(c)) {
+            double v;
+            if (!unpacker.get(&v, sizeof(v))) { complete = false; break; }
+            if (spec.lengthMod == 'D') {
+                written = snprintf(line + lineLength, room, specText, (long double)v);
+            } else {
+                written = snprintf(line + lineLength, room, specText, v);
+            }
+        } else if (c == 's') {
+            uint16_t strLength;
+            char str[LOG_RECORD_MAX];
+            if (!unpacker.get(&strLength, 2) || !unpacker.get(str, strLength)) { complete = false; break; }
+            str[strLength] = '\0';
+            written = snprintf(line + lineLength, room, specText, str);
+        } else if (c == 'p') {
+            uint64_t v;
+            if (!unpacker.get(&v, sizeof(v))) { complete = false; break; }
+            written = snprintf(line + lineLength, room, specText, (void*)(uintptr_t)v);
+        }
+
+        if (written > 0) {
+            lineLength += (size_t)written < room ? (size_t)written : room - 1;
+        }
+    }
+
+    if ((flags & FLAG_TRUNCATED) || !complete) {
+        const char* marker = "...";
+        for (const char* q = marker; *q && lineLength < sizeof(line) - 1; q++) {
+            line[lineLength++] = *q;
+        }
+    }
+    line[lineLength] = '\0';
+
+    _tail.store(tail + length, std::memory_order_release);
+
+    // Redact before cutting to the caller's size, so no partial secret survives
+    redact(line, sizeof(line));
+    strncpy(out, line, outSize - 1);
+    out[outSize - 1] = '\0';
+    return true;
+}
+
+unsigned long LogRing::getDroppedCount() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+void LogRing::redact(char* text, size_t size) const {
+    size_t redactedLength = strlen(LOG_REDACTED);
+    for (int i = 0; i < _secretCount; i++) {
+        // A secret's buffer may have been changed since it was added
+        size_t secretLength = strlen(_secrets[i]);
+        if (secretLength < 4) continue;
+        char* found = text;
+        while ((found = strstr(found, _secrets[i])) != nullptr) {
+            // The replacement is never longer than the secret, so this only shrinks
+            memmove(found + redactedLength, found + secretLength, strlen(found + secretLength) + 1);
+            memcpy(found, LOG_REDACTED, redactedLength);
+            found += redactedLength;
+        }
+    }
+}
+
+char logLevelLetter(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return 'E';
+        case LOG_LEVEL_WARN: return 'W';
+        case LOG_LEVEL_INFO: return 'I';
+        default: return 'D';
+    }
+}
+
+int parseLogLevel(const char* name) {
+    static const char* const NAMES[] = {"none", "error", "warn", "info", "debug"};
+    for (int level = LOG_LEVEL_NONE; level <= LOG_LEVEL_DEBUG; level++) {
+        if (strcmp(name, NAMES[level]) == 0) return level;
+    }
+    return -1;
+}
@@ -1,217 +1,1929 @@
 #include <Arduino.h>
+#include <WiFi.h>
+#include <esp_system.h>
+#include <esp_wifi.h>
+#include <esp_sleep.h>
+#include <esp_pm.h>
+#include <driver/uart.h>
 #include "config.h"
 #include "display.h"
 #include "wifi_manager.h"
 #include "wmata_client.h"
 #include "relative_time.h"
+#include "poll_scheduler.h"
+#include "headway_stats.h"
+#include "rail_incidents.h"
+#include "rate_governor.h"
+#include "status_server.h"
+#include "buffer_writer.h"
+#include "prometheus_writer.h"
+#include "frame_buffer.h"
+#include "prediction_snapshot.h"
+#include "fanout_election.h"
+#include "multicast_socket.h"
+#include "log.h"
+#include "postmortem.h"
+#include "hang_monitor.h"
+#include "page_carousel.h"
+#include "time_utils.h"
+#include "mono_clock.h"
+#include "schedule_table.h"
+#include "gtfs_realtime.h"
+#include "device_config.h"
+#include "config_store.h"
+#include "serial_console.h"
+#include "power_schedule.h"
+#include "heap_watermarks.h"
 
 // WMATA_API_KEY and STATION_CODE are defined via build flags from .env file
 // See load_env.py for details
 
 /**
- * Refresh interval for metro data (in milliseconds)
+ * Minimum refresh interval for metro data (in milliseconds)
+ * 
+ * Polls are aligned to WMATA's feed updates by PollScheduler, so the
+ * actual gap is between this and this plus one upstream update period.
  */
 #define REFRESH_INTERVAL_MS 30000  // 30 seconds
 
 /**
- * Line colors for WMATA metro lines
+ * Share of the API key's daily quota this panel may use (percent)
+ * 
+ * Lower this when several panels use the same WMATA API key.
+ */
+#define DAILY_QUOTA_SHARE_PERCENT 100
+
+/**
+ * TCP port of the status server (/predictions, /metrics, /health)
+ */
+#define STATUS_SERVER_PORT 80
+
+/**
+ * Share one panel's fetches with the other panels at this station (0 disables)
+ * 
+ * One panel is elected leader and fetches from WMATA; the rest render its
+ * snapshots over UDP multicast and only fetch if the leader goes quiet.
+ */
+#define FANOUT_ENABLED 0
+
+/**
+ * Multicast group and UDP port for prediction snapshots
+ */
+#define FANOUT_GROUP "239.255.43.21"
+#define FANOUT_PORT 43210
+
+/**
+ * Most snapshots read from the socket per loop tick
+ */
+#define FANOUT_MAX_RECEIVE_PER_LOOP 4
+
+/**
+ * How often the display (relative time) is redrawn (in milliseconds)
+ */
+#define DISPLAY_UPDATE_INTERVAL_MS 1000
+
+/**
+ * Main loop tick; bounds how late a scheduled poll can start (in milliseconds)
+ */
+#define LOOP_TICK_MS 100
+
+/**
+ * Show arrivals as times of day ("Glen 12:41") instead of minutes (1), once
+ * NTP has set the clock; trains boarding or arriving still say BRD/ARR
+ */
+#define ARRIVAL_CLOCK_TIMES 0
+
+/**
+ * Show timetable departures on the summary page, marked "Scheduled", while
+ * live predictions are unavailable (1), instead of an error
+ * 
+ * Needs GTFS_ZIP in .env at build time (see gtfs_schedule.py) and a clock
+ * set by NTP; without either the summary page shows the error as before.
+ */
+#define SCHEDULE_FALLBACK 1
+
+/**
+ * GTFS-realtime TripUpdates feed to take predictions from instead of the
+ * WMATA JSON API; empty to use WMATA
+ * 
+ * Only http:// feeds can be fetched. Trips are matched against
+ * GTFS_RT_STOP_IDS and shown as GTFS_RT_ROUTES describes.
+ */
+#define GTFS_RT_FEED_URL ""
+
+/**
+ * Show the next buses at the stops in BUS_STOP_IDS on bus pages (1)
+ */
+#define BUS_PREDICTIONS 0
+
+/**
+ * Rail incidents refresh interval (in milliseconds)
+ * 
+ * Incidents change rarely, so they are polled much less often than
+ * predictions, and retried sooner after a failure.
+ */
+#define INCIDENT_REFRESH_INTERVAL_MS 300000  // 5 minutes
+#define INCIDENT_RETRY_INTERVAL_MS 60000     // 1 minute
+
+/**
+ * Only poll incidents when the next prediction poll is at least this far
+ * away, so incidents never delay a phase-locked prediction poll
+ */
+#define INCIDENT_POLL_CLEARANCE_MS 3000
+
+/**
+ * Bus predictions refresh interval (in milliseconds)
+ * 
+ * Every refresh makes one request per bus stop. Buses are polled on their
+ * own schedule, fitted between prediction polls like incidents, and
+ * retried sooner after a failure.
+ */
+#define BUS_REFRESH_INTERVAL_MS 60000  // 1 minute
+#define BUS_RETRY_INTERVAL_MS 30000    // 30 seconds
+
+/**
+ * Advisory scroll speed: one pixel per step (in milliseconds)
+ */
+#define ADVISORY_SCROLL_STEP_MS 40
+
+/**
+ * Pause between advisory passes, showing the "last updated" row (in milliseconds)
+ */
+#define ADVISORY_PAUSE_MS 5000
+
+/**
+ * How often heap and Wi-Fi health are sampled into the postmortem log (in milliseconds)
+ */
+#define POSTMORTEM_SAMPLE_INTERVAL_MS 60000
+
+/**
+ * Software watchdog for API requests (in milliseconds)
+ * 
+ * Requests normally give up within WMATA_TOTAL_BUDGET_MS. One still running
+ * after HANG_RECOVER_MS is stuck in a socket call, and has its socket shut
+ * down so it fails while the display keeps running. After
+ * HANG_RESET_NETWORK_MS Wi-Fi is reconnected, which still spares the
+ * display; only after HANG_RESTART_MS does the device restart.
+ */
+#define HANG_RECOVER_MS (WMATA_TOTAL_BUDGET_MS + 5000)
+#define HANG_RESET_NETWORK_MS 35000
+#define HANG_RESTART_MS 60000
+
+/**
+ * How often the watchdog task checks on the request in progress (in milliseconds)
+ */
+#define WATCHDOG_CHECK_INTERVAL_MS 500
+
+/**
+ * Serial command console for inspecting and steering the panel in the
+ * field (1), or serial output only (0); type "help" in the monitor
  */
-#define LINE_COLOR_RD 0xF800  // Red Line
-#define LINE_COLOR_BL 0x001F  // Blue Line
-#define LINE_COLOR_OR 0xFC00  // Orange Line
-#define LINE_COLOR_GR 0x07E0  // Green Line
-#define LINE_COLOR_YL 0xFFE0  // Yellow Line
-#define LINE_COLOR_SV 0xC618  // Silver Line
+#define SERIAL_CONSOLE 1
+
+/**
+ * UART transmit buffer for console answers (bytes)
+ * 
+ * The loop hands over only what fits, so a long answer goes out over
+ * several passes instead of holding up drawing.
+ */
+#define CONSOLE_TX_BUFFER_SIZE 1024
+
+/**
+ * Power the panel down outside Metro's service hours (1), or run it at
+ * full power around the clock (0); needs the clock set by NTP
+ */
+#define POWER_SCHEDULE 1
+
+/**
+ * Time in service before the first trains and after the last (in minutes)
+ */
+#define SERVICE_LEAD_MIN 15
+#define SERVICE_TAIL_MIN 30
+
+/**
+ * While closed, blank the panel (1), or show the clock at CLOSED_DIM_LEVEL (0)
+ */
+#define CLOSED_BLANK_PANEL 1
+#define CLOSED_DIM_LEVEL 3
+
+/**
+ * While closed, fetch predictions this often to check the API and key
+ * still work (in milliseconds)
+ */
+#define CLOSED_HEALTH_CHECK_MS 3600000UL
+
+/**
+ * Loop pass while closed and blank (in milliseconds); 0 only uses modem sleep
+ * 
+ * While the panel is blank the power manager light-sleeps whenever the
+ * loop waits, waking for Wi-Fi beacons, so the board stays associated.
+ * The status server and console are served once a pass, so a request may
+ * take up to this long.
+ */
+#define CLOSED_LIGHT_SLEEP_MS 1000
+
+/**
+ * How often energy use is added up (in milliseconds)
+ */
+#define POWER_UPDATE_INTERVAL_MS 1000
+
+/**
+ * Estimated power of the hardware, for the energy figures (in milliwatts):
+ * the board in service and closed, the panel with every LED off, and the
+ * extra for a full white panel
+ */
+#define POWER_BOARD_MW 600
+#define POWER_BOARD_CLOSED_MW 150
+#define POWER_PANEL_IDLE_MW 400
+#define POWER_PANEL_FULL_WHITE_MW 20000
+
+/**
+ * Metro's service hours, Sunday first (seconds after local midnight; past
+ * midnight runs into the next day)
+ */
+static const ServiceHours SERVICE_HOURS[7] = {
+    {7 * 3600UL, 24 * 3600UL},   // Sunday
+    {5 * 3600UL, 24 * 3600UL},   // Monday
+    {5 * 3600UL, 24 * 3600UL},   // Tuesday
+    {5 * 3600UL, 24 * 3600UL},   // Wednesday
+    {5 * 3600UL, 24 * 3600UL},   // Thursday
+    {5 * 3600UL, 25 * 3600UL},   // Friday, until 1 AM
+    {7 * 3600UL, 25 * 3600UL},   // Saturday, until 1 AM
+};
+
+/**
+ * Page rotation: each page stays up for its duration (in milliseconds; 0
+ * disables it), then the next page with something to show takes over
+ * 
+ * PAGE_GROUP pages list the next MAX_TRAINS_PER_GROUP trains in one direction,
+ * and PAGE_BUS pages the next buses at one of BUS_STOP_IDS (1 for the first).
+ */
+static const CarouselPage CAROUSEL_PAGES[] = {
+    {PAGE_SUMMARY, 0, 10000},
+    {PAGE_GROUP, 1, 5000},
+    {PAGE_GROUP, 2, 5000},
+    {PAGE_CLOCK, 0, 3000},
+    {PAGE_ADVISORY, 0, 5000},
+    {PAGE_BUS, 1, 5000},
+    {PAGE_HEADWAYS, 0, 0},
+};
+
+/**
+ * stop_ids of the station's platforms in the GTFS-realtime feed
+ */
+static const char* const GTFS_RT_STOP_IDS[] = {"PF_B35_C"};
+
+/**
+ * How each route in the GTFS-realtime feed is shown: line code, and the
+ * destination for direction_id 0 and 1 (TripUpdates carry no headsign)
+ */
+static const GtfsRtRoute GTFS_RT_ROUTES[] = {
+    {"RED", "RD", {"Glenmont", "Shady Gr"}},
+};
+
+/**
+ * WMATA bus stop IDs (the 7-digit number on the stop's flag) for the bus
+ * pages; up to MAX_BUS_STOPS
+ */
+static const char* const BUS_STOP_IDS[] = {"1001195"};
 
 // Global instances
 Display display;
 WifiManager wifi;
-WmataClient wmataClient(STATION_CODE, WMATA_API_KEY);
+RateGovernor rateGovernor((unsigned long)RATE_DAILY_QUOTA * DAILY_QUOTA_SHARE_PERCENT / 100);
+GtfsRtProvider gtfsRtProvider(GTFS_RT_FEED_URL,
+                              GTFS_RT_STOP_IDS, sizeof(GTFS_RT_STOP_IDS) / sizeof(GTFS_RT_STOP_IDS[0]),
+                              GTFS_RT_ROUTES, sizeof(GTFS_RT_ROUTES) / sizeof(GTFS_RT_ROUTES[0]));
+WmataClient wmataClient(STATION_CODE, WMATA_API_KEY, &rateGovernor,
+                        GTFS_RT_FEED_URL[0] != '\0' ? &gtfsRtProvider : nullptr);
+PollScheduler pollScheduler(REFRESH_INTERVAL_MS);
+HeadwayStats headwayStats;
+StatusServer statusServer;
+MulticastSocket fanoutSocket;
+FanoutElection election((uint32_t)(ESP.getEfuseMac() >> 16));  // Low MAC bytes; the OUI is shared
+
+// Survives every reset except power loss; PostmortemLog::begin() validates it
+RTC_NOINIT_ATTR PostmortemStore postmortemStore;
+PostmortemLog postmortem(&postmortemStore);
+HangMonitor hangMonitor(HANG_RECOVER_MS, HANG_RESTART_MS, HANG_RESET_NETWORK_MS);
+TimeManager timeManager;
+PageCarousel carousel(CAROUSEL_PAGES, sizeof(CAROUSEL_PAGES) / sizeof(CAROUSEL_PAGES[0]));
+Schedule schedule(STATION_SCHEDULE);
+ServiceSchedule serviceSchedule(SERVICE_HOURS, SERVICE_LEAD_MIN * 60UL, SERVICE_TAIL_MIN * 60UL);
+PowerLedger powerLedger;
+HeapWatermarks heapWatermarks;
+static const PowerModel POWER_MODEL = {POWER_BOARD_MW, POWER_BOARD_CLOSED_MW, POWER_PANEL_IDLE_MW,
+                                       POWER_PANEL_FULL_WHITE_MW};
+
+// Settings in use: the .env values, overridden by any saved with POST /config
+DeviceConfig deviceConfig;
+ConfigStore configStore;
+DeviceConfig pendingConfig;      // Saved by POST /config or the console, applied by the loop
+bool configPending = false;
+TaskHandle_t watchdogHandle = nullptr;
+
+// Status response bodies: rebuilt after each fetch, or per scrape for /metrics
+static char predictionsBody[2048];
+// Room kept at the end of predictionsBody to close the JSON after a list is cut short
+#define PREDICTIONS_CLOSE_RESERVE 64
+static char metricsBody[8192];
+static char healthBody[384];
+static char postmortemBody[4096];
+static char configBody[256];
+static char headwaysBody[HEADWAY_MAX_STREAMS * 56];  // One formatReport() line per stream
+static char consoleOutput[sizeof(metricsBody) + 64];  // Room for a full metrics dump
+static char frameBody[FRAME_PNG_SIZE(DISPLAY_WIDTH, DISPLAY_HEIGHT) > FRAME_RLE_MAX_SIZE(DISPLAY_WIDTH, DISPLAY_HEIGHT)
+                      ? FRAME_PNG_SIZE(DISPLAY_WIDTH, DISPLAY_HEIGHT)
+                      : FRAME_RLE_MAX_SIZE(DISPLAY_WIDTH, DISPLAY_HEIGHT)];  // Shared by both frame endpoints
 
 // State tracking
-unsigned long lastFetchTime = 0;
+uint64_t lastFetchTime = 0;
+uint64_t lastDisplayUpdate = 0;
 bool hasError = false;           // Track if last fetch had an error
 const char* errorMessage = "";   // Error message to display
+bool fetchFailed = false;        // Last prediction fetch failed (API or network error)
+bool showingSchedule = false;    // Summary page is showing timetable departures
+bool hasRecordedDeparture = false;
+uint64_t lastDepartureRecorded = 0;       // departedMs of the newest recorded departure
+uint64_t nextIncidentPoll = 0;
+uint64_t nextBusPoll = 0;
+uint64_t lastAdvisoryStep = 0;
+uint64_t advisoryStartTime = 0;           // When the current advisory text started scrolling
+char advisoryText[MAX_INCIDENTS * (INCIDENT_TEXT_MAX_LEN + 12)] = "";
+char advisoryRows[DISPLAY_ROWS][DISPLAY_ROW_LEN];  // Advisory page, built when the incidents change
+uint64_t lastPostmortemSample = 0;
+bool forceFetch = false;         // Console asked for a fetch now
+bool replayHold = false;         // Showing a replayed snapshot; no fetching until "fetch"
+bool serviceClosed = false;      // Outside service hours: powered down, health checks only
+uint32_t secondsToService = 0;   // While closed, time until the panel wakes
+uint8_t serviceDimLevel = PANEL_DIM_LEVEL;  // Dimming level to go back to at service start
+uint64_t lastPowerUpdate = 0;
+uint32_t frameHashForDuty = 0;
+uint16_t frameDuty = 0;          // frameDutyPermille() of the frame on the panel
+uint32_t powerMw = 0;            // Latest power estimate
+uint32_t serviceCpuMhz = 240;    // CPU clock to go back to at service start
+bool autoLightSleep = false;     // Power manager light-sleeps when idle
+uint8_t heapPhase = FETCH_PHASE_IDLE;      // Request phase whose heap use is being watched
+HeapSample heapPhaseStart = {0, 0};
+wifi_ps_type_t serviceWifiPs = WIFI_PS_MIN_MODEM;
+
+// Fan-out state
+static PredictionSnapshot snapshot;       // Last snapshot sent or received
+static uint8_t snapshotPacket[SNAPSHOT_MAX_SIZE];
+uint32_t snapshotSequence = 0;            // Sequence of our last new snapshot
+uint64_t lastSnapshotSent = 0;
+uint32_t appliedLeaderId = 0;             // Leader and sequence last rendered as follower
+uint32_t appliedSequence = 0;
+
+/**
+ * Get the appropriate color for a metro line
+ * 
+ * :param const char* lineCode: The line code (RD, BL, OR, GR, YL, SV)
+ * :return uint16_t: 565-format color value
+ */
+uint16_t getLineColor(const char* lineCode) {
+    return display.color(lineColor(lineCode));
+}
+
+/**
+ * Feed departures the tracker saw since the last poll into the headway statistics
+ */
+void recordDepartures() {
+    const TrainTracker& tracker = wmataClient.getTracker();
+    bool recorded = false;
+    
+    // Oldest first, so headways are computed in order
+    for (int n = tracker.getDepartureCount() - 1; n >= 0; n--) {
+        const DepartureEvent& departure = tracker.getDeparture(n);
+        if (hasRecordedDeparture && departure.departedMs <= lastDepartureRecorded) {
+            continue;
+        }
+        
+        headwayStats.recordDeparture(departure.line, departure.group, departure.departedMs);
+        lastDepartureRecorded = departure.departedMs;
+        hasRecordedDeparture = true;
+        recorded = true;
+        LOG_INFO("MAIN", "Departure: %s %s (Group %u)",
+                 departure.line, departure.destination, departure.group);
+    }
+    
+    if (recorded) {
+        static char report[sizeof(headwaysBody)];
+        size_t length = headwayStats.formatReport(report, sizeof(report), monoMillis());
+        if (length > 0 && report[length - 1] == '\n') {
+            report[length - 1] = '\0';
+        }
+        LOG_INFO("MAIN", "Headways:\n%s", report);
+    }
+}
+
+/**
+ * Show the headway statistics page
+ * 
+ * One row per direction for the first two streams ("RD1 6/9m" is a mean
+ * of 6 minutes and a 90th percentile of 9), then a gap alert if any.
+ */
+void showHeadwayPage() {
+    uint64_t now = monoMillis();
+    char rows[3][16];
+    const char* rowPtrs[3] = {nullptr, nullptr, nullptr};
+    const char* gapRow = "Headways";
+    static char gapText[16];
+    
+    for (int i = 0; i < headwayStats.getStreamCount(); i++) {
+        HeadwaySummary summary;
+        headwayStats.getSummary(i, now, summary);
+        
+        if (i < 2) {
+            snprintf(rows[i], sizeof(rows[i]), "%s%u %u/%um", summary.line, summary.group,
+                     (summary.meanSec + 30) / 60, (summary.p90Sec + 30) / 60);
+            rowPtrs[i] = rows[i];
+        }
+        if (summary.gapAlert) {
+            snprintf(gapText, sizeof(gapText), "GAP %s%u", summary.line, summary.group);
+            gapRow = gapText;
+        }
+    }
+    
+    display.showTextRows(rowPtrs[0], rowPtrs[1], gapRow,
+                         display.color(COLOR_WHITE),
+                         gapRow == gapText ? display.color(COLOR_RED) : display.color(COLOR_CYAN));
+}
+
+/**
+ * Get what a train's row shows for its arrival: the minutes, or in clock
+ * mode the time of day
+ * 
+ * :param const char* minutes: Minutes, "BRD", "ARR" or "LFT"
+ * :param time_t arrival: Wall-clock arrival, 0 if unknown
+ * :param char* buffer: Output buffer for the time of day (min 6 chars)
+ * :param size_t bufferSize: Size of the output buffer
+ * :return const char*: minutes or buffer
+ */
+const char* formatArrival(const char* minutes, time_t arrival, char* buffer, size_t bufferSize) {
+    bool counting = minutes[0] >= '0' && minutes[0] <= '9';
+    if (ARRIVAL_CLOCK_TIMES && counting && TimeManager::formatClockTime(arrival, buffer, bufferSize)) {
+        return buffer;
+    }
+    return minutes;
+}
+
+/**
+ * Show the next trains in one direction (or buses at one stop), one per row
+ * 
+ * The trains were picked when the predictions arrived; only their minutes
+ * are formatted here, so most ticks repaint no rows at all.
+ * 
+ * :param const GroupBoard* board: The direction's trains, or nullptr to leave the page as it is
+ * :param const TrainTracker& tracker: Tracker the board was picked from
+ */
+void showBoardPage(const GroupBoard* board, const TrainTracker& tracker) {
+    if (board == nullptr) return;
+    
+    uint64_t now = monoMillis();
+    char text[DISPLAY_ROWS][DISPLAY_ROW_LEN];
+    const char* rows[DISPLAY_ROWS] = {"", "", ""};
+    uint16_t colors[DISPLAY_ROWS] = {0, 0, 0};
+    
+    for (int i = 0; i < board->count && i < DISPLAY_ROWS; i++) {
+        const TrackedTrain& train = board->trains[i];
+        char minutes[MIN_MAX_LEN];
+        char clock[8];
+        tracker.formatMinutes(train, now, minutes, sizeof(minutes));
+        Display::formatTrainRow(train.destination,
+                                formatArrival(minutes, board->arrivals[i], clock, sizeof(clock)),
+                                text[i], sizeof(text[i]));
+        rows[i] = text[i];
+        colors[i] = getLineColor(train.line);
+    }
+    display.showRows(rows, colors);
+}
+
+/**
+ * Show the time of day
+ */
+void showClockPage() {
+    TimeData now = timeManager.getCurrentTime();
+    if (now.isValid) {
+        display.showTime(now.hour, now.minute, now.second, now.isPM);
+    }
+}
+
+/**
+ * Show the incidents affecting the station, one per row
+ */
+void showAdvisoryPage() {
+    const char* rows[DISPLAY_ROWS] = {advisoryRows[0], advisoryRows[1], advisoryRows[2]};
+    uint16_t amber = display.color(COLOR_AMBER);
+    const uint16_t colors[DISPLAY_ROWS] = {amber, amber, amber};
+    display.showRows(rows, colors);
+}
+
+/**
+ * Build the advisory page's rows: lines and type of each incident, with
+ * "+N more" in the last row if they don't all fit
+ */
+void buildAdvisoryRows() {
+    const IncidentList& incidents = wmataClient.getIncidents();
+    int count = incidents.getCount();
+    
+    for (int row = 0; row < DISPLAY_ROWS; row++) {
+        if (row == DISPLAY_ROWS - 1 && count > DISPLAY_ROWS) {
+            snprintf(advisoryRows[row], DISPLAY_ROW_LEN, "+%d more", count - row);
+        } else if (row < count) {
+            const RailIncident& incident = incidents.get(row);
+            char lines[24];
+            formatLineMask(incident.lines, lines, sizeof(lines));
+            snprintf(advisoryRows[row], DISPLAY_ROW_LEN, "%s %s", lines, incident.type);
+        } else {
+            advisoryRows[row][0] = '\0';
+        }
+    }
+}
+
+/**
+ * Rebuild the advisory page, and restart the advisory scroll if the
+ * incidents' text has changed
+ */
+void refreshAdvisory() {
+    buildAdvisoryRows();
+    
+    char text[sizeof(advisoryText)];
+    wmataClient.getIncidents().formatAdvisory(text, sizeof(text));
+    
+    // Restart the scroll only when the advisory actually changes
+    if (strcmp(text, advisoryText) != 0) {
+        strcpy(advisoryText, text);
+        advisoryStartTime = monoMillis();
+        LOG_INFO("MAIN", "Advisory: %s", advisoryText[0] ? advisoryText : "(none)");
+    }
+}
+
+/**
+ * Fetch rail incidents and update the advisory text
+ * 
+ * :return bool: True if the incidents were fetched
+ */
+bool updateIncidents() {
+    bool fetched = wmataClient.fetchIncidents();
+    unsigned long intervalMs = fetched ? INCIDENT_REFRESH_INTERVAL_MS : INCIDENT_RETRY_INTERVAL_MS;
+    nextIncidentPoll = monoMillis() + rateGovernor.stretchInterval(intervalMs, monoMillis());
+    if (!fetched) return false;
+    
+    statusServer.rebuild(monoMillis());
+    refreshAdvisory();
+    return true;
+}
+
+/**
+ * Fetch the next buses at every bus stop
+ * 
+ * :return bool: True if the buses were fetched
+ */
+bool updateBuses() {
+    bool fetched = wmataClient.fetchBusPredictions();
+    unsigned long intervalMs = fetched ? BUS_REFRESH_INTERVAL_MS : BUS_RETRY_INTERVAL_MS;
+    nextBusPoll = monoMillis() + rateGovernor.stretchInterval(intervalMs, monoMillis());
+    return fetched;
+}
+
+/**
+ * Get the advisory scroll position, if the advisory is scrolling now
+ * 
+ * Each pass scrolls the text fully across the panel, then the bottom row
+ * shows the "last updated" time for ADVISORY_PAUSE_MS.
+ * 
+ * :param uint64_t now: Current monoMillis() value
+ * :param int& offsetPx: Output scroll position
+ * :return bool: True while the advisory is scrolling
+ */
+bool getAdvisoryOffset(uint64_t now, int& offsetPx) {
+    if (advisoryText[0] == '\0') return false;
+    
+    unsigned long scrollPx = (unsigned long)DISPLAY_WIDTH + strlen(advisoryText) * DisplayLayout::CHAR_WIDTH;
+    unsigned long scrollMs = scrollPx * ADVISORY_SCROLL_STEP_MS;
+    unsigned long phaseMs = (unsigned long)((now - advisoryStartTime) % (scrollMs + ADVISORY_PAUSE_MS));
+    if (phaseMs >= scrollMs) return false;
+    
+    offsetPx = (int)(phaseMs / ADVISORY_SCROLL_STEP_MS);
+    return true;
+}
+
+/**
+ * Get the bottom row text: the relative time, or nullptr while the
+ * advisory is scrolling over that row
+ * 
+ * :param const char* relativeTime: Formatted time since the last update
+ * :return const char*: Text for the bottom row, or nullptr
+ */
+const char* getFooter(const char* relativeTime) {
+    int offsetPx;
+    return getAdvisoryOffset(monoMillis(), offsetPx) ? nullptr : relativeTime;
+}
+
+/**
+ * Drop a list item that ran into the room kept for closing the JSON
+ *
+ * :param BufferWriter& out: Body being built
+ * :param size_t mark: Length before the item
+ * :param size_t limit: Length the items may reach
+ * :return bool: True if the item was dropped, and the lists end here
+ */
+static bool dropOverflowedItem(BufferWriter& out, size_t mark, size_t limit) {
+    if (!out.overflowed() && out.length() <= limit) return false;
+    out.truncate(mark);
+    return true;
+}
+
+/**
+ * Build the /predictions body: every tracked train, the trains on the
+ * panel, and the incidents affecting the station
+ *
+ * If it doesn't all fit, the lists end at the last whole item and the
+ * body gets "truncated":true, so it is still valid JSON.
+ */
+size_t buildPredictionsBody(char* buffer, size_t capacity, void* context) {
+    BufferWriter out(buffer, capacity);
+    size_t limit = capacity - 1 - PREDICTIONS_CLOSE_RESERVE;
+    bool truncated = false;
+    uint64_t now = monoMillis();
+    const TrainTracker& tracker = wmataClient.getTracker();
+    
+    out.print("{\"station\":");
+    out.printJsonString(wmataClient.getStationCode());
+    out.printf(",\"uptime_ms\":%llu,\"fetched_ms\":%llu,\"trains\":[",
+               (unsigned long long)now, (unsigned long long)wmataClient.getLastFetchTime());
+    
+    for (int i = 0; i < tracker.getCount() && !truncated; i++) {
+        const TrackedTrain& train = tracker.getTrain(i);
+        char minutes[MIN_MAX_LEN];
+        tracker.formatMinutes(train, now, minutes, sizeof(minutes));
+        
+        size_t mark = out.length();
+        out.print(i > 0 ? ",{\"line\":" : "{\"line\":");
+        out.printJsonString(train.line);
+        out.print(",\"destination\":");
+        out.printJsonString(train.destination);
+        out.printf(",\"group\":%u,\"cars\":%u,\"eta_s\":%ld,\"min\":",
+                   train.group, train.cars, tracker.getEtaMs(train, now) / 1000);
+        out.printJsonString(minutes);
+        out.print("}");
+        truncated = dropOverflowedItem(out, mark, limit);
+    }
+    
+    out.print("],\"shown\":[");
+    int shown = wmataClient.getTrainCount();
+    for (int i = 0; i < shown && !truncated; i++) {
+        TrainPrediction train = wmataClient.getTrain(i);
+        size_t mark = out.length();
+        out.print(i > 0 ? ",{\"line\":" : "{\"line\":");
+        out.printJsonString(train.line);
+        out.print(",\"destination\":");
+        out.printJsonString(train.destination);
+        out.print(",\"min\":");
+        out.printJsonString(train.minutes);
+        out.print("}");
+        truncated = dropOverflowedItem(out, mark, limit);
+    }
+    
+    out.print("],\"incidents\":[");
+    const IncidentList& incidents = wmataClient.getIncidents();
+    for (int i = 0; i < incidents.getCount() && !truncated; i++) {
+        const RailIncident& incident = incidents.get(i);
+        char lines[24];
+        formatLineMask(incident.lines, lines, sizeof(lines));
+        
+        size_t mark = out.length();
+        out.print(i > 0 ? ",{\"lines\":" : "{\"lines\":");
+        out.printJsonString(lines);
+        out.print(",\"type\":");
+        out.printJsonString(incident.type);
+        out.print(",\"description\":");
+        out.printJsonString(incident.description);
+        out.print("}");
+        truncated = dropOverflowedItem(out, mark, limit);
+    }
+    out.print(truncated ? "],\"truncated\":true}" : "]}");
+    
+    if (truncated) {
+        LOG_WARN("MAIN", "/predictions body truncated");
+    }
+    return out.length();
+}
+
+/**
+ * Build the /metrics body in the Prometheus text format
+ * 
+ * Rebuilt for every scrape, straight into the endpoint's buffer.
+ */
+size_t buildMetricsBody(char* buffer, size_t capacity, void* context) {
+    BufferWriter out(buffer, capacity);
+    PrometheusWriter metrics(out);
+    
+    metrics.gauge("uptime_seconds", "Time since boot", monoMillis() / 1000);
+    
+    metrics.family("wmata_fetches_total", "counter", "Prediction fetches by result");
+    metrics.sample("wmata_fetches_total", "result", "ok", wmataClient.getFetchSuccessCount());
+    metrics.sample("wmata_fetches_total", "result", "error", wmataClient.getFetchFailureCount());
+    metrics.histogram("wmata_fetch_latency_seconds", "Latency of successful prediction fetches",
+                      wmataClient.getFetchLatency());
+    metrics.family("wmata_fetch_overruns_total", "counter", "API requests aborted for running over budget, by phase");
+    for (uint8_t phase = FETCH_PHASE_DNS; phase < FETCH_PHASE_COUNT; phase++) {
+        metrics.sample("wmata_fetch_overruns_total", "phase", fetchPhaseName(phase),
+                       wmataClient.getFetchBudget().getOverrunCount(phase));
+    }
+    metrics.counter("wmata_hang_recoveries_total", "Stuck requests aborted by the watchdog",
+                    hangMonitor.getRecoveryCount());
+    const DnsCache& dns = wmataClient.getDnsCache();
+    metrics.family("wmata_dns_lookups_total", "counter", "Lookups of the API host, by where the address came from");
+    metrics.sample("wmata_dns_lookups_total", "result", "cached", dns.getHitCount());
+    metrics.sample("wmata_dns_lookups_total", "result", "resolved", dns.getResolveCount());
+    metrics.sample("wmata_dns_lookups_total", "result", "stale", dns.getStaleCount());
+    metrics.sample("wmata_dns_lookups_total", "result", "failed", dns.getFailureCount());
+    
+    metrics.counter("wmata_requests_total", "WMATA API requests since boot (all endpoints)",
+                    wmataClient.getRequestCount());
+    metrics.gauge("wmata_requests_today", "WMATA API requests in the current quota day",
+                  rateGovernor.getDailyCount());
+    metrics.gauge("wmata_daily_budget", "WMATA API requests this panel may make per day",
+                  rateGovernor.getDailyBudget());
+    metrics.counter("wmata_throttled_total", "Requests refused by the rate governor",
+                    rateGovernor.getThrottledCount());
+    metrics.counter("wmata_deferred_total", "Polls postponed to stay within the daily quota",
+                    rateGovernor.getDeferredCount());
+    metrics.counter("wmata_rate_limited_total", "HTTP 429 responses from WMATA",
+                    rateGovernor.getRateLimitedCount());
+    metrics.gauge("poll_period_seconds", "Poll period learned from the feed",
+                  pollScheduler.getPeriodMs() / 1000.0);
+    metrics.gauge("tracked_trains", "Trains followed by the tracker", wmataClient.getTracker().getCount());
+    metrics.gauge("incidents", "Rail incidents affecting this station", wmataClient.getIncidents().getCount());
+    
+    metrics.gauge("heap_free_bytes", "Free heap", ESP.getFreeHeap());
+    metrics.gauge("heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    metrics.family("heap_step_peak_bytes", "gauge", "Most heap a step was seen to take at once, by step");
+    for (int i = 0; i < heapWatermarks.getCount(); i++) {
+        const HeapStep& step = heapWatermarks.getStep(i);
+        metrics.sample("heap_step_peak_bytes", "step", step.name, step.peakBytes);
+    }
+    metrics.family("heap_step_held_bytes", "gauge", "Heap still held after a step's last run, by step");
+    for (int i = 0; i < heapWatermarks.getCount(); i++) {
+        const HeapStep& step = heapWatermarks.getStep(i);
+        metrics.sample("heap_step_held_bytes", "step", step.name, step.heldBytes);
+    }
+    
+    metrics.gauge("wifi_rssi_dbm", "Wi-Fi signal strength (0 when disconnected)", wifi.getRssi());
+    metrics.counter("wifi_disconnects_total", "Wi-Fi connection drops", wifi.getDisconnectCount());
+    metrics.counter("wifi_reconnects_total", "Wi-Fi reconnections after a drop", wifi.getReconnectCount());
+    metrics.gauge("clock_synced", "1 once NTP has set the clock", timeManager.isSynced() ? 1 : 0);
+    metrics.counter("ntp_syncs_total", "Completed NTP syncs", timeManager.getSyncCount());
+    metrics.gauge("schedule_fallback", "1 while the summary shows timetable departures", showingSchedule ? 1 : 0);
+    
+    metrics.family("display_redraws_total", "counter", "Panel redraws by kind");
+    metrics.sample("display_redraws_total", "kind", "full", display.getRedrawCount());
+    metrics.sample("display_redraws_total", "kind", "partial", display.getPartialRedrawCount());
+    metrics.gauge("display_dim_level", "Panel dimming level (0 is full brightness)", display.getDimLevel());
+    
+    metrics.gauge("service_closed", "1 while powered down outside service hours", serviceClosed ? 1 : 0);
+    metrics.gauge("power_estimate_milliwatts", "Estimated power drawn now", powerMw);
+    metrics.counter("energy_estimate_joules_total", "Estimated energy used since boot",
+                    powerLedger.getTotalEnergyMj() / 1000.0);
+    metrics.family("energy_estimate_wh", "gauge", "Estimated energy used by local day");
+    metrics.sample("energy_estimate_wh", "day", "today", powerLedger.getToday().energyMj / 3600000.0);
+    metrics.sample("energy_estimate_wh", "day", "yesterday", powerLedger.getYesterday().energyMj / 3600000.0);
+    metrics.family("api_calls", "gauge", "API requests by local day");
+    metrics.sample("api_calls", "day", "today", powerLedger.getToday().apiCalls);
+    metrics.sample("api_calls", "day", "yesterday", powerLedger.getYesterday().apiCalls);
+    
+    metrics.counter("status_requests_total", "Status endpoint requests answered", statusServer.getRequestCount());
+    metrics.counter("status_errors_total", "Status endpoint requests refused or dropped",
+                    statusServer.getErrorCount());
+    metrics.gauge("fanout_role", "0 listening, 1 follower, 2 leader", (int)election.getRole());
+    metrics.counter("fanout_role_changes_total", "Fan-out role changes", election.getRoleChangeCount());
+    
+    if (out.overflowed()) {
+        LOG_WARN("MAIN", "/metrics body truncated");
+    }
+    return out.length();
+}
+
+/**
+ * Get a short name for why the chip last reset
+ */
+const char* getResetReasonName() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_POWERON: return "power on";
+        case ESP_RST_EXT: return "external pin";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "interrupt watchdog";
+        case ESP_RST_TASK_WDT: return "task watchdog";
+        case ESP_RST_WDT: return "other watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep sleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_SDIO: return "SDIO";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Build the /health body
+ */
+size_t buildHealthBody(char* buffer, size_t capacity, void* context) {
+    static const char* const POLL_STATES[] = {"free-running", "learning", "locked"};
+    static const char* const FANOUT_ROLES[] = {"listening", "follower", "leader"};
+    BufferWriter out(buffer, capacity);
+    
+    out.printf("{\"status\":\"%s\",\"uptime_s\":%lu,\"last_fetch_ms\":%llu,"
+               "\"wifi_connected\":%s,\"wifi_rssi\":%d,\"free_heap\":%u,"
+               "\"poll_state\":\"%s\",\"poll_period_ms\":%lu,\"fanout\":\"%s\","
+               "\"boot\":%lu,\"reset_reason\":\"%s\"}",
+               fetchFailed ? "error" : "ok", (unsigned long)(monoMillis() / 1000),
+               (unsigned long long)wmataClient.getLastFetchTime(),
+               wifi.isConnected() ? "true" : "false", wifi.getRssi(), (unsigned)ESP.getFreeHeap(),
+               POLL_STATES[pollScheduler.getState()], pollScheduler.getPeriodMs(),
+               !FANOUT_ENABLED ? "off" : FANOUT_ROLES[election.getRole()],
+               (unsigned long)postmortem.getBootCount(), getResetReasonName());
+    return out.length();
+}
+
+/**
+ * Build the /postmortem body: the previous run's last state and the
+ * most recent log lines and health samples, across resets
+ */
+size_t buildPostmortemBody(char* buffer, size_t capacity, void* context) {
+    BufferWriter out(buffer, capacity);
+    postmortem.formatDump(out);
+    return out.length();
+}
+
+/**
+ * Build the /headways body: one line of rolling statistics per line and direction
+ */
+size_t buildHeadwaysBody(char* buffer, size_t capacity, void* context) {
+    return headwayStats.formatReport(buffer, capacity, monoMillis());
+}
+
+/**
+ * Build the /config body: the settings in use, secrets masked
+ */
+size_t buildConfigBody(char* buffer, size_t capacity, void* context) {
+    BufferWriter out(buffer, capacity);
+    formatConfig(configPending ? pendingConfig : deviceConfig, out);
+    return out.length();
+}
+
+/**
+ * Save new settings and have the loop apply them
+ * 
+ * :param const DeviceConfig& updated: Settings to switch to
+ * :return bool: False if they could not be saved (nothing changes then)
+ */
+bool saveConfig(const DeviceConfig& updated) {
+    if (!configStore.save(updated)) return false;
+    pendingConfig = updated;
+    configPending = true;
+    return true;
+}
+
+/**
+ * Handle POST /config: check and save the new settings; the loop applies them
+ */
+int postConfig(char* form, char* buffer, size_t capacity, size_t& length, void* context) {
+    BufferWriter out(buffer, capacity);
+    DeviceConfig updated = configPending ? pendingConfig : deviceConfig;
+    const char* error = nullptr;
+    int code = 200;
+    
+    if (!applyConfigForm(updated, form, error)) {
+        code = 400;
+    } else if (!saveConfig(updated)) {
+        error = "saving to flash failed";
+        code = 500;
+    }
+    
+    if (code != 200) {
+        out.print("{\"error\":");
+        out.printJsonString(error);
+        out.print("}");
+    } else {
+        formatConfig(updated, out);
+    }
+    length = out.length();
+    return code;
+}
+
+/**
+ * Build the /frame.png body: the panel as it looks now
+ */
+size_t buildFramePngBody(char* buffer, size_t capacity, void* context) {
+    return encodeFramePng(display.getFrame(), (uint8_t*)buffer, capacity);
+}
+
+/**
+ * Build the /frame.rle body: the panel as run-length encoded RGB565
+ */
+size_t buildFrameRleBody(char* buffer, size_t capacity, void* context) {
+    return encodeFrameRle(display.getFrame(), (uint8_t*)buffer, capacity);
+}
+
+/**
+ * Version of the frame endpoints, for ETags and long polling
+ */
+uint32_t getFrameVersion(void* context) {
+    return display.getFrame().getHash();
+}
+
+/**
+ * Show the next two departures from the timetable on the summary page,
+ * as times of day in amber, with "Scheduled" in the bottom row
+ * 
+ * :return bool: False if there is no timetable, the clock isn't set, or
+ *               no more trains run today
+ */
+bool showScheduledSummary() {
+    if (!SCHEDULE_FALLBACK || schedule.isEmpty() || !timeManager.isSynced()) return false;
+    
+    // The timetable is built for the .env station only
+    if (strcmp(deviceConfig.stationCode, STATION_CODE) != 0) return false;
+    
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    uint32_t nowSec = (uint32_t)(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+    
+    ScheduledDeparture next[2];
+    int count = schedule.findNext(local.tm_wday, nowSec, 0, next, 2);
+    if (count == 0) return false;
+    
+    char clock[2][8];
+    for (int i = 0; i < count; i++) {
+        TimeManager::formatClockTime(now + (next[i].departSec - (long)nowSec), clock[i], sizeof(clock[i]));
+    }
+    display.showMetroArrivals(
+        next[0].destination, clock[0],
+        count > 1 ? next[1].destination : nullptr, count > 1 ? clock[1] : nullptr,
+        getFooter("Scheduled"), display.color(COLOR_AMBER)
+    );
+    return true;
+}
+
+/**
+ * Show the summary page: the next train in each direction, and the time
+ * since the last update (or the advisory) in the bottom row
+ * 
+ * While predictions are unavailable it falls back to the timetable.
+ */
+void showSummaryPage() {
+    // Calculate relative time since last fetch (always shown)
+    uint64_t elapsedMs = monoMillis() - lastFetchTime;
+    char relativeTime[16];
+    formatRelativeTime(elapsedMs, relativeTime, sizeof(relativeTime));
+    
+    showingSchedule = hasError && showScheduledSummary();
+    if (showingSchedule) return;
+    
+    if (hasError) {
+        // Still in error state - show error with updated timer
+        display.showMetroArrivals(
+            "ERR", "!",
+            nullptr, nullptr,
+            getFooter(relativeTime), display.color(COLOR_RED)
+        );
+        return;
+    }
+    
+    int trainCount = wmataClient.getTrainCount();
+    
+    if (trainCount == 0) {
+        display.showMetroArrivals(
+            "None", "-",
+            nullptr, nullptr,
+            getFooter(relativeTime), display.color(COLOR_YELLOW)
+        );
+        return;
+    }
+    
+    TrainPrediction train1 = wmataClient.getTrain(0);
+    TrainPrediction train2 = wmataClient.getTrain(1);
+    uint16_t lineColor = getLineColor(train1.line);
+    char clock1[8];
+    char clock2[8];
+    const char* arrival1 = formatArrival(train1.minutes, train1.arrival, clock1, sizeof(clock1));
+    const char* arrival2 = formatArrival(train2.minutes, train2.arrival, clock2, sizeof(clock2));
+    
+    if (trainCount == 1) {
+        display.showMetroArrivals(
+            train1.destination, arrival1,
+            nullptr, nullptr,
+            getFooter(relativeTime), lineColor
+        );
+    } else {
+        display.showMetroArrivals(
+            train1.destination, arrival1,
+            train2.destination, arrival2,
+            getFooter(relativeTime), lineColor
+        );
+    }
+}
+
+/**
+ * Get the pages that have something to show, for the carousel
+ * 
+ * :return uint32_t: Bit i set if CAROUSEL_PAGES[i] can be shown
+ */
+uint32_t getAvailablePages() {
+    uint32_t available = 0;
+    for (int i = 0; i < carousel.getCount(); i++) {
+        const CarouselPage& page = CAROUSEL_PAGES[i];
+        bool show = true;
+        switch (page.kind) {
+            case PAGE_GROUP:
+                show = !hasError && wmataClient.findBoard(page.group) != nullptr;
+                break;
+            case PAGE_CLOCK:
+                show = timeManager.isSynced();
+                break;
+            case PAGE_ADVISORY:
+                show = wmataClient.getIncidents().getCount() > 0;
+                break;
+            case PAGE_HEADWAYS:
+                show = headwayStats.getStreamCount() > 0;
+                break;
+            case PAGE_BUS:
+                show = wmataClient.findBusBoard(page.group) != nullptr;
+                break;
+            default:
+                break;
+        }
+        if (serviceClosed && page.kind != PAGE_CLOCK) show = false;
+        if (show) available |= 1UL << i;
+    }
+    return available;
+}
 
 /**
- * Get the appropriate color for a metro line
+ * Draw the page that is up
  * 
- * :param const char* lineCode: The line code (RD, BL, OR, GR, YL, SV)
- * :return uint16_t: 565-format color value
+ * Pages are drawn as rows, and only rows whose text changed are repainted,
+ * so both the once-a-second tick and a page change are partial redraws.
  */
-uint16_t getLineColor(const char* lineCode) {
-    if (strcmp(lineCode, "RD") == 0) return LINE_COLOR_RD;
-    if (strcmp(lineCode, "BL") == 0) return LINE_COLOR_BL;
-    if (strcmp(lineCode, "OR") == 0) return LINE_COLOR_OR;
-    if (strcmp(lineCode, "GR") == 0) return LINE_COLOR_GR;
-    if (strcmp(lineCode, "YL") == 0) return LINE_COLOR_YL;
-    if (strcmp(lineCode, "SV") == 0) return LINE_COLOR_SV;
-    return display.color565(255, 255, 255);  // Default white
+void drawPage() {
+    const CarouselPage& page = carousel.getPage();
+    switch (page.kind) {
+        case PAGE_GROUP:
+            showBoardPage(wmataClient.findBoard(page.group), wmataClient.getTracker());
+            break;
+        case PAGE_BUS:
+            showBoardPage(wmataClient.findBusBoard(page.group), wmataClient.getBusTracker());
+            break;
+        case PAGE_CLOCK:
+            showClockPage();
+            break;
+        case PAGE_ADVISORY:
+            showAdvisoryPage();
+            break;
+        case PAGE_HEADWAYS:
+            showHeadwayPage();
+            break;
+        default:
+            showSummaryPage();
+            break;
+    }
 }
 
 /**
- * Fetch and display metro arrivals
+ * Fetch metro arrivals and redraw the page that is up
  * Sets hasError and errorMessage if fetch fails
  */
 void updateMetroDisplay() {
-    Serial.println("[MAIN] Updating metro display...");
+    LOG_DEBUG("MAIN", "Updating metro display...");
     
-    // Calculate relative time (always shown, even on error)
-    unsigned long elapsedMs = millis() - lastFetchTime;
-    char relativeTime[16];
-    formatRelativeTime(elapsedMs, relativeTime, sizeof(relativeTime));
+    bool fetched = wmataClient.fetchPredictions();
+    LOG_DEBUG("MAIN", "API: %lu today (budget %lu), stretch %u%%, throttled %lu, deferred %lu",
+              rateGovernor.getDailyCount(), rateGovernor.getDailyBudget(),
+              rateGovernor.getStretchPercent(monoMillis()),
+              rateGovernor.getThrottledCount(), rateGovernor.getDeferredCount());
+    LOG_DEBUG("MAIN", "Fetch latency p50 %lu ms, p90 %lu ms",
+              wmataClient.getFetchLatency().estimatePercentile(50),
+              wmataClient.getFetchLatency().estimatePercentile(90));
+    
+    fetchFailed = !fetched;
+    statusServer.rebuild(monoMillis());
     
-    if (!wmataClient.fetchPredictions()) {
-        Serial.println("[MAIN] Failed to fetch predictions");
+    if (!fetched) {
+        if (wmataClient.wasThrottled()) {
+            LOG_INFO("MAIN", "Prediction request throttled");
+        } else {
+            LOG_WARN("MAIN", "Failed to fetch predictions");
+        }
+        pollScheduler.onPollFailed(monoMillis());
         hasError = true;
         errorMessage = "API Error";
+    } else {
+        pollScheduler.onPollResult(monoMillis(), wmataClient.hasDataChanged());
+        recordDepartures();
+        LOG_DEBUG("MAIN", "Next poll in %ld ms (period %lu ms)",
+                  (long)(pollScheduler.getNextPollTime() - monoMillis()), pollScheduler.getPeriodMs());
         
-        // Show error but still display the timer
-        display.showMetroArrivals(
-            "ERR", "!",
-            nullptr, nullptr,
-            relativeTime, display.color565(255, 0, 0)
-        );
-        return;
+        // An empty station isn't an error; the summary page says "None"
+        hasError = false;
+        errorMessage = wmataClient.getTrainCount() == 0 ? "No trains" : "";
     }
     
-    int trainCount = wmataClient.getTrainCount();
+    // Leaves a direction's page at once if the fetch emptied it
+    carousel.update(monoMillis(), getAvailablePages());
+    drawPage();
+}
+
+/**
+ * Send our latest fetch to the follower panels
+ * 
+ * :param bool isNew: True for a new fetch (next sequence), false for a heartbeat
+ */
+void sendSnapshot(bool isNew) {
+    // Nothing to share until the first successful fetch
+    if (wmataClient.getLastFetchTime() == 0) return;
     
-    if (trainCount == 0) {
-        hasError = true;
-        errorMessage = "No trains";
-        
-        display.showMetroArrivals(
-            "None", "-",
-            nullptr, nullptr,
-            relativeTime, display.color565(255, 255, 0)
-        );
-        return;
+    if (isNew) snapshotSequence++;
+    wmataClient.fillSnapshot(snapshot, monoMillis());
+    snapshot.leaderId = election.getDeviceId();
+    snapshot.sequence = snapshotSequence;
+    
+    size_t length = encodeSnapshot(snapshot, snapshotPacket, sizeof(snapshotPacket));
+    if (length == 0 || !fanoutSocket.send(snapshotPacket, length)) {
+        LOG_WARN("FANOUT", "Failed to send snapshot");
     }
+    lastSnapshotSent = monoMillis();
+}
+
+/**
+ * Render a snapshot from the leader as if we had fetched it
+ */
+void applySnapshot() {
+    wmataClient.applySnapshot(snapshot, monoMillis());
+    appliedLeaderId = snapshot.leaderId;
+    appliedSequence = snapshot.sequence;
     
-    // Success! Clear error state
+    lastFetchTime = wmataClient.getLastFetchTime();
+    lastDisplayUpdate = monoMillis();
+    fetchFailed = false;
     hasError = false;
     errorMessage = "";
     
-    // Get train data
-    TrainPrediction train1 = wmataClient.getTrain(0);
-    TrainPrediction train2 = wmataClient.getTrain(1);
+    recordDepartures();
+    refreshAdvisory();
+    statusServer.rebuild(monoMillis());
+    carousel.update(monoMillis(), getAvailablePages());
+    drawPage();
+}
+
+/**
+ * Read waiting snapshots from other panels and run the election
+ */
+void updateFanout() {
+    for (int i = 0; i < FANOUT_MAX_RECEIVE_PER_LOOP; i++) {
+        int length = fanoutSocket.receive(snapshotPacket, sizeof(snapshotPacket));
+        if (length < 0) break;
+        
+        // Panels for other stations may share the group
+        if (!decodeSnapshot(snapshotPacket, (size_t)length, snapshot) ||
+            strcmp(snapshot.station, deviceConfig.stationCode) != 0) {
+            continue;
+        }
+        
+        bool fromLeader = election.onSnapshot(snapshot.leaderId, monoMillis());
+        if (fromLeader && (snapshot.leaderId != appliedLeaderId || snapshot.sequence != appliedSequence)) {
+            LOG_DEBUG("FANOUT", "Snapshot %lu from %08lx",
+                      (unsigned long)snapshot.sequence, (unsigned long)snapshot.leaderId);
+            applySnapshot();
+        }
+    }
     
-    // Get line color from first train
-    uint16_t lineColor = getLineColor(train1.line);
+    if (election.update(monoMillis())) {
+        // Nobody is fetching for us; start polling right away
+        LOG_INFO("FANOUT", "No leader heard, taking over");
+        pollScheduler.reset();
+    } else if (election.isHeartbeatDue(lastSnapshotSent, monoMillis())) {
+        sendSnapshot(false);
+    }
+}
+
+/**
+ * Switch to the settings saved by POST /config, touching only what changed
+ * 
+ * A new station starts over like a boot, without re-initializing the panel;
+ * a new API key is used from the next request; new Wi-Fi credentials
+ * reconnect in the background.
+ */
+void applyPendingConfig() {
+    configPending = false;
+    uint8_t changes = configChanges(deviceConfig, pendingConfig);
+    deviceConfig = pendingConfig;
     
-    // Display the arrivals
-    if (trainCount == 1) {
-        display.showMetroArrivals(
-            train1.destination, train1.minutes,
-            nullptr, nullptr,
-            relativeTime, lineColor
-        );
+    // A secret too short to register before may be long enough now
+    logRedact(deviceConfig.apiKey);
+    logRedact(deviceConfig.wifiPassword);
+    
+    if (changes & (CONFIG_CHANGED_STATION | CONFIG_CHANGED_API_KEY)) {
+        wmataClient.reconfigure(deviceConfig.stationCode, deviceConfig.apiKey);
+    }
+    if (changes & CONFIG_CHANGED_STATION) {
+        pollScheduler.reset();
+        headwayStats.reset();
+        hasRecordedDeparture = false;
+        carousel.reset();
+        hasError = false;
+        fetchFailed = false;
+        nextIncidentPoll = 0;
+        refreshAdvisory();
+        statusServer.rebuild(monoMillis());
+        display.clear();
+        display.showMessage("Fetching...", display.color(COLOR_WHITE));
+    }
+    if (changes & CONFIG_CHANGED_WIFI) {
+        wifi.reconnect();
+    }
+    LOG_INFO("MAIN", "Config applied (changes 0x%02x), station %s", changes, deviceConfig.stationCode);
+}
+
+/**
+ * Turn the power manager's automatic light sleep on or off
+ * 
+ * With it on, the chip light-sleeps whenever every task is waiting, and
+ * wakes for the next timer, Wi-Fi beacon or console input, so the station
+ * stays associated (unlike a manual esp_light_sleep_start(), which needs
+ * Wi-Fi stopped). Only used while the panel is blank: refresh pauses in
+ * light sleep, which a black frame doesn't show. It needs a framework
+ * built with tickless idle; without that, modem sleep alone is used.
+ * 
+ * :param bool enable: True while closed and blank
+ * :return bool: True if automatic light sleep is now on
+ */
+bool configureLightSleep(bool enable) {
+    uint32_t mhz = enable ? 80 : serviceCpuMhz;
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = mhz;
+    config.min_freq_mhz = enable ? 40 : mhz;
+    config.light_sleep_enable = enable;
+    
+    if (enable && SERIAL_CONSOLE) {
+        Serial.flush();
+        uart_set_wakeup_threshold(UART_NUM_0, 3);
+        esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    }
+    esp_err_t err = esp_pm_configure(&config);
+    if (!enable || err != ESP_OK) {
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+    }
+    if (err != ESP_OK) {
+        if (enable) {
+            LOG_WARN("POWER", "Automatic light sleep unavailable (%s); using modem sleep only",
+                     esp_err_to_name(err));
+        }
+        return false;
+    }
+    return enable;
+}
+
+/**
+ * Power down outside service hours: blank the panel (or dim it to the
+ * clock), let Wi-Fi sleep between beacons and slow the CPU
+ * 
+ * Fetching drops to a health check every CLOSED_HEALTH_CHECK_MS.
+ */
+void enterClosed() {
+    serviceClosed = true;
+    serviceDimLevel = display.getDimLevel();
+    if (CLOSED_BLANK_PANEL) {
+        display.setBlank(true);
     } else {
-        display.showMetroArrivals(
-            train1.destination, train1.minutes,
-            train2.destination, train2.minutes,
-            relativeTime, lineColor
-        );
+        display.setDimLevel(CLOSED_DIM_LEVEL);
+        carousel.reset();  // Only the clock is shown while closed
+    }
+    
+    esp_wifi_get_ps(&serviceWifiPs);
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+    serviceCpuMhz = getCpuFrequencyMhz();
+    setCpuFrequencyMhz(80);
+    if (display.isBlank() && CLOSED_LIGHT_SLEEP_MS > 0) {
+        autoLightSleep = configureLightSleep(true);
     }
+    LOG_INFO("POWER", "Service closed, waking in %lu min", (unsigned long)(secondsToService / 60));
 }
 
 /**
- * Update the display (timer always updates, data only if no error)
+ * Power back up at service start and fetch straight away
  */
-void updateDisplay() {
-    // Calculate relative time since last fetch (always shown)
-    unsigned long elapsedMs = millis() - lastFetchTime;
-    char relativeTime[16];
-    formatRelativeTime(elapsedMs, relativeTime, sizeof(relativeTime));
+void leaveClosed() {
+    serviceClosed = false;
+    if (autoLightSleep) {
+        configureLightSleep(false);
+        autoLightSleep = false;
+    }
+    setCpuFrequencyMhz(serviceCpuMhz);
+    esp_wifi_set_ps(serviceWifiPs);
+    display.setBlank(false);
+    display.setDimLevel(serviceDimLevel);
     
-    if (hasError) {
-        // Still in error state - show error with updated timer
-        display.showMetroArrivals(
-            "ERR", "!",
-            nullptr, nullptr,
-            relativeTime, display.color565(255, 0, 0)
-        );
+    forceFetch = true;
+    nextIncidentPoll = 0;
+    nextBusPoll = 0;
+    carousel.reset();
+    LOG_INFO("POWER", "Service starting");
+}
+
+/**
+ * Follow the service hours, and add up energy use and API calls per day
+ * 
+ * The mode is checked on every pass, so the panel wakes as soon as service
+ * starts; energy is added up every POWER_UPDATE_INTERVAL_MS. Until NTP
+ * sets the clock the panel stays in service.
+ */
+void updatePower() {
+    bool closed = false;
+    long day = -1;
+    if (timeManager.isSynced()) {
+        time_t now = time(nullptr);
+        struct tm local;
+        localtime_r(&now, &local);
+        day = (long)local.tm_year * 366 + local.tm_yday;
+        if (POWER_SCHEDULE) {
+            uint32_t secOfDay = (uint32_t)(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+            secondsToService = serviceSchedule.secondsUntilService(local.tm_wday, secOfDay);
+            closed = secondsToService > 0;
+        }
+    }
+    if (closed && !serviceClosed) {
+        enterClosed();
+    } else if (!closed && serviceClosed) {
+        leaveClosed();
+    }
+    
+    uint64_t nowMs = monoMillis();
+    if (nowMs - lastPowerUpdate < POWER_UPDATE_INTERVAL_MS) return;
+    lastPowerUpdate = nowMs;
+    
+    // The power estimated last time covers the time since
+    if (powerLedger.update(nowMs, powerMw, serviceClosed, rateGovernor.getAllowedCount(), day)) {
+        const PowerDay& yesterday = powerLedger.getYesterday();
+        LOG_INFO("POWER", "Yesterday: %lu.%lu Wh, %lu API calls, closed %lu min",
+                 (unsigned long)(yesterday.energyMj / 3600000), (unsigned long)(yesterday.energyMj / 360000 % 10),
+                 yesterday.apiCalls, (unsigned long)(yesterday.closedSec / 60));
+    }
+    
+    // The duty only changes with the frame
+    uint32_t hash = display.getFrame().getHash();
+    if (hash != frameHashForDuty) {
+        frameHashForDuty = hash;
+        frameDuty = frameDutyPermille(display.getFrame());
+    }
+    powerMw = estimatePowerMw(POWER_MODEL, frameDuty, serviceClosed);
+}
+
+
+/**
+ * Write the power state and daily totals
+ * 
+ * :param BufferWriter& out: Output
+ */
+void formatPower(BufferWriter& out) {
+    const PowerDay* days[2] = {&powerLedger.getToday(), &powerLedger.getYesterday()};
+    static const char* const DAY_NAMES[2] = {"today", "yesterday"};
+    
+    if (serviceClosed) {
+        out.printf("closed (%s), waking in %lu min\n", display.isBlank() ? "blank" : "dimmed",
+                   (unsigned long)(secondsToService / 60));
+    } else {
+        out.printf("in service%s\n", POWER_SCHEDULE && !timeManager.isSynced() ? " (clock not set)" : "");
+    }
+    out.printf("estimate %lu mW, panel duty %u.%u%%\n", (unsigned long)powerMw, frameDuty / 10, frameDuty % 10);
+    for (int i = 0; i < 2; i++) {
+        out.printf("%s: %lu.%lu Wh, %lu API calls, closed %lu min\n", DAY_NAMES[i],
+                   (unsigned long)(days[i]->energyMj / 3600000), (unsigned long)(days[i]->energyMj / 360000 % 10),
+                   days[i]->apiCalls, (unsigned long)(days[i]->closedSec / 60));
+    }
+}
+
+/**
+ * Console: the trains and incidents as of the last fetch (as /predictions)
+ */
+void consoleSnapshot(char* args, BufferWriter& out, void* context) {
+    out.print(predictionsBody);
+}
+
+/**
+ * Console: the Prometheus metrics (as /metrics)
+ */
+void consoleMetrics(char* args, BufferWriter& out, void* context) {
+    buildMetricsBody(metricsBody, sizeof(metricsBody), nullptr);
+    out.print(metricsBody);
+}
+
+/**
+ * Console: heap use
+ */
+void consoleHeap(char* args, BufferWriter& out, void* context) {
+    out.printf("free %u, lowest %u, largest block %u of %u bytes\n",
+               (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(),
+               (unsigned)ESP.getMaxAllocHeap(), (unsigned)ESP.getHeapSize());
+    heapWatermarks.format(out);
+}
+
+/**
+ * Console: headway statistics per line and direction
+ */
+void consoleHeadways(char* args, BufferWriter& out, void* context) {
+    char report[sizeof(headwaysBody)];
+    if (headwayStats.formatReport(report, sizeof(report), monoMillis()) == 0) {
+        out.print("no departures seen yet");
+        return;
+    }
+    out.print(report);
+}
+
+/**
+ * Console: task count and the stack headroom of ours
+ */
+void consoleTasks(char* args, BufferWriter& out, void* context) {
+    out.printf("%u tasks; stack never used: loop %u, watchdog %u bytes; log drops %lu",
+               (unsigned)uxTaskGetNumberOfTasks(), (unsigned)uxTaskGetStackHighWaterMark(nullptr),
+               watchdogHandle != nullptr ? (unsigned)uxTaskGetStackHighWaterMark(watchdogHandle) : 0u,
+               logGetDroppedCount());
+}
+
+/**
+ * Console: fetch predictions now (and end a replay)
+ */
+void consoleFetch(char* args, BufferWriter& out, void* context) {
+    if (FANOUT_ENABLED && fanoutSocket.isOpen() && !election.isLeader()) {
+        out.print("following another panel; its leader fetches");
         return;
     }
+    forceFetch = true;
+    replayHold = false;
+    out.print("fetching");
+}
+
+/**
+ * Console: show or change the log level
+ */
+void consoleLog(char* args, BufferWriter& out, void* context) {
+    static const char* const LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug"};
+    if (args[0] != '\0') {
+        int level = parseLogLevel(args);
+        if (level < 0) {
+            out.print("levels: none, error, warn, info, debug");
+            return;
+        }
+        logSetLevel((uint8_t)level);
+    }
+    out.printf("log level %s (compiled up to %s)", LEVEL_NAMES[logGetLevel()], LEVEL_NAMES[LOG_LEVEL]);
+}
+
+/**
+ * Console: show or change the dimming level
+ */
+void consoleDim(char* args, BufferWriter& out, void* context) {
+    if (args[0] != '\0') {
+        char* end;
+        long level = strtol(args, &end, 10);
+        if (*end != '\0' || level < 0 || level >= DIM_LEVELS) {
+            out.printf("levels: 0 (full) to %d", DIM_LEVELS - 1);
+            return;
+        }
+        display.setDimLevel((uint8_t)level);
+        drawPage();
+    }
+    out.printf("dim level %u", display.getDimLevel());
+}
+
+/**
+ * Console: the power state and daily energy and API call totals
+ */
+void consolePower(char* args, BufferWriter& out, void* context) {
+    formatPower(out);
+}
+
+/**
+ * Console: list the pages, or put one up
+ */
+void consolePage(char* args, BufferWriter& out, void* context) {
+    static const char* const KIND_NAMES[] = {"summary", "group", "clock", "advisory", "headways", "bus"};
+    uint32_t available = getAvailablePages();
     
-    int trainCount = wmataClient.getTrainCount();
+    if (args[0] != '\0') {
+        char* end;
+        long index = strtol(args, &end, 10);
+        if (*end != '\0' || !carousel.show((int)index, monoMillis(), available)) {
+            out.printf("page %s is not there or has nothing to show", args);
+            return;
+        }
+        lastDisplayUpdate = monoMillis();
+        drawPage();
+    }
+    for (int i = 0; i < carousel.getCount(); i++) {
+        const CarouselPage& page = CAROUSEL_PAGES[i];
+        out.printf("%c %d %s %u%s\n", i == carousel.getIndex() ? '*' : ' ', i, KIND_NAMES[page.kind],
+                   page.group, (available & (1UL << i)) ? "" : " (nothing to show)");
+    }
+}
+
+/**
+ * Console: print the current predictions as a hex snapshot for "replay"
+ */
+void consoleCapture(char* args, BufferWriter& out, void* context) {
+    static PredictionSnapshot captured;
+    static uint8_t packet[SNAPSHOT_MAX_SIZE];
+    if (wmataClient.getLastFetchTime() == 0) {
+        out.print("nothing fetched yet");
+        return;
+    }
     
-    if (trainCount == 0) {
-        display.showMetroArrivals(
-            "None", "-",
-            nullptr, nullptr,
-            relativeTime, display.color565(255, 255, 0)
-        );
+    wmataClient.fillSnapshot(captured, monoMillis());
+    size_t length = encodeSnapshot(captured, packet, sizeof(packet));
+    formatHex(packet, length, out);
+}
+
+/**
+ * Console: show a captured snapshot as if just fetched, holding off fetches
+ * until "fetch"
+ */
+void consoleReplay(char* args, BufferWriter& out, void* context) {
+    static uint8_t packet[SNAPSHOT_MAX_SIZE];
+    int length = parseHex(args, packet, sizeof(packet));
+    if (length <= 0 || !decodeSnapshot(packet, (size_t)length, snapshot)) {
+        out.print("not a snapshot from capture");
         return;
     }
     
-    TrainPrediction train1 = wmataClient.getTrain(0);
-    TrainPrediction train2 = wmataClient.getTrain(1);
-    uint16_t lineColor = getLineColor(train1.line);
+    replayHold = true;
+    applySnapshot();
+    out.printf("replaying %d trains at %s; \"fetch\" to resume", snapshot.trainCount, snapshot.station);
+}
+
+/**
+ * Console: show the settings, or change one (saved, like POST /config)
+ */
+void consoleConfig(char* args, BufferWriter& out, void* context) {
+    DeviceConfig updated = configPending ? pendingConfig : deviceConfig;
+    if (args[0] != '\0') {
+        char* value = args + strcspn(args, " ");
+        if (*value != '\0') *value++ = '\0';
+        
+        const char* error = nullptr;
+        if (!setConfigField(updated, args, value, error)) {
+            out.print(error);
+            return;
+        }
+        if (!saveConfig(updated)) {
+            out.print("saving to flash failed");
+            return;
+        }
+    }
+    formatConfig(updated, out);
+}
+
+static const ConsoleCommand CONSOLE_COMMANDS[] = {
+    {"snapshot", "", "Trains and incidents as of the last fetch (JSON)", consoleSnapshot},
+    {"metrics", "", "Prometheus metrics", consoleMetrics},
+    {"heap", "", "Heap use", consoleHeap},
+    {"headways", "", "Headway statistics per line and direction", consoleHeadways},
+    {"tasks", "", "Tasks and stack headroom", consoleTasks},
+    {"fetch", "", "Fetch predictions now", consoleFetch},
+    {"log", "[level]", "Show or set the log level", consoleLog},
+    {"page", "[n]", "List pages, or show page n", consolePage},
+    {"dim", "[level]", "Show or set the dimming level", consoleDim},
+    {"power", "", "Service hours state, energy and API calls per day", consolePower},
+    {"capture", "", "Current predictions as hex, for replay", consoleCapture},
+    {"replay", "<hex>", "Show a captured snapshot until the next fetch", consoleReplay},
+    {"config", "[name value]", "Show settings, or set station/api_key/wifi_ssid/wifi_password", consoleConfig},
+};
+
+SerialConsole console(CONSOLE_COMMANDS, sizeof(CONSOLE_COMMANDS) / sizeof(CONSOLE_COMMANDS[0]),
+                      consoleOutput, sizeof(consoleOutput), nullptr);
+
+/**
+ * Read what has arrived on the serial port and send what fits of the answer
+ * 
+ * Never waits: input is taken a character at a time from the receive
+ * buffer, and output only as fast as the transmit buffer frees up. The log
+ * is held while an answer goes out, so the two don't interleave.
+ */
+void updateConsole() {
+    while (!console.hasOutput() && Serial.available() > 0) {
+        if (console.feed((char)Serial.read())) {
+            logHold(true);
+        }
+    }
+    if (!console.hasOutput()) return;
     
-    // Redraw display with updated relative time
-    if (trainCount == 1) {
-        display.showMetroArrivals(
-            train1.destination, train1.minutes,
-            nullptr, nullptr,
-            relativeTime, lineColor
-        );
-    } else {
-        display.showMetroArrivals(
-            train1.destination, train1.minutes,
-            train2.destination, train2.minutes,
-            relativeTime, lineColor
-        );
+    size_t length;
+    const char* text = console.getOutput(length);
+    int room = Serial.availableForWrite();
+    if (room <= 0) return;
+    
+    console.consumeOutput(Serial.write((const uint8_t*)text, length < (size_t)room ? length : (size_t)room));
+    if (!console.hasOutput()) {
+        logHold(false);
+    }
+}
+
+/**
+ * Get the heap state now, for the heap high-water marks
+ * 
+ * :return HeapSample: Free heap and its low since boot
+ */
+HeapSample heapSample() {
+    HeapSample sample = {ESP.getFreeHeap(), ESP.getMinFreeHeap()};
+    return sample;
+}
+
+/**
+ * Keep the request phase in the postmortem state, so a hang shows where it
+ * was, and have the watchdog time each request
+ * 
+ * The heap use of each phase is recorded as it ends, which separates the
+ * HTTP client's buffers (connect to body) from the JSON parser's (parse).
+ */
+void onFetchPhase(uint8_t phase, void* context) {
+    HeapSample now = heapSample();
+    if (heapPhase != FETCH_PHASE_IDLE) {
+        heapWatermarks.record(fetchPhaseName(heapPhase), heapPhaseStart, now);
+    }
+    heapPhase = phase;
+    heapPhaseStart = now;
+    
+    postmortem.setPhase(phase, monoMillis());
+    if (phase == FETCH_PHASE_IDLE) {
+        hangMonitor.disarm();
+    } else if (!hangMonitor.isArmed()) {
+        hangMonitor.arm(monoMillis());
+    }
+}
+
+/**
+ * Watchdog task: unblock a stuck request, then reset Wi-Fi, and restart
+ * only as a last resort
+ */
+void watchdogTask(void* arg) {
+    for (;;) {
+        switch (hangMonitor.check(monoMillis())) {
+            case HANG_RECOVER:
+                LOG_ERROR("WATCHDOG", "Request stuck in %s phase; aborting it",
+                          fetchPhaseName(wmataClient.getPhase()));
+                wmataClient.abortRequest();
+                break;
+            case HANG_RESET_NETWORK:
+                LOG_ERROR("WATCHDOG", "Request still stuck in %s phase; reconnecting Wi-Fi",
+                          fetchPhaseName(wmataClient.getPhase()));
+                wmataClient.abortRequest();
+                WiFi.reconnect();
+                break;
+            case HANG_RESTART:
+                LOG_ERROR("WATCHDOG", "Request still stuck; restarting");
+                logFlush();
+                ESP.restart();
+                break;
+            default:
+                break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(WATCHDOG_CHECK_INTERVAL_MS));
+    }
+}
+
+/**
+ * Sample heap and Wi-Fi health into the postmortem log
+ */
+void samplePostmortem() {
+    lastPostmortemSample = monoMillis();
+    postmortem.addSample(ESP.getFreeHeap(), ESP.getMinFreeHeap(), wifi.isConnected(), wifi.getRssi(), monoMillis());
+}
+
+/**
+ * Print what the previous run left in the postmortem log, one line at a time
+ */
+void printPostmortem() {
+    size_t length = buildPostmortemBody(postmortemBody, sizeof(postmortemBody), nullptr);
+    char line[128];
+    size_t start = 0;
+    while (start < length) {
+        const char* end = strchr(postmortemBody + start, '\n');
+        size_t lineLength = end != nullptr ? (size_t)(end - (postmortemBody + start)) : length - start;
+        size_t copied = lineLength < sizeof(line) - 1 ? lineLength : sizeof(line) - 1;
+        memcpy(line, postmortemBody + start, copied);
+        line[copied] = '\0';
+        LOG_INFO(POSTMORTEM_LOG_TAG, "%s", line);
+        start += lineLength + 1;
     }
 }
 
 void setup() {
+    if (SERIAL_CONSOLE) {
+        // Room for a pasted "replay" line while the loop is busy fetching
+        Serial.setRxBufferSize(CONSOLE_LINE_MAX_LEN);
+        Serial.setTxBufferSize(CONSOLE_TX_BUFFER_SIZE);
+    }
     Serial.begin(115200);
     while (!Serial) {
         // Wait for serial connection
     }
     
-    Serial.println("\n=== WMATA Metro Monitor ===");
-    Serial.printf("Station Code: %s\n", STATION_CODE);
+    // Saved settings override the ones built in
+    initConfig(deviceConfig, STATION_CODE, WMATA_API_KEY, WIFI_SSID, WIFI_PASSWORD);
+    bool configLoaded = configStore.load(deviceConfig);
+    wmataClient.reconfigure(deviceConfig.stationCode, deviceConfig.apiKey);
+    wifi.setCredentials(deviceConfig.wifiSsid, deviceConfig.wifiPassword);
     
-    // Initialize display
+    // Keep secrets out of the log, then let the flush task own the UART
+    logRedact(deviceConfig.apiKey);
+    logRedact(deviceConfig.wifiPassword);
+    logBegin();
+    
+    LOG_INFO("MAIN", "=== WMATA Metro Monitor ===");
+    LOG_INFO("MAIN", "Station Code: %s%s", deviceConfig.stationCode, configLoaded ? " (saved)" : "");
+    
+    // What was the device doing before this reset?
+    if (postmortem.begin(getResetReasonName(), monoMillis())) {
+        printPostmortem();
+    }
+    logSetPostmortem(&postmortem);
+    wmataClient.setPhaseListener(onFetchPhase, nullptr);
+    if (BUS_PREDICTIONS) {
+        wmataClient.setBusStops(BUS_STOP_IDS, sizeof(BUS_STOP_IDS) / sizeof(BUS_STOP_IDS[0]));
+    }
+    
+    // Above the loop's priority, so it runs while the loop is blocked
+    xTaskCreatePinnedToCore(watchdogTask, "watchdog", 3072, nullptr, 2, &watchdogHandle, 0);
+    
+    // Initialize display (the DMA buffers come from the heap)
+    HeapSample heapBefore = heapSample();
     display.init();
-    display.showMessage("Starting...", display.color565(255, 255, 255));
+    heapWatermarks.record("display", heapBefore, heapSample());
+    display.showMessage("Starting...", display.color(COLOR_WHITE));
     
     // Connect to WiFi
     display.clear();
-    display.showMessage("Connecting...", display.color565(255, 255, 255));
+    display.showMessage("Connecting...", display.color(COLOR_WHITE));
     
-    if (!wifi.connect()) {
+    heapBefore = heapSample();
+    bool connected = wifi.connect();
+    heapWatermarks.record("wifi", heapBefore, heapSample());
+    if (!connected) {
         display.clear();
-        display.showMessage("WiFi Failed!", display.color565(255, 0, 0));
-        Serial.println("[MAIN] WiFi connection failed!");
+        display.showMessage("WiFi Failed!", display.color(COLOR_RED));
+        LOG_ERROR("MAIN", "WiFi connection failed!");
         while (1) { delay(1000); }
     }
     
-    Serial.println("[MAIN] WiFi connected!");
-    Serial.print("[MAIN] IP: ");
-    Serial.println(wifi.getIPAddress());
+    LOG_INFO("MAIN", "WiFi connected, IP %s", wifi.getIPAddress().c_str());
+    
+    // Syncs in the background; the clock page and clock times appear once it's set
+    timeManager.begin();
+    
+    // Status endpoints for field checks without USB serial
+    statusServer.addEndpoint("/predictions", "application/json", predictionsBody, sizeof(predictionsBody),
+                             buildPredictionsBody, nullptr);
+    int metricsEndpoint = statusServer.addEndpoint("/metrics", PROMETHEUS_CONTENT_TYPE, metricsBody,
+                                                   sizeof(metricsBody), buildMetricsBody, nullptr);
+    statusServer.setLive(metricsEndpoint, true);
+    
+    // Frame mirror: encoded only when requested, never while drawing. The two
+    // endpoints share one buffer, which is safe because live bodies are
+    // rebuilt just before each response.
+    int pngEndpoint = statusServer.addEndpoint("/frame.png", "image/png", frameBody, sizeof(frameBody),
+                                               buildFramePngBody, nullptr);
+    int rleEndpoint = statusServer.addEndpoint("/frame.rle", "application/octet-stream", frameBody,
+                                               sizeof(frameBody), buildFrameRleBody, nullptr);
+    statusServer.setLive(pngEndpoint, true);
+    statusServer.setLive(rleEndpoint, true);
+    statusServer.setLongPoll(pngEndpoint, getFrameVersion);
+    statusServer.setLongPoll(rleEndpoint, getFrameVersion);
+    statusServer.addEndpoint("/health", "application/json", healthBody, sizeof(healthBody),
+                             buildHealthBody, nullptr);
+    int postmortemEndpoint = statusServer.addEndpoint("/postmortem", "text/plain", postmortemBody,
+                                                      sizeof(postmortemBody), buildPostmortemBody, nullptr);
+    statusServer.setLive(postmortemEndpoint, true);
+    int configEndpoint = statusServer.addEndpoint("/config", "application/json", configBody, sizeof(configBody),
+                                                  buildConfigBody, nullptr);
+    statusServer.setLive(configEndpoint, true);
+#ifdef CONFIG_TOKEN
+    // Settings changes over the LAN need the shared secret from .env
+    statusServer.setActionToken(CONFIG_TOKEN);
+    statusServer.setAction(configEndpoint, postConfig);
+#else
+    LOG_INFO("MAIN", "POST /config is off; set CONFIG_TOKEN in .env to turn it on");
+#endif
+    int headwaysEndpoint = statusServer.addEndpoint("/headways", "text/plain", headwaysBody, sizeof(headwaysBody),
+                                                    buildHeadwaysBody, nullptr);
+    statusServer.setLive(headwaysEndpoint, true);
+    heapBefore = heapSample();
+    bool serverStarted = statusServer.begin(STATUS_SERVER_PORT);
+    heapWatermarks.record("status_server", heapBefore, heapSample());
+    if (serverStarted) {
+        LOG_INFO("MAIN", "Status server on port %u", statusServer.getPort());
+    } else {
+        LOG_ERROR("MAIN", "Status server failed to start");
+    }
+    
+    if (FANOUT_ENABLED) {
+        // Listen for a leader before spending any API calls
+        if (fanoutSocket.begin(FANOUT_GROUP, FANOUT_PORT)) {
+            LOG_INFO("FANOUT", "Device %08lx listening on %s:%u",
+                     (unsigned long)election.getDeviceId(), FANOUT_GROUP, FANOUT_PORT);
+        } else {
+            LOG_WARN("FANOUT", "Multicast socket failed; fetching alone");
+        }
+        election.begin(monoMillis());
+        display.clear();
+        display.showMessage("Listening...", display.color(COLOR_WHITE));
+        lastFetchTime = monoMillis();
+        lastDisplayUpdate = lastFetchTime;
+        return;
+    }
     
     // Initial fetch
     display.clear();
-    display.showMessage("Fetching...", display.color565(255, 255, 255));
-    lastFetchTime = millis();  // Set time before fetch for accurate timer
+    display.showMessage("Fetching...", display.color(COLOR_WHITE));
+    lastFetchTime = monoMillis();  // Set time before fetch for accurate timer
+    lastDisplayUpdate = lastFetchTime;
     updateMetroDisplay();
 }
 
 void loop() {
-    unsigned long currentTime = millis();
+    // Followers render the leader's snapshots and make no API calls
+    bool fetching = true;
+    if (FANOUT_ENABLED && fanoutSocket.isOpen()) {
+        updateFanout();
+        fetching = election.isLeader();
+    }
+    if (replayHold) {
+        fetching = false;
+    }
+    updatePower();
+    
+    uint64_t currentTime = monoMillis();
+    
+    // Refresh data when the scheduler says WMATA should have new data,
+    // unless the daily quota projection says to wait longer; while
+    // closed, only an occasional health check
+    bool pollDue;
+    if (serviceClosed) {
+        pollDue = fetching && currentTime - lastFetchTime >= CLOSED_HEALTH_CHECK_MS;
+    } else {
+        pollDue = fetching && pollScheduler.isDue(currentTime) &&
+                  !rateGovernor.shouldDefer(lastFetchTime, REFRESH_INTERVAL_MS, currentTime);
+    }
     
-    // Refresh data every REFRESH_INTERVAL_MS
-    if (currentTime - lastFetchTime >= REFRESH_INTERVAL_MS) {
+    if (pollDue || (fetching && forceFetch)) {
+        forceFetch = false;
         lastFetchTime = currentTime;  // Update time before fetch
+        lastDisplayUpdate = currentTime;
         updateMetroDisplay();
-    } else {
-        // Just update the timer display (every second)
-        updateDisplay();
+        if (fanoutSocket.isOpen() && !fetchFailed) sendSnapshot(true);
+    } else if (fetching && !serviceClosed && currentTime >= nextIncidentPoll &&
+               (int64_t)(pollScheduler.getNextPollTime() - currentTime) >= (int64_t)INCIDENT_POLL_CLEARANCE_MS) {
+        // Incidents share the connection and rate budget; fit them between predictions
+        if (updateIncidents() && fanoutSocket.isOpen()) sendSnapshot(true);
+    } else if (BUS_PREDICTIONS && fetching && !serviceClosed && currentTime >= nextBusPoll &&
+               (int64_t)(pollScheduler.getNextPollTime() - currentTime) >= (int64_t)INCIDENT_POLL_CLEARANCE_MS) {
+        // Buses have their own schedule but the same connection and rate budget
+        updateBuses();
+    } else if (carousel.update(currentTime, getAvailablePages()) ||
+               currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL_MS) {
+        // Next page, or just the countdown and timer (every second)
+        lastDisplayUpdate = currentTime;
+        drawPage();
+    }
+    
+    // Answer status requests from the cached bodies
+    HeapSample heapBefore = heapSample();
+    if (statusServer.poll(monoMillis()) > 0) {
+        heapWatermarks.record("status_requests", heapBefore, heapSample());
+    }
+    if (configPending) {
+        applyPendingConfig();
+    }
+    if (SERIAL_CONSOLE) {
+        updateConsole();
+    }
+    wifi.update();
+    
+    if (monoMillis() - lastPostmortemSample >= POSTMORTEM_SAMPLE_INTERVAL_MS) {
+        samplePostmortem();
     }
     
-    delay(1000);
+    // Scroll the advisory over the bottom row between full redraws
+    int advisoryOffset;
+    bool scrolling = carousel.getPage().kind == PAGE_SUMMARY && getAdvisoryOffset(monoMillis(), advisoryOffset);
+    if (scrolling && monoMillis() - lastAdvisoryStep >= ADVISORY_SCROLL_STEP_MS) {
+        lastAdvisoryStep = monoMillis();
+        display.showAdvisory(advisoryText, advisoryOffset);
+    }
+    
+    if (autoLightSleep && !console.hasOutput()) {
+        // The power manager light-sleeps through the wait
+        delay(CLOSED_LIGHT_SLEEP_MS);
+    } else {
+        delay(scrolling ? ADVISORY_SCROLL_STEP_MS : LOOP_TICK_MS);
+    }
 }
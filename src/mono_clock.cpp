@@ -0,0 +1,66 @@
+#include "mono_clock.h"
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+static uint64_t _systemMicros(void* context) {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time();
+#else
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static ClockSource clockSource = _systemMicros;
+static void* clockContext = nullptr;
+
+void setClockSource(ClockSource source, void* context) {
+    clockSource = source != nullptr ? source : _systemMicros;
+    clockContext = source != nullptr ? context : nullptr;
+}
+
+uint64_t monoMicros() {
+    return clockSource(clockContext);
+}
+
+uint64_t monoMillis() {
+    return clockSource(clockContext) / 1000;
+}
+
+FakeClock::FakeClock(uint64_t startMs) : _nowUs(startMs * 1000) {}
+
+void FakeClock::install() {
+    setClockSource(_read, this);
+}
+
+void FakeClock::uninstall() {
+    if (clockContext == this) setClockSource(nullptr);
+}
+
+void FakeClock::setMs(uint64_t nowMs) {
+    if (nowMs * 1000 > _nowUs) _nowUs = nowMs * 1000;
+}
+
+void FakeClock::advanceMs(uint64_t deltaMs) {
+    _nowUs += deltaMs * 1000;
+}
+
+void FakeClock::advanceUs(uint64_t deltaUs) {
+    _nowUs += deltaUs;
+}
+
+uint64_t FakeClock::nowUs() const {
+    return _nowUs;
+}
+
+uint64_t FakeClock::nowMs() const {
+    return _nowUs / 1000;
+}
+
+uint64_t FakeClock::_read(void* context) {
+    return ((const FakeClock*)context)->_nowUs;
+}
@@ -0,0 +1,99 @@
+#include "multicast_socket.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#endif
+#include <unistd.h>
+
+MulticastSocket::MulticastSocket() : _fd(-1), _group(0), _port(0) {}
+
+MulticastSocket::~MulticastSocket() {
+    stop();
+}
+
+bool MulticastSocket::begin(const char* group, uint16_t port, const char* interfaceAddr) {
+    stop();
+
+    struct in_addr groupAddr;
+    struct in_addr localAddr;
+    if (inet_aton(group, &groupAddr) == 0 || inet_aton(interfaceAddr, &localAddr) == 0) {
+        return false;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return false;
+
+    // Several panels (or test sockets) may share the port on one host
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    struct ip_mreq membership;
+    membership.imr_multiaddr = groupAddr;
+    membership.imr_interface = localAddr;
+
+    uint8_t ttl = 1;
+    uint8_t loop = 1;
+    int flags;
+
+    bool ok = bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+              setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0 &&
+              setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &localAddr, sizeof(localAddr)) == 0 &&
+              setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == 0 &&
+              setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) == 0 &&
+              (flags = fcntl(fd, F_GETFL, 0)) >= 0 &&
+              fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    if (!ok) {
+        close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _group = groupAddr.s_addr;
+    _port = port;
+    return true;
+}
+
+void MulticastSocket::stop() {
+    if (_fd >= 0) {
+        close(_fd);  // Closing also leaves the group
+        _fd = -1;
+    }
+}
+
+bool MulticastSocket::send(const uint8_t* data, size_t length) {
+    if (_fd < 0) return false;
+
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = _group;
+    dest.sin_port = htons(_port);
+
+    return sendto(_fd, data, length, 0, (struct sockaddr*)&dest, sizeof(dest)) == (ssize_t)length;
+}
+
+int MulticastSocket::receive(uint8_t* buffer, size_t size) {
+    if (_fd < 0) return -1;
+
+    ssize_t received = recv(_fd, buffer, size, 0);
+    return received >= 0 ? (int)received : -1;
+}
+
+bool MulticastSocket::isOpen() const {
+    return _fd >= 0;
+}
@@ -0,0 +1,60 @@
+#include "page_carousel.h"
+
+PageCarousel::PageCarousel(const CarouselPage* pages, int count)
+    : _count(0), _current(-1), _shownAt(0) {
+    if (pages == nullptr || count < 0) count = 0;
+    if (count > CAROUSEL_MAX_PAGES) count = CAROUSEL_MAX_PAGES;
+    for (int i = 0; i < count; i++) {
+        _pages[i] = pages[i];
+    }
+    _count = count;
+}
+
+bool PageCarousel::update(uint64_t nowMs, uint32_t available) {
+    if (_current >= 0 && _isShowable(_current, available) &&
+        nowMs - _shownAt < _pages[_current].durationMs) {
+        return false;
+    }
+
+    // Next showable page after the current one, coming back round to it last
+    int start = _current >= 0 ? _current : _count - 1;
+    for (int step = 1; step <= _count; step++) {
+        int index = (start + step) % _count;
+        if (!_isShowable(index, available)) continue;
+
+        bool changed = index != _current;
+        _current = index;
+        _shownAt = nowMs;
+        return changed;
+    }
+
+    // Nothing to show; leave the last page up
+    return false;
+}
+
+void PageCarousel::reset() {
+    _current = -1;
+}
+
+bool PageCarousel::show(int index, uint64_t nowMs, uint32_t available) {
+    if (index < 0 || index >= _count || !_isShowable(index, available)) return false;
+    _current = index;
+    _shownAt = nowMs;
+    return true;
+}
+
+const CarouselPage& PageCarousel::getPage() const {
+    return _pages[_current >= 0 ? _current : 0];
+}
+
+int PageCarousel::getIndex() const {
+    return _current;
+}
+
+int PageCarousel::getCount() const {
+    return _count;
+}
+
+bool PageCarousel::_isShowable(int index, uint32_t available) const {
+    return _pages[index].durationMs > 0 && (available & (1UL << index)) != 0;
+}
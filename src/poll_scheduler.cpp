@@ -0,0 +1,277 @@
+#include "poll_scheduler.h"
+
+/**
+ * Steps of the locked polling cycle
+ */
+enum LockStep {
+    LOCK_ALIGNED,  // Next poll is the regular one just after the expected update
+    LOCK_PRE,      // Next poll opens a bracket just before the expected update
+    LOCK_POST,     // Next poll closes the bracket just after the expected update
+    LOCK_PROBE     // Bracket missed; polling shortly after to find the update
+};
+
+/**
+ * Signed difference a - b between two monoMillis() values
+ */
+static int64_t _diffMs(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b);
+}
+
+PollScheduler::PollScheduler(unsigned long minIntervalMs) : _minIntervalMs(minIntervalMs) {
+    reset();
+}
+
+void PollScheduler::reset() {
+    _hasPoll = false;
+    _lastPollMs = 0;
+    _nextPollMs = 0;
+    _periodMs = 0;
+    _anchorMs = 0;
+    _expectedMs = 0;
+    _baseMs = 0;
+    _baseCycles = 0;
+    _measuredMs = 0;
+    _enterState(POLL_LEARNING, 0);
+}
+
+bool PollScheduler::isDue(uint64_t nowMs) const {
+    if (!_hasPoll) return true;
+    return _diffMs(nowMs, _nextPollMs) >= 0;
+}
+
+void PollScheduler::onPollResult(uint64_t nowMs, bool dataChanged) {
+    // The first poll has nothing to compare against, so its window is unbounded
+    unsigned long windowMs = _hasPoll ? (unsigned long)(nowMs - _lastPollMs) : (unsigned long)-1;
+
+    if (!_hasPoll) {
+        _stateSinceMs = nowMs;
+    }
+    _hasPoll = true;
+    _lastPollMs = nowMs;
+
+    switch (_state) {
+        case POLL_LEARNING:
+            _onLearningResult(nowMs, windowMs, dataChanged);
+            break;
+        case POLL_LOCKED:
+            _onLockedResult(nowMs, windowMs, dataChanged);
+            break;
+        case POLL_FREE_RUNNING:
+            if (_diffMs(nowMs, _stateSinceMs) >= (long)POLL_RELEARN_AFTER_MS) {
+                _enterState(POLL_LEARNING, nowMs);
+                _nextPollMs = nowMs + POLL_LEARN_INTERVAL_MS;
+            } else {
+                _nextPollMs = nowMs + _minIntervalMs;
+            }
+            break;
+    }
+}
+
+void PollScheduler::onPollFailed(uint64_t nowMs) {
+    if (!_hasPoll) {
+        _stateSinceMs = nowMs;
+        _hasPoll = true;
+        _lastPollMs = nowMs;
+    }
+
+    // A gap in observations breaks any interval or bracket being measured
+    _hasLearnRef = false;
+    if (_state == POLL_LOCKED) {
+        _scheduleAligned(nowMs, false);
+    } else {
+        _nextPollMs = nowMs + _minIntervalMs;
+    }
+}
+
+uint64_t PollScheduler::getNextPollTime() const {
+    return _nextPollMs;
+}
+
+PollState PollScheduler::getState() const {
+    return _state;
+}
+
+unsigned long PollScheduler::getPeriodMs() const {
+    return (_state == POLL_LOCKED) ? _periodMs : 0;
+}
+
+void PollScheduler::_enterState(PollState state, uint64_t nowMs) {
+    _state = state;
+    _stateSinceMs = nowMs;
+    _hasLearnRef = false;
+    _learnFirstMs = 0;
+    _learnRefMs = 0;
+    _learnMinMs = 0;
+    _learnMaxMs = 0;
+    _learnSamples = 0;
+    _lockStep = LOCK_ALIGNED;
+    _cycles = 0;
+    _probes = 0;
+    _misses = 0;
+}
+
+void PollScheduler::_onLearningResult(uint64_t nowMs, unsigned long windowMs, bool dataChanged) {
+    if (dataChanged) {
+        if (windowMs <= 2UL * POLL_LEARN_INTERVAL_MS) {
+            // The update happened somewhere in the window; take its midpoint
+            uint64_t changeMs = nowMs - windowMs / 2;
+
+            if (_hasLearnRef) {
+                unsigned long intervalMs = (unsigned long)(changeMs - _learnRefMs);
+                if (_learnSamples == 0 || intervalMs < _learnMinMs) _learnMinMs = intervalMs;
+                if (_learnSamples == 0 || intervalMs > _learnMaxMs) _learnMaxMs = intervalMs;
+                _learnSamples++;
+            } else {
+                // Consecutive intervals only: restart the run
+                _learnFirstMs = changeMs;
+                _learnSamples = 0;
+            }
+            _learnRefMs = changeMs;
+            _hasLearnRef = true;
+        } else {
+            _hasLearnRef = false;
+        }
+    }
+
+    if (_learnSamples >= POLL_LEARN_SAMPLES) {
+        unsigned long meanMs = (unsigned long)((_learnRefMs - _learnFirstMs) / _learnSamples);
+        unsigned long spreadMs = _learnMaxMs - _learnMinMs;
+
+        // Each change is only bracketed to within one learning interval, so
+        // a regular feed shows at most about two intervals of spread
+        bool periodic = spreadMs <= 2UL * POLL_LEARN_INTERVAL_MS + meanMs / 10;
+        bool plausible = meanMs >= POLL_MIN_PERIOD_MS && meanMs <= POLL_MAX_PERIOD_MS;
+
+        if (periodic && plausible) {
+            uint64_t firstMs = _learnFirstMs;
+            uint64_t refMs = _learnRefMs;
+            unsigned long samples = (unsigned long)_learnSamples;
+
+            _enterState(POLL_LOCKED, nowMs);
+            _periodMs = meanMs;
+            _anchorMs = refMs;
+            _measuredMs = refMs;
+            _baseMs = firstMs;
+            _baseCycles = samples;
+
+            // The learned phase is coarse; bracket the very next update
+            _scheduleAligned(nowMs, true);
+        } else {
+            _enterState(POLL_FREE_RUNNING, nowMs);
+            _nextPollMs = nowMs + _minIntervalMs;
+        }
+        return;
+    }
+
+    if (_diffMs(nowMs, _stateSinceMs) >= (long)POLL_LEARN_TIMEOUT_MS) {
+        _enterState(POLL_FREE_RUNNING, nowMs);
+        _nextPollMs = nowMs + _minIntervalMs;
+        return;
+    }
+
+    _nextPollMs = nowMs + POLL_LEARN_INTERVAL_MS;
+}
+
+void PollScheduler::_onLockedResult(uint64_t nowMs, unsigned long windowMs, bool dataChanged) {
+    switch (_lockStep) {
+        case LOCK_PRE:
+            // Baseline for the bracket; the post poll compares against it
+            _lockStep = LOCK_POST;
+            _nextPollMs = _expectedMs + POLL_GUARD_MS;
+            return;
+
+        case LOCK_POST:
+        case LOCK_PROBE: {
+            if (dataChanged) {
+                // The update landed between the last two polls
+                uint64_t updateMs = nowMs - windowMs / 2;
+                int64_t errorMs = _diffMs(updateMs, _expectedMs);
+                bool settled = _registerMeasurement(updateMs);
+                _misses = 0;
+
+                // Keep bracketing until the model predicts within half a guard
+                bool onTarget = errorMs > -(long)POLL_GUARD_MS / 2 && errorMs < (long)POLL_GUARD_MS / 2;
+                _scheduleAligned(nowMs, !(onTarget && settled));
+                return;
+            }
+            if (_probes < POLL_MAX_PROBES) {
+                // Expected update has not landed yet; look again shortly
+                _lockStep = LOCK_PROBE;
+                _probes++;
+                _nextPollMs = nowMs + POLL_PROBE_STEP_MS;
+                return;
+            }
+
+            // The update came before the bracket opened: our phase is late
+            _misses++;
+            if (_misses >= POLL_MAX_MISSES) {
+                // Upstream cadence changed or stopped; measure it again
+                _enterState(POLL_LEARNING, nowMs);
+                _nextPollMs = nowMs + POLL_LEARN_INTERVAL_MS;
+                return;
+            }
+            _anchorMs = _expectedMs - 2ULL * POLL_GUARD_MS * (unsigned long)_misses;
+            _scheduleAligned(nowMs, true);
+            return;
+        }
+
+        default:
+            if (!dataChanged) {
+                // Aligned poll saw stale data: treat like a missed bracket
+                _lockStep = LOCK_PROBE;
+                _probes = 1;
+                _nextPollMs = nowMs + POLL_PROBE_STEP_MS;
+                return;
+            }
+            _cycles++;
+            _scheduleAligned(nowMs, (_cycles % POLL_VERIFY_EVERY) == 0);
+            return;
+    }
+}
+
+bool PollScheduler::_registerMeasurement(uint64_t updateMs) {
+    unsigned long previousPeriodMs = _periodMs;
+    uint64_t deltaMs = updateMs - _measuredMs;
+    uint64_t cycles = (deltaMs + _periodMs / 2) / _periodMs;
+
+    if (_diffMs(updateMs, _measuredMs) > 0 && cycles >= 1) {
+        // Period over the whole baseline: the error shrinks as it grows
+        _baseCycles += (unsigned long)cycles;
+        _periodMs = (unsigned long)((updateMs - _baseMs) / _baseCycles);
+    } else {
+        _baseMs = updateMs;
+        _baseCycles = 0;
+    }
+
+    _measuredMs = updateMs;
+    _anchorMs = updateMs;
+
+    // Settled once the period change would move the next aligned poll by
+    // only a fraction of the guard
+    unsigned long changeMs = (_periodMs > previousPeriodMs) ? _periodMs - previousPeriodMs
+                                                            : previousPeriodMs - _periodMs;
+    unsigned long cyclesPerPoll = _minIntervalMs / _periodMs + 1;
+    return changeMs * cyclesPerPoll < POLL_GUARD_MS / 4;
+}
+
+void PollScheduler::_scheduleAligned(uint64_t nowMs, bool verify) {
+    // Next expected update that leaves at least the minimum interval
+    uint64_t earliestMs = nowMs + _minIntervalMs;
+    int64_t untilEarliest = _diffMs(earliestMs - POLL_GUARD_MS, _anchorMs);
+
+    uint64_t cycles = 0;
+    if (untilEarliest > 0) {
+        cycles = ((uint64_t)untilEarliest + _periodMs - 1) / _periodMs;
+    }
+
+    _expectedMs = _anchorMs + cycles * _periodMs;
+    _probes = 0;
+
+    if (verify) {
+        _lockStep = LOCK_PRE;
+        _nextPollMs = _expectedMs - POLL_GUARD_MS;
+    } else {
+        _lockStep = LOCK_ALIGNED;
+        _nextPollMs = _expectedMs + POLL_GUARD_MS;
+    }
+}
@@ -0,0 +1,205 @@
+#include "postmortem.h"
+#include "fetch_phase.h"
+#include "log_ring.h"
+#include <stdio.h>
+#include <string.h>
+
+// FNV-1a parameters used for the checksums
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+static uint32_t _checksum(const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint32_t _headerChecksum(const PostmortemStore& store) {
+    return _checksum(&store, offsetof(PostmortemStore, headerChecksum));
+}
+
+static bool _recordValid(const PostmortemRecord& record) {
+    return record.checksum == _checksum(&record, offsetof(PostmortemRecord, checksum));
+}
+
+static bool _recordEmpty(const PostmortemRecord& record) {
+    return record.sequence == 0 && record.checksum == 0;
+}
+
+static bool _stateValid(const PostmortemState& state) {
+    return state.checksum == _checksum(&state, offsetof(PostmortemState, checksum));
+}
+
+/**
+ * Copy a string into a fixed field, always terminated
+ */
+static void _copyField(char* field, size_t size, const char* text) {
+    strncpy(field, text != nullptr ? text : "", size - 1);
+    field[size - 1] = '\0';
+}
+
+PostmortemLog::PostmortemLog(PostmortemStore* store)
+    : _store(store), _hasPrevious(false), _corrupt(0) {
+    memset(&_previous, 0, sizeof(_previous));
+}
+
+bool PostmortemLog::begin(const char* resetReason, uint64_t nowMs) {
+    bool valid = _store->magic == POSTMORTEM_MAGIC && _store->headerChecksum == _headerChecksum(*_store);
+    _corrupt = 0;
+
+    if (valid) {
+        _hasPrevious = _stateValid(_store->state);
+        if (_hasPrevious) {
+            _previous = _store->state;
+        }
+
+        // The last intact record tells us where to continue
+        uint32_t last = 0;
+        for (int i = 0; i < POSTMORTEM_RECORDS; i++) {
+            const PostmortemRecord& record = _store->records[i];
+            if (_recordEmpty(record)) continue;
+            if (!_recordValid(record)) {
+                _corrupt++;
+            } else if (record.sequence > last) {
+                last = record.sequence;
+            }
+        }
+        _store->nextSequence = last + 1;
+    } else {
+        // Cold boot: RTC memory holds garbage
+        memset(_store, 0, sizeof(*_store));
+        _store->magic = POSTMORTEM_MAGIC;
+        _store->nextSequence = 1;
+        _hasPrevious = false;
+    }
+
+    _store->bootCount++;
+    _store->headerChecksum = _headerChecksum(*_store);
+
+    memset(&_store->state, 0, sizeof(_store->state));
+    _store->state.phase = FETCH_PHASE_IDLE;
+    _store->state.uptimeMs = (uint32_t)nowMs;
+    _store->state.phaseSinceMs = (uint32_t)nowMs;
+    _sealState();
+
+    char text[POSTMORTEM_TEXT_SIZE];
+    snprintf(text, sizeof(text), "boot %lu, reset: %s", (unsigned long)_store->bootCount,
+             resetReason != nullptr ? resetReason : "unknown");
+    _add(POSTMORTEM_KIND_BOOT, 0, "BOOT", text, nowMs);
+    return valid;
+}
+
+void PostmortemLog::addLog(uint8_t level, const char* tag, const char* text, uint64_t nowMs) {
+    _add(POSTMORTEM_KIND_LOG, level, tag, text, nowMs);
+}
+
+void PostmortemLog::addSample(uint32_t freeHeap, uint32_t minFreeHeap, bool wifiConnected, int rssi,
+                              uint64_t nowMs) {
+    PostmortemState& state = _store->state;
+    state.uptimeMs = (uint32_t)nowMs;
+    state.freeHeap = freeHeap;
+    state.minFreeHeap = minFreeHeap;
+    state.wifiConnected = wifiConnected ? 1 : 0;
+    state.rssi = (int8_t)(wifiConnected ? rssi : 0);
+    _sealState();
+
+    char text[POSTMORTEM_TEXT_SIZE];
+    if (wifiConnected) {
+        snprintf(text, sizeof(text), "heap %lu min %lu wifi %d dBm",
+                 (unsigned long)freeHeap, (unsigned long)minFreeHeap, rssi);
+    } else {
+        snprintf(text, sizeof(text), "heap %lu min %lu wifi down",
+                 (unsigned long)freeHeap, (unsigned long)minFreeHeap);
+    }
+    _add(POSTMORTEM_KIND_SAMPLE, 0, "HEALTH", text, nowMs);
+}
+
+void PostmortemLog::setPhase(uint8_t phase, uint64_t nowMs) {
+    PostmortemState& state = _store->state;
+    state.phase = phase;
+    state.phaseSinceMs = (uint32_t)nowMs;
+    state.uptimeMs = (uint32_t)nowMs;
+    _sealState();
+}
+
+uint32_t PostmortemLog::getBootCount() const {
+    return _store->bootCount;
+}
+
+bool PostmortemLog::hasPreviousState() const {
+    return _hasPrevious;
+}
+
+const PostmortemState& PostmortemLog::getPreviousState() const {
+    return _previous;
+}
+
+int PostmortemLog::getCorruptCount() const {
+    return _corrupt;
+}
+
+void PostmortemLog::formatDump(BufferWriter& out) const {
+    out.printf("boot %lu, %d corrupt records dropped\n", (unsigned long)_store->bootCount, _corrupt);
+
+    if (_hasPrevious) {
+        const PostmortemState& state = _previous;
+        out.printf("previous run: phase %s for %lu ms at uptime %lu ms, heap %lu (min %lu), ",
+                   fetchPhaseName(state.phase), (unsigned long)(state.uptimeMs - state.phaseSinceMs),
+                   (unsigned long)state.uptimeMs, (unsigned long)state.freeHeap,
+                   (unsigned long)state.minFreeHeap);
+        if (state.wifiConnected) {
+            out.printf("wifi %d dBm\n", state.rssi);
+        } else {
+            out.print("wifi down\n");
+        }
+    } else {
+        out.print("previous run: no state (cold boot)\n");
+    }
+
+    uint32_t next = _store->nextSequence;
+    uint32_t first = next > POSTMORTEM_RECORDS ? next - POSTMORTEM_RECORDS : 1;
+    for (uint32_t sequence = first; sequence < next; sequence++) {
+        const PostmortemRecord* record = _find(sequence);
+        if (record == nullptr) continue;
+
+        char kind;
+        switch (record->kind) {
+            case POSTMORTEM_KIND_SAMPLE: kind = 'S'; break;
+            case POSTMORTEM_KIND_BOOT: kind = 'B'; break;
+            default: kind = logLevelLetter(record->level); break;
+        }
+        out.printf("#%lu b%lu %lu.%03lu %c [%s] %s\n",
+                   (unsigned long)record->sequence, (unsigned long)record->boot,
+                   (unsigned long)(record->uptimeMs / 1000), (unsigned long)(record->uptimeMs % 1000),
+                   kind, record->tag, record->text);
+    }
+}
+
+void PostmortemLog::_add(uint8_t kind, uint8_t level, const char* tag, const char* text, uint64_t nowMs) {
+    uint32_t sequence = __atomic_fetch_add(&_store->nextSequence, 1, __ATOMIC_RELAXED);
+    PostmortemRecord& record = _store->records[sequence % POSTMORTEM_RECORDS];
+
+    record.sequence = sequence;
+    record.boot = _store->bootCount;
+    record.uptimeMs = (uint32_t)nowMs;
+    record.kind = kind;
+    record.level = level;
+    _copyField(record.tag, sizeof(record.tag), tag);
+    _copyField(record.text, sizeof(record.text), text);
+    record.checksum = _checksum(&record, offsetof(PostmortemRecord, checksum));
+}
+
+const PostmortemRecord* PostmortemLog::_find(uint32_t sequence) const {
+    const PostmortemRecord& record = _store->records[sequence % POSTMORTEM_RECORDS];
+    if (record.sequence != sequence || !_recordValid(record)) return nullptr;
+    return &record;
+}
+
+void PostmortemLog::_sealState() {
+    PostmortemState& state = _store->state;
+    state.checksum = _checksum(&state, offsetof(PostmortemState, checksum));
+}
@@ -0,0 +1,117 @@
+#include "power_schedule.h"
+
+ServiceSchedule::ServiceSchedule(const ServiceHours hours[7], uint32_t leadSec, uint32_t tailSec)
+    : _leadSec(leadSec), _tailSec(tailSec) {
+    for (int i = 0; i < 7; i++) {
+        _hours[i] = hours[i];
+    }
+}
+
+bool ServiceSchedule::_inDay(uint8_t weekday, uint32_t secOfDay) const {
+    // Windows can start the evening before (lead) or end the morning after
+    for (int offset = -1; offset <= 1; offset++) {
+        const ServiceHours& hours = _hours[(weekday + 7 - offset) % 7];
+        if (hours.closeSec <= hours.openSec) continue;  // No service that day
+
+        int64_t sec = (int64_t)secOfDay + (int64_t)offset * POWER_DAY_SEC;
+        if (sec >= (int64_t)hours.openSec - _leadSec && sec < (int64_t)hours.closeSec + _tailSec) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ServiceSchedule::isInService(uint8_t weekday, uint32_t secOfDay) const {
+    return _inDay(weekday % 7, secOfDay);
+}
+
+uint32_t ServiceSchedule::secondsUntilService(uint8_t weekday, uint32_t secOfDay) const {
+    weekday %= 7;
+    if (_inDay(weekday, secOfDay)) return 0;
+
+    // Earliest window starting after now, over the next week
+    int64_t best = 7 * (int64_t)POWER_DAY_SEC;
+    for (int days = 0; days <= 7; days++) {
+        const ServiceHours& hours = _hours[(weekday + days) % 7];
+        if (hours.closeSec <= hours.openSec) continue;
+
+        int64_t wait = (int64_t)days * POWER_DAY_SEC + hours.openSec - _leadSec - secOfDay;
+        if (wait > 0 && wait < best) best = wait;
+    }
+    return (uint32_t)best;
+}
+
+uint16_t frameDutyPermille(const FrameBuffer& frame) {
+    uint64_t sum = 0;
+    for (int y = 0; y < frame.getHeight(); y++) {
+        for (int x = 0; x < frame.getWidth(); x++) {
+            uint16_t color = frame.getPixel(x, y);
+            // Each channel's share of full scale, out of 31 * 63 (5 and 6 bits)
+            sum += (uint32_t)((color >> 11) & 0x1F) * 63 + (uint32_t)((color >> 5) & 0x3F) * 31 +
+                   (uint32_t)(color & 0x1F) * 63;
+        }
+    }
+    uint64_t full = (uint64_t)frame.getWidth() * frame.getHeight() * 3 * 31 * 63;
+    return full > 0 ? (uint16_t)(sum * 1000 / full) : 0;
+}
+
+uint32_t estimatePowerMw(const PowerModel& model, uint16_t dutyPermille, bool closed) {
+    if (dutyPermille > 1000) dutyPermille = 1000;
+    uint32_t board = closed ? model.boardClosedMw : model.boardMw;
+    return board + model.panelIdleMw + (uint32_t)((uint64_t)model.fullWhiteMw * dutyPermille / 1000);
+}
+
+PowerLedger::PowerLedger()
+    : _today(), _yesterday(), _totalEnergyMj(0), _lastUpdateMs(0), _energyRemainder(0),
+      _closedRemainderMs(0), _dayStartCalls(0), _day(-1), _started(false) {}
+
+bool PowerLedger::update(uint64_t nowMs, uint32_t milliwatts, bool closed, unsigned long apiCallTotal, long day) {
+    if (!_started) {
+        _started = true;
+        _lastUpdateMs = nowMs;
+        _dayStartCalls = apiCallTotal;
+        _day = day;
+        return false;
+    }
+
+    // The time since the last update belongs to the day it was spent in
+    uint64_t elapsedMs = nowMs - _lastUpdateMs;
+    _lastUpdateMs = nowMs;
+
+    uint64_t microjoules = (uint64_t)milliwatts * elapsedMs + _energyRemainder;
+    _today.energyMj += microjoules / 1000;
+    _totalEnergyMj += microjoules / 1000;
+    _energyRemainder = (uint32_t)(microjoules % 1000);
+
+    if (closed) {
+        uint64_t closedMs = elapsedMs + _closedRemainderMs;
+        _today.closedSec += (uint32_t)(closedMs / 1000);
+        _closedRemainderMs = (uint32_t)(closedMs % 1000);
+    }
+    _today.apiCalls = apiCallTotal - _dayStartCalls;
+
+    if (day == _day || day < 0) return false;
+    if (_day < 0) {
+        // The clock was just set: boot so far counts as today
+        _day = day;
+        return false;
+    }
+
+    _yesterday = _today;
+    _today = PowerDay();
+    _dayStartCalls = apiCallTotal;
+    _day = day;
+    return true;
+}
+
+const PowerDay& PowerLedger::getToday() const {
+    return _today;
+}
+
+const PowerDay& PowerLedger::getYesterday() const {
+    return _yesterday;
+}
+
+uint64_t PowerLedger::getTotalEnergyMj() const {
+    return _totalEnergyMj;
+}
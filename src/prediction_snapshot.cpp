@@ -0,0 +1,169 @@
+#include "prediction_snapshot.h"
+#include <string.h>
+
+// Header and record sizes of the version 1 format
+static const size_t HEADER_SIZE = 31;
+static const size_t TRAIN_RECORD_SIZE = 13;
+static const size_t CHECKSUM_SIZE = 4;
+
+// FNV-1a parameters used for the checksum
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+static uint32_t _checksum(const uint8_t* data, size_t length) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static void _putU32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t _getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Copy a string into a fixed-width, null-padded field
+ */
+static void _putField(uint8_t* p, const char* str, size_t width) {
+    size_t length = strnlen(str, width);
+    memcpy(p, str, length);
+    memset(p + length, 0, width - length);
+}
+
+/**
+ * Read a fixed-width, null-padded field into a terminated string
+ */
+static void _getField(const uint8_t* p, size_t width, char* out) {
+    memcpy(out, p, width);
+    out[width] = '\0';
+}
+
+size_t encodeSnapshot(const PredictionSnapshot& snapshot, uint8_t* buffer, size_t bufferSize) {
+    int trainCount = snapshot.trainCount;
+    if (trainCount < 0) trainCount = 0;
+    if (trainCount > SNAPSHOT_MAX_TRAINS) trainCount = SNAPSHOT_MAX_TRAINS;
+
+    size_t fixedSize = HEADER_SIZE + (size_t)trainCount * TRAIN_RECORD_SIZE + CHECKSUM_SIZE;
+    if (bufferSize > SNAPSHOT_MAX_SIZE) bufferSize = SNAPSHOT_MAX_SIZE;
+    if (bufferSize < fixedSize) return 0;
+
+    uint8_t* p = buffer;
+    p[0] = 'W';
+    p[1] = 'M';
+    p[2] = SNAPSHOT_VERSION;
+    p[3] = snapshot.flags & ~SNAPSHOT_FLAG_TRUNCATED;
+    _putU32(p + 4, snapshot.leaderId);
+    _putU32(p + 8, snapshot.sequence);
+    _putU32(p + 12, snapshot.responseHash);
+    _putU32(p + 16, snapshot.ageMs);
+    _putField(p + 20, snapshot.station, SNAPSHOT_STATION_LEN);
+    p[28] = snapshot.stationLines;
+    p[29] = (uint8_t)trainCount;
+    p += HEADER_SIZE;
+
+    for (int i = 0; i < trainCount; i++) {
+        const TrainObservation& train = snapshot.trains[i];
+        _putField(p, train.line, LINE_MAX_LEN - 1);
+        _putField(p + 2, train.destination, DEST_MAX_LEN - 1);
+        p[6] = train.group;
+        p[7] = train.cars;
+        p[8] = train.status;
+        _putU32(p + 9, (uint32_t)(int32_t)train.etaMs);
+        p += TRAIN_RECORD_SIZE;
+    }
+
+    // Incidents are variable length; keep whole ones that fit
+    uint8_t incidentCount = 0;
+    uint8_t* end = buffer + bufferSize - CHECKSUM_SIZE;
+    for (int i = 0; i < snapshot.incidents.getCount(); i++) {
+        const RailIncident& incident = snapshot.incidents.get(i);
+        size_t typeLength = strnlen(incident.type, INCIDENT_TYPE_MAX_LEN - 1);
+        size_t textLength = strnlen(incident.description, INCIDENT_TEXT_MAX_LEN - 1);
+        size_t recordSize = 3 + typeLength + textLength;
+
+        if ((size_t)(end - p) < recordSize) {
+            buffer[3] |= SNAPSHOT_FLAG_TRUNCATED;
+            break;
+        }
+        *p++ = incident.lines;
+        *p++ = (uint8_t)typeLength;
+        memcpy(p, incident.type, typeLength);
+        p += typeLength;
+        *p++ = (uint8_t)textLength;
+        memcpy(p, incident.description, textLength);
+        p += textLength;
+        incidentCount++;
+    }
+    buffer[30] = incidentCount;
+
+    size_t length = (size_t)(p - buffer);
+    _putU32(p, _checksum(buffer, length));
+    return length + CHECKSUM_SIZE;
+}
+
+bool decodeSnapshot(const uint8_t* data, size_t length, PredictionSnapshot& snapshot) {
+    if (length < HEADER_SIZE + CHECKSUM_SIZE || length > SNAPSHOT_MAX_SIZE) return false;
+    if (data[0] != 'W' || data[1] != 'M' || data[2] != SNAPSHOT_VERSION) return false;
+
+    size_t bodyLength = length - CHECKSUM_SIZE;
+    if (_getU32(data + bodyLength) != _checksum(data, bodyLength)) return false;
+
+    int trainCount = data[29];
+    int incidentCount = data[30];
+    if (trainCount > SNAPSHOT_MAX_TRAINS || incidentCount > MAX_INCIDENTS) return false;
+    if (HEADER_SIZE + (size_t)trainCount * TRAIN_RECORD_SIZE > bodyLength) return false;
+
+    snapshot.flags = data[3];
+    snapshot.leaderId = _getU32(data + 4);
+    snapshot.sequence = _getU32(data + 8);
+    snapshot.responseHash = _getU32(data + 12);
+    snapshot.ageMs = _getU32(data + 16);
+    _getField(data + 20, SNAPSHOT_STATION_LEN - 1, snapshot.station);
+    snapshot.stationLines = data[28];
+    snapshot.trainCount = trainCount;
+
+    const uint8_t* p = data + HEADER_SIZE;
+    for (int i = 0; i < trainCount; i++) {
+        TrainObservation& train = snapshot.trains[i];
+        _getField(p, LINE_MAX_LEN - 1, train.line);
+        _getField(p + 2, DEST_MAX_LEN - 1, train.destination);
+        train.group = p[6];
+        train.cars = p[7];
+        train.status = p[8];
+        train.etaMs = (long)(int32_t)_getU32(p + 9);
+        p += TRAIN_RECORD_SIZE;
+    }
+
+    const uint8_t* end = data + bodyLength;
+    snapshot.incidents.reset();
+    for (int i = 0; i < incidentCount; i++) {
+        char type[INCIDENT_TYPE_MAX_LEN];
+        char text[INCIDENT_TEXT_MAX_LEN];
+
+        if (end - p < 2) return false;
+        uint8_t lines = *p++;
+        size_t typeLength = *p++;
+        if (typeLength >= sizeof(type) || (size_t)(end - p) < typeLength + 1) return false;
+        memcpy(type, p, typeLength);
+        type[typeLength] = '\0';
+        p += typeLength;
+
+        size_t textLength = *p++;
+        if (textLength >= sizeof(text) || (size_t)(end - p) < textLength) return false;
+        memcpy(text, p, textLength);
+        text[textLength] = '\0';
+        p += textLength;
+
+        snapshot.incidents.add(lines, type, text);
+    }
+    return p == end;
+}
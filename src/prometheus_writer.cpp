@@ -0,0 +1,78 @@
+#include "prometheus_writer.h"
+#include <math.h>
+
+PrometheusWriter::PrometheusWriter(BufferWriter& out) : _out(out) {}
+
+void PrometheusWriter::family(const char* name, const char* type, const char* help) {
+    _out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void PrometheusWriter::sample(const char* name, double value) {
+    _out.print(name);
+    _out.print(" ");
+    _printValue(value);
+    _out.print("\n");
+}
+
+void PrometheusWriter::sample(const char* name, const char* label, const char* labelValue, double value) {
+    _out.printf("%s{%s=\"", name, label);
+    _printLabelValue(labelValue);
+    _out.print("\"} ");
+    _printValue(value);
+    _out.print("\n");
+}
+
+void PrometheusWriter::counter(const char* name, const char* help, double value) {
+    family(name, "counter", help);
+    sample(name, value);
+}
+
+void PrometheusWriter::gauge(const char* name, const char* help, double value) {
+    family(name, "gauge", help);
+    sample(name, value);
+}
+
+void PrometheusWriter::histogram(const char* name, const char* help, const LatencyHistogram& histogram) {
+    family(name, "histogram", help);
+
+    // Prometheus buckets are cumulative: each counts every sample at or below its bound
+    unsigned long cumulative = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        cumulative += histogram.getBucketCount(i);
+        unsigned long boundMs = LatencyHistogram::getBucketBound(i);
+        _out.printf("%s_bucket{le=\"%lu.%03lu\"} %lu\n", name, boundMs / 1000, boundMs % 1000, cumulative);
+    }
+    _out.printf("%s_bucket{le=\"+Inf\"} %lu\n", name, histogram.getCount());
+
+    uint64_t sumMs = histogram.getSumMs();
+    _out.printf("%s_sum %lu.%03u\n", name, (unsigned long)(sumMs / 1000), (unsigned)(sumMs % 1000));
+    _out.printf("%s_count %lu\n", name, histogram.getCount());
+}
+
+void PrometheusWriter::_printValue(double value) {
+    if (isnan(value)) {
+        _out.print("NaN");
+    } else if (isinf(value)) {
+        _out.print(value > 0 ? "+Inf" : "-Inf");
+    } else if (value == floor(value) && fabs(value) < 1e15) {
+        // Counters and most gauges are whole numbers; skip the exponent form
+        _out.printf("%.0f", value);
+    } else {
+        _out.printf("%g", value);
+    }
+}
+
+void PrometheusWriter::_printLabelValue(const char* value) {
+    for (const char* p = value; *p; p++) {
+        if (*p == '\\') {
+            _out.print("\\\\");
+        } else if (*p == '"') {
+            _out.print("\\\"");
+        } else if (*p == '\n') {
+            _out.print("\\n");
+        } else {
+            char c[2] = {*p, '\0'};
+            _out.print(c);
+        }
+    }
+}
@@ -0,0 +1,182 @@
+#include "rail_incidents.h"
+#include <string.h>
+
+/**
+ * Line codes in mask bit order
+ */
+static const char* const LINE_CODES[] = {"RD", "BL", "OR", "GR", "YL", "SV"};
+static const int LINE_CODE_COUNT = sizeof(LINE_CODES) / sizeof(LINE_CODES[0]);
+
+/**
+ * Separator between incidents in the advisory text
+ */
+static const char* ADVISORY_SEPARATOR = "   ";
+
+/**
+ * Copy a string into a fixed field, truncating and terminating
+ */
+static void _copyField(char* dest, const char* src, size_t size) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+/**
+ * Append a string to a buffer at pos, stopping at the end of the buffer
+ */
+static size_t _append(char* buffer, size_t bufferSize, size_t pos, const char* str) {
+    while (*str && pos + 1 < bufferSize) {
+        buffer[pos++] = *str++;
+    }
+    buffer[pos] = '\0';
+    return pos;
+}
+
+uint8_t lineMaskFromCode(const char* code) {
+    if (code == nullptr || code[0] == '\0' || code[1] == '\0') return 0;
+
+    for (int i = 0; i < LINE_CODE_COUNT; i++) {
+        if (code[0] == LINE_CODES[i][0] && code[1] == LINE_CODES[i][1]) {
+            return (uint8_t)(1 << i);
+        }
+    }
+    return 0;
+}
+
+uint8_t parseLineList(const char* text) {
+    uint8_t mask = 0;
+    if (text == nullptr) return mask;
+
+    while (*text) {
+        // Skip separators, then read one code
+        if (*text == ';' || *text == ' ' || *text == ',') {
+            text++;
+            continue;
+        }
+        mask |= lineMaskFromCode(text);
+        while (*text && *text != ';' && *text != ',') {
+            text++;
+        }
+    }
+    return mask;
+}
+
+size_t formatLineMask(uint8_t mask, char* buffer, size_t bufferSize) {
+    if (bufferSize == 0) return 0;
+    buffer[0] = '\0';
+
+    size_t pos = 0;
+    for (int i = 0; i < LINE_CODE_COUNT; i++) {
+        if (!(mask & (1 << i))) continue;
+        if (pos > 0) pos = _append(buffer, bufferSize, pos, "/");
+        pos = _append(buffer, bufferSize, pos, LINE_CODES[i]);
+    }
+    return pos;
+}
+
+const char* jsonFindArray(const char* json, const char* key) {
+    if (json == nullptr || key == nullptr) return nullptr;
+
+    size_t keyLen = strlen(key);
+    const char* p = json;
+    while ((p = strchr(p, '"')) != nullptr) {
+        if (strncmp(p + 1, key, keyLen) == 0 && p[keyLen + 1] == '"') {
+            const char* q = p + keyLen + 2;
+            while (*q == ' ' || *q == '\t' || *q == '\r' || *q == '\n') q++;
+            if (*q == ':') {
+                q++;
+                while (*q == ' ' || *q == '\t' || *q == '\r' || *q == '\n') q++;
+                if (*q == '[') return q + 1;
+            }
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+bool jsonNextObject(const char*& cursor, const char* end, const char*& objectStart, size_t& objectLen) {
+    const char* p = cursor;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',')) {
+        p++;
+    }
+    if (p >= end || *p != '{') {
+        cursor = p;
+        return false;
+    }
+
+    const char* start = p;
+    int depth = 0;
+    bool inString = false;
+    while (p < end) {
+        char c = *p++;
+        if (inString) {
+            if (c == '\\') {
+                p++;  // Skip the escaped character
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+            if (depth == 0) {
+                objectStart = start;
+                objectLen = (size_t)(p - start);
+                cursor = p;
+                return true;
+            }
+        }
+    }
+
+    // Ran out of text inside the element: treat as the end of the array
+    cursor = end;
+    return false;
+}
+
+IncidentList::IncidentList() {
+    reset();
+}
+
+void IncidentList::reset() {
+    _count = 0;
+}
+
+bool IncidentList::add(uint8_t lines, const char* type, const char* description) {
+    if (_count >= MAX_INCIDENTS) return false;
+
+    RailIncident& incident = _incidents[_count++];
+    incident.lines = lines;
+    _copyField(incident.type, type ? type : "", INCIDENT_TYPE_MAX_LEN);
+    _copyField(incident.description, description ? description : "", INCIDENT_TEXT_MAX_LEN);
+    return true;
+}
+
+int IncidentList::getCount() const {
+    return _count;
+}
+
+const RailIncident& IncidentList::get(int index) const {
+    if (index < 0) index = 0;
+    if (index >= MAX_INCIDENTS) index = MAX_INCIDENTS - 1;
+    return _incidents[index];
+}
+
+size_t IncidentList::formatAdvisory(char* buffer, size_t bufferSize) const {
+    if (bufferSize == 0) return 0;
+    buffer[0] = '\0';
+
+    size_t pos = 0;
+    for (int i = 0; i < _count; i++) {
+        char lines[24];
+        formatLineMask(_incidents[i].lines, lines, sizeof(lines));
+
+        if (i > 0) pos = _append(buffer, bufferSize, pos, ADVISORY_SEPARATOR);
+        if (lines[0] != '\0') {
+            pos = _append(buffer, bufferSize, pos, lines);
+            pos = _append(buffer, bufferSize, pos, ": ");
+        }
+        pos = _append(buffer, bufferSize, pos, _incidents[i].description);
+    }
+    return pos;
+}
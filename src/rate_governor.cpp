@@ -0,0 +1,170 @@
+#include "rate_governor.h"
+
+/**
+ * Token amounts are kept in thousandths so refill needs no floating point
+ */
+static const unsigned long MILLI = 1000;
+static const unsigned long MINUTE_MS = 60000;
+
+RateGovernor::RateGovernor(unsigned long dailyBudget) : _dailyBudget(dailyBudget) {
+    _started = false;
+    _startMs = 0;
+    _tokensMilli = RATE_BURST * MILLI;
+    _refillMs = 0;
+    _dayStartMs = 0;
+    _dayCount = 0;
+    for (int i = 0; i < RATE_HISTORY_MINUTES; i++) {
+        _minuteCounts[i] = 0;
+    }
+    _minuteStartMs = 0;
+    _minuteIndex = 0;
+    _hourCount = 0;
+    _allowed = 0;
+    _throttled = 0;
+    _deferred = 0;
+    _rateLimited = 0;
+    _hasDeferredPoll = false;
+    _deferredPollMs = 0;
+}
+
+bool RateGovernor::tryAcquire(RequestPriority priority, uint64_t nowMs) {
+    _advance(nowMs);
+
+    if (_tokensMilli < _reserveMilli(priority) + MILLI) {
+        _throttled++;
+        return false;
+    }
+
+    _tokensMilli -= MILLI;
+    _allowed++;
+    _dayCount++;
+    _hourCount++;
+    _minuteCounts[_minuteIndex]++;
+    return true;
+}
+
+unsigned long RateGovernor::getWaitMs(RequestPriority priority, uint64_t nowMs) {
+    _advance(nowMs);
+
+    unsigned long neededMilli = _reserveMilli(priority) + MILLI;
+    if (_tokensMilli >= neededMilli) return 0;
+
+    // Refill adds RATE_TOKENS_PER_SEC thousandths of a token per ms
+    return (neededMilli - _tokensMilli + RATE_TOKENS_PER_SEC - 1) / RATE_TOKENS_PER_SEC;
+}
+
+void RateGovernor::onRateLimited(uint64_t nowMs) {
+    _advance(nowMs);
+    _tokensMilli = 0;
+    _rateLimited++;
+}
+
+unsigned int RateGovernor::getStretchPercent(uint64_t nowMs) {
+    _advance(nowMs);
+
+    // Too little history for a meaningful rate
+    uint64_t coveredMs = nowMs - _startMs;
+    if (coveredMs < MINUTE_MS) return 100;
+    if (coveredMs > (uint64_t)RATE_HISTORY_MINUTES * MINUTE_MS) {
+        coveredMs = (uint64_t)RATE_HISTORY_MINUTES * MINUTE_MS;
+    }
+
+    // Requests left in the day at the recent rate
+    unsigned long remainingMs = RATE_DAY_MS - (unsigned long)(nowMs - _dayStartMs);
+    uint64_t projected = (uint64_t)_hourCount * remainingMs / coveredMs;
+
+    if (_dayCount + projected <= _dailyBudget) return 100;
+    if (_dayCount >= _dailyBudget) return RATE_MAX_STRETCH_PERCENT;
+
+    uint64_t stretch = projected * 100 / (_dailyBudget - _dayCount);
+    if (stretch < 100) return 100;
+    if (stretch > RATE_MAX_STRETCH_PERCENT) return RATE_MAX_STRETCH_PERCENT;
+    return (unsigned int)stretch;
+}
+
+unsigned long RateGovernor::stretchInterval(unsigned long intervalMs, uint64_t nowMs) {
+    return (unsigned long)((uint64_t)intervalMs * getStretchPercent(nowMs) / 100);
+}
+
+bool RateGovernor::shouldDefer(uint64_t lastPollMs, unsigned long intervalMs, uint64_t nowMs) {
+    // On budget, the caller's own schedule stands (it may poll faster than intervalMs)
+    unsigned int stretch = getStretchPercent(nowMs);
+    if (stretch <= 100) return false;
+    if (nowMs - lastPollMs >= (uint64_t)intervalMs * stretch / 100) return false;
+
+    if (!_hasDeferredPoll || _deferredPollMs != lastPollMs) {
+        _hasDeferredPoll = true;
+        _deferredPollMs = lastPollMs;
+        _deferred++;
+    }
+    return true;
+}
+
+unsigned long RateGovernor::getAllowedCount() const {
+    return _allowed;
+}
+
+unsigned long RateGovernor::getThrottledCount() const {
+    return _throttled;
+}
+
+unsigned long RateGovernor::getDeferredCount() const {
+    return _deferred;
+}
+
+unsigned long RateGovernor::getRateLimitedCount() const {
+    return _rateLimited;
+}
+
+unsigned long RateGovernor::getDailyCount() const {
+    return _dayCount;
+}
+
+unsigned long RateGovernor::getDailyBudget() const {
+    return _dailyBudget;
+}
+
+void RateGovernor::_advance(uint64_t nowMs) {
+    if (!_started) {
+        _started = true;
+        _startMs = nowMs;
+        _refillMs = nowMs;
+        _dayStartMs = nowMs;
+        _minuteStartMs = nowMs;
+        return;
+    }
+
+    // Refill, capping the elapsed time so the product can't overflow
+    uint64_t elapsedMs = nowMs - _refillMs;
+    unsigned long fullMs = RATE_BURST * MILLI / RATE_TOKENS_PER_SEC;
+    if (elapsedMs > fullMs) elapsedMs = fullMs;
+    _tokensMilli += (unsigned long)elapsedMs * RATE_TOKENS_PER_SEC;
+    if (_tokensMilli > RATE_BURST * MILLI) _tokensMilli = RATE_BURST * MILLI;
+    _refillMs = nowMs;
+
+    // Start a new quota day
+    while (nowMs - _dayStartMs >= RATE_DAY_MS) {
+        _dayStartMs += RATE_DAY_MS;
+        _dayCount = 0;
+    }
+
+    // Rotate the per-minute history
+    if (nowMs - _minuteStartMs >= (uint64_t)RATE_HISTORY_MINUTES * MINUTE_MS) {
+        for (int i = 0; i < RATE_HISTORY_MINUTES; i++) {
+            _minuteCounts[i] = 0;
+        }
+        _hourCount = 0;
+        _minuteStartMs = nowMs;
+        return;
+    }
+    while (nowMs - _minuteStartMs >= MINUTE_MS) {
+        _minuteStartMs += MINUTE_MS;
+        _minuteIndex = (_minuteIndex + 1) % RATE_HISTORY_MINUTES;
+        _hourCount -= _minuteCounts[_minuteIndex];
+        _minuteCounts[_minuteIndex] = 0;
+    }
+}
+
+unsigned long RateGovernor::_reserveMilli(RequestPriority priority) const {
+    return (priority == PRIORITY_HIGH) ? 0 : RATE_HIGH_PRIORITY_RESERVE * MILLI;
+}
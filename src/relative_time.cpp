@@ -1,8 +1,8 @@
 #include "relative_time.h"
 #include <stdio.h>
 
-void getRelativeTimeComponents(unsigned long elapsedMs, int& value, char& unit) {
-    unsigned long elapsedSec = elapsedMs / 1000;
+void getRelativeTimeComponents(uint64_t elapsedMs, int& value, char& unit) {
+    uint64_t elapsedSec = elapsedMs / 1000;
     
     // If less than 90 seconds, show in seconds
     if (elapsedSec < 90) {
@@ -15,18 +15,15 @@ void getRelativeTimeComponents(unsigned long elapsedMs, int& value, char& unit)
         }
     } else {
         // Convert to minutes
-        unsigned long elapsedMin = elapsedSec / 60;
-        value = (int)elapsedMin;
+        uint64_t elapsedMin = elapsedSec / 60;
         unit = 'm';
         
-        // Cap at 99 minutes
-        if (value > 99) {
-            value = 99;
-        }
+        // Cap at 99 minutes (before narrowing, so weeks don't overflow int)
+        value = elapsedMin > 99 ? 99 : (int)elapsedMin;
     }
 }
 
-void formatRelativeTime(unsigned long elapsedMs, char* buffer, size_t bufferSize) {
+void formatRelativeTime(uint64_t elapsedMs, char* buffer, size_t bufferSize) {
     if (buffer == nullptr || bufferSize < 2) {
         return;
     }
@@ -0,0 +1,94 @@
+#include "schedule_table.h"
+#include <string.h>
+
+uint8_t scheduleDayType(int weekday) {
+    if (weekday == 0) return SCHEDULE_SUNDAY;
+    if (weekday == 6) return SCHEDULE_SATURDAY;
+    return SCHEDULE_WEEKDAY;
+}
+
+Schedule::Schedule(const ScheduleTable& table) : _table(table) {}
+
+int Schedule::findNext(int weekday, uint32_t nowSec, uint8_t group, ScheduledDeparture* departures, int maxCount) const {
+    if (departures == nullptr || maxCount <= 0) return 0;
+
+    // Yesterday's trips still running after midnight, then today's
+    int yesterday = (weekday + 6) % 7;
+    int count = _findInDay(scheduleDayType(yesterday), nowSec + SCHEDULE_DAY_SEC, -(long)SCHEDULE_DAY_SEC,
+                           group, departures, 0, maxCount);
+    return _findInDay(scheduleDayType(weekday), nowSec, 0, group, departures, count, maxCount);
+}
+
+bool Schedule::isEmpty() const {
+    for (int i = 0; i < SCHEDULE_DAY_TYPES; i++) {
+        if (_table.days[i].departureCount > 0) return false;
+    }
+    return true;
+}
+
+int Schedule::_findInDay(uint8_t dayType, uint32_t fromSec, long shiftSec, uint8_t group,
+                         ScheduledDeparture* departures, int count, int maxCount) const {
+    const ScheduleDay& day = _table.days[dayType];
+    if (day.blockCount == 0) return count;
+
+    // Last block starting at or before fromSec
+    int low = 0;
+    int high = day.blockCount;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (day.blocks[mid].firstSec <= fromSec) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    uint32_t timeSec = 0;
+    const uint8_t* p = day.data;
+    for (int i = low * SCHEDULE_BLOCK_SIZE; i < day.departureCount; i++) {
+        if (i % SCHEDULE_BLOCK_SIZE == 0) {
+            const ScheduleBlock& block = day.blocks[i / SCHEDULE_BLOCK_SIZE];
+            timeSec = block.firstSec;
+            p = day.data + block.offset;
+        }
+
+        uint32_t delta = 0;
+        for (int shift = 0; shift < 32; shift += 7) {
+            uint8_t byte = *p++;
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        timeSec += delta;
+        uint8_t destination = *p++;
+        uint8_t lineAndGroup = *p++;
+
+        if (timeSec < fromSec) continue;
+        long departSec = (long)timeSec + shiftSec;
+
+        // Sorted, so once the list is full nothing later can get in
+        if (count == maxCount && departSec >= departures[count - 1].departSec) break;
+
+        uint8_t departureGroup = lineAndGroup >> 5;
+        if (group != 0 && departureGroup != group) continue;
+
+        // Bounded insertion, soonest first
+        int slot = count < maxCount ? count++ : maxCount - 1;
+        while (slot > 0 && departures[slot - 1].departSec > departSec) {
+            departures[slot] = departures[slot - 1];
+            slot--;
+        }
+
+        ScheduledDeparture& departure = departures[slot];
+        uint8_t line = lineAndGroup & 0x1F;
+        memset(&departure, 0, sizeof(departure));
+        if (destination < _table.destinationCount) {
+            memcpy(departure.destination, _table.destinations[destination], DEST_MAX_LEN - 1);
+        }
+        if (line < _table.lineCount) {
+            memcpy(departure.line, _table.lines[line], LINE_MAX_LEN - 1);
+        }
+        departure.group = departureGroup;
+        departure.departSec = departSec;
+    }
+    return count;
+}
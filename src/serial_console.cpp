@@ -0,0 +1,149 @@
+#include "serial_console.h"
+#include <string.h>
+
+// Room kept at the end of the output buffer for the truncation note
+static const char TRUNCATED_NOTE[] = "\n(output truncated)\n";
+
+SerialConsole::SerialConsole(const ConsoleCommand* commands, int count, char* output, size_t outputSize,
+                             void* context)
+    : _commandCount(0), _context(context), _lineLength(0), _lineTooLong(false),
+      _output(output), _outputSize(outputSize), _outputLength(0), _outputSent(0), _commandsRun(0) {
+    if (commands == nullptr || count < 0) count = 0;
+    if (count > CONSOLE_MAX_COMMANDS) count = CONSOLE_MAX_COMMANDS;
+    for (int i = 0; i < count; i++) {
+        _commands[i] = commands[i];
+    }
+    _commandCount = count;
+    _output[0] = '\0';
+}
+
+bool SerialConsole::feed(char c) {
+    if (c == '\r' || c == '\n') {
+        // "\r\n" ends one line, not two: an empty line does nothing
+        if (_lineLength == 0 && !_lineTooLong) return false;
+        _runLine();
+        _lineLength = 0;
+        _lineTooLong = false;
+        return hasOutput();
+    }
+
+    if (c == '\b' || c == 0x7f) {
+        if (_lineLength > 0) _lineLength--;
+        return false;
+    }
+    if ((unsigned char)c < ' ') return false;
+
+    if (_lineLength >= CONSOLE_LINE_MAX_LEN) {
+        _lineTooLong = true;  // Drop the rest of the line
+        return false;
+    }
+    _line[_lineLength++] = c;
+    return false;
+}
+
+bool SerialConsole::hasOutput() const {
+    return _outputSent < _outputLength;
+}
+
+const char* SerialConsole::getOutput(size_t& length) const {
+    length = _outputLength - _outputSent;
+    return _output + _outputSent;
+}
+
+void SerialConsole::consumeOutput(size_t length) {
+    _outputSent += length;
+    if (_outputSent >= _outputLength) {
+        _outputSent = 0;
+        _outputLength = 0;
+    }
+}
+
+unsigned long SerialConsole::getCommandCount() const {
+    return _commandsRun;
+}
+
+void SerialConsole::_runLine() {
+    // Leave room to say the answer was cut short
+    size_t room = _outputSize > sizeof(TRUNCATED_NOTE) ? _outputSize - sizeof(TRUNCATED_NOTE) + 1 : _outputSize;
+    BufferWriter out(_output, room);
+
+    _line[_lineLength] = '\0';
+    char* name = _line;
+    while (*name == ' ') name++;
+    char* args = name + strcspn(name, " ");
+    if (*args != '\0') {
+        *args++ = '\0';
+        while (*args == ' ') args++;
+    }
+    size_t argsLength = strlen(args);
+    while (argsLength > 0 && args[argsLength - 1] == ' ') args[--argsLength] = '\0';
+
+    if (_lineTooLong) {
+        out.printf("line too long (max %d characters)", CONSOLE_LINE_MAX_LEN);
+    } else if (*name == '\0') {
+        return;  // Only spaces
+    } else if (strcmp(name, "help") == 0) {
+        _printHelp(out);
+    } else {
+        int index = 0;
+        while (index < _commandCount && strcmp(_commands[index].name, name) != 0) index++;
+        if (index < _commandCount) {
+            _commands[index].handler(args, out, _context);
+        } else {
+            out.printf("unknown command '%s'; try help", name);
+        }
+    }
+    _commandsRun++;
+
+    size_t length = out.length();
+    if (out.overflowed()) {
+        memcpy(_output + length, TRUNCATED_NOTE, sizeof(TRUNCATED_NOTE));
+        length += sizeof(TRUNCATED_NOTE) - 1;
+    } else if (length == 0 || _output[length - 1] != '\n') {
+        // Every answer ends its line (room for this was kept above)
+        _output[length++] = '\n';
+        _output[length] = '\0';
+    }
+    _outputLength = length;
+    _outputSent = 0;
+}
+
+void SerialConsole::_printHelp(BufferWriter& out) const {
+    out.print("Commands:\n");
+    for (int i = 0; i < _commandCount; i++) {
+        out.printf("  %s%s%s - %s\n", _commands[i].name, _commands[i].usage[0] != '\0' ? " " : "",
+                   _commands[i].usage, _commands[i].help);
+    }
+    out.print("  help - This list\n");
+}
+
+void formatHex(const uint8_t* data, size_t length, BufferWriter& out) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        char pair[3] = {DIGITS[data[i] >> 4], DIGITS[data[i] & 0x0f], '\0'};
+        out.print(pair);
+    }
+}
+
+/**
+ * Value of a hex digit, or -1
+ */
+static int _hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int parseHex(const char* text, uint8_t* buffer, size_t size) {
+    size_t length = strlen(text);
+    if (length % 2 != 0 || length / 2 > size) return -1;
+
+    for (size_t i = 0; i < length / 2; i++) {
+        int high = _hexDigit(text[2 * i]);
+        int low = _hexDigit(text[2 * i + 1]);
+        if (high < 0 || low < 0) return -1;
+        buffer[i] = (uint8_t)(high * 16 + low);
+    }
+    return (int)(length / 2);
+}
@@ -0,0 +1,619 @@
+#include "status_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#endif
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/**
+ * Make a socket non-blocking
+ */
+static bool _setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * Close a client socket
+ */
+static void _closeClient(int clientFd) {
+    // Half-close first so the client sees the whole response before the FIN
+    shutdown(clientFd, SHUT_WR);
+    close(clientFd);
+}
+
+StatusServer::StatusServer() {
+    _endpointCount = 0;
+    for (int i = 0; i < STATUS_MAX_CONNECTIONS; i++) {
+        _connections[i].fd = -1;
+        _connections[i].state = CONN_FREE;
+    }
+    _answered = 0;
+    _listenFd = -1;
+    _port = 0;
+    _requests = 0;
+    _errors = 0;
+    _rebuilds = 0;
+    _actionToken = nullptr;
+}
+
+StatusServer::~StatusServer() {
+    stop();
+}
+
+int StatusServer::addEndpoint(const char* path, const char* contentType, char* buffer, size_t capacity,
+                              StatusBuilder builder, void* context) {
+    if (_endpointCount >= STATUS_MAX_ENDPOINTS || capacity == 0) return -1;
+
+    Endpoint& endpoint = _endpoints[_endpointCount];
+    endpoint.path = path;
+    endpoint.contentType = contentType;
+    endpoint.buffer = buffer;
+    endpoint.capacity = capacity;
+    endpoint.length = 0;
+    endpoint.builder = builder;
+    endpoint.context = context;
+    endpoint.built = false;
+    endpoint.live = false;
+    endpoint.version = nullptr;
+    endpoint.action = nullptr;
+    endpoint.builtMs = 0;
+    endpoint.senders = 0;
+    endpoint.rebuildPending = false;
+    buffer[0] = '\0';
+    return _endpointCount++;
+}
+
+void StatusServer::setLive(int endpoint, bool live) {
+    if (endpoint < 0 || endpoint >= _endpointCount) return;
+    _endpoints[endpoint].live = live;
+}
+
+void StatusServer::setLongPoll(int endpoint, StatusVersion version) {
+    if (endpoint < 0 || endpoint >= _endpointCount) return;
+    _endpoints[endpoint].version = version;
+}
+
+void StatusServer::setAction(int endpoint, StatusAction action) {
+    if (endpoint < 0 || endpoint >= _endpointCount) return;
+    _endpoints[endpoint].action = action;
+}
+
+void StatusServer::setActionToken(const char* token) {
+    _actionToken = token;
+}
+
+bool StatusServer::begin(uint16_t port) {
+    stop();
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(fd, STATUS_MAX_CONNECTIONS) != 0 ||
+        !_setNonBlocking(fd)) {
+        close(fd);
+        return false;
+    }
+
+    // Port 0 asks the stack for a free port; find out which
+    socklen_t addrLen = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &addrLen) != 0) {
+        close(fd);
+        return false;
+    }
+
+    _listenFd = fd;
+    _port = ntohs(addr.sin_port);
+    return true;
+}
+
+void StatusServer::stop() {
+    for (int i = 0; i < STATUS_MAX_CONNECTIONS; i++) {
+        Connection& c = _connections[i];
+        if (c.state != CONN_FREE) {
+            _closeClient(c.fd);
+            c.fd = -1;
+            c.state = CONN_FREE;
+        }
+    }
+    for (int i = 0; i < _endpointCount; i++) {
+        Endpoint& e = _endpoints[i];
+        e.senders = 0;
+        if (e.rebuildPending) {
+            // An action's answer is still in the buffer, not the body
+            e.built = false;
+            e.rebuildPending = false;
+        }
+    }
+
+    if (_listenFd >= 0) {
+        close(_listenFd);
+        _listenFd = -1;
+    }
+    _port = 0;
+}
+
+uint16_t StatusServer::getPort() const {
+    return _port;
+}
+
+void StatusServer::rebuild(uint64_t nowMs) {
+    for (int i = 0; i < _endpointCount; i++) {
+        // Live bodies are built when requested, never on the caller's time
+        if (!_endpoints[i].live) rebuild(i, nowMs);
+    }
+}
+
+void StatusServer::rebuild(int endpoint, uint64_t nowMs) {
+    if (endpoint < 0 || endpoint >= _endpointCount) return;
+
+    Endpoint& e = _endpoints[endpoint];
+    if (e.senders > 0) {
+        // A response is still going out from this buffer; build after it
+        e.rebuildPending = true;
+        return;
+    }
+    size_t length = e.builder(e.buffer, e.capacity, e.context);
+    e.length = (length < e.capacity) ? length : e.capacity - 1;
+    e.built = true;
+    e.rebuildPending = false;
+    e.builtMs = nowMs;
+    _rebuilds++;
+}
+
+int StatusServer::poll(uint64_t nowMs) {
+    if (_listenFd < 0) return 0;
+
+    // While every slot is taken, new clients wait in the listen backlog
+    int accepted = 0;
+    for (int i = 0; i < STATUS_MAX_CONNECTIONS && accepted < STATUS_MAX_CLIENTS_PER_POLL; i++) {
+        Connection& c = _connections[i];
+        if (c.state != CONN_FREE) continue;
+
+        int clientFd = accept(_listenFd, nullptr, nullptr);
+        if (clientFd < 0) break;  // EWOULDBLOCK: nobody waiting
+
+        _setNonBlocking(clientFd);
+        c.fd = clientFd;
+        c.state = CONN_READING;
+        c.buffer[0] = '\0';
+        c.length = 0;
+        c.headerLength = 0;
+        c.bodyLength = 0;
+        c.endpoint = -1;
+        c.startedMs = nowMs;
+        accepted++;
+    }
+
+    _answered = 0;
+    for (int i = 0; i < STATUS_MAX_CONNECTIONS; i++) {
+        if (_connections[i].state != CONN_FREE) _step(_connections[i], nowMs);
+    }
+    return _answered;
+}
+
+unsigned long StatusServer::getRequestCount() const {
+    return _requests;
+}
+
+unsigned long StatusServer::getErrorCount() const {
+    return _errors;
+}
+
+unsigned long StatusServer::getRebuildCount() const {
+    return _rebuilds;
+}
+
+int StatusServer::getParkedCount() const {
+    int parked = 0;
+    for (int i = 0; i < STATUS_MAX_CONNECTIONS; i++) {
+        if (_connections[i].state == CONN_PARKED) parked++;
+    }
+    return parked;
+}
+
+/**
+ * Split a request line into its method and path
+ *
+ * :return bool: False for a method other than GET, HEAD or POST
+ */
+static bool _parseRequestLine(const char* request, bool& head, bool& post, const char*& path) {
+    head = strncmp(request, "HEAD ", 5) == 0;
+    post = strncmp(request, "POST ", 5) == 0;
+    if (!head && !post && strncmp(request, "GET ", 4) != 0) return false;
+    path = request + (head || post ? 5 : 4);
+    return true;
+}
+
+/**
+ * Find a hex query parameter (e.g. since=1a2b) in a request target
+ */
+static bool _findQueryHex(const char* target, size_t targetLen, const char* key, uint32_t& value) {
+    const char* query = (const char*)memchr(target, '?', targetLen);
+    if (query == nullptr) return false;
+
+    size_t keyLen = strlen(key);
+    const char* end = target + targetLen;
+    for (const char* p = query + 1; p + keyLen < end; p++) {
+        bool atStart = p[-1] == '?' || p[-1] == '&';
+        if (atStart && strncmp(p, key, keyLen) == 0 && p[keyLen] == '=') {
+            char* parsedEnd;
+            value = (uint32_t)strtoul(p + keyLen + 1, &parsedEnd, 16);
+            return parsedEnd != p + keyLen + 1;
+        }
+    }
+    return false;
+}
+
+/**
+ * Find a header's value in a request, ignoring the name's case
+ *
+ * Only lines of the header block count, so nothing in the body can pass
+ * for a header.
+ *
+ * :param const char* request: Request, starting with the request line
+ * :param size_t headerLength: Size of the header block, through its blank line
+ * :param const char* name: Header name
+ * :return const char*: Start of the value, or nullptr if there's no such header
+ */
+static const char* _findHeader(const char* request, size_t headerLength, const char* name) {
+    size_t nameLen = strlen(name);
+    const char* end = request + headerLength;
+    for (const char* p = request; p + 1 < end; p++) {
+        if (p[0] != '\r' || p[1] != '\n') continue;
+
+        const char* line = p + 2;
+        if ((size_t)(end - line) > nameLen && strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':') {
+            const char* value = line + nameLen + 1;
+            while (*value == ' ') value++;
+            return value;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Parse a Content-Length value: digits only, up to the end of the line
+ *
+ * :param const char* value: Header value
+ * :param size_t limit: Largest length of interest; anything bigger is reported as limit + 1
+ * :param size_t& length: Parsed length
+ * :return bool: False if the value isn't a plain decimal number
+ */
+static bool _parseContentLength(const char* value, size_t limit, size_t& length) {
+    length = 0;
+    const char* p = value;
+    while (*p >= '0' && *p <= '9') {
+        // Stop growing past the limit, so huge values can't wrap around
+        if (length <= limit) length = length * 10 + (size_t)(*p - '0');
+        p++;
+    }
+    while (*p == ' ' || *p == '\t') p++;
+    if (length > limit) length = limit + 1;
+    return p != value && (*p == '\r' || *p == '\0');
+}
+
+void StatusServer::_step(Connection& c, uint64_t nowMs) {
+    // Each state hands over to the next as soon as it can, so a request
+    // that arrived whole is answered in the same poll
+    if (c.state == CONN_READING) _read(c, nowMs);
+    if (c.state == CONN_READY) _respond(c, nowMs);
+    if (c.state == CONN_PARKED) _pollParked(c, nowMs);
+    if (c.state == CONN_WRITING) _write(c, nowMs);
+}
+
+void StatusServer::_read(Connection& c, uint64_t nowMs) {
+    for (;;) {
+        if (c.headerLength > 0 && c.length >= c.headerLength + c.bodyLength) {
+            c.buffer[c.headerLength + c.bodyLength] = '\0';
+            c.state = CONN_READY;
+            c.startedMs = nowMs;
+            return;
+        }
+        if (c.headerLength == 0 && c.length >= sizeof(c.buffer) - 1) {
+            _sendStatus(c, 431, "Request Header Fields Too Large", nowMs);
+            return;
+        }
+
+        // Headers first, then only as much body as Content-Length gives
+        size_t wanted = c.headerLength == 0 ? sizeof(c.buffer) - 1 - c.length
+                                            : c.headerLength + c.bodyLength - c.length;
+        ssize_t received = recv(c.fd, c.buffer + c.length, wanted, 0);
+        if (received > 0) {
+            c.length += (size_t)received;
+            c.buffer[c.length] = '\0';
+            const char* end = c.headerLength == 0 ? strstr(c.buffer, "\r\n\r\n") : nullptr;
+            if (end != nullptr) {
+                c.headerLength = (size_t)(end + 4 - c.buffer);
+                if (!_checkHeaders(c, nowMs)) return;
+            }
+        } else if (received < 0 && (errno == EWOULDBLOCK || errno == EAGAIN) &&
+                   nowMs - c.startedMs < STATUS_IO_TIMEOUT_MS) {
+            return;  // The rest comes on a later poll
+        } else {
+            _errors++;  // Timed out or closed before sending a request
+            _finish(c, nowMs);
+            return;
+        }
+    }
+}
+
+bool StatusServer::_checkHeaders(Connection& c, uint64_t nowMs) {
+    // Request line: METHOD SP PATH SP VERSION
+    bool head;
+    bool post;
+    const char* path;
+    if (!_parseRequestLine(c.buffer, head, post, path)) {
+        _sendStatus(c, 405, "Method Not Allowed", nowMs);
+        return false;
+    }
+    if (!post) return true;
+
+    int index = _findEndpoint(path, strcspn(path, " ?\r\n"));
+    if (index < 0 || _endpoints[index].action == nullptr) {
+        _sendStatus(c, index < 0 ? 404 : 405, index < 0 ? "Not Found" : "Method Not Allowed", nowMs);
+        return false;
+    }
+    if (!_authorized(c.buffer, c.headerLength)) {
+        _sendStatus(c, 401, "Unauthorized", nowMs);
+        return false;
+    }
+
+    // Refuse a body that can't fit before reading any of it
+    const char* contentLength = _findHeader(c.buffer, c.headerLength, "Content-Length");
+    size_t bodyLength = 0;
+    if (contentLength != nullptr && !_parseContentLength(contentLength, sizeof(c.buffer), bodyLength)) {
+        _sendStatus(c, 400, "Bad Request", nowMs);
+        return false;
+    }
+    if (bodyLength > sizeof(c.buffer) - 1 - c.headerLength) {
+        _sendStatus(c, 413, "Payload Too Large", nowMs);
+        return false;
+    }
+    c.bodyLength = bodyLength;
+    return true;
+}
+
+void StatusServer::_respond(Connection& c, uint64_t nowMs) {
+    bool head;
+    bool post;
+    const char* path;
+    _parseRequestLine(c.buffer, head, post, path);
+    int index = _findEndpoint(path, strcspn(path, " ?\r\n"));
+
+    // Actions and live builders write the endpoint's buffer, and a pending
+    // rebuild means it's out of date: wait until nothing is sent from it
+    if (index >= 0) {
+        const Endpoint& e = _endpoints[index];
+        if (e.senders > 0 && (post || e.live || e.rebuildPending)) {
+            if (nowMs - c.startedMs >= STATUS_IO_TIMEOUT_MS) {
+                _sendStatus(c, 503, "Service Unavailable", nowMs);
+            }
+            return;
+        }
+    }
+
+    if (post) {
+        _runAction(c, index, c.buffer + c.headerLength, nowMs);
+        return;
+    }
+
+    // Long poll: hold the request while the client already has the current content
+    uint32_t since;
+    if (index >= 0 && _endpoints[index].version != nullptr && getParkedCount() < STATUS_MAX_PARKED &&
+        _findQueryHex(path, strcspn(path, " \r\n"), "since", since) &&
+        since == _endpoints[index].version(_endpoints[index].context)) {
+        c.state = CONN_PARKED;
+        c.endpoint = index;
+        c.since = since;
+        c.startedMs = nowMs;
+        return;
+    }
+
+    if (index >= 0 && _endpoints[index].live) {
+        rebuild(index, nowMs);
+    }
+    if (index < 0 || !_endpoints[index].built) {
+        _sendStatus(c, index < 0 ? 404 : 503, index < 0 ? "Not Found" : "Service Unavailable", nowMs);
+        return;
+    }
+
+    _sendBody(c, index, head, nowMs);
+}
+
+void StatusServer::_pollParked(Connection& c, uint64_t nowMs) {
+    const Endpoint& e = _endpoints[c.endpoint];
+    uint32_t version = e.version(e.context);
+
+    char probe;
+    if (recv(c.fd, &probe, 1, MSG_PEEK) == 0) {
+        // Client gave up waiting; nothing to answer
+        _finish(c, nowMs);
+    } else if (version != c.since) {
+        c.state = CONN_READY;
+        c.endpoint = -1;
+        c.startedMs = nowMs;
+        _respond(c, nowMs);
+    } else if (nowMs - c.startedMs >= STATUS_LONG_POLL_TIMEOUT_MS) {
+        int length = snprintf(c.buffer, sizeof(c.buffer),
+                              "HTTP/1.1 304 Not Modified\r\n"
+                              "ETag: \"%08lx\"\r\n"
+                              "Connection: close\r\n\r\n",
+                              (unsigned long)version);
+        _startWriting(c, (size_t)length, -1, 0, true, nowMs);
+    }
+}
+
+void StatusServer::_sendBody(Connection& c, int index, bool head, uint64_t nowMs) {
+    const Endpoint& e = _endpoints[index];
+
+    char etag[32] = "";
+    if (e.version != nullptr) {
+        snprintf(etag, sizeof(etag), "ETag: \"%08lx\"\r\n", (unsigned long)e.version(e.context));
+    }
+
+    int headerLen = snprintf(c.buffer, sizeof(c.buffer),
+                             "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: %s\r\n"
+                             "Content-Length: %u\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Age: %lu\r\n"
+                             "%s"
+                             "Connection: close\r\n\r\n",
+                             e.contentType, (unsigned)e.length, (unsigned long)((nowMs - e.builtMs) / 1000), etag);
+    if (headerLen < 0 || (size_t)headerLen >= sizeof(c.buffer)) {
+        _errors++;
+        _finish(c, nowMs);
+        return;
+    }
+
+    // The body goes out straight from the endpoint's buffer
+    _startWriting(c, (size_t)headerLen, head ? -1 : index, head ? 0 : e.length, true, nowMs);
+}
+
+void StatusServer::_write(Connection& c, uint64_t nowMs) {
+    while (c.sent < c.length + c.bodyLength) {
+        const char* data;
+        size_t remaining;
+        if (c.sent < c.length) {
+            data = c.buffer + c.sent;
+            remaining = c.length - c.sent;
+        } else {
+            data = _endpoints[c.endpoint].buffer + (c.sent - c.length);
+            remaining = c.length + c.bodyLength - c.sent;
+        }
+
+        ssize_t sent = send(c.fd, data, remaining, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c.sent += (size_t)sent;
+        } else if (sent < 0 && (errno == EWOULDBLOCK || errno == EAGAIN) &&
+                   nowMs - c.startedMs < STATUS_IO_TIMEOUT_MS) {
+            return;  // The rest goes out on a later poll
+        } else {
+            if (c.success) _errors++;
+            _finish(c, nowMs);
+            return;
+        }
+    }
+
+    if (c.success) _requests++;
+    _finish(c, nowMs);
+}
+
+void StatusServer::_startWriting(Connection& c, size_t headerLength, int endpoint, size_t bodyLength, bool success,
+                                 uint64_t nowMs) {
+    c.state = CONN_WRITING;
+    c.length = headerLength;
+    c.endpoint = endpoint;
+    c.bodyLength = bodyLength;
+    c.sent = 0;
+    c.success = success;
+    c.startedMs = nowMs;
+    if (endpoint >= 0) _endpoints[endpoint].senders++;
+    _answered++;
+}
+
+void StatusServer::_finish(Connection& c, uint64_t nowMs) {
+    _closeClient(c.fd);
+    if (c.state == CONN_WRITING && c.endpoint >= 0) {
+        Endpoint& e = _endpoints[c.endpoint];
+        if (--e.senders == 0 && e.rebuildPending) {
+            rebuild(c.endpoint, nowMs);
+        }
+    }
+    c.fd = -1;
+    c.state = CONN_FREE;
+}
+
+bool StatusServer::_authorized(const char* request, size_t headerLength) const {
+    if (_actionToken == nullptr) return true;
+
+    const char* value = _findHeader(request, headerLength, "Authorization");
+    if (value == nullptr || strncmp(value, "Bearer ", 7) != 0) return false;
+    value += 7;
+
+    // Compare every byte, so the time taken doesn't tell how much matched
+    size_t tokenLen = strlen(_actionToken);
+    size_t valueLen = strcspn(value, "\r\n");
+    unsigned char diff = valueLen == tokenLen ? 0 : 1;
+    for (size_t i = 0; i < tokenLen; i++) {
+        diff |= (unsigned char)(_actionToken[i] ^ (i < valueLen ? value[i] : 0));
+    }
+    return diff == 0;
+}
+
+void StatusServer::_runAction(Connection& c, int index, char* body, uint64_t nowMs) {
+    Endpoint& e = _endpoints[index];
+    size_t length = 0;
+    int code = e.action(body, e.buffer, e.capacity, length, e.context);
+    if (length >= e.capacity) length = e.capacity - 1;
+
+    // The action wrote over the cached body; build it again once its answer is out
+    if (e.built && !e.live) {
+        e.rebuildPending = true;
+    }
+
+    int headerLen = snprintf(c.buffer, sizeof(c.buffer),
+                             "HTTP/1.1 %d %s\r\n"
+                             "Content-Type: %s\r\n"
+                             "Content-Length: %u\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Connection: close\r\n\r\n",
+                             code, code == 200 ? "OK" : code == 400 ? "Bad Request" : "Internal Server Error",
+                             e.contentType, (unsigned)length);
+    if (headerLen < 0 || (size_t)headerLen >= sizeof(c.buffer)) {
+        _errors++;
+        if (e.rebuildPending) rebuild(index, nowMs);
+        _finish(c, nowMs);
+        return;
+    }
+    if (code != 200) _errors++;
+    _startWriting(c, (size_t)headerLen, index, length, code == 200, nowMs);
+}
+
+int StatusServer::_findEndpoint(const char* path, size_t pathLen) const {
+    for (int i = 0; i < _endpointCount; i++) {
+        if (strlen(_endpoints[i].path) == pathLen && strncmp(_endpoints[i].path, path, pathLen) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void StatusServer::_sendStatus(Connection& c, int code, const char* reason, uint64_t nowMs) {
+    int length = snprintf(c.buffer, sizeof(c.buffer),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Content-Length: 0\r\n"
+                          "Connection: close\r\n\r\n",
+                          code, reason);
+    _errors++;
+    if (length > 0 && (size_t)length < sizeof(c.buffer)) {
+        _startWriting(c, (size_t)length, -1, 0, false, nowMs);
+    } else {
+        _finish(c, nowMs);
+    }
+}
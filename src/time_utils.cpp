@@ -1,36 +1,75 @@
 #include "time_utils.h"
 #include "config.h"
-#include <time.h>
+#include "log.h"
+#include "mono_clock.h"
+#include <esp_sntp.h>
+#include <atomic>
+
+// Written from the SNTP callback in the network stack's task
+static volatile unsigned long syncCount = 0;
+static std::atomic<uint64_t> lastSyncMs(0);  // 64 bits: a plain read could tear
+
+/**
+ * Called by SNTP after each successful sync
+ */
+static void _onTimeSync(struct timeval* tv) {
+    lastSyncMs.store(monoMillis(), std::memory_order_relaxed);
+    syncCount = syncCount + 1;
+}
+
+/**
+ * Convert 24-hour time to 12-hour time
+ */
+static int _to12Hour(int hour24) {
+    if (hour24 == 0) {
+        return 12;
+    } else if (hour24 > 12) {
+        return hour24 - 12;
+    }
+    return hour24;
+}
 
 TimeManager::TimeManager() {}
 
+void TimeManager::begin() {
+    sntp_set_sync_interval(NTP_RESYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(_onTimeSync);
+    configTzTime(TIMEZONE_RULE, NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
+    LOG_INFO("TIME", "NTP time sync initiated (TZ %s)", TIMEZONE_RULE);
+}
+
 void TimeManager::syncNTP() {
-    configTime(TIMEZONE_OFFSET_SEC, DST_OFFSET_SEC, NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
-    Serial.println("NTP time sync initiated");
+    begin();
+}
+
+bool TimeManager::isSynced() const {
+    return syncCount > 0 || isClockSet(time(nullptr));
+}
+
+unsigned long TimeManager::getSyncCount() const {
+    return syncCount;
+}
+
+uint64_t TimeManager::getLastSyncMs() const {
+    return lastSyncMs.load(std::memory_order_relaxed);
 }
 
 TimeData TimeManager::getCurrentTime() {
     TimeData data = {0, 0, 0, false, false};
     
-    struct tm timeInfo;
-    if (!getLocalTime(&timeInfo)) {
+    // Don't wait for a sync (getLocalTime() polls for up to 5 s by default)
+    time_t now = time(nullptr);
+    if (!isClockSet(now)) {
         return data;
     }
     
+    struct tm timeInfo;
+    localtime_r(&now, &timeInfo);
     data.isValid = true;
     
     // Convert to 12-hour format
-    int hour24 = timeInfo.tm_hour;
-    data.isPM = (hour24 >= 12);
-    
-    if (hour24 == 0) {
-        data.hour = 12;
-    } else if (hour24 > 12) {
-        data.hour = hour24 - 12;
-    } else {
-        data.hour = hour24;
-    }
-    
+    data.isPM = (timeInfo.tm_hour >= 12);
+    data.hour = _to12Hour(timeInfo.tm_hour);
     data.minute = timeInfo.tm_min;
     data.second = timeInfo.tm_sec;
     
@@ -46,3 +85,12 @@ bool TimeManager::getFormattedTime(char* buffer, size_t bufferSize) {
     snprintf(buffer, bufferSize, "%02d:%02d:%02d", data.hour, data.minute, data.second);
     return true;
 }
+
+bool TimeManager::formatClockTime(time_t when, char* buffer, size_t bufferSize) {
+    if (buffer == nullptr || bufferSize < 6 || !isClockSet(when)) return false;
+    
+    struct tm timeInfo;
+    localtime_r(&when, &timeInfo);
+    snprintf(buffer, bufferSize, "%d:%02d", _to12Hour(timeInfo.tm_hour), timeInfo.tm_min);
+    return true;
+}
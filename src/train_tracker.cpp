@@ -0,0 +1,248 @@
+#include "train_tracker.h"
+#include <stdio.h>
+#include <string.h>
+
+bool parseTrainMinutes(const char* minutes, uint8_t& status, long& etaMs) {
+    if (minutes == nullptr || minutes[0] == '\0') {
+        return false;
+    }
+    
+    if (strcmp(minutes, "BRD") == 0) {
+        status = TRAIN_BOARDING;
+        etaMs = 0;
+        return true;
+    }
+    
+    if (strcmp(minutes, "ARR") == 0) {
+        status = TRAIN_ARRIVING;
+        etaMs = ARRIVING_ETA_MS;
+        return true;
+    }
+    
+    long value = 0;
+    for (const char* p = minutes; *p != '\0'; p++) {
+        if (*p < '0' || *p > '9' || value > 999) {
+            return false;  // "---" or other placeholders
+        }
+        value = value * 10 + (*p - '0');
+    }
+    
+    status = TRAIN_MOVING;
+    etaMs = value * 60000L + 30000L;
+    return true;
+}
+
+TrainTracker::TrainTracker() {
+    reset();
+}
+
+void TrainTracker::reset() {
+    _count = 0;
+    _nextId = 1;
+    _departureCount = 0;
+    _departureHead = 0;
+}
+
+void TrainTracker::update(const TrainObservation* observations, int count, uint64_t nowMs) {
+    bool matched[MAX_TRACKED_TRAINS] = {false};
+    
+    for (int i = 0; i < count; i++) {
+        const TrainObservation& observation = observations[i];
+        int index = _findMatch(observation, nowMs, matched);
+        
+        if (index >= 0) {
+            TrackedTrain& train = _trains[index];
+            long predictedMs = getEtaMs(train, nowMs);
+            long errorMs = observation.etaMs - predictedMs;
+            
+            if (observation.status == TRAIN_BOARDING ||
+                errorMs > TRACK_RESYNC_MS || errorMs < -TRACK_RESYNC_MS) {
+                train.etaMs = observation.etaMs;
+            } else {
+                train.etaMs = predictedMs + errorMs * TRACK_GAIN_NUM / TRACK_GAIN_DEN;
+            }
+            
+            if (train.cars == 0) train.cars = observation.cars;
+            train.status = observation.status;
+            train.misses = 0;
+            train.updatedMs = nowMs;
+            matched[index] = true;
+        } else if (_count < MAX_TRACKED_TRAINS) {
+            TrackedTrain& train = _trains[_count];
+            memcpy(train.line, observation.line, LINE_MAX_LEN);
+            memcpy(train.destination, observation.destination, DEST_MAX_LEN);
+            train.group = observation.group;
+            train.cars = observation.cars;
+            train.status = observation.status;
+            train.misses = 0;
+            train.id = _nextId++;
+            if (_nextId == 0) _nextId = 1;
+            train.etaMs = observation.etaMs;
+            train.updatedMs = nowMs;
+            matched[_count] = true;
+            _count++;
+        }
+    }
+    
+    // Walk backwards so removing (swap with last) never skips a train
+    for (int i = _count - 1; i >= 0; i--) {
+        if (matched[i]) continue;
+        
+        TrackedTrain& train = _trains[i];
+        if (train.status == TRAIN_BOARDING) {
+            _recordDeparture(train, nowMs);
+            _remove(i);
+            continue;
+        }
+        
+        train.misses++;
+        if (train.misses > TRACK_MISS_LIMIT) {
+            _remove(i);
+        }
+    }
+}
+
+int TrainTracker::getCount() const {
+    return _count;
+}
+
+const TrackedTrain& TrainTracker::getTrain(int index) const {
+    return _trains[index];
+}
+
+int TrainTracker::findNext(uint8_t group, uint64_t nowMs) const {
+    int best = -1;
+    long bestEtaMs = 0;
+    
+    for (int i = 0; i < _count; i++) {
+        if (_trains[i].group != group) continue;
+        
+        long etaMs = getEtaMs(_trains[i], nowMs);
+        if (best < 0 || etaMs < bestEtaMs ||
+            (etaMs == bestEtaMs && _trains[i].status > _trains[best].status)) {
+            best = i;
+            bestEtaMs = etaMs;
+        }
+    }
+    return best;
+}
+
+int TrainTracker::findUpcoming(uint8_t group, uint64_t nowMs, TrackedTrain* trains, int maxCount) const {
+    int count = 0;
+    
+    for (int i = 0; i < _count; i++) {
+        const TrackedTrain& train = _trains[i];
+        if (train.group != group) continue;
+        
+        // Insertion into the sorted top-K; later trains fall off the end
+        int position = count;
+        while (position > 0 && _arrivesBefore(train, trains[position - 1], nowMs)) {
+            position--;
+        }
+        if (position >= maxCount) continue;
+        
+        int last = count < maxCount ? count : maxCount - 1;
+        for (int n = last; n > position; n--) {
+            trains[n] = trains[n - 1];
+        }
+        trains[position] = train;
+        if (count < maxCount) count++;
+    }
+    return count;
+}
+
+long TrainTracker::getEtaMs(const TrackedTrain& train, uint64_t nowMs) const {
+    long etaMs = train.etaMs - (long)(nowMs - train.updatedMs);
+    return etaMs > 0 ? etaMs : 0;
+}
+
+void TrainTracker::formatMinutes(const TrackedTrain& train, uint64_t nowMs, char* buffer, size_t bufferSize) const {
+    if (buffer == nullptr || bufferSize == 0) {
+        return;
+    }
+    
+    if (train.status == TRAIN_BOARDING) {
+        snprintf(buffer, bufferSize, "BRD");
+        return;
+    }
+    
+    long minutes = getEtaMs(train, nowMs) / 60000L;
+    if (train.status == TRAIN_ARRIVING || minutes == 0) {
+        snprintf(buffer, bufferSize, "ARR");
+        return;
+    }
+    
+    snprintf(buffer, bufferSize, "%ld", minutes);
+}
+
+bool TrainTracker::getRecentDeparture(uint8_t group, uint64_t nowMs, DepartureEvent& event) const {
+    for (int n = 0; n < _departureCount; n++) {
+        const DepartureEvent& departure = getDeparture(n);
+        if (departure.group != group) continue;
+        
+        if (nowMs - departure.departedMs <= TRACK_DEPARTED_HOLD_MS) {
+            event = departure;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+int TrainTracker::getDepartureCount() const {
+    return _departureCount;
+}
+
+const DepartureEvent& TrainTracker::getDeparture(int n) const {
+    int index = (_departureHead - 1 - n + TRACK_DEPARTURE_HISTORY) % TRACK_DEPARTURE_HISTORY;
+    return _departures[index];
+}
+
+bool TrainTracker::_arrivesBefore(const TrackedTrain& a, const TrackedTrain& b, uint64_t nowMs) const {
+    long etaA = getEtaMs(a, nowMs);
+    long etaB = getEtaMs(b, nowMs);
+    return etaA < etaB || (etaA == etaB && a.status > b.status);
+}
+
+int TrainTracker::_findMatch(const TrainObservation& observation, uint64_t nowMs, const bool* matched) const {
+    int best = -1;
+    long bestErrorMs = 0;
+    
+    for (int i = 0; i < _count; i++) {
+        const TrackedTrain& train = _trains[i];
+        if (matched[i]) continue;
+        if (train.group != observation.group) continue;
+        if (strcmp(train.line, observation.line) != 0) continue;
+        if (strcmp(train.destination, observation.destination) != 0) continue;
+        if (train.cars != 0 && observation.cars != 0 && train.cars != observation.cars) continue;
+        
+        long errorMs = observation.etaMs - getEtaMs(train, nowMs);
+        if (errorMs < 0) errorMs = -errorMs;
+        if (errorMs > TRACK_MATCH_WINDOW_MS) continue;
+        
+        if (best < 0 || errorMs < bestErrorMs) {
+            best = i;
+            bestErrorMs = errorMs;
+        }
+    }
+    return best;
+}
+
+void TrainTracker::_recordDeparture(const TrackedTrain& train, uint64_t nowMs) {
+    DepartureEvent& departure = _departures[_departureHead];
+    memcpy(departure.line, train.line, LINE_MAX_LEN);
+    memcpy(departure.destination, train.destination, DEST_MAX_LEN);
+    departure.group = train.group;
+    departure.id = train.id;
+    departure.departedMs = nowMs;
+    
+    _departureHead = (_departureHead + 1) % TRACK_DEPARTURE_HISTORY;
+    if (_departureCount < TRACK_DEPARTURE_HISTORY) _departureCount++;
+}
+
+void TrainTracker::_remove(int index) {
+    _count--;
+    if (index != _count) {
+        _trains[index] = _trains[_count];
+    }
+}
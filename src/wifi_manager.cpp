@@ -1,31 +1,43 @@
 #include "wifi_manager.h"
 #include "config.h"
+#include "log.h"
+#include "mono_clock.h"
 #include <WiFi.h>
 
-WifiManager::WifiManager() {}
+WifiManager::WifiManager()
+    : _ssid(WIFI_SSID), _password(WIFI_PASSWORD), _connected(false), _disconnects(0), _reconnects(0) {}
+
+void WifiManager::setCredentials(const char* ssid, const char* password) {
+    _ssid = ssid;
+    _password = password;
+}
 
 bool WifiManager::connect(unsigned long timeoutMs) {
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    WiFi.begin(_ssid, _password);
     
-    Serial.print("Connecting to WiFi");
+    LOG_INFO("WIFI", "Connecting to %s", _ssid);
     
-    unsigned long startTime = millis();
+    uint64_t startTime = monoMillis();
     while (WiFi.status() != WL_CONNECTED) {
-        if (millis() - startTime > timeoutMs) {
-            Serial.println("\nWiFi connection timeout!");
+        if (monoMillis() - startTime > timeoutMs) {
+            LOG_ERROR("WIFI", "Connection timeout!");
             return false;
         }
         delay(500);
-        Serial.print(".");
     }
     
-    Serial.println();
-    Serial.print("Connected! IP: ");
-    Serial.println(WiFi.localIP());
+    LOG_INFO("WIFI", "Connected! IP: %s", WiFi.localIP().toString().c_str());
     
+    _connected = true;
     return true;
 }
 
+void WifiManager::reconnect() {
+    LOG_INFO("WIFI", "Joining %s", _ssid);
+    WiFi.disconnect();
+    WiFi.begin(_ssid, _password);
+}
+
 bool WifiManager::isConnected() {
     return WiFi.status() == WL_CONNECTED;
 }
@@ -33,3 +45,29 @@ bool WifiManager::isConnected() {
 String WifiManager::getIPAddress() {
     return WiFi.localIP().toString();
 }
+
+void WifiManager::update() {
+    bool connected = isConnected();
+    if (connected == _connected) return;
+    
+    _connected = connected;
+    if (connected) {
+        _reconnects++;
+        LOG_INFO("WIFI", "Reconnected (RSSI %d dBm)", getRssi());
+    } else {
+        _disconnects++;
+        LOG_WARN("WIFI", "Connection lost");
+    }
+}
+
+int WifiManager::getRssi() {
+    return isConnected() ? WiFi.RSSI() : 0;
+}
+
+unsigned long WifiManager::getDisconnectCount() const {
+    return _disconnects;
+}
+
+unsigned long WifiManager::getReconnectCount() const {
+    return _reconnects;
+}
@@ -1,142 +1,617 @@
 #include "wmata_client.h"
-#include <HTTPClient.h>
+#include "log.h"
+#include "mono_clock.h"
 #include <ArduinoJson.h>
+#include <lwip/sockets.h>
 
-// Base URL for WMATA StationPrediction API
-static const char* WMATA_API_BASE_URL = "http://api.wmata.com/StationPrediction.svc/json/GetPrediction/";
+// WMATA Incidents API (all rail incidents; filtered by line here)
+static const char* WMATA_INCIDENTS_URL = "http://api.wmata.com/Incidents.svc/json/Incidents";
 
-WmataClient::WmataClient(const char* stationCode, const char* apiKey) {
+// WMATA Rail Station Information API
+static const char* WMATA_STATION_INFO_URL = "http://api.wmata.com/Rail.svc/json/jStationInfo";
+
+// Next buses at one stop
+static const char* WMATA_BUS_PREDICTIONS_URL = "http://api.wmata.com/NextBusService.svc/json/jPredictions";
+
+// Port of http URLs that don't name one
+static const uint16_t HTTP_DEFAULT_PORT = 80;
+
+// Budget of each request phase, indexed by FetchPhase
+static const unsigned long PHASE_BUDGET_MS[FETCH_PHASE_COUNT] = {
+    0,                              // Idle
+    WMATA_DNS_BUDGET_MS,
+    WMATA_CONNECT_BUDGET_MS,
+    WMATA_FIRST_BYTE_BUDGET_MS,
+    WMATA_BODY_BUDGET_MS,
+    WMATA_PARSE_BUDGET_MS
+};
+
+/**
+ * Resolve a host through the Wi-Fi stack, for the DNS cache
+ * 
+ * lwIP doesn't pass on the record's TTL, so the cache's default applies.
+ */
+static bool _resolveWithWiFi(const char* host, uint32_t& address, unsigned long& ttlMs, void* context) {
+    IPAddress resolved;
+    if (WiFi.hostByName(host, resolved) != 1) return false;
+    address = (uint32_t)resolved;
+    ttlMs = 0;
+    return true;
+}
+
+/**
+ * Split an http URL into host and port
+ * 
+ * :return bool: False if the URL isn't http or the host doesn't fit
+ */
+static bool _parseUrlHost(const char* url, char* host, size_t hostSize, uint16_t& port) {
+    static const char PREFIX[] = "http://";
+    if (strncmp(url, PREFIX, sizeof(PREFIX) - 1) != 0) return false;
+    
+    const char* start = url + sizeof(PREFIX) - 1;
+    size_t length = strcspn(start, ":/?");
+    if (length == 0 || length >= hostSize) return false;
+    memcpy(host, start, length);
+    host[length] = '\0';
+    
+    port = start[length] == ':' ? (uint16_t)atoi(start + length + 1) : HTTP_DEFAULT_PORT;
+    return port != 0;
+}
+
+/**
+ * Stream for HTTPClient::writeToStream() that refuses writes after a
+ * deadline, which makes writeToStream() give up
+ */
+class DeadlineStream : public Stream {
+public:
+    explicit DeadlineStream(uint64_t deadlineMs)
+        : _deadlineMs(deadlineMs), _timedOut(false), _refused(false) {}
+    
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    
+    size_t write(const uint8_t* data, size_t length) override {
+        if (monoMillis() > _deadlineMs) {
+            _timedOut = true;
+            return 0;
+        }
+        size_t taken = _accept(data, length);
+        if (taken < length) _refused = true;
+        return taken;
+    }
+    
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    
+    bool timedOut() const { return _timedOut; }
+    
+    // True if part of the body was turned away and is still in flight
+    bool refused() const { return _refused; }
+
+protected:
+    /**
+     * Take body bytes
+     * 
+     * :return size_t: Bytes taken; fewer than length stops the transfer
+     */
+    virtual size_t _accept(const uint8_t* data, size_t length) = 0;
+
+private:
+    uint64_t _deadlineMs;
+    bool _timedOut;
+    bool _refused;
+};
+
+/**
+ * Stream that stores what is written into a fixed buffer; writes past the
+ * end are refused
+ */
+class BoundedBufferStream : public DeadlineStream {
+public:
+    BoundedBufferStream(char* buffer, size_t size, uint64_t deadlineMs)
+        : DeadlineStream(deadlineMs), _buffer(buffer), _size(size), _length(0), _truncated(false) {
+        _buffer[0] = '\0';
+    }
+    
+    size_t length() const { return _length; }
+    bool truncated() const { return _truncated; }
+
+protected:
+    size_t _accept(const uint8_t* data, size_t length) override {
+        size_t room = _size - 1 - _length;
+        if (length > room) {
+            length = room;
+            _truncated = true;
+        }
+        memcpy(_buffer + _length, data, length);
+        _length += length;
+        _buffer[_length] = '\0';
+        return length;
+    }
+
+private:
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _truncated;
+};
+
+/**
+ * Stream that hands what is written to a prediction provider to decode
+ */
+class ProviderStream : public DeadlineStream {
+public:
+    ProviderStream(PredictionProvider& provider, uint64_t deadlineMs)
+        : DeadlineStream(deadlineMs), _provider(provider) {}
+
+protected:
+    size_t _accept(const uint8_t* data, size_t length) override {
+        return _provider.write(data, length);
+    }
+
+private:
+    PredictionProvider& _provider;
+};
+
+WmataClient::WmataClient(const char* stationCode, const char* apiKey, RateGovernor* governor,
+                         PredictionProvider* provider)
+    : _wmataProvider(_stationCode, _apiKey, _bodyBuffer, sizeof(_bodyBuffer)),
+      _provider(provider != nullptr ? provider : &_wmataProvider),
+      _governor(governor), _budget(PHASE_BUDGET_MS, WMATA_TOTAL_BUDGET_MS), _dns(_resolveWithWiFi) {
     strncpy(_stationCode, stationCode, sizeof(_stationCode) - 1);
     _stationCode[sizeof(_stationCode) - 1] = '\0';
     
     strncpy(_apiKey, apiKey, sizeof(_apiKey) - 1);
     _apiKey[sizeof(_apiKey) - 1] = '\0';
     
-    _trainCount = 0;
     _lastFetchTime = 0;
+    _responseHash = 0;
+    _dataChanged = false;
+    _observationCount = 0;
+    _boardCount = 0;
     
-    // Initialize trains array
-    for (int i = 0; i < MAX_TRAINS; i++) {
-        _trains[i].destination[0] = '\0';
-        _trains[i].minutes[0] = '\0';
-        _trains[i].line[0] = '\0';
-    }
+    _host[0] = '\0';
+    _requestCount = 0;
+    _requestStartMs = 0;
+    _throttled = false;
+    _phase = FETCH_PHASE_IDLE;
+    _socketLock = xSemaphoreCreateMutex();
+    _activeFd = -1;
+    _phaseListener = nullptr;
+    _phaseContext = nullptr;
+    
+    _fetchSuccesses = 0;
+    _fetchFailures = 0;
+    
+    _hasStationInfo = false;
+    _infoLines = 0;
+    _observedLines = 0;
+    _bodyBuffer[0] = '\0';
+    
+    _busStopIds = nullptr;
+    _busStopCount = 0;
+    _lastBusFetchTime = 0;
+    
+    // Keep the connection open between requests; _get() drops it when the host changes
+    _http.setReuse(true);
 }
 
 bool WmataClient::fetchPredictions() {
-    HTTPClient http;
+    bool fetched = _fetchPredictions();
+    _finishRequest();
     
-    // Build the full URL
-    String url = String(WMATA_API_BASE_URL) + _stationCode + 
-                 "?contentType=application/json&api_key=" + _apiKey;
+    if (fetched) {
+        _fetchSuccesses++;
+        _fetchLatency.record((unsigned long)(monoMillis() - _requestStartMs));
+    } else if (!_throttled) {
+        _fetchFailures++;
+    }
+    return fetched;
+}
+
+bool WmataClient::_fetchPredictions() {
+    char url[PROVIDER_URL_MAX_LEN];
+    if (!_provider->buildUrl(url, sizeof(url))) {
+        LOG_ERROR("WMATA", "%s feed URL longer than %d characters", _provider->getName(), PROVIDER_URL_MAX_LEN - 1);
+        return false;
+    }
     
-    Serial.println("[WMATA] Fetching predictions...");
-    Serial.print("[WMATA] URL: ");
-    Serial.println(url);
+    // The URL may carry an API key, so only the station is logged
+    LOG_DEBUG("WMATA", "Fetching %s predictions for %s", _provider->getName(), _stationCode);
     
-    http.begin(url);
-    int httpCode = http.GET();
+    int httpCode = _get(url, PRIORITY_HIGH);
     
     if (httpCode != HTTP_CODE_OK) {
-        Serial.printf("[WMATA] HTTP error: %d\n", httpCode);
-        http.end();
+        LOG_WARN("WMATA", "HTTP error: %d", httpCode);
+        _endHttp();
         return false;
     }
     
-    String payload = http.getString();
-    http.end();
-    
-    Serial.println("[WMATA] Response received, parsing...");
+    // Feeds that give absolute times need the wall clock, once NTP has set it
+    time_t wallNow = time(nullptr);
+    _provider->begin(isClockSet(wallNow) ? wallNow : 0);
+    if (!_streamBody()) {
+        return false;
+    }
     
-    // Parse JSON response
-    // The response can be quite large, allocate enough memory
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    LOG_DEBUG("WMATA", "Response received, parsing...");
+    _setPhase(FETCH_PHASE_PARSE);
+    _budget.enter(FETCH_PHASE_PARSE, monoMillis());
     
-    if (error) {
-        Serial.printf("[WMATA] JSON parse error: %s\n", error.c_str());
+    // Normalized predictions for the tracker, with a fingerprint of the
+    // whole feed so we can tell when the agency has refreshed it
+    int observationCount = 0;
+    uint32_t hash = 0;
+    if (!_provider->finish(_observations, MAX_OBSERVATIONS, observationCount, hash)) {
+        LOG_WARN("WMATA", "%s parse error: %s", _provider->getName(), _provider->getError());
         return false;
     }
     
-    // Reset train count
-    _trainCount = 0;
+    for (int i = 0; i < observationCount; i++) {
+        _observedLines |= lineMaskFromCode(_observations[i].line);
+    }
+    
+    _dataChanged = (_lastFetchTime == 0) || (hash != _responseHash);
+    _responseHash = hash;
+    _observationCount = observationCount;
+    
+    _lastFetchTime = monoMillis();
+    _tracker.update(_observations, observationCount, _lastFetchTime);
+    _buildBoards(_lastFetchTime);
+    
+    LOG_INFO("WMATA", "Parsed %d predictions, tracking %d trains",
+             observationCount, _tracker.getCount());
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    int trainCount = getTrainCount();
+    for (int i = 0; i < trainCount; i++) {
+        TrainPrediction selected = getTrain(i);
+        LOG_DEBUG("WMATA", "  Train %d: %s - %s min (Line %s)",
+                  i + 1, selected.destination, selected.minutes, selected.line);
+    }
+#endif
+    
+    return true;
+}
+
+bool WmataClient::fetchIncidents() {
+    if (!_hasStationInfo) {
+        _hasStationInfo = _fetchStationInfo();
+    }
+    
+    bool fetched = _fetchIncidents();
+    _finishRequest();
+    return fetched;
+}
+
+bool WmataClient::_fetchIncidents() {
+    String url = String(WMATA_INCIDENTS_URL) + "?api_key=" + _apiKey;
+    
+    LOG_DEBUG("WMATA", "Fetching incidents...");
     
-    // Get the Trains array
-    JsonArray trains = doc["Trains"].as<JsonArray>();
+    int httpCode = _get(url, PRIORITY_BACKGROUND);
+    if (httpCode != HTTP_CODE_OK) {
+        LOG_WARN("WMATA", "Incidents HTTP error: %d", httpCode);
+        _endHttp();
+        return false;
+    }
+    
+    size_t length;
+    bool truncated;
+    if (!_readBody(length, truncated)) {
+        return false;
+    }
+    _setPhase(FETCH_PHASE_PARSE);
+    _budget.enter(FETCH_PHASE_PARSE, monoMillis());
     
-    if (trains.isNull()) {
-        Serial.println("[WMATA] No Trains array in response");
+    const char* cursor = jsonFindArray(_bodyBuffer, "Incidents");
+    if (cursor == nullptr) {
+        LOG_WARN("WMATA", "No Incidents array in response");
         return false;
     }
     
-    // Track which groups we've seen (to get one train per direction)
-    // Group "1" and "2" represent opposite directions at a station
-    bool seenGroup1 = false;
-    bool seenGroup2 = false;
+    // Parse one incident at a time and keep only the fields we show,
+    // so parse memory is bounded by a single element
+    JsonDocument filter;
+    filter["Description"] = true;
+    filter["IncidentType"] = true;
+    filter["LinesAffected"] = true;
     
-    // Process trains - get the first train from each group
-    // WMATA returns trains sorted by arrival time, so first occurrence
-    // of each group is the next train in that direction
-    for (JsonObject train : trains) {
-        if (_trainCount >= MAX_TRAINS) break;
-        
-        const char* destination = train["Destination"] | "";
-        const char* minutes = train["Min"] | "";
-        const char* line = train["Line"] | "";
-        const char* group = train["Group"] | "";
-        
-        // Skip trains with empty or invalid data
-        if (strlen(destination) == 0 || strlen(minutes) == 0) {
+    uint8_t stationLines = getStationLines();
+    const char* end = _bodyBuffer + length;
+    const char* element;
+    size_t elementLength;
+    int total = 0;
+    
+    _incidents.reset();
+    while (jsonNextObject(cursor, end, element, elementLength)) {
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, element, elementLength,
+                                                     DeserializationOption::Filter(filter));
+        if (error) {
+            LOG_WARN("WMATA", "Incident parse error: %s", error.c_str());
             continue;
         }
+        total++;
         
-        // Check if we've already got a train for this group
-        bool isGroup1 = (strcmp(group, "1") == 0);
-        bool isGroup2 = (strcmp(group, "2") == 0);
-        
-        if (isGroup1 && seenGroup1) continue;  // Already have Group 1 train
-        if (isGroup2 && seenGroup2) continue;  // Already have Group 2 train
-        
-        // Store this train
-        _parseTrainObject(destination, minutes, line, _trains[_trainCount]);
-        _trainCount++;
-        
-        // Mark group as seen
-        if (isGroup1) seenGroup1 = true;
-        if (isGroup2) seenGroup2 = true;
+        uint8_t lines = parseLineList(doc["LinesAffected"] | "");
+        if ((lines & stationLines) == 0) continue;
         
-        Serial.printf("[WMATA] Selected train for Group %s: %s - %s min\n", 
-                      group, destination, minutes);
+        if (!_incidents.add(lines & stationLines, doc["IncidentType"] | "", doc["Description"] | "")) {
+            break;
+        }
+    }
+    
+    LOG_INFO("WMATA", "%d incidents, %d affect this station%s",
+             total, _incidents.getCount(), truncated ? " (response truncated)" : "");
+    return true;
+}
+
+void WmataClient::setBusStops(const char* const* stopIds, int count) {
+    _busStopIds = stopIds;
+    _busStopCount = count < MAX_BUS_STOPS ? count : MAX_BUS_STOPS;
+}
+
+bool WmataClient::fetchBusPredictions() {
+    if (_busStopCount == 0) return false;
+    
+    int count = 0;
+    for (int i = 0; i < _busStopCount; i++) {
+        bool fetched = _fetchBusStop(i, count);
+        _finishRequest();
+        if (!fetched) return false;
+    }
+    
+    _lastBusFetchTime = monoMillis();
+    _busTracker.update(_busObservations, count, _lastBusFetchTime);
+    for (int i = 0; i < _busStopCount; i++) {
+        _fillBoard(_busTracker, (uint8_t)(i + 1), _lastBusFetchTime, _busBoards[i]);
+    }
+    
+    LOG_INFO("WMATA", "Parsed %d bus predictions at %d stops, tracking %d buses",
+             count, _busStopCount, _busTracker.getCount());
+    return true;
+}
+
+bool WmataClient::_fetchBusStop(int index, int& count) {
+    const char* stopId = _busStopIds[index];
+    String url = String(WMATA_BUS_PREDICTIONS_URL) + "?StopID=" + stopId + "&api_key=" + _apiKey;
+    
+    LOG_DEBUG("WMATA", "Fetching bus predictions for stop %s", stopId);
+    
+    int httpCode = _get(url, PRIORITY_BACKGROUND);
+    if (httpCode != HTTP_CODE_OK) {
+        LOG_WARN("WMATA", "Bus HTTP error: %d", httpCode);
+        _endHttp();
+        return false;
+    }
+    
+    size_t length;
+    bool truncated;
+    if (!_readBody(length, truncated)) {
+        return false;
     }
+    _setPhase(FETCH_PHASE_PARSE);
+    _budget.enter(FETCH_PHASE_PARSE, monoMillis());
+    
+    const char* cursor = jsonFindArray(_bodyBuffer, "Predictions");
+    if (cursor == nullptr) {
+        LOG_WARN("WMATA", "No Predictions array in bus response");
+        return false;
+    }
+    
+    // Parse one prediction at a time, keeping only the fields and the
+    // buses we show, so parse memory is bounded by a single element
+    JsonDocument filter;
+    filter["RouteID"] = true;
+    filter["Minutes"] = true;
     
-    _lastFetchTime = millis();
+    TrainObservation* buses = _busObservations + count;
+    int busCount = 0;
+    const char* end = _bodyBuffer + length;
+    const char* element;
+    size_t elementLength;
+    int total = 0;
     
-    Serial.printf("[WMATA] Parsed %d trains (one per direction)\n", _trainCount);
-    for (int i = 0; i < _trainCount; i++) {
-        Serial.printf("[WMATA]   Train %d: %s - %s min (Line %s)\n", 
-                      i + 1, _trains[i].destination, _trains[i].minutes, _trains[i].line);
+    while (jsonNextObject(cursor, end, element, elementLength)) {
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, element, elementLength,
+                                                     DeserializationOption::Filter(filter));
+        if (error) {
+            LOG_WARN("WMATA", "Bus prediction parse error: %s", error.c_str());
+            continue;
+        }
+        total++;
+        
+        TrainObservation observation;
+        if (!parseBusPrediction(doc["RouteID"] | "", doc["Minutes"] | -1L, (uint8_t)(index + 1), observation)) {
+            continue;
+        }
+        busCount = keepSoonest(buses, busCount, MAX_BUS_PER_STOP, observation);
     }
+    count += busCount;
     
+    LOG_DEBUG("WMATA", "%d buses due at stop %s, %d kept%s",
+              total, stopId, busCount, truncated ? " (response truncated)" : "");
     return true;
 }
 
+const GroupBoard* WmataClient::findBusBoard(uint8_t stop) const {
+    if (stop < 1 || stop > _busStopCount || _lastBusFetchTime == 0) return nullptr;
+    if (monoMillis() - _lastBusFetchTime > WMATA_BUS_STALE_MS) return nullptr;
+    
+    const GroupBoard& board = _busBoards[stop - 1];
+    return board.count > 0 ? &board : nullptr;
+}
+
+const TrainTracker& WmataClient::getBusTracker() const {
+    return _busTracker;
+}
+
+const IncidentList& WmataClient::getIncidents() const {
+    return _incidents;
+}
+
+uint8_t WmataClient::getStationLines() const {
+    return _infoLines | _observedLines;
+}
+
+unsigned long WmataClient::getRequestCount() const {
+    return _requestCount;
+}
+
+unsigned long WmataClient::getFetchSuccessCount() const {
+    return _fetchSuccesses;
+}
+
+unsigned long WmataClient::getFetchFailureCount() const {
+    return _fetchFailures;
+}
+
+const LatencyHistogram& WmataClient::getFetchLatency() const {
+    return _fetchLatency;
+}
+
+bool WmataClient::wasThrottled() const {
+    return _throttled;
+}
+
+void WmataClient::setPhaseListener(FetchPhaseListener listener, void* context) {
+    _phaseListener = listener;
+    _phaseContext = context;
+}
+
+uint8_t WmataClient::getPhase() const {
+    return _phase;
+}
+
+const FetchBudget& WmataClient::getFetchBudget() const {
+    return _budget;
+}
+
+const DnsCache& WmataClient::getDnsCache() const {
+    return _dns;
+}
+
+void WmataClient::abortRequest() {
+    // The lock keeps the loop from closing the socket (and the descriptor
+    // being reused) between reading it and shutting it down
+    xSemaphoreTake(_socketLock, portMAX_DELAY);
+    if (_activeFd >= 0) {
+        // Wakes a blocked recv()/select(); the owner closes the socket
+        shutdown(_activeFd, SHUT_RDWR);
+    }
+    xSemaphoreGive(_socketLock);
+}
+
+void WmataClient::_publishSocket(int fd) {
+    xSemaphoreTake(_socketLock, portMAX_DELAY);
+    _activeFd = fd;
+    xSemaphoreGive(_socketLock);
+}
+
+void WmataClient::_endHttp() {
+    _publishSocket(-1);
+    _http.end();
+}
+
+void WmataClient::_setPhase(uint8_t phase) {
+    if (phase == _phase) return;
+    _phase = phase;
+    bool waiting = phase == FETCH_PHASE_FIRST_BYTE || phase == FETCH_PHASE_BODY;
+    _publishSocket(waiting ? _wifiClient.fd() : -1);
+    if (_phaseListener != nullptr) {
+        _phaseListener(phase, _phaseContext);
+    }
+}
+
+void WmataClient::fillSnapshot(PredictionSnapshot& snapshot, uint64_t nowMs) const {
+    snapshot.responseHash = _responseHash;
+    snapshot.ageMs = (uint32_t)(nowMs - _lastFetchTime);
+    snapshot.flags = _dataChanged ? SNAPSHOT_FLAG_CHANGED : 0;
+    
+    strncpy(snapshot.station, _stationCode, SNAPSHOT_STATION_LEN - 1);
+    snapshot.station[SNAPSHOT_STATION_LEN - 1] = '\0';
+    snapshot.stationLines = getStationLines();
+    
+    snapshot.trainCount = _observationCount < SNAPSHOT_MAX_TRAINS ? _observationCount : SNAPSHOT_MAX_TRAINS;
+    memcpy(snapshot.trains, _observations, snapshot.trainCount * sizeof(TrainObservation));
+    snapshot.incidents = _incidents;
+}
+
+void WmataClient::applySnapshot(const PredictionSnapshot& snapshot, uint64_t nowMs) {
+    _dataChanged = (_lastFetchTime == 0) || (snapshot.responseHash != _responseHash);
+    _responseHash = snapshot.responseHash;
+    
+    _observationCount = snapshot.trainCount < MAX_OBSERVATIONS ? snapshot.trainCount : MAX_OBSERVATIONS;
+    memcpy(_observations, snapshot.trains, _observationCount * sizeof(TrainObservation));
+    _observedLines |= snapshot.stationLines;
+    _incidents = snapshot.incidents;
+    
+    _lastFetchTime = nowMs - snapshot.ageMs;
+    _tracker.update(_observations, _observationCount, _lastFetchTime);
+    _buildBoards(nowMs);
+}
+
 int WmataClient::getTrainCount() const {
-    return _trainCount;
+    int boards[MAX_TRAINS];
+    return _liveBoards(monoMillis(), boards);
 }
 
 TrainPrediction WmataClient::getTrain(int index) const {
-    if (index >= 0 && index < _trainCount) {
-        return _trains[index];
+    TrainPrediction prediction;
+    prediction.destination[0] = '\0';
+    prediction.minutes[0] = '\0';
+    prediction.line[0] = '\0';
+    prediction.arrival = 0;
+    
+    uint64_t now = monoMillis();
+    int boards[MAX_TRAINS];
+    int count = _liveBoards(now, boards);
+    if (index < 0 || index >= count) {
+        // Return empty prediction for invalid index
+        return prediction;
+    }
+    
+    const GroupBoard& board = _boards[boards[index]];
+    bool nextBoarding = board.count > 0 && board.trains[0].status == TRAIN_BOARDING;
+    
+    // Briefly show a train that just left, unless the next one is already boarding
+    DepartureEvent departure;
+    if (!nextBoarding && _tracker.getRecentDeparture(board.group, now, departure)) {
+        memcpy(prediction.destination, departure.destination, DEST_MAX_LEN);
+        memcpy(prediction.line, departure.line, LINE_MAX_LEN);
+        strncpy(prediction.minutes, "LFT", MIN_MAX_LEN);
+        return prediction;
     }
-    // Return empty prediction for invalid index
-    TrainPrediction empty;
-    empty.destination[0] = '\0';
-    empty.minutes[0] = '\0';
-    empty.line[0] = '\0';
-    return empty;
+    
+    if (board.count > 0) {
+        const TrackedTrain& train = board.trains[0];
+        memcpy(prediction.destination, train.destination, DEST_MAX_LEN);
+        memcpy(prediction.line, train.line, LINE_MAX_LEN);
+        _tracker.formatMinutes(train, now, prediction.minutes, MIN_MAX_LEN);
+        prediction.arrival = board.arrivals[0];
+    }
+    return prediction;
+}
+
+const GroupBoard* WmataClient::findBoard(uint8_t group) const {
+    for (int i = 0; i < _boardCount; i++) {
+        if (_boards[i].group == group && _boards[i].count > 0) return &_boards[i];
+    }
+    return nullptr;
+}
+
+const TrainTracker& WmataClient::getTracker() const {
+    return _tracker;
+}
+
+bool WmataClient::hasDataChanged() const {
+    return _dataChanged;
 }
 
-unsigned long WmataClient::getLastFetchTime() const {
+uint64_t WmataClient::getLastFetchTime() const {
     return _lastFetchTime;
 }
 
@@ -144,16 +619,252 @@ const char* WmataClient::getStationCode() const {
     return _stationCode;
 }
 
-void WmataClient::_parseTrainObject(const char* destination, const char* minutes, const char* line, TrainPrediction& prediction) {
-    // Copy destination (truncated to fit LED display)
-    strncpy(prediction.destination, destination, DEST_MAX_LEN - 1);
-    prediction.destination[DEST_MAX_LEN - 1] = '\0';
+void WmataClient::reconfigure(const char* stationCode, const char* apiKey) {
+    // The JSON provider reads these buffers, so it follows along
+    strncpy(_apiKey, apiKey, sizeof(_apiKey) - 1);
+    _apiKey[sizeof(_apiKey) - 1] = '\0';
+    if (strncmp(_stationCode, stationCode, sizeof(_stationCode) - 1) == 0) return;
+    
+    strncpy(_stationCode, stationCode, sizeof(_stationCode) - 1);
+    _stationCode[sizeof(_stationCode) - 1] = '\0';
+    
+    _tracker.reset();
+    _boardCount = 0;
+    _observationCount = 0;
+    _lastFetchTime = 0;
+    _responseHash = 0;
+    _dataChanged = true;
     
-    // Copy minutes
-    strncpy(prediction.minutes, minutes, MIN_MAX_LEN - 1);
-    prediction.minutes[MIN_MAX_LEN - 1] = '\0';
+    _incidents.reset();
+    _hasStationInfo = false;
+    _infoLines = 0;
+    _observedLines = 0;
     
-    // Copy line code
-    strncpy(prediction.line, line, LINE_MAX_LEN - 1);
-    prediction.line[LINE_MAX_LEN - 1] = '\0';
+    LOG_INFO("WMATA", "Now tracking station %s", _stationCode);
+}
+
+int WmataClient::_selectGroups(uint64_t nowMs, uint8_t groups[MAX_TRAINS]) const {
+    int count = 0;
+    
+    // Lowest groups first, so each direction keeps its row
+    int lastGroup = -1;
+    while (count < MAX_TRAINS) {
+        int nextGroup = 256;
+        for (int i = 0; i < _tracker.getCount(); i++) {
+            int group = _tracker.getTrain(i).group;
+            if (group > lastGroup && group < nextGroup) nextGroup = group;
+        }
+        
+        // A direction whose last train just left keeps its row for "LFT"
+        for (int n = 0; n < _tracker.getDepartureCount(); n++) {
+            const DepartureEvent& departure = _tracker.getDeparture(n);
+            if (departure.group > lastGroup && departure.group < nextGroup &&
+                nowMs - departure.departedMs <= TRACK_DEPARTED_HOLD_MS) {
+                nextGroup = departure.group;
+            }
+        }
+        
+        if (nextGroup > 255) break;
+        groups[count++] = (uint8_t)nextGroup;
+        lastGroup = nextGroup;
+    }
+    return count;
+}
+
+void WmataClient::_buildBoards(uint64_t nowMs) {
+    uint8_t groups[MAX_TRAINS];
+    _boardCount = _selectGroups(nowMs, groups);
+    for (int i = 0; i < _boardCount; i++) {
+        _fillBoard(_tracker, groups[i], nowMs, _boards[i]);
+    }
+}
+
+void WmataClient::_fillBoard(const TrainTracker& tracker, uint8_t group, uint64_t nowMs, GroupBoard& board) const {
+    // Wall clock as of nowMs; arrivals are left at 0 until NTP sets it
+    time_t wallNow = time(nullptr) - (time_t)((monoMillis() - nowMs) / 1000);
+    bool clockSet = isClockSet(wallNow);
+    
+    board.group = group;
+    board.count = (uint8_t)tracker.findUpcoming(group, nowMs, board.trains, MAX_TRAINS_PER_GROUP);
+    for (int n = 0; n < board.count; n++) {
+        long etaMs = tracker.getEtaMs(board.trains[n], nowMs);
+        board.arrivals[n] = clockSet ? wallNow + (time_t)((etaMs + 500) / 1000) : 0;
+    }
+}
+
+int WmataClient::_liveBoards(uint64_t nowMs, int indices[MAX_TRAINS]) const {
+    int count = 0;
+    DepartureEvent departure;
+    for (int i = 0; i < _boardCount; i++) {
+        if (_boards[i].count > 0 || _tracker.getRecentDeparture(_boards[i].group, nowMs, departure)) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+int WmataClient::_get(const String& url, RequestPriority priority) {
+    _throttled = false;
+    
+    if (_governor != nullptr) {
+        // Predictions are worth a short wait; background requests just try later
+        unsigned long waitMs = _governor->getWaitMs(priority, monoMillis());
+        if (priority == PRIORITY_HIGH && waitMs > 0 && waitMs <= WMATA_MAX_TOKEN_WAIT_MS) {
+            delay(waitMs);
+        }
+        if (!_governor->tryAcquire(priority, monoMillis())) {
+            _throttled = true;
+            return WMATA_ERROR_THROTTLED;
+        }
+    }
+    
+    char host[sizeof(_host)];
+    uint16_t port;
+    if (!_parseUrlHost(url.c_str(), host, sizeof(host), port)) {
+        LOG_ERROR("WMATA", "Only http:// URLs with short host names can be fetched");
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    
+    _requestCount++;
+    _requestStartMs = monoMillis();
+    _budget.start(_requestStartMs);
+    
+    // An open connection to another host can't be reused
+    if (strcmp(host, _host) != 0) {
+        _wifiClient.stop();
+    }
+    
+    // HTTPClient reuses a connection that is already open, so opening it
+    // here lets DNS and connect be timed separately
+    if (!_wifiClient.connected()) {
+        _setPhase(FETCH_PHASE_DNS);
+        _budget.enter(FETCH_PHASE_DNS, monoMillis());
+        uint32_t address;
+        DnsLookupResult lookup = _dns.lookup(host, monoMillis(), address);
+        if (!_budget.check(monoMillis())) return _abortOverBudget();
+        if (lookup == DNS_FAILED) {
+            LOG_WARN("WMATA", "Could not resolve %s", host);
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        if (lookup == DNS_STALE) {
+            LOG_DEBUG("WMATA", "Resolver down; using last known address of %s", host);
+        }
+        
+        _setPhase(FETCH_PHASE_CONNECT);
+        unsigned long connectMs = _budget.enter(FETCH_PHASE_CONNECT, monoMillis());
+        bool connected = _wifiClient.connect(IPAddress(address), port, (int32_t)connectMs);
+        if (!connected) {
+            // The host may have moved; look it up again next time
+            _dns.invalidate(host);
+        }
+        if (!_budget.check(monoMillis())) return _abortOverBudget();
+        if (!connected) return HTTPC_ERROR_CONNECTION_REFUSED;
+        strcpy(_host, host);
+    }
+    
+    _setPhase(FETCH_PHASE_FIRST_BYTE);
+    _http.setTimeout((uint16_t)_budget.enter(FETCH_PHASE_FIRST_BYTE, monoMillis()));
+    _http.begin(_wifiClient, url);
+    int httpCode = _http.GET();
+    if (!_budget.check(monoMillis())) return _abortOverBudget();
+    
+    if (httpCode == 429 && _governor != nullptr) {
+        _governor->onRateLimited(monoMillis());
+    }
+    return httpCode;
+}
+
+bool WmataClient::_readBody(size_t& length, bool& truncated) {
+    _setPhase(FETCH_PHASE_BODY);
+    _http.setTimeout((uint16_t)_budget.enter(FETCH_PHASE_BODY, monoMillis()));
+    
+    BoundedBufferStream body(_bodyBuffer, sizeof(_bodyBuffer), _budget.getPhaseDeadline());
+    bool received = _receive(body);
+    length = body.length();
+    truncated = body.truncated();
+    return received;
+}
+
+bool WmataClient::_streamBody() {
+    _setPhase(FETCH_PHASE_BODY);
+    _http.setTimeout((uint16_t)_budget.enter(FETCH_PHASE_BODY, monoMillis()));
+    
+    ProviderStream body(*_provider, _budget.getPhaseDeadline());
+    return _receive(body);
+}
+
+bool WmataClient::_receive(DeadlineStream& body) {
+    _http.writeToStream(&body);
+    
+    if (body.timedOut() || !_budget.check(monoMillis())) {
+        _abortOverBudget();
+        return false;
+    }
+    
+    _endHttp();
+    if (body.refused()) {
+        // The rest of the response is still in flight; don't reuse the connection
+        _wifiClient.stop();
+    }
+    return true;
+}
+
+int WmataClient::_abortOverBudget() {
+    _endHttp();
+    _wifiClient.stop();
+    LOG_WARN("WMATA", "Request over budget in %s phase%s", fetchPhaseName(_budget.getOverrunPhase()),
+             _budget.wasTotalOverrun() ? " (total cap)" : "");
+    return WMATA_ERROR_TIMEOUT;
+}
+
+void WmataClient::_finishRequest() {
+    if (_phase == FETCH_PHASE_PARSE && !_budget.check(monoMillis())) {
+        LOG_WARN("WMATA", "Request over budget in parse phase (%lu ms in all)",
+                 (unsigned long)(monoMillis() - _requestStartMs));
+    }
+    _setPhase(FETCH_PHASE_IDLE);
+}
+
+bool WmataClient::_fetchStationInfo() {
+    String url = String(WMATA_STATION_INFO_URL) + "?StationCode=" + _stationCode + "&api_key=" + _apiKey;
+    
+    int httpCode = _get(url, PRIORITY_BACKGROUND);
+    if (httpCode != HTTP_CODE_OK) {
+        LOG_WARN("WMATA", "Station info HTTP error: %d", httpCode);
+        _endHttp();
+        return false;
+    }
+    
+    size_t length;
+    bool truncated;
+    if (!_readBody(length, truncated)) {
+        return false;
+    }
+    
+    JsonDocument filter;
+    filter["LineCode1"] = true;
+    filter["LineCode2"] = true;
+    filter["LineCode3"] = true;
+    filter["LineCode4"] = true;
+    
+    _setPhase(FETCH_PHASE_PARSE);
+    _budget.enter(FETCH_PHASE_PARSE, monoMillis());
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, _bodyBuffer, length,
+                                                 DeserializationOption::Filter(filter));
+    if (error) {
+        LOG_WARN("WMATA", "Station info parse error: %s", error.c_str());
+        return false;
+    }
+    
+    // Unused line slots are null
+    _infoLines = lineMaskFromCode(doc["LineCode1"] | "") |
+                 lineMaskFromCode(doc["LineCode2"] | "") |
+                 lineMaskFromCode(doc["LineCode3"] | "") |
+                 lineMaskFromCode(doc["LineCode4"] | "");
+    
+    char lines[24];
+    formatLineMask(_infoLines, lines, sizeof(lines));
+    LOG_INFO("WMATA", "Station %s serves %s", _stationCode, lines);
+    return true;
 }
@@ -0,0 +1,134 @@
+#include "wmata_json_provider.h"
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Base URL for WMATA StationPrediction API
+static const char* WMATA_API_BASE_URL = "http://api.wmata.com/StationPrediction.svc/json/GetPrediction/";
+
+// FNV-1a parameters used to fingerprint responses
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+/**
+ * Fold a string (including its terminator) into an FNV-1a hash
+ */
+static uint32_t _hashString(uint32_t hash, const char* str) {
+    do {
+        hash ^= (uint8_t)*str;
+        hash *= FNV_PRIME;
+    } while (*str++);
+    return hash;
+}
+
+WmataJsonProvider::WmataJsonProvider(const char* stationCode, const char* apiKey, char* buffer, size_t size)
+    : _stationCode(stationCode), _apiKey(apiKey), _buffer(buffer), _size(size),
+      _length(0), _truncated(false), _error("") {}
+
+const char* WmataJsonProvider::getName() const {
+    return "WMATA";
+}
+
+bool WmataJsonProvider::buildUrl(char* url, size_t size) const {
+    int written = snprintf(url, size, "%s%s?contentType=application/json&api_key=%s",
+                           WMATA_API_BASE_URL, _stationCode, _apiKey);
+    return written > 0 && (size_t)written < size;
+}
+
+void WmataJsonProvider::begin(time_t wallNow) {
+    _length = 0;
+    _truncated = false;
+    _error = "";
+    _buffer[0] = '\0';
+}
+
+size_t WmataJsonProvider::write(const uint8_t* data, size_t length) {
+    size_t room = _size - 1 - _length;
+    if (length > room) {
+        length = room;
+        _truncated = true;
+    }
+    memcpy(_buffer + _length, data, length);
+    _length += length;
+    _buffer[_length] = '\0';
+    return length;
+}
+
+bool WmataJsonProvider::finish(TrainObservation* observations, int maxCount, int& count, uint32_t& hash) {
+    count = 0;
+    if (_truncated) {
+        _error = "response larger than the body buffer";
+        return false;
+    }
+
+    // Parse JSON response
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, _buffer, _length);
+
+    if (error) {
+        _error = error.c_str();
+        return false;
+    }
+
+    // Get the Trains array
+    JsonArray trains = doc["Trains"].as<JsonArray>();
+
+    if (trains.isNull()) {
+        _error = "no Trains array in response";
+        return false;
+    }
+
+    // Normalize every prediction for the tracker, and fingerprint them all
+    // so we can tell when WMATA has refreshed its feed
+    hash = FNV_OFFSET_BASIS;
+
+    for (JsonObject train : trains) {
+        const char* cars = train["Car"] | "";
+        const char* destination = train["Destination"] | "";
+        const char* group = train["Group"] | "";
+        const char* line = train["Line"] | "";
+        const char* minutes = train["Min"] | "";
+
+        hash = _hashString(hash, cars);
+        hash = _hashString(hash, destination);
+        hash = _hashString(hash, group);
+        hash = _hashString(hash, line);
+        hash = _hashString(hash, train["LocationCode"] | "");
+        hash = _hashString(hash, minutes);
+
+        if (count >= maxCount) continue;
+
+        // Skip trains with empty or invalid data
+        if (strlen(destination) == 0) {
+            continue;
+        }
+
+        TrainObservation& observation = observations[count];
+        if (!parseTrainMinutes(minutes, observation.status, observation.etaMs)) {
+            continue;
+        }
+
+        _parseTrainObject(destination, line, group, cars, observation);
+        count++;
+    }
+    return true;
+}
+
+const char* WmataJsonProvider::getError() const {
+    return _error;
+}
+
+void WmataJsonProvider::_parseTrainObject(const char* destination, const char* line, const char* group, const char* cars, TrainObservation& observation) {
+    // Copy destination (truncated to fit LED display)
+    strncpy(observation.destination, destination, DEST_MAX_LEN - 1);
+    observation.destination[DEST_MAX_LEN - 1] = '\0';
+
+    // Copy line code
+    strncpy(observation.line, line, LINE_MAX_LEN - 1);
+    observation.line[LINE_MAX_LEN - 1] = '\0';
+
+    // "-" or an empty field means unknown; atoi() gives 0 for those
+    observation.group = (uint8_t)atoi(group);
+    observation.cars = (uint8_t)atoi(cars);
+}
@@ -0,0 +1,178 @@
+/**
+ * Unit tests for bus prediction normalization
+ *
+ * Tests turning WMATA bus predictions into tracker records, keeping the
+ * soonest buses per stop in a fixed list, and tracking them by stop.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "bus_predictions.h"
+
+/**
+ * Build a bus observation the way WmataClient does from a JSON prediction
+ */
+TrainObservation makeBus(const char* route, long minutes, uint8_t stop = 1) {
+    TrainObservation observation;
+    memset(&observation, 0, sizeof(observation));
+    parseBusPrediction(route, minutes, stop, observation);
+    return observation;
+}
+
+// ============================================================================
+// Normalization Tests
+// ============================================================================
+
+void test_bus_fields_normalized() {
+    TrainObservation observation;
+    TEST_ASSERT_TRUE(parseBusPrediction("D4", 7, 2, observation));
+    TEST_ASSERT_EQUAL_STRING("D4", observation.destination);
+    TEST_ASSERT_EQUAL_STRING("", observation.line);
+    TEST_ASSERT_EQUAL(2, observation.group);
+    TEST_ASSERT_EQUAL(0, observation.cars);
+    TEST_ASSERT_EQUAL(TRAIN_MOVING, observation.status);
+    TEST_ASSERT_EQUAL(7 * 60000L + 30000L, observation.etaMs);
+}
+
+void test_bus_zero_minutes_is_arriving() {
+    TrainObservation observation;
+    TEST_ASSERT_TRUE(parseBusPrediction("X2", 0, 1, observation));
+    TEST_ASSERT_EQUAL(TRAIN_ARRIVING, observation.status);
+    TEST_ASSERT_EQUAL(ARRIVING_ETA_MS, observation.etaMs);
+}
+
+void test_bus_long_route_truncated() {
+    TrainObservation observation;
+    TEST_ASSERT_TRUE(parseBusPrediction("MW1X2", 3, 1, observation));
+    TEST_ASSERT_EQUAL_STRING("MW1X", observation.destination);
+}
+
+void test_bus_invalid_rejected() {
+    TrainObservation observation;
+    TEST_ASSERT_FALSE(parseBusPrediction("", 3, 1, observation));
+    TEST_ASSERT_FALSE(parseBusPrediction(nullptr, 3, 1, observation));
+    TEST_ASSERT_FALSE(parseBusPrediction("D4", -1, 1, observation));
+}
+
+void test_bus_minutes_capped() {
+    TrainObservation observation;
+    TEST_ASSERT_TRUE(parseBusPrediction("D4", 5000, 1, observation));
+    TEST_ASSERT_EQUAL(999 * 60000L + 30000L, observation.etaMs);
+}
+
+// ============================================================================
+// Soonest-K Tests
+// ============================================================================
+
+void test_keep_soonest_sorts() {
+    TrainObservation list[MAX_BUS_PER_STOP];
+    int count = 0;
+    count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("D4", 9));
+    count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("X2", 2));
+    count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("90", 5));
+
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL_STRING("X2", list[0].destination);
+    TEST_ASSERT_EQUAL_STRING("90", list[1].destination);
+    TEST_ASSERT_EQUAL_STRING("D4", list[2].destination);
+}
+
+void test_keep_soonest_bounded() {
+    // However many routes serve the stop, only the soonest are kept
+    TrainObservation list[MAX_BUS_PER_STOP];
+    int count = 0;
+    for (long minutes = 40; minutes > 0; minutes--) {
+        count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("D4", minutes));
+    }
+
+    TEST_ASSERT_EQUAL(MAX_BUS_PER_STOP, count);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL((i + 1) * 60000L + 30000L, list[i].etaMs);
+    }
+}
+
+void test_keep_soonest_drops_later_when_full() {
+    TrainObservation list[2];
+    int count = 0;
+    count = keepSoonest(list, count, 2, makeBus("D4", 1));
+    count = keepSoonest(list, count, 2, makeBus("X2", 2));
+    count = keepSoonest(list, count, 2, makeBus("90", 3));
+
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL_STRING("D4", list[0].destination);
+    TEST_ASSERT_EQUAL_STRING("X2", list[1].destination);
+}
+
+void test_keep_soonest_ties_keep_feed_order() {
+    TrainObservation list[MAX_BUS_PER_STOP];
+    int count = 0;
+    count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("D4", 4));
+    count = keepSoonest(list, count, MAX_BUS_PER_STOP, makeBus("X2", 4));
+
+    TEST_ASSERT_EQUAL_STRING("D4", list[0].destination);
+    TEST_ASSERT_EQUAL_STRING("X2", list[1].destination);
+}
+
+// ============================================================================
+// Tracking Tests
+// ============================================================================
+
+void test_stops_tracked_apart() {
+    // The same route at two stops is two buses, one on each stop's board
+    TrainObservation buses[] = {makeBus("D4", 3, 1), makeBus("D4", 3, 2)};
+    TrainTracker tracker;
+    tracker.update(buses, 2, 0);
+
+    TrackedTrain upcoming[MAX_BUS_PER_STOP];
+    TEST_ASSERT_EQUAL(2, tracker.getCount());
+    TEST_ASSERT_EQUAL(1, tracker.findUpcoming(1, 0, upcoming, MAX_BUS_PER_STOP));
+    TEST_ASSERT_EQUAL(1, tracker.findUpcoming(2, 0, upcoming, MAX_BUS_PER_STOP));
+}
+
+void test_bus_counts_down_between_polls() {
+    TrainObservation bus = makeBus("D4", 5);
+    TrainTracker tracker;
+    tracker.update(&bus, 1, 0);
+
+    char minutes[MIN_MAX_LEN];
+    tracker.formatMinutes(tracker.getTrain(0), 2 * 60000UL, minutes, sizeof(minutes));
+    TEST_ASSERT_EQUAL_STRING("3", minutes);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Normalization
+    RUN_TEST(test_bus_fields_normalized);
+    RUN_TEST(test_bus_zero_minutes_is_arriving);
+    RUN_TEST(test_bus_long_route_truncated);
+    RUN_TEST(test_bus_invalid_rejected);
+    RUN_TEST(test_bus_minutes_capped);
+
+    // Soonest-K
+    RUN_TEST(test_keep_soonest_sorts);
+    RUN_TEST(test_keep_soonest_bounded);
+    RUN_TEST(test_keep_soonest_drops_later_when_full);
+    RUN_TEST(test_keep_soonest_ties_keep_feed_order);
+
+    // Tracking
+    RUN_TEST(test_stops_tracked_apart);
+    RUN_TEST(test_bus_counts_down_between_polls);
+
+    return UNITY_END();
+}
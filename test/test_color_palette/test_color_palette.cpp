@@ -0,0 +1,187 @@
+/**
+ * Unit tests for the gamma tables and line palette
+ *
+ * Tests the gamma curve, dimming, the compile-time tables against the
+ * constexpr functions they were built from, and what the palette looks
+ * like once drawn into a shadow frame and read back as the frame mirror
+ * would show it. These tests run natively on your computer without ESP32
+ * hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "color_palette.h"
+#include "frame_buffer.h"
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static uint16_t pixels[WIDTH * HEIGHT];
+
+// Worked out by the compiler
+static_assert(correctedColor565({255, 255, 255}, 100) == 0xFFFF, "white");
+static_assert(correctedColor565({0, 0, 0}, 10) == 0, "black");
+static_assert(gammaLevel(255, 10, 5) == 3, "dimmed full red");
+
+/**
+ * Expand an RGB565 pixel to 8 bits per channel, as the PNG mirror does
+ */
+static Rgb888 expand565(uint16_t color) {
+    uint8_t r = (color >> 11) & 0x1F;
+    uint8_t g = (color >> 5) & 0x3F;
+    uint8_t b = color & 0x1F;
+    Rgb888 rgb = {(uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2))};
+    return rgb;
+}
+
+// ============================================================================
+// Gamma Tests
+// ============================================================================
+
+void test_gamma_ends_fixed() {
+    TEST_ASSERT_EQUAL(0, gammaLevel(0, 100, 5));
+    TEST_ASSERT_EQUAL(31, gammaLevel(255, 100, 5));
+    TEST_ASSERT_EQUAL(63, gammaLevel(255, 100, 6));
+}
+
+void test_gamma_darkens_midtones() {
+    // Half value is about a fifth of the light (0.5^2.2 = 0.22)
+    TEST_ASSERT_EQUAL(14, gammaLevel(128, 100, 6));
+    TEST_ASSERT_EQUAL(7, gammaLevel(128, 100, 5));
+}
+
+void test_gamma_never_decreases() {
+    for (int level = 0; level < DIM_LEVELS; level++) {
+        for (int value = 1; value < 256; value++) {
+            TEST_ASSERT_TRUE(GAMMA_TABLES[level].red[value] >= GAMMA_TABLES[level].red[value - 1]);
+            TEST_ASSERT_TRUE(GAMMA_TABLES[level].green[value] >= GAMMA_TABLES[level].green[value - 1]);
+        }
+    }
+}
+
+void test_lit_channel_stays_lit() {
+    TEST_ASSERT_EQUAL(1, gammaLevel(1, 100, 5));
+    TEST_ASSERT_EQUAL(1, gammaLevel(60, 10, 6));
+    TEST_ASSERT_EQUAL(1, GAMMA_TABLES[DIM_LEVELS - 1].red[1]);
+}
+
+// ============================================================================
+// Table Tests
+// ============================================================================
+
+void test_tables_match_functions() {
+    static const uint8_t percents[DIM_LEVELS] = DIM_LEVEL_PERCENTS;
+    for (int level = 0; level < DIM_LEVELS; level++) {
+        for (int value = 0; value < 256; value += 17) {
+            TEST_ASSERT_EQUAL(gammaLevel(value, percents[level], 5), GAMMA_TABLES[level].red[value]);
+            TEST_ASSERT_EQUAL(gammaLevel(value, percents[level], 6), GAMMA_TABLES[level].green[value]);
+        }
+        for (int color = 0; color < PALETTE_SIZE; color++) {
+            const Rgb888& rgb = PALETTE_RGB[color];
+            TEST_ASSERT_EQUAL_HEX16(correctedColor565(rgb, percents[level]), PALETTE_TABLES[level].color[color]);
+            TEST_ASSERT_EQUAL_HEX16(gammaColor565(rgb.r, rgb.g, rgb.b, level), PALETTE_TABLES[level].color[color]);
+        }
+    }
+}
+
+void test_palette_values() {
+    TEST_ASSERT_EQUAL_HEX16(0xF800, PALETTE_TABLES[0].color[COLOR_LINE_RD]);
+    TEST_ASSERT_EQUAL_HEX16(0x001F, PALETTE_TABLES[0].color[COLOR_LINE_BL]);
+    TEST_ASSERT_EQUAL_HEX16(0x07E0, PALETTE_TABLES[0].color[COLOR_LINE_GR]);
+    TEST_ASSERT_EQUAL_HEX16(0xF9C0, PALETTE_TABLES[0].color[COLOR_LINE_OR]);
+    TEST_ASSERT_EQUAL_HEX16(0x8C51, PALETTE_TABLES[0].color[COLOR_LINE_SV]);
+    TEST_ASSERT_EQUAL_HEX16(0xFAE0, PALETTE_TABLES[0].color[COLOR_AMBER]);
+    TEST_ASSERT_EQUAL_HEX16(0x1840, PALETTE_TABLES[3].color[COLOR_AMBER]);
+}
+
+void test_out_of_range_level_clamped() {
+    TEST_ASSERT_EQUAL_HEX16(gammaColor565(255, 160, 0, DIM_LEVELS - 1), gammaColor565(255, 160, 0, 200));
+}
+
+void test_line_codes() {
+    TEST_ASSERT_EQUAL(COLOR_LINE_RD, lineColor("RD"));
+    TEST_ASSERT_EQUAL(COLOR_LINE_SV, lineColor("SV"));
+    TEST_ASSERT_EQUAL(COLOR_LINE_YL, lineColor("YL"));
+    TEST_ASSERT_EQUAL(COLOR_WHITE, lineColor("XX"));
+    TEST_ASSERT_EQUAL(COLOR_WHITE, lineColor(""));
+}
+
+// ============================================================================
+// Rendering Tests
+// ============================================================================
+
+void test_rendered_palette_keeps_hues() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    for (int level = 0; level < DIM_LEVELS; level++) {
+        for (int color = 0; color < PALETTE_SIZE; color++) {
+            frame.fillRect(color * 5, level * 8, 5, 8, PALETTE_TABLES[level].color[color]);
+        }
+    }
+
+    for (int level = 0; level < DIM_LEVELS; level++) {
+        int y = level * 8 + 4;
+        Rgb888 black = expand565(frame.getPixel(COLOR_BLACK * 5 + 2, y));
+        Rgb888 white = expand565(frame.getPixel(COLOR_WHITE * 5 + 2, y));
+        Rgb888 amber = expand565(frame.getPixel(COLOR_AMBER * 5 + 2, y));
+        Rgb888 orange = expand565(frame.getPixel(COLOR_LINE_OR * 5 + 2, y));
+        Rgb888 silver = expand565(frame.getPixel(COLOR_LINE_SV * 5 + 2, y));
+
+        TEST_ASSERT_EQUAL(0, black.r + black.g + black.b);
+        TEST_ASSERT_TRUE(white.r > 0 && white.r == white.b);
+        TEST_ASSERT_TRUE(silver.r > 0 && silver.r < white.r);
+
+        // Amber is between orange and yellow: red, some green, no blue
+        TEST_ASSERT_TRUE(amber.r > amber.g && amber.g > 0 && amber.b == 0);
+        TEST_ASSERT_TRUE(orange.r > orange.g && orange.g > 0 && orange.g <= amber.g);
+    }
+}
+
+void test_dimming_darkens_rendered_colors() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    for (int level = 0; level < DIM_LEVELS; level++) {
+        frame.setPixel(level, 0, PALETTE_TABLES[level].color[COLOR_WHITE]);
+        frame.setPixel(level, 1, PALETTE_TABLES[level].color[COLOR_LINE_GR]);
+    }
+
+    for (int level = 1; level < DIM_LEVELS; level++) {
+        TEST_ASSERT_TRUE(expand565(frame.getPixel(level, 0)).r < expand565(frame.getPixel(level - 1, 0)).r);
+        TEST_ASSERT_TRUE(expand565(frame.getPixel(level, 1)).g < expand565(frame.getPixel(level - 1, 1)).g);
+    }
+    // Half brightness is half the light, not half the value
+    TEST_ASSERT_EQUAL(16, frame.getPixel(1, 0) >> 11);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Gamma
+    RUN_TEST(test_gamma_ends_fixed);
+    RUN_TEST(test_gamma_darkens_midtones);
+    RUN_TEST(test_gamma_never_decreases);
+    RUN_TEST(test_lit_channel_stays_lit);
+
+    // Tables
+    RUN_TEST(test_tables_match_functions);
+    RUN_TEST(test_palette_values);
+    RUN_TEST(test_out_of_range_level_clamped);
+    RUN_TEST(test_line_codes);
+
+    // Rendering
+    RUN_TEST(test_rendered_palette_keeps_hues);
+    RUN_TEST(test_dimming_darkens_rendered_colors);
+
+    return UNITY_END();
+}
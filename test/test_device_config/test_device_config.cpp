@@ -0,0 +1,275 @@
+/**
+ * Unit tests for the stored device config
+ *
+ * Tests the versioned blob format (round trip, checksum, unknown and
+ * missing fields), field validation, form updates and change detection.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "device_config.h"
+
+static DeviceConfig config;
+
+/**
+ * Recompute a blob's checksum after a test edits it (FNV-1a, little-endian)
+ */
+static void resealBlob(uint8_t* blob, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length - 4; i++) {
+        hash ^= blob[i];
+        hash *= 16777619u;
+    }
+    for (int i = 0; i < 4; i++) {
+        blob[length - 4 + i] = (uint8_t)(hash >> (8 * i));
+    }
+}
+
+// ============================================================================
+// Blob Tests
+// ============================================================================
+
+void test_blob_round_trip() {
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    size_t length = encodeConfig(config, blob, sizeof(blob));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    DeviceConfig decoded;
+    initConfig(decoded, "", "", "", "");
+    TEST_ASSERT_TRUE(decodeConfig(blob, length, decoded));
+    TEST_ASSERT_EQUAL_STRING("B35", decoded.stationCode);
+    TEST_ASSERT_EQUAL_STRING("0123456789abcdef0123456789abcdef", decoded.apiKey);
+    TEST_ASSERT_EQUAL_STRING("home", decoded.wifiSsid);
+    TEST_ASSERT_EQUAL_STRING("password123", decoded.wifiPassword);
+}
+
+void test_longest_config_fits_blob() {
+    DeviceConfig longest;
+    memset(&longest, 'x', sizeof(longest));
+    longest.stationCode[CONFIG_STATION_MAX_LEN - 1] = '\0';
+    longest.apiKey[CONFIG_API_KEY_MAX_LEN - 1] = '\0';
+    longest.wifiSsid[CONFIG_SSID_MAX_LEN - 1] = '\0';
+    longest.wifiPassword[CONFIG_PASSWORD_MAX_LEN - 1] = '\0';
+
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    TEST_ASSERT_GREATER_THAN(0, encodeConfig(longest, blob, sizeof(blob)));
+}
+
+void test_blob_too_small_buffer() {
+    uint8_t blob[16];
+    TEST_ASSERT_EQUAL(0, encodeConfig(config, blob, sizeof(blob)));
+}
+
+void test_corrupt_blob_rejected_and_config_kept() {
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    size_t length = encodeConfig(config, blob, sizeof(blob));
+    blob[5] ^= 0x01;
+
+    DeviceConfig kept;
+    initConfig(kept, "A01", "key", "net", "");
+    TEST_ASSERT_FALSE(decodeConfig(blob, length, kept));
+    TEST_ASSERT_EQUAL_STRING("A01", kept.stationCode);
+
+    // Cut off mid-write
+    encodeConfig(config, blob, sizeof(blob));
+    TEST_ASSERT_FALSE(decodeConfig(blob, length - 1, kept));
+    TEST_ASSERT_FALSE(decodeConfig(blob, 3, kept));
+}
+
+void test_other_version_rejected() {
+    uint8_t blob[CONFIG_BLOB_MAX_LEN];
+    size_t length = encodeConfig(config, blob, sizeof(blob));
+    blob[2] = CONFIG_SCHEMA_VERSION + 1;
+    resealBlob(blob, length);
+
+    DeviceConfig decoded = config;
+    TEST_ASSERT_FALSE(decodeConfig(blob, length, decoded));
+}
+
+void test_unknown_record_skipped() {
+    // A later firmware's extra field, placed before the known ones
+    const uint8_t extra[] = {99, 3, 'a', 'b', 'c'};
+    uint8_t original[CONFIG_BLOB_MAX_LEN];
+    size_t originalLength = encodeConfig(config, original, sizeof(original));
+
+    uint8_t blob[CONFIG_BLOB_MAX_LEN + sizeof(extra)];
+    memcpy(blob, original, 3);
+    memcpy(blob + 3, extra, sizeof(extra));
+    memcpy(blob + 3 + sizeof(extra), original + 3, originalLength - 3);
+    size_t length = originalLength + sizeof(extra);
+    resealBlob(blob, length);
+
+    DeviceConfig decoded;
+    initConfig(decoded, "", "", "", "");
+    TEST_ASSERT_TRUE(decodeConfig(blob, length, decoded));
+    TEST_ASSERT_EQUAL_STRING("B35", decoded.stationCode);
+    TEST_ASSERT_EQUAL_STRING("home", decoded.wifiSsid);
+}
+
+void test_missing_field_keeps_default() {
+    // An older blob with only the station record
+    uint8_t blob[16] = {'W', 'C', CONFIG_SCHEMA_VERSION, 1, 3, 'C', '0', '1', 0, 0, 0, 0};
+    resealBlob(blob, 12);
+
+    DeviceConfig decoded = config;
+    TEST_ASSERT_TRUE(decodeConfig(blob, 12, decoded));
+    TEST_ASSERT_EQUAL_STRING("C01", decoded.stationCode);
+    TEST_ASSERT_EQUAL_STRING("home", decoded.wifiSsid);
+}
+
+void test_oversized_record_rejected() {
+    uint8_t blob[24] = {'W', 'C', CONFIG_SCHEMA_VERSION, 1, 9, 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I'};
+    resealBlob(blob, 18);
+
+    DeviceConfig decoded = config;
+    TEST_ASSERT_FALSE(decodeConfig(blob, 18, decoded));
+    TEST_ASSERT_EQUAL_STRING("B35", decoded.stationCode);
+}
+
+// ============================================================================
+// Field Tests
+// ============================================================================
+
+void test_set_valid_fields() {
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(setConfigField(config, "station", "A01", error));
+    TEST_ASSERT_TRUE(setConfigField(config, "wifi_password", "", error));
+    TEST_ASSERT_EQUAL_STRING("A01", config.stationCode);
+    TEST_ASSERT_EQUAL_STRING("", config.wifiPassword);
+}
+
+void test_set_rejects_bad_values() {
+    const char* error = nullptr;
+    TEST_ASSERT_FALSE(setConfigField(config, "station", "b35", error));
+    TEST_ASSERT_FALSE(setConfigField(config, "station", "B350", error));
+    TEST_ASSERT_FALSE(setConfigField(config, "api_key", "", error));
+    TEST_ASSERT_FALSE(setConfigField(config, "api_key", "has space", error));
+    TEST_ASSERT_FALSE(setConfigField(config, "wifi_ssid", "", error));
+    TEST_ASSERT_FALSE(setConfigField(config, "wifi_password", "short", error));
+    TEST_ASSERT_NOT_NULL(error);
+    TEST_ASSERT_EQUAL_STRING("B35", config.stationCode);
+}
+
+void test_set_rejects_unknown_and_long() {
+    char tooLong[CONFIG_SSID_MAX_LEN + 1];
+    memset(tooLong, 's', sizeof(tooLong) - 1);
+    tooLong[sizeof(tooLong) - 1] = '\0';
+
+    const char* error = nullptr;
+    TEST_ASSERT_FALSE(setConfigField(config, "color", "red", error));
+    TEST_ASSERT_EQUAL_STRING("unknown setting", error);
+    TEST_ASSERT_FALSE(setConfigField(config, "wifi_ssid", tooLong, error));
+    TEST_ASSERT_EQUAL_STRING("value too long", error);
+}
+
+// ============================================================================
+// Form Tests
+// ============================================================================
+
+void test_form_sets_several_fields() {
+    char form[] = "station=E10&wifi_ssid=Cafe+Wifi&wifi_password=p%40ss%26word";
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(applyConfigForm(config, form, error));
+    TEST_ASSERT_EQUAL_STRING("E10", config.stationCode);
+    TEST_ASSERT_EQUAL_STRING("Cafe Wifi", config.wifiSsid);
+    TEST_ASSERT_EQUAL_STRING("p@ss&word", config.wifiPassword);
+}
+
+void test_form_is_all_or_nothing() {
+    char form[] = "station=E10&wifi_password=short";
+    const char* error = nullptr;
+    TEST_ASSERT_FALSE(applyConfigForm(config, form, error));
+    TEST_ASSERT_EQUAL_STRING("B35", config.stationCode);
+    TEST_ASSERT_EQUAL_STRING("password123", config.wifiPassword);
+}
+
+void test_form_rejects_malformed() {
+    const char* error = nullptr;
+    char noValue[] = "station";
+    char badEscape[] = "wifi_ssid=bad%2";
+    char nulEscape[] = "wifi_ssid=a%00b";
+    char empty[] = "";
+    TEST_ASSERT_FALSE(applyConfigForm(config, noValue, error));
+    TEST_ASSERT_FALSE(applyConfigForm(config, badEscape, error));
+    TEST_ASSERT_FALSE(applyConfigForm(config, nulEscape, error));
+    TEST_ASSERT_FALSE(applyConfigForm(config, empty, error));
+    TEST_ASSERT_EQUAL_STRING("no settings given", error);
+}
+
+// ============================================================================
+// Change and Format Tests
+// ============================================================================
+
+void test_changes_detected_per_part() {
+    DeviceConfig after = config;
+    TEST_ASSERT_EQUAL(0, configChanges(config, after));
+
+    strcpy(after.stationCode, "A01");
+    TEST_ASSERT_EQUAL(CONFIG_CHANGED_STATION, configChanges(config, after));
+
+    strcpy(after.wifiPassword, "different1");
+    TEST_ASSERT_EQUAL(CONFIG_CHANGED_STATION | CONFIG_CHANGED_WIFI, configChanges(config, after));
+
+    after = config;
+    strcpy(after.apiKey, "newkey");
+    TEST_ASSERT_EQUAL(CONFIG_CHANGED_API_KEY, configChanges(config, after));
+}
+
+void test_format_masks_secrets() {
+    char buffer[256];
+    BufferWriter out(buffer, sizeof(buffer));
+    formatConfig(config, out);
+    TEST_ASSERT_EQUAL_STRING("{\"version\":1,\"station\":\"B35\",\"api_key\":\"***\","
+                             "\"wifi_ssid\":\"home\",\"wifi_password\":\"***\"}", buffer);
+
+    // An unset password shows as empty
+    strcpy(config.wifiPassword, "");
+    out.reset();
+    formatConfig(config, out);
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"wifi_password\":\"\""));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    initConfig(config, "B35", "0123456789abcdef0123456789abcdef", "home", "password123");
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Blob format
+    RUN_TEST(test_blob_round_trip);
+    RUN_TEST(test_longest_config_fits_blob);
+    RUN_TEST(test_blob_too_small_buffer);
+    RUN_TEST(test_corrupt_blob_rejected_and_config_kept);
+    RUN_TEST(test_other_version_rejected);
+    RUN_TEST(test_unknown_record_skipped);
+    RUN_TEST(test_missing_field_keeps_default);
+    RUN_TEST(test_oversized_record_rejected);
+
+    // Fields
+    RUN_TEST(test_set_valid_fields);
+    RUN_TEST(test_set_rejects_bad_values);
+    RUN_TEST(test_set_rejects_unknown_and_long);
+
+    // Forms
+    RUN_TEST(test_form_sets_several_fields);
+    RUN_TEST(test_form_is_all_or_nothing);
+    RUN_TEST(test_form_rejects_malformed);
+
+    // Changes and format
+    RUN_TEST(test_changes_detected_per_part);
+    RUN_TEST(test_format_masks_secrets);
+
+    return UNITY_END();
+}
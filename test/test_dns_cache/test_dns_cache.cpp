@@ -0,0 +1,262 @@
+/**
+ * Unit tests for the DNS cache
+ *
+ * Tests TTL handling, the last-known-good fallback when the resolver is
+ * down, invalidation after a failed connect, and eviction, using a fake
+ * resolver.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "dns_cache.h"
+
+static const char* HOST = "api.wmata.com";
+static const uint32_t ADDR_A = 0x0A00000A;
+static const uint32_t ADDR_B = 0x0B00000B;
+
+/**
+ * Fake resolver: answers with whatever the test set up and counts calls
+ */
+struct FakeResolver {
+    bool up;
+    uint32_t address;
+    unsigned long ttlMs;
+    int calls;
+    char lastHost[DNS_CACHE_HOST_LEN];
+};
+
+static bool fakeResolve(const char* host, uint32_t& address, unsigned long& ttlMs, void* context) {
+    FakeResolver* fake = (FakeResolver*)context;
+    fake->calls++;
+    strncpy(fake->lastHost, host, sizeof(fake->lastHost) - 1);
+    if (!fake->up) return false;
+    address = fake->address;
+    ttlMs = fake->ttlMs;
+    return true;
+}
+
+static FakeResolver fake;
+
+// ============================================================================
+// Caching Tests
+// ============================================================================
+
+void test_first_lookup_resolves() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, 0, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_A, address);
+    TEST_ASSERT_EQUAL(1, fake.calls);
+    TEST_ASSERT_EQUAL_STRING(HOST, fake.lastHost);
+}
+
+void test_cached_within_ttl() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 120000;
+
+    cache.lookup(HOST, 0, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup(HOST, 119999, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_A, address);
+    TEST_ASSERT_EQUAL(1, fake.calls);
+
+    fake.address = ADDR_B;
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, 120000, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_B, address);
+    TEST_ASSERT_EQUAL(1, cache.getHitCount());
+    TEST_ASSERT_EQUAL(2, cache.getResolveCount());
+}
+
+void test_ttl_floor() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 5000;  // Far below the floor
+
+    cache.lookup(HOST, 0, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup(HOST, DNS_CACHE_MIN_TTL_MS - 1, address));
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, DNS_CACHE_MIN_TTL_MS, address));
+}
+
+void test_ttl_ceiling() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 86400000UL;
+
+    cache.lookup(HOST, 0, address);
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, DNS_CACHE_MAX_TTL_MS, address));
+}
+
+void test_unknown_ttl_uses_default() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 0;
+
+    cache.lookup(HOST, 0, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup(HOST, DNS_CACHE_DEFAULT_TTL_MS - 1, address));
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, DNS_CACHE_DEFAULT_TTL_MS, address));
+}
+
+void test_ttl_across_millis_wrap() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 60000;
+    unsigned long start = 0xFFFFFFFFUL - 1000;
+
+    cache.lookup(HOST, start, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup(HOST, start + 30000, address));
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, start + 60000, address));
+}
+
+// ============================================================================
+// Fallback Tests
+// ============================================================================
+
+void test_resolver_down_uses_last_known_good() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 60000;
+    cache.lookup(HOST, 0, address);
+
+    fake.up = false;
+    address = 0;
+    TEST_ASSERT_EQUAL(DNS_STALE, cache.lookup(HOST, 70000, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_A, address);
+    TEST_ASSERT_EQUAL(1, cache.getStaleCount());
+}
+
+void test_failing_resolver_not_retried_immediately() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.ttlMs = 60000;
+    cache.lookup(HOST, 0, address);
+    fake.up = false;
+    cache.lookup(HOST, 70000, address);
+    TEST_ASSERT_EQUAL(2, fake.calls);
+
+    // Inside the retry interval the resolver is left alone
+    TEST_ASSERT_EQUAL(DNS_STALE, cache.lookup(HOST, 70000 + DNS_CACHE_RETRY_MS - 1, address));
+    TEST_ASSERT_EQUAL(2, fake.calls);
+
+    // Then it is asked again, and a recovery is picked up
+    fake.up = true;
+    fake.address = ADDR_B;
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, 70000 + DNS_CACHE_RETRY_MS, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_B, address);
+    TEST_ASSERT_EQUAL(3, fake.calls);
+}
+
+void test_nothing_to_fall_back_on() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0x12345678;
+    fake.up = false;
+
+    TEST_ASSERT_EQUAL(DNS_FAILED, cache.lookup(HOST, 0, address));
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, address);
+    TEST_ASSERT_EQUAL(1, cache.getFailureCount());
+
+    // Without a fallback, every lookup is worth another try
+    TEST_ASSERT_EQUAL(DNS_FAILED, cache.lookup(HOST, 100, address));
+    TEST_ASSERT_EQUAL(2, fake.calls);
+}
+
+void test_zero_address_is_failure() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    fake.address = 0;
+    TEST_ASSERT_EQUAL(DNS_FAILED, cache.lookup(HOST, 0, address));
+}
+
+void test_invalidate_forces_lookup_but_keeps_fallback() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    cache.lookup(HOST, 0, address);
+
+    cache.invalidate(HOST);
+    fake.address = ADDR_B;
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup(HOST, 1000, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_B, address);
+
+    cache.invalidate(HOST);
+    fake.up = false;
+    TEST_ASSERT_EQUAL(DNS_STALE, cache.lookup(HOST, 2000, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_B, address);
+}
+
+// ============================================================================
+// Slot Tests
+// ============================================================================
+
+void test_hosts_cached_separately() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    cache.lookup("a.example", 0, address);
+    fake.address = ADDR_B;
+    cache.lookup("b.example", 0, address);
+
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup("a.example", 10, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_A, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup("b.example", 10, address));
+    TEST_ASSERT_EQUAL_HEX32(ADDR_B, address);
+}
+
+void test_least_recently_used_evicted() {
+    DnsCache cache(fakeResolve, &fake);
+    uint32_t address = 0;
+    char host[16];
+    for (int i = 0; i < DNS_CACHE_SLOTS; i++) {
+        snprintf(host, sizeof(host), "h%d.example", i);
+        cache.lookup(host, (unsigned long)i, address);
+    }
+    cache.lookup("h0.example", 100, address);  // h1 is now the oldest
+
+    cache.lookup("new.example", 200, address);
+    int calls = fake.calls;
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup("h0.example", 300, address));
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup("h1.example", 300, address));
+    TEST_ASSERT_EQUAL(calls + 1, fake.calls);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    memset(&fake, 0, sizeof(fake));
+    fake.up = true;
+    fake.address = ADDR_A;
+    fake.ttlMs = 300000;
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Caching tests
+    RUN_TEST(test_first_lookup_resolves);
+    RUN_TEST(test_cached_within_ttl);
+    RUN_TEST(test_ttl_floor);
+    RUN_TEST(test_ttl_ceiling);
+    RUN_TEST(test_unknown_ttl_uses_default);
+    RUN_TEST(test_ttl_across_millis_wrap);
+
+    // Fallback tests
+    RUN_TEST(test_resolver_down_uses_last_known_good);
+    RUN_TEST(test_failing_resolver_not_retried_immediately);
+    RUN_TEST(test_nothing_to_fall_back_on);
+    RUN_TEST(test_zero_address_is_failure);
+    RUN_TEST(test_invalidate_forces_lookup_but_keeps_fallback);
+
+    // Slot tests
+    RUN_TEST(test_hosts_cached_separately);
+    RUN_TEST(test_least_recently_used_evicted);
+
+    return UNITY_END();
+}
@@ -0,0 +1,385 @@
+/**
+ * Unit tests for leader/follower snapshot fan-out
+ *
+ * Tests the binary snapshot wire format, the leader election, and a
+ * round trip over loopback multicast.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <unistd.h>
+#include "prediction_snapshot.h"
+#include "fanout_election.h"
+#include "multicast_socket.h"
+
+/**
+ * Fill a snapshot with two trains and one incident
+ */
+static void makeSnapshot(PredictionSnapshot& snapshot) {
+    memset(snapshot.trains, 0, sizeof(snapshot.trains));
+    snapshot.leaderId = 0xA1B2C3D4;
+    snapshot.sequence = 42;
+    snapshot.responseHash = 0x12345678;
+    snapshot.ageMs = 250;
+    snapshot.flags = SNAPSHOT_FLAG_CHANGED;
+    strcpy(snapshot.station, "B35");
+    snapshot.stationLines = LINE_MASK_RD;
+    snapshot.trainCount = 2;
+
+    strcpy(snapshot.trains[0].line, "RD");
+    strcpy(snapshot.trains[0].destination, "Glen");
+    snapshot.trains[0].group = 1;
+    snapshot.trains[0].cars = 8;
+    snapshot.trains[0].status = TRAIN_MOVING;
+    snapshot.trains[0].etaMs = 210000;
+
+    strcpy(snapshot.trains[1].line, "RD");
+    strcpy(snapshot.trains[1].destination, "Shad");
+    snapshot.trains[1].group = 2;
+    snapshot.trains[1].cars = 6;
+    snapshot.trains[1].status = TRAIN_BOARDING;
+    snapshot.trains[1].etaMs = 0;
+
+    snapshot.incidents.reset();
+    snapshot.incidents.add(LINE_MASK_RD, "Delay", "Single tracking");
+}
+
+// ============================================================================
+// Wire Format Tests
+// ============================================================================
+
+void test_snapshot_round_trip() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    PredictionSnapshot out;
+    TEST_ASSERT_TRUE(decodeSnapshot(packet, length, out));
+    TEST_ASSERT_EQUAL_HEX32(in.leaderId, out.leaderId);
+    TEST_ASSERT_EQUAL(42, out.sequence);
+    TEST_ASSERT_EQUAL_HEX32(in.responseHash, out.responseHash);
+    TEST_ASSERT_EQUAL(250, out.ageMs);
+    TEST_ASSERT_EQUAL_HEX8(SNAPSHOT_FLAG_CHANGED, out.flags);
+    TEST_ASSERT_EQUAL_STRING("B35", out.station);
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_RD, out.stationLines);
+
+    TEST_ASSERT_EQUAL(2, out.trainCount);
+    TEST_ASSERT_EQUAL_STRING("Glen", out.trains[0].destination);
+    TEST_ASSERT_EQUAL_STRING("RD", out.trains[0].line);
+    TEST_ASSERT_EQUAL(1, out.trains[0].group);
+    TEST_ASSERT_EQUAL(8, out.trains[0].cars);
+    TEST_ASSERT_EQUAL(210000, out.trains[0].etaMs);
+    TEST_ASSERT_EQUAL(TRAIN_BOARDING, out.trains[1].status);
+
+    TEST_ASSERT_EQUAL(1, out.incidents.getCount());
+    TEST_ASSERT_EQUAL_STRING("Single tracking", out.incidents.get(0).description);
+    TEST_ASSERT_EQUAL_STRING("Delay", out.incidents.get(0).type);
+}
+
+void test_snapshot_is_little_endian() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    encodeSnapshot(in, packet, sizeof(packet));
+    TEST_ASSERT_EQUAL_HEX8('W', packet[0]);
+    TEST_ASSERT_EQUAL_HEX8('M', packet[1]);
+    TEST_ASSERT_EQUAL_HEX8(SNAPSHOT_VERSION, packet[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xD4, packet[4]);
+    TEST_ASSERT_EQUAL_HEX8(0xA1, packet[7]);
+}
+
+void test_negative_eta_survives() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+    in.trains[0].etaMs = -15000;
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    PredictionSnapshot out;
+    TEST_ASSERT_TRUE(decodeSnapshot(packet, length, out));
+    TEST_ASSERT_EQUAL(-15000, out.trains[0].etaMs);
+}
+
+void test_corrupt_packet_rejected() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    packet[40] ^= 0x01;
+
+    PredictionSnapshot out;
+    TEST_ASSERT_FALSE(decodeSnapshot(packet, length, out));
+}
+
+void test_truncated_packet_rejected() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+
+    PredictionSnapshot out;
+    TEST_ASSERT_FALSE(decodeSnapshot(packet, length - 1, out));
+    TEST_ASSERT_FALSE(decodeSnapshot(packet, 10, out));
+}
+
+void test_unknown_version_rejected() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    packet[2] = SNAPSHOT_VERSION + 1;
+
+    PredictionSnapshot out;
+    TEST_ASSERT_FALSE(decodeSnapshot(packet, length, out));
+}
+
+void test_full_snapshot_fits_datagram() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+    in.trainCount = SNAPSHOT_MAX_TRAINS;
+    for (int i = 0; i < SNAPSHOT_MAX_TRAINS; i++) {
+        in.trains[i] = in.trains[0];
+    }
+
+    char longText[INCIDENT_TEXT_MAX_LEN];
+    memset(longText, 'x', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    in.incidents.reset();
+    for (int i = 0; i < MAX_INCIDENTS; i++) {
+        in.incidents.add(LINE_MASK_RD, "Alert", longText);
+    }
+
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    TEST_ASSERT_LESS_OR_EQUAL(SNAPSHOT_MAX_SIZE, length);
+
+    PredictionSnapshot out;
+    TEST_ASSERT_TRUE(decodeSnapshot(packet, length, out));
+    TEST_ASSERT_EQUAL(SNAPSHOT_MAX_TRAINS, out.trainCount);
+    TEST_ASSERT_EQUAL(MAX_INCIDENTS, out.incidents.getCount());
+}
+
+void test_incidents_dropped_when_buffer_small() {
+    PredictionSnapshot in;
+    makeSnapshot(in);
+
+    // Room for the header and trains but not the incident
+    uint8_t packet[31 + 2 * 13 + 4 + 5];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    PredictionSnapshot out;
+    TEST_ASSERT_TRUE(decodeSnapshot(packet, length, out));
+    TEST_ASSERT_EQUAL(0, out.incidents.getCount());
+    TEST_ASSERT_TRUE(out.flags & SNAPSHOT_FLAG_TRUNCATED);
+
+    uint8_t tiny[16];
+    TEST_ASSERT_EQUAL(0, encodeSnapshot(in, tiny, sizeof(tiny)));
+}
+
+// ============================================================================
+// Election Tests
+// ============================================================================
+
+void test_listens_before_leading() {
+    FanoutElection election(5);
+    election.begin(1000);
+
+    TEST_ASSERT_FALSE(election.update(1000 + FANOUT_STARTUP_LISTEN_MS - 1));
+    TEST_ASSERT_EQUAL(FANOUT_LISTENING, election.getRole());
+    TEST_ASSERT_TRUE(election.update(1000 + FANOUT_STARTUP_LISTEN_MS));
+    TEST_ASSERT_TRUE(election.isLeader());
+    TEST_ASSERT_EQUAL(5, election.getLeaderId());
+}
+
+void test_follows_existing_leader() {
+    FanoutElection election(5);
+    election.begin(1000);
+
+    TEST_ASSERT_TRUE(election.onSnapshot(9, 2000));
+    TEST_ASSERT_EQUAL(FANOUT_FOLLOWER, election.getRole());
+    TEST_ASSERT_EQUAL(9, election.getLeaderId());
+
+    // A live leader keeps us following well past the startup window
+    for (unsigned long t = 2000; t < 120000; t += FANOUT_HEARTBEAT_MS) {
+        election.onSnapshot(9, t);
+        TEST_ASSERT_FALSE(election.update(t + 1000));
+    }
+    TEST_ASSERT_FALSE(election.isLeader());
+}
+
+void test_takes_over_when_leader_quiet() {
+    FanoutElection election(5);
+    election.begin(0);
+    election.onSnapshot(9, 1000);
+
+    TEST_ASSERT_FALSE(election.update(1000 + FANOUT_LEADER_TIMEOUT_MS - 1));
+    TEST_ASSERT_TRUE(election.update(1000 + FANOUT_LEADER_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(election.isLeader());
+}
+
+void test_higher_id_leader_steps_down() {
+    FanoutElection election(9);
+    election.begin(0);
+    election.update(FANOUT_STARTUP_LISTEN_MS);
+    TEST_ASSERT_TRUE(election.isLeader());
+
+    // Another leader with a lower id wins
+    TEST_ASSERT_TRUE(election.onSnapshot(5, FANOUT_STARTUP_LISTEN_MS + 100));
+    TEST_ASSERT_EQUAL(FANOUT_FOLLOWER, election.getRole());
+    TEST_ASSERT_EQUAL(5, election.getLeaderId());
+}
+
+void test_lower_id_leader_keeps_lead() {
+    FanoutElection election(5);
+    election.begin(0);
+    election.update(FANOUT_STARTUP_LISTEN_MS);
+
+    TEST_ASSERT_FALSE(election.onSnapshot(9, FANOUT_STARTUP_LISTEN_MS + 100));
+    TEST_ASSERT_TRUE(election.isLeader());
+}
+
+void test_own_snapshots_ignored() {
+    FanoutElection election(5);
+    election.begin(0);
+
+    TEST_ASSERT_FALSE(election.onSnapshot(5, 100));
+    TEST_ASSERT_EQUAL(FANOUT_LISTENING, election.getRole());
+}
+
+void test_follower_prefers_lower_id() {
+    FanoutElection election(20);
+    election.begin(0);
+    election.onSnapshot(9, 100);
+
+    // A higher id is ignored while our leader is alive, a lower id is adopted
+    TEST_ASSERT_FALSE(election.onSnapshot(12, 200));
+    TEST_ASSERT_EQUAL(9, election.getLeaderId());
+    TEST_ASSERT_TRUE(election.onSnapshot(3, 300));
+    TEST_ASSERT_EQUAL(3, election.getLeaderId());
+}
+
+void test_heartbeat_only_for_leader() {
+    FanoutElection election(5);
+    election.begin(0);
+    TEST_ASSERT_FALSE(election.isHeartbeatDue(0, FANOUT_HEARTBEAT_MS));
+
+    election.update(FANOUT_STARTUP_LISTEN_MS);
+    TEST_ASSERT_FALSE(election.isHeartbeatDue(FANOUT_STARTUP_LISTEN_MS, FANOUT_STARTUP_LISTEN_MS + 1));
+    TEST_ASSERT_TRUE(election.isHeartbeatDue(FANOUT_STARTUP_LISTEN_MS,
+                                             FANOUT_STARTUP_LISTEN_MS + FANOUT_HEARTBEAT_MS));
+}
+
+void test_two_panels_converge() {
+    // Both panels boot together and claim leadership; the exchange settles on one
+    FanoutElection a(5);
+    FanoutElection b(9);
+    a.begin(0);
+    b.begin(0);
+    a.update(FANOUT_STARTUP_LISTEN_MS);
+    b.update(FANOUT_STARTUP_LISTEN_MS);
+
+    b.onSnapshot(a.getDeviceId(), FANOUT_STARTUP_LISTEN_MS + 10);
+    a.onSnapshot(b.getDeviceId(), FANOUT_STARTUP_LISTEN_MS + 10);
+
+    TEST_ASSERT_TRUE(a.isLeader());
+    TEST_ASSERT_FALSE(b.isLeader());
+    TEST_ASSERT_EQUAL(5, b.getLeaderId());
+}
+
+// ============================================================================
+// Loopback Multicast Tests
+// ============================================================================
+
+void test_multicast_round_trip() {
+    MulticastSocket leader;
+    MulticastSocket follower;
+    TEST_ASSERT_TRUE(leader.begin("239.255.43.21", 43219, "127.0.0.1"));
+    TEST_ASSERT_TRUE(follower.begin("239.255.43.21", 43219, "127.0.0.1"));
+
+    PredictionSnapshot in;
+    makeSnapshot(in);
+    uint8_t packet[SNAPSHOT_MAX_SIZE];
+    size_t length = encodeSnapshot(in, packet, sizeof(packet));
+    TEST_ASSERT_TRUE(leader.send(packet, length));
+
+    uint8_t received[SNAPSHOT_MAX_SIZE];
+    int receivedLength = -1;
+    for (int i = 0; i < 100 && receivedLength < 0; i++) {
+        receivedLength = follower.receive(received, sizeof(received));
+        if (receivedLength < 0) usleep(1000);
+    }
+    TEST_ASSERT_EQUAL((int)length, receivedLength);
+
+    PredictionSnapshot out;
+    TEST_ASSERT_TRUE(decodeSnapshot(received, (size_t)receivedLength, out));
+    TEST_ASSERT_EQUAL(in.sequence, out.sequence);
+}
+
+void test_multicast_receive_empty() {
+    MulticastSocket socket;
+    TEST_ASSERT_TRUE(socket.begin("239.255.43.22", 43218, "127.0.0.1"));
+
+    uint8_t buffer[16];
+    TEST_ASSERT_EQUAL(-1, socket.receive(buffer, sizeof(buffer)));
+}
+
+void test_multicast_bad_group() {
+    MulticastSocket socket;
+    TEST_ASSERT_FALSE(socket.begin("not-an-address", 43218));
+    TEST_ASSERT_FALSE(socket.isOpen());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Wire format tests
+    RUN_TEST(test_snapshot_round_trip);
+    RUN_TEST(test_snapshot_is_little_endian);
+    RUN_TEST(test_negative_eta_survives);
+    RUN_TEST(test_corrupt_packet_rejected);
+    RUN_TEST(test_truncated_packet_rejected);
+    RUN_TEST(test_unknown_version_rejected);
+    RUN_TEST(test_full_snapshot_fits_datagram);
+    RUN_TEST(test_incidents_dropped_when_buffer_small);
+
+    // Election tests
+    RUN_TEST(test_listens_before_leading);
+    RUN_TEST(test_follows_existing_leader);
+    RUN_TEST(test_takes_over_when_leader_quiet);
+    RUN_TEST(test_higher_id_leader_steps_down);
+    RUN_TEST(test_lower_id_leader_keeps_lead);
+    RUN_TEST(test_own_snapshots_ignored);
+    RUN_TEST(test_follower_prefers_lower_id);
+    RUN_TEST(test_heartbeat_only_for_leader);
+    RUN_TEST(test_two_panels_converge);
+
+    // Loopback multicast tests
+    RUN_TEST(test_multicast_round_trip);
+    RUN_TEST(test_multicast_receive_empty);
+    RUN_TEST(test_multicast_bad_group);
+
+    return UNITY_END();
+}
@@ -0,0 +1,202 @@
+/**
+ * Unit tests for request deadlines and the hang watchdog
+ *
+ * Tests how FetchBudget splits a request's time between phases and which
+ * phase an overrun is blamed on, and when HangMonitor asks for recovery
+ * and restart.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "fetch_budget.h"
+#include "hang_monitor.h"
+
+// Idle, DNS, connect, first byte, body, parse
+static const unsigned long PHASE_MS[FETCH_PHASE_COUNT] = {0, 2000, 3000, 5000, 4000, 0};
+static const unsigned long TOTAL_MS = 10000;
+
+// ============================================================================
+// FetchBudget Tests
+// ============================================================================
+
+void test_phase_gets_own_budget() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(1000);
+
+    TEST_ASSERT_EQUAL(2000, budget.enter(FETCH_PHASE_DNS, 1000));
+    TEST_ASSERT_EQUAL(3000, budget.enter(FETCH_PHASE_CONNECT, 1100));
+    TEST_ASSERT_EQUAL(4100, budget.getPhaseDeadline());
+}
+
+void test_phase_clipped_by_total() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+
+    // 7 s spent before the first byte; only 3 s of the 5 s are left
+    TEST_ASSERT_EQUAL(3000, budget.enter(FETCH_PHASE_FIRST_BYTE, 7000));
+
+    // A phase without its own budget gets whatever is left
+    TEST_ASSERT_EQUAL(1500, budget.enter(FETCH_PHASE_PARSE, 8500));
+}
+
+void test_never_zero() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+    TEST_ASSERT_EQUAL(1, budget.enter(FETCH_PHASE_BODY, 12000));
+}
+
+void test_within_budget() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+    budget.enter(FETCH_PHASE_DNS, 0);
+    TEST_ASSERT_TRUE(budget.check(2000));
+    TEST_ASSERT_EQUAL(FETCH_PHASE_IDLE, budget.getOverrunPhase());
+}
+
+void test_overrun_blamed_on_phase() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+    budget.enter(FETCH_PHASE_DNS, 0);
+    TEST_ASSERT_TRUE(budget.check(100));
+    budget.enter(FETCH_PHASE_CONNECT, 100);
+
+    TEST_ASSERT_FALSE(budget.check(3200));
+    TEST_ASSERT_EQUAL(FETCH_PHASE_CONNECT, budget.getOverrunPhase());
+    TEST_ASSERT_FALSE(budget.wasTotalOverrun());
+    TEST_ASSERT_EQUAL(1, budget.getOverrunCount(FETCH_PHASE_CONNECT));
+    TEST_ASSERT_EQUAL(0, budget.getOverrunCount(FETCH_PHASE_DNS));
+}
+
+void test_overrun_blamed_on_total() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+    budget.enter(FETCH_PHASE_BODY, 8000);  // 2 s left of 4 s
+
+    TEST_ASSERT_FALSE(budget.check(10500));
+    TEST_ASSERT_EQUAL(FETCH_PHASE_BODY, budget.getOverrunPhase());
+    TEST_ASSERT_TRUE(budget.wasTotalOverrun());
+}
+
+void test_overrun_counted_once_per_request() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    budget.start(0);
+    budget.enter(FETCH_PHASE_DNS, 0);
+    TEST_ASSERT_FALSE(budget.check(2500));
+    TEST_ASSERT_FALSE(budget.check(2600));
+    TEST_ASSERT_EQUAL(1, budget.getOverrunCount(FETCH_PHASE_DNS));
+
+    // The next request starts clean, and its overrun counts again
+    budget.start(5000);
+    TEST_ASSERT_EQUAL(FETCH_PHASE_IDLE, budget.getOverrunPhase());
+    budget.enter(FETCH_PHASE_DNS, 5000);
+    TEST_ASSERT_FALSE(budget.check(7500));
+    TEST_ASSERT_EQUAL(2, budget.getOverrunCount(FETCH_PHASE_DNS));
+}
+
+void test_budget_across_millis_wrap() {
+    FetchBudget budget(PHASE_MS, TOTAL_MS);
+    unsigned long start = 0xFFFFFFFFUL - 500;
+    budget.start(start);
+    budget.enter(FETCH_PHASE_DNS, start);
+    TEST_ASSERT_TRUE(budget.check(start + 1500));
+    TEST_ASSERT_FALSE(budget.check(start + 2500));
+}
+
+// ============================================================================
+// HangMonitor Tests
+// ============================================================================
+
+void test_disarmed_does_nothing() {
+    HangMonitor monitor(15000, 60000);
+    TEST_ASSERT_FALSE(monitor.isArmed());
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(1000000));
+}
+
+void test_recover_then_restart_once_each() {
+    HangMonitor monitor(15000, 60000);
+    monitor.arm(1000);
+
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(15999));
+    TEST_ASSERT_EQUAL(HANG_RECOVER, monitor.check(16000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(17000));
+    TEST_ASSERT_EQUAL(HANG_RESTART, monitor.check(61000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(62000));
+    TEST_ASSERT_EQUAL(1, monitor.getRecoveryCount());
+}
+
+void test_network_reset_between_recover_and_restart() {
+    HangMonitor monitor(15000, 60000, 30000);
+    monitor.arm(0);
+
+    TEST_ASSERT_EQUAL(HANG_RECOVER, monitor.check(15000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(29999));
+    TEST_ASSERT_EQUAL(HANG_RESET_NETWORK, monitor.check(30000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(31000));
+    TEST_ASSERT_EQUAL(HANG_RESTART, monitor.check(60000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(61000));
+}
+
+void test_finished_request_not_acted_on() {
+    HangMonitor monitor(15000, 60000);
+    monitor.arm(0);
+    monitor.disarm();
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(20000));
+}
+
+void test_rearm_starts_over() {
+    HangMonitor monitor(15000, 60000);
+    monitor.arm(0);
+    TEST_ASSERT_EQUAL(HANG_RECOVER, monitor.check(15000));
+    monitor.disarm();
+
+    monitor.arm(20000);
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(30000));
+    TEST_ASSERT_EQUAL(HANG_RECOVER, monitor.check(35000));
+    TEST_ASSERT_EQUAL(2, monitor.getRecoveryCount());
+}
+
+void test_late_check_goes_straight_to_restart() {
+    // If the watchdog itself was held up, don't waste a step on recovery
+    HangMonitor monitor(15000, 60000);
+    monitor.arm(0);
+    TEST_ASSERT_EQUAL(HANG_RESTART, monitor.check(70000));
+    TEST_ASSERT_EQUAL(HANG_NONE, monitor.check(71000));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // FetchBudget tests
+    RUN_TEST(test_phase_gets_own_budget);
+    RUN_TEST(test_phase_clipped_by_total);
+    RUN_TEST(test_never_zero);
+    RUN_TEST(test_within_budget);
+    RUN_TEST(test_overrun_blamed_on_phase);
+    RUN_TEST(test_overrun_blamed_on_total);
+    RUN_TEST(test_overrun_counted_once_per_request);
+    RUN_TEST(test_budget_across_millis_wrap);
+
+    // HangMonitor tests
+    RUN_TEST(test_disarmed_does_nothing);
+    RUN_TEST(test_recover_then_restart_once_each);
+    RUN_TEST(test_network_reset_between_recover_and_restart);
+    RUN_TEST(test_finished_request_not_acted_on);
+    RUN_TEST(test_rearm_starts_over);
+    RUN_TEST(test_late_check_goes_straight_to_restart);
+
+    return UNITY_END();
+}
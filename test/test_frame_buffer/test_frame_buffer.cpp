@@ -0,0 +1,207 @@
+/**
+ * Unit tests for the display shadow frame
+ *
+ * Tests drawing into the frame, change detection, and the RLE and PNG
+ * encoders used by the frame mirror endpoints.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "frame_buffer.h"
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static uint16_t pixels[WIDTH * HEIGHT];
+
+/**
+ * Read a big-endian u32
+ */
+static uint32_t getU32Be(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * Decode an RLE stream back into pixels
+ *
+ * :return bool: True if the stream is well formed and covers the frame exactly
+ */
+static bool decodeRle(const uint8_t* data, size_t length, uint16_t* out, size_t outCount) {
+    if (length < 7 || data[0] != 'F' || data[1] != 'R' || data[2] != 1) return false;
+    size_t position = 0;
+    for (size_t i = 7; i + 3 <= length; i += 3) {
+        uint16_t color = (uint16_t)(data[i + 1] | (data[i + 2] << 8));
+        for (int n = 0; n < data[i]; n++) {
+            if (position >= outCount) return false;
+            out[position++] = color;
+        }
+    }
+    return position == outCount;
+}
+
+// ============================================================================
+// Drawing Tests
+// ============================================================================
+
+void test_frame_starts_black() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    TEST_ASSERT_EQUAL_HEX16(0, frame.getPixel(0, 0));
+    TEST_ASSERT_EQUAL_HEX16(0, frame.getPixel(WIDTH - 1, HEIGHT - 1));
+}
+
+void test_fill_rect_clipped() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    frame.fillRect(-5, 22, WIDTH + 10, 100, 0xF800);
+
+    TEST_ASSERT_EQUAL_HEX16(0, frame.getPixel(0, 21));
+    TEST_ASSERT_EQUAL_HEX16(0xF800, frame.getPixel(0, 22));
+    TEST_ASSERT_EQUAL_HEX16(0xF800, frame.getPixel(WIDTH - 1, HEIGHT - 1));
+}
+
+void test_set_pixel_outside_ignored() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    frame.setPixel(-1, 0, 0xFFFF);
+    frame.setPixel(WIDTH, 0, 0xFFFF);
+    frame.setPixel(0, HEIGHT, 0xFFFF);
+    frame.setPixel(3, 4, 0x07E0);
+
+    TEST_ASSERT_EQUAL_HEX16(0x07E0, frame.getPixel(3, 4));
+    TEST_ASSERT_EQUAL_HEX16(0, frame.getPixel(WIDTH, 0));
+}
+
+void test_hash_follows_content() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    uint32_t blank = frame.getHash();
+
+    frame.setPixel(10, 10, 0xFFFF);
+    uint32_t drawn = frame.getHash();
+    TEST_ASSERT_NOT_EQUAL(blank, drawn);
+
+    // Clearing and redrawing the same picture gives the same hash
+    frame.fill(0);
+    TEST_ASSERT_EQUAL_HEX32(blank, frame.getHash());
+    frame.setPixel(10, 10, 0xFFFF);
+    TEST_ASSERT_EQUAL_HEX32(drawn, frame.getHash());
+}
+
+// ============================================================================
+// RLE Tests
+// ============================================================================
+
+void test_rle_round_trip() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    frame.fillRect(1, 2, 30, 8, 0xF800);
+    frame.setPixel(63, 31, 0x001F);
+
+    static uint8_t encoded[FRAME_RLE_MAX_SIZE(WIDTH, HEIGHT)];
+    size_t length = encodeFrameRle(frame, encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_THAN(200, length);  // Mostly black frames stay small
+
+    static uint16_t decoded[WIDTH * HEIGHT];
+    TEST_ASSERT_TRUE(decodeRle(encoded, length, decoded, WIDTH * HEIGHT));
+    TEST_ASSERT_EQUAL_MEMORY(pixels, decoded, sizeof(pixels));
+}
+
+void test_rle_worst_case_fits() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            frame.setPixel(x, y, (uint16_t)((y * WIDTH + x) & 1 ? 0xFFFF : 0));
+        }
+    }
+
+    static uint8_t encoded[FRAME_RLE_MAX_SIZE(WIDTH, HEIGHT)];
+    TEST_ASSERT_EQUAL(FRAME_RLE_MAX_SIZE(WIDTH, HEIGHT), encodeFrameRle(frame, encoded, sizeof(encoded)));
+    TEST_ASSERT_EQUAL(0, encodeFrameRle(frame, encoded, sizeof(encoded) - 1));
+}
+
+// ============================================================================
+// PNG Tests
+// ============================================================================
+
+void test_png_structure() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    frame.setPixel(0, 0, 0xF800);
+
+    static uint8_t png[FRAME_PNG_SIZE(WIDTH, HEIGHT)];
+    size_t length = encodeFramePng(frame, png, sizeof(png));
+    TEST_ASSERT_EQUAL(FRAME_PNG_SIZE(WIDTH, HEIGHT), length);
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    TEST_ASSERT_EQUAL_MEMORY(SIGNATURE, png, 8);
+    TEST_ASSERT_EQUAL_MEMORY("IHDR", png + 12, 4);
+    TEST_ASSERT_EQUAL(WIDTH, getU32Be(png + 16));
+    TEST_ASSERT_EQUAL(HEIGHT, getU32Be(png + 20));
+    TEST_ASSERT_EQUAL_MEMORY("IDAT", png + 37, 4);
+
+    // IEND has no data, so its CRC is the well-known constant
+    TEST_ASSERT_EQUAL_MEMORY("IEND", png + length - 8, 4);
+    TEST_ASSERT_EQUAL_HEX32(0xAE426082, getU32Be(png + length - 4));
+
+    // IHDR CRC for a 64x32 8-bit RGB image
+    TEST_ASSERT_EQUAL_HEX32(0x2DFFE9D3, getU32Be(png + 29));
+}
+
+void test_png_pixels_stored() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    frame.setPixel(0, 0, 0xF800);   // Pure red
+    frame.setPixel(1, 0, 0x07E0);   // Pure green
+
+    static uint8_t png[FRAME_PNG_SIZE(WIDTH, HEIGHT)];
+    encodeFramePng(frame, png, sizeof(png));
+
+    // IDAT data: zlib header, stored block header, then filter byte and RGB
+    const uint8_t* data = png + 41;
+    TEST_ASSERT_EQUAL_HEX8(0x78, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, data[2]);  // Final stored block
+    const uint8_t* row = data + 7;
+    TEST_ASSERT_EQUAL_HEX8(0, row[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, row[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, row[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, row[3]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, row[4]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, row[5]);
+}
+
+void test_png_buffer_too_small() {
+    FrameBuffer frame(pixels, WIDTH, HEIGHT);
+    static uint8_t png[FRAME_PNG_SIZE(WIDTH, HEIGHT)];
+    TEST_ASSERT_EQUAL(0, encodeFramePng(frame, png, sizeof(png) - 1));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Drawing tests
+    RUN_TEST(test_frame_starts_black);
+    RUN_TEST(test_fill_rect_clipped);
+    RUN_TEST(test_set_pixel_outside_ignored);
+    RUN_TEST(test_hash_follows_content);
+
+    // RLE tests
+    RUN_TEST(test_rle_round_trip);
+    RUN_TEST(test_rle_worst_case_fits);
+
+    // PNG tests
+    RUN_TEST(test_png_structure);
+    RUN_TEST(test_png_pixels_stored);
+    RUN_TEST(test_png_buffer_too_small);
+
+    return UNITY_END();
+}
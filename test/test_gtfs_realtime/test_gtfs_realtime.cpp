@@ -0,0 +1,336 @@
+/**
+ * Unit tests for the GTFS-realtime provider
+ *
+ * Tests the streaming protobuf decoder against a local TripUpdates feed
+ * (trip_updates.pb, next to this file) fed in pieces of every size, and
+ * against small feeds encoded here. These tests run natively on your
+ * computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "gtfs_realtime.h"
+
+static const time_t FEED_TIME = 1760000000;   // trip_updates.pb header timestamp
+
+static const char* const STOPS[] = {"PF_B35_C", "PF_B35_D"};
+static const GtfsRtRoute ROUTES[] = {
+    {"RED", "RD", {"Glenmont", "Shady Grove"}},
+};
+
+static uint8_t feedFile[4096];
+static size_t feedFileLength = 0;
+
+/**
+ * Read trip_updates.pb from the directory this file is in
+ */
+static void loadFeedFile() {
+    char path[512];
+    const char* slash = strrchr(__FILE__, '/');
+    size_t dirLength = slash != nullptr ? (size_t)(slash - __FILE__ + 1) : 0;
+    snprintf(path, sizeof(path), "%.*strip_updates.pb", (int)dirLength, __FILE__);
+
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) file = fopen("test/test_gtfs_realtime/trip_updates.pb", "rb");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "trip_updates.pb not found");
+    feedFileLength = fread(feedFile, 1, sizeof(feedFile), file);
+    fclose(file);
+}
+
+/**
+ * Minimal protobuf writer for building feeds in tests
+ */
+struct Encoder {
+    uint8_t data[2048];
+    size_t length = 0;
+
+    void varint(uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            data[length++] = value ? (byte | 0x80) : byte;
+        } while (value);
+    }
+    void varintField(uint32_t field, uint64_t value) {
+        varint(field << 3);
+        varint(value);
+    }
+    void bytesField(uint32_t field, const void* bytes, size_t size) {
+        varint(field << 3 | 2);
+        varint(size);
+        memcpy(data + length, bytes, size);
+        length += size;
+    }
+    void stringField(uint32_t field, const char* text) {
+        bytesField(field, text, strlen(text));
+    }
+    void messageField(uint32_t field, const Encoder& message) {
+        bytesField(field, message.data, message.length);
+    }
+};
+
+// One trip serving a stop, then a later stop
+static void encodeTrip(Encoder& feed, const char* routeId, int direction, const char* stopId, int64_t arrival) {
+    Encoder trip, event, stop, next, update, entity;
+    trip.stringField(5, routeId);
+    trip.varintField(6, direction);
+    event.varintField(2, (uint64_t)arrival);
+    stop.messageField(2, event);
+    stop.stringField(4, stopId);
+    next.stringField(4, "LATER");
+    update.messageField(1, trip);
+    update.messageField(2, stop);
+    update.messageField(2, next);
+    entity.stringField(1, "e");
+    entity.messageField(3, update);
+    feed.messageField(2, entity);
+}
+
+static void encodeHeader(Encoder& feed, time_t timestamp) {
+    Encoder header;
+    header.stringField(1, "2.0");
+    header.varintField(3, (uint64_t)timestamp);
+    feed.messageField(1, header);
+}
+
+static bool decode(GtfsRtProvider& provider, const uint8_t* data, size_t length, size_t chunk,
+                   TrainObservation* observations, int maxCount, int& count, uint32_t& hash, time_t wallNow = 0) {
+    provider.begin(wallNow);
+    for (size_t offset = 0; offset < length; offset += chunk) {
+        size_t size = length - offset < chunk ? length - offset : chunk;
+        if (provider.write(data + offset, size) != size) break;
+    }
+    return provider.finish(observations, maxCount, count, hash);
+}
+
+// ============================================================================
+// Feed File Tests
+// ============================================================================
+
+void test_feed_file_predictions() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[16];
+    int count;
+    uint32_t hash;
+
+    TEST_ASSERT_TRUE(decode(provider, feedFile, feedFileLength, feedFileLength, observations, 16, count, hash));
+    TEST_ASSERT_EQUAL(8, provider.getTripCount());
+    TEST_ASSERT_EQUAL(FEED_TIME, provider.getFeedTime());
+
+    // Boarding, then 2, 5 and 10 minutes; the trip ending here, the
+    // cancelled one, the skipped stop and the one that left are gone
+    TEST_ASSERT_EQUAL(4, count);
+    TEST_ASSERT_EQUAL(TRAIN_BOARDING, observations[0].status);
+    TEST_ASSERT_EQUAL_STRING("Shad", observations[0].destination);
+    TEST_ASSERT_EQUAL(2, observations[0].group);
+
+    TEST_ASSERT_EQUAL(TRAIN_MOVING, observations[1].status);
+    TEST_ASSERT_EQUAL(120000, observations[1].etaMs);
+    TEST_ASSERT_EQUAL_STRING("RD", observations[1].line);
+
+    TEST_ASSERT_EQUAL(300000, observations[2].etaMs);
+    TEST_ASSERT_EQUAL_STRING("Glen", observations[2].destination);
+    TEST_ASSERT_EQUAL(1, observations[2].group);
+
+    // Unknown route: its ID as the line, no destination
+    TEST_ASSERT_EQUAL(600000, observations[3].etaMs);
+    TEST_ASSERT_EQUAL_STRING("SH", observations[3].line);
+    TEST_ASSERT_EQUAL_STRING("", observations[3].destination);
+}
+
+void test_feed_file_in_every_chunk_size() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation whole[16];
+    TrainObservation pieces[16];
+    int wholeCount, count;
+    uint32_t wholeHash, hash;
+
+    // Cleared so padding compares equal
+    memset(whole, 0, sizeof(whole));
+    decode(provider, feedFile, feedFileLength, feedFileLength, whole, 16, wholeCount, wholeHash);
+    for (size_t chunk = 1; chunk <= 64; chunk++) {
+        memset(pieces, 0, sizeof(pieces));
+        TEST_ASSERT_TRUE(decode(provider, feedFile, feedFileLength, chunk, pieces, 16, count, hash));
+        TEST_ASSERT_EQUAL(wholeCount, count);
+        TEST_ASSERT_EQUAL_UINT32(wholeHash, hash);
+        TEST_ASSERT_EQUAL_MEMORY(whole, pieces, sizeof(TrainObservation) * count);
+    }
+}
+
+void test_wall_clock_overrides_feed_time() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[16];
+    int count;
+    uint32_t hash;
+
+    // A minute later the boarding train is gone and the rest are closer
+    TEST_ASSERT_TRUE(decode(provider, feedFile, feedFileLength, 100, observations, 16, count, hash, FEED_TIME + 60));
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(60000, observations[0].etaMs);
+}
+
+void test_cut_off_feed_fails() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[16];
+    int count;
+    uint32_t hash;
+
+    TEST_ASSERT_FALSE(decode(provider, feedFile, feedFileLength - 7, 32, observations, 16, count, hash));
+    TEST_ASSERT_EQUAL_STRING("feed cut off", provider.getError());
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+// ============================================================================
+// Encoded Feed Tests
+// ============================================================================
+
+void test_empty_feed() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[4];
+    int count = -1;
+    uint32_t hash;
+    Encoder feed;
+    encodeHeader(feed, FEED_TIME);
+
+    TEST_ASSERT_TRUE(decode(provider, feed.data, feed.length, feed.length, observations, 4, count, hash));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_soonest_kept_when_full() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[GTFS_RT_MAX_ARRIVALS];
+    int count;
+    uint32_t hash;
+    Encoder feed;
+    encodeHeader(feed, FEED_TIME);
+
+    // Latest first, so every later trip has to push one out
+    for (int i = GTFS_RT_MAX_ARRIVALS + 8; i > 0; i--) {
+        encodeTrip(feed, "RED", i % 2, "PF_B35_D", FEED_TIME + i * 60);
+    }
+    TEST_ASSERT_TRUE(decode(provider, feed.data, feed.length, 16, observations, GTFS_RT_MAX_ARRIVALS, count, hash));
+    TEST_ASSERT_EQUAL(GTFS_RT_MAX_ARRIVALS, count);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL((i + 1) * 60000L, observations[i].etaMs);
+    }
+}
+
+void test_max_count_respected() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[3];
+    int count;
+    uint32_t hash;
+    Encoder feed;
+    encodeHeader(feed, FEED_TIME);
+    for (int i = 1; i <= 5; i++) encodeTrip(feed, "RED", 0, "PF_B35_C", FEED_TIME + i * 60);
+
+    TEST_ASSERT_TRUE(decode(provider, feed.data, feed.length, feed.length, observations, 2, count, hash));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(120000, observations[1].etaMs);
+}
+
+void test_long_stop_id_never_matches() {
+    static const char* const LONG_STOPS[] = {"PF_B35_C_AND_A_VERY_LONG_SUFFIX_X"};
+    GtfsRtProvider provider("http://example.com/rt", LONG_STOPS, 1, ROUTES, 1);
+    TrainObservation observations[4];
+    int count;
+    uint32_t hash;
+    Encoder feed;
+    encodeHeader(feed, FEED_TIME);
+    encodeTrip(feed, "RED", 0, LONG_STOPS[0], FEED_TIME + 60);
+
+    TEST_ASSERT_TRUE(decode(provider, feed.data, feed.length, 5, observations, 4, count, hash));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_hash_follows_arrivals_not_header() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[4];
+    int count;
+    uint32_t first, sameTrips, moved;
+
+    Encoder a, b, c;
+    encodeHeader(a, FEED_TIME);
+    encodeTrip(a, "RED", 0, "PF_B35_C", FEED_TIME + 300);
+    encodeHeader(b, FEED_TIME + 30);
+    encodeTrip(b, "RED", 0, "PF_B35_C", FEED_TIME + 300);
+    encodeHeader(c, FEED_TIME + 30);
+    encodeTrip(c, "RED", 0, "PF_B35_C", FEED_TIME + 360);
+
+    decode(provider, a.data, a.length, a.length, observations, 4, count, first, FEED_TIME);
+    decode(provider, b.data, b.length, b.length, observations, 4, count, sameTrips, FEED_TIME);
+    decode(provider, c.data, c.length, c.length, observations, 4, count, moved, FEED_TIME);
+    TEST_ASSERT_EQUAL_UINT32(first, sameTrips);
+    TEST_ASSERT_TRUE(first != moved);
+}
+
+void test_field_overrunning_message_fails() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[4];
+    int count;
+    uint32_t hash;
+
+    // Header claims 4 bytes but holds a 10-byte string
+    const uint8_t feed[] = {0x0A, 0x04, 0x0A, 0x0A, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_FALSE(decode(provider, feed, sizeof(feed), sizeof(feed), observations, 4, count, hash));
+    TEST_ASSERT_EQUAL_STRING("field overruns its message", provider.getError());
+}
+
+void test_no_time_reference_fails() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    TrainObservation observations[4];
+    int count;
+    uint32_t hash;
+    Encoder feed;
+    encodeTrip(feed, "RED", 0, "PF_B35_C", FEED_TIME + 60);
+
+    TEST_ASSERT_FALSE(decode(provider, feed.data, feed.length, feed.length, observations, 4, count, hash));
+    TEST_ASSERT_TRUE(decode(provider, feed.data, feed.length, feed.length, observations, 4, count, hash, FEED_TIME));
+    TEST_ASSERT_EQUAL(1, count);
+}
+
+void test_build_url() {
+    GtfsRtProvider provider("http://example.com/rt", STOPS, 2, ROUTES, 1);
+    char url[PROVIDER_URL_MAX_LEN];
+    char small[8];
+    TEST_ASSERT_TRUE(provider.buildUrl(url, sizeof(url)));
+    TEST_ASSERT_EQUAL_STRING("http://example.com/rt", url);
+    TEST_ASSERT_FALSE(provider.buildUrl(small, sizeof(small)));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    if (feedFileLength == 0) loadFeedFile();
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Feed file tests
+    RUN_TEST(test_feed_file_predictions);
+    RUN_TEST(test_feed_file_in_every_chunk_size);
+    RUN_TEST(test_wall_clock_overrides_feed_time);
+    RUN_TEST(test_cut_off_feed_fails);
+
+    // Encoded feed tests
+    RUN_TEST(test_empty_feed);
+    RUN_TEST(test_soonest_kept_when_full);
+    RUN_TEST(test_max_count_respected);
+    RUN_TEST(test_long_stop_id_never_matches);
+    RUN_TEST(test_hash_follows_arrivals_not_header);
+    RUN_TEST(test_field_overrunning_message_fails);
+    RUN_TEST(test_no_time_reference_fails);
+    RUN_TEST(test_build_url);
+
+    return UNITY_END();
+}
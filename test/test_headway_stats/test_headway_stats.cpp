@@ -0,0 +1,218 @@
+/**
+ * Unit tests for rolling headway statistics
+ * 
+ * Tests the per-stream ring buffer, incremental mean and percentiles,
+ * gap alerts, and stream recycling.
+ * These tests run natively on your computer without ESP32 hardware.
+ * 
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "headway_stats.h"
+
+/**
+ * Record departures at a fixed headway, starting at startMs
+ * 
+ * :return unsigned long: Time of the last departure
+ */
+unsigned long recordEvery(HeadwayStats& stats, const char* line, uint8_t group,
+                          unsigned long startMs, unsigned long headwayMs, int departures) {
+    unsigned long t = startMs;
+    for (int i = 0; i < departures; i++) {
+        t = startMs + i * headwayMs;
+        stats.recordDeparture(line, group, t);
+    }
+    return t;
+}
+
+// ============================================================================
+// Basic Recording Tests
+// ============================================================================
+
+void test_first_departure_has_no_headway() {
+    HeadwayStats stats;
+    stats.recordDeparture("RD", 1, 1000);
+    
+    HeadwaySummary summary;
+    TEST_ASSERT_TRUE(stats.getSummary(0, 1000, summary));
+    TEST_ASSERT_EQUAL(1, stats.getStreamCount());
+    TEST_ASSERT_EQUAL(0, summary.samples);
+    TEST_ASSERT_EQUAL(0, summary.meanSec);
+}
+
+void test_mean_of_regular_headways() {
+    HeadwayStats stats;
+    unsigned long last = recordEvery(stats, "RD", 1, 0, 360000, 6);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, last, summary);
+    TEST_ASSERT_EQUAL(5, summary.samples);
+    TEST_ASSERT_EQUAL(360, summary.meanSec);
+}
+
+void test_streams_split_by_line_and_group() {
+    HeadwayStats stats;
+    recordEvery(stats, "RD", 1, 0, 300000, 3);
+    recordEvery(stats, "RD", 2, 0, 600000, 3);
+    recordEvery(stats, "BL", 1, 0, 480000, 3);
+    
+    TEST_ASSERT_EQUAL(3, stats.getStreamCount());
+    
+    HeadwaySummary summary;
+    stats.getSummary(1, 0, summary);
+    TEST_ASSERT_EQUAL_STRING("RD", summary.line);
+    TEST_ASSERT_EQUAL(2, summary.group);
+    TEST_ASSERT_EQUAL(600, summary.meanSec);
+}
+
+// ============================================================================
+// Rolling Window Tests
+// ============================================================================
+
+void test_window_evicts_oldest_headways() {
+    HeadwayStats stats;
+    // A full window of 10-minute headways, then a full window of 4-minute ones
+    unsigned long t = recordEvery(stats, "GR", 1, 0, 600000, HEADWAY_WINDOW + 1);
+    t = recordEvery(stats, "GR", 1, t + 240000, 240000, HEADWAY_WINDOW);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, t, summary);
+    TEST_ASSERT_EQUAL(HEADWAY_WINDOW, summary.samples);
+    TEST_ASSERT_EQUAL(240, summary.meanSec);
+    TEST_ASSERT_EQUAL(255, summary.p90Sec);  // Midpoint of the 240-270 s bin
+}
+
+void test_percentiles_follow_distribution() {
+    HeadwayStats stats;
+    // Nine 5-minute headways and one 15-minute headway
+    unsigned long t = recordEvery(stats, "OR", 2, 0, 300000, 10);
+    t += 900000;
+    stats.recordDeparture("OR", 2, t);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, t, summary);
+    TEST_ASSERT_EQUAL(10, summary.samples);
+    TEST_ASSERT_EQUAL(315, summary.p50Sec);
+    TEST_ASSERT_EQUAL(315, summary.p90Sec);
+    TEST_ASSERT_EQUAL(360, summary.meanSec);
+}
+
+void test_service_break_is_not_a_headway() {
+    HeadwayStats stats;
+    unsigned long t = recordEvery(stats, "YL", 1, 0, 480000, 3);
+    stats.recordDeparture("YL", 1, t + (HEADWAY_MAX_SEC + 1) * 1000UL);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, t, summary);
+    TEST_ASSERT_EQUAL(2, summary.samples);
+    TEST_ASSERT_EQUAL(480, summary.meanSec);
+}
+
+// ============================================================================
+// Gap Alert Tests
+// ============================================================================
+
+void test_gap_alert_after_long_wait() {
+    HeadwayStats stats;
+    unsigned long t = recordEvery(stats, "SV", 1, 0, 480000, HEADWAY_MIN_SAMPLES + 1);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, t + 480000, summary);
+    TEST_ASSERT_FALSE(summary.gapAlert);
+    
+    stats.getSummary(0, t + 1200000, summary);  // 20 minutes without a train
+    TEST_ASSERT_TRUE(summary.gapAlert);
+}
+
+void test_no_gap_alert_without_enough_samples() {
+    HeadwayStats stats;
+    unsigned long t = recordEvery(stats, "SV", 1, 0, 480000, HEADWAY_MIN_SAMPLES);
+    
+    HeadwaySummary summary;
+    stats.getSummary(0, t + 3600000, summary);
+    TEST_ASSERT_FALSE(summary.gapAlert);
+    TEST_ASSERT_EQUAL(0, summary.p90Sec);
+}
+
+// ============================================================================
+// Capacity and Report Tests
+// ============================================================================
+
+void test_least_recent_stream_is_recycled() {
+    HeadwayStats stats;
+    const char* lines[] = {"RD", "BL", "OR", "GR", "YL", "SV"};
+    for (int i = 0; i < HEADWAY_MAX_STREAMS; i++) {
+        stats.recordDeparture(lines[i % 6], (uint8_t)(1 + i / 6), 1000UL * (i + 1));
+    }
+    stats.recordDeparture("RD", 1, 50000);  // Refresh the first stream
+    stats.recordDeparture("XX", 9, 60000);  // Must recycle "BL" 1
+    
+    TEST_ASSERT_EQUAL(HEADWAY_MAX_STREAMS, stats.getStreamCount());
+    
+    HeadwaySummary summary;
+    stats.getSummary(1, 60000, summary);
+    TEST_ASSERT_EQUAL_STRING("XX", summary.line);
+    stats.getSummary(0, 60000, summary);
+    TEST_ASSERT_EQUAL_STRING("RD", summary.line);
+}
+
+void test_report_format() {
+    HeadwayStats stats;
+    recordEvery(stats, "RD", 1, 0, 360000, 2);
+    
+    char buffer[128];
+    size_t length = stats.formatReport(buffer, sizeof(buffer), 480000);
+    
+    TEST_ASSERT_EQUAL_STRING("RD1 n=1 mean=360 p50=0 p90=0 last=120\n", buffer);
+    TEST_ASSERT_EQUAL(strlen(buffer), length);
+}
+
+void test_report_truncates_whole_lines() {
+    HeadwayStats stats;
+    recordEvery(stats, "RD", 1, 0, 360000, 2);
+    recordEvery(stats, "RD", 2, 0, 360000, 2);
+    
+    char buffer[50];
+    stats.formatReport(buffer, sizeof(buffer), 480000);
+    
+    TEST_ASSERT_EQUAL_STRING("RD1 n=1 mean=360 p50=0 p90=0 last=120\n", buffer);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    
+    // Basic recording
+    RUN_TEST(test_first_departure_has_no_headway);
+    RUN_TEST(test_mean_of_regular_headways);
+    RUN_TEST(test_streams_split_by_line_and_group);
+    
+    // Rolling window
+    RUN_TEST(test_window_evicts_oldest_headways);
+    RUN_TEST(test_percentiles_follow_distribution);
+    RUN_TEST(test_service_break_is_not_a_headway);
+    
+    // Gap alerts
+    RUN_TEST(test_gap_alert_after_long_wait);
+    RUN_TEST(test_no_gap_alert_without_enough_samples);
+    
+    // Capacity and report
+    RUN_TEST(test_least_recent_stream_is_recycled);
+    RUN_TEST(test_report_format);
+    RUN_TEST(test_report_truncates_whole_lines);
+    
+    return UNITY_END();
+}
@@ -0,0 +1,115 @@
+/**
+ * Unit tests for the per-step heap high-water marks
+ *
+ * Tests what is charged to a step from the free heap and the low-water
+ * mark around it, peaks over several runs, and the report.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "heap_watermarks.h"
+
+static HeapWatermarks* heap;
+
+// ============================================================================
+// Recording Tests
+// ============================================================================
+
+void test_held_bytes_charged() {
+    // The display takes its DMA buffers for good
+    heap->record("display", {200000, 200000}, {140000, 140000});
+    const HeapStep* step = heap->find("display");
+    TEST_ASSERT_NOT_NULL(step);
+    TEST_ASSERT_EQUAL(60000, step->heldBytes);
+    TEST_ASSERT_EQUAL_UINT32(60000, step->peakBytes);
+    TEST_ASSERT_EQUAL(1, step->runs);
+}
+
+void test_new_low_shows_peak() {
+    // A fetch that frees what it took, but dipped 30 KB below where it started
+    heap->record("fetch", {140000, 135000}, {140000, 110000});
+    const HeapStep* step = heap->find("fetch");
+    TEST_ASSERT_EQUAL(0, step->heldBytes);
+    TEST_ASSERT_EQUAL_UINT32(30000, step->peakBytes);
+}
+
+void test_no_new_low_shows_only_held() {
+    // The low was set earlier, so this run's peak can't be seen
+    heap->record("metrics", {140000, 100000}, {139000, 100000});
+    TEST_ASSERT_EQUAL_UINT32(1000, heap->find("metrics")->peakBytes);
+}
+
+void test_freed_memory_is_negative_held() {
+    heap->record("config", {100000, 90000}, {104000, 90000});
+    TEST_ASSERT_EQUAL(-4000, heap->find("config")->heldBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, heap->find("config")->peakBytes);
+}
+
+void test_peak_kept_over_runs() {
+    heap->record("fetch", {140000, 140000}, {140000, 100000});
+    heap->record("fetch", {140000, 100000}, {139500, 100000});
+    const HeapStep* step = heap->find("fetch");
+    TEST_ASSERT_EQUAL(2, step->runs);
+    TEST_ASSERT_EQUAL(500, step->heldBytes);
+    TEST_ASSERT_EQUAL_UINT32(40000, step->peakBytes);
+    TEST_ASSERT_EQUAL(1, heap->getCount());
+}
+
+void test_table_full() {
+    static const char* const NAMES[HEAP_MAX_STEPS] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l"};
+    for (int i = 0; i < HEAP_MAX_STEPS; i++) {
+        TEST_ASSERT_TRUE(heap->record(NAMES[i], {1000, 1000}, {900, 900}));
+    }
+    TEST_ASSERT_FALSE(heap->record("extra", {1000, 1000}, {900, 900}));
+    TEST_ASSERT_TRUE(heap->record("a", {1000, 900}, {1000, 900}));  // Known steps still recorded
+    TEST_ASSERT_NULL(heap->find("extra"));
+    TEST_ASSERT_EQUAL(HEAP_MAX_STEPS, heap->getCount());
+}
+
+// ============================================================================
+// Report Tests
+// ============================================================================
+
+void test_format() {
+    heap->record("display", {200000, 200000}, {140000, 140000});
+    heap->record("fetch", {140000, 140000}, {140000, 110000});
+    heap->record("fetch", {140000, 110000}, {140000, 110000});
+
+    char buffer[256];
+    BufferWriter out(buffer, sizeof(buffer));
+    heap->format(out);
+    TEST_ASSERT_EQUAL_STRING("display: peak 60000, held 60000 bytes (1 run)\n"
+                             "fetch: peak 30000, held 0 bytes (2 runs)\n", buffer);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    heap = new HeapWatermarks();
+}
+
+void tearDown(void) {
+    delete heap;
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Recording
+    RUN_TEST(test_held_bytes_charged);
+    RUN_TEST(test_new_low_shows_peak);
+    RUN_TEST(test_no_new_low_shows_only_held);
+    RUN_TEST(test_freed_memory_is_negative_held);
+    RUN_TEST(test_peak_kept_over_runs);
+    RUN_TEST(test_table_full);
+
+    // Report
+    RUN_TEST(test_format);
+
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+/**
+ * Unit tests for the deferred log ring
+ *
+ * Tests that records written with raw arguments format back to the same
+ * text printf would give, and the ring's wrap, overflow and redaction
+ * behavior.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include "log_ring.h"
+
+static LogRing* ring;
+
+/**
+ * Write a record through a variadic wrapper, as logWrite() does
+ */
+static bool logTo(LogRing& target, uint8_t level, const char* tag, uint32_t timestampMs,
+                  const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    bool written = target.write(level, tag, timestampMs, format, args);
+    va_end(args);
+    return written;
+}
+
+/**
+ * Read the next record and check its text
+ */
+static void expectLine(LogRing& source, const char* expected) {
+    char line[256];
+    LogEntry entry;
+    TEST_ASSERT_TRUE(source.readNext(line, sizeof(line), entry));
+    TEST_ASSERT_EQUAL_STRING(expected, line);
+}
+
+// ============================================================================
+// Formatting Tests
+// ============================================================================
+
+void test_empty_ring() {
+    char line[64];
+    LogEntry entry;
+    TEST_ASSERT_FALSE(ring->readNext(line, sizeof(line), entry));
+}
+
+void test_metadata_round_trip() {
+    logTo(*ring, LOG_LEVEL_WARN, "WMATA", 123456, "HTTP error: %d", -1);
+
+    char line[64];
+    LogEntry entry;
+    TEST_ASSERT_TRUE(ring->readNext(line, sizeof(line), entry));
+    TEST_ASSERT_EQUAL_STRING("HTTP error: -1", line);
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, entry.level);
+    TEST_ASSERT_EQUAL_UINT32(123456, entry.timestampMs);
+    TEST_ASSERT_EQUAL_STRING("WMATA", entry.tag);
+    TEST_ASSERT_FALSE(ring->readNext(line, sizeof(line), entry));
+}
+
+void test_integer_conversions() {
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "%d %u %ld %lu %lld %08lx %X %c %zu %hhu",
+          -5, 4000000000u, -70000L, 4000000000UL, -9000000000LL, 0xBEEFUL, 0xABCu, 'Q', (size_t)42,
+          (unsigned char)200);
+
+    char expected[128];
+    snprintf(expected, sizeof(expected), "%d %u %ld %lu %lld %08lx %X %c %zu %hhu",
+             -5, 4000000000u, -70000L, 4000000000UL, -9000000000LL, 0xBEEFUL, 0xABCu, 'Q', (size_t)42,
+             (unsigned char)200);
+    expectLine(*ring, expected);
+}
+
+void test_float_and_percent() {
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "%.2f %g 100%%", 3.14159, 0.5f);
+    expectLine(*ring, "3.14 0.5 100%");
+}
+
+void test_star_width_and_precision() {
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "[%*d] [%-*s] [%.*s]", 5, 42, 4, "ab", 3, "abcdef");
+    expectLine(*ring, "[   42] [ab  ] [abc]");
+}
+
+void test_null_string() {
+    const char* missing = nullptr;
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "name=%s", missing);
+    expectLine(*ring, "name=(null)");
+}
+
+void test_string_copied_at_write() {
+    // The caller's buffer may change before the record is formatted
+    char buffer[16];
+    strcpy(buffer, "before");
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "value %s", buffer);
+    strcpy(buffer, "after");
+    expectLine(*ring, "value before");
+}
+
+void test_long_string_truncated() {
+    char big[1024];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    TEST_ASSERT_TRUE(logTo(*ring, LOG_LEVEL_INFO, "T", 0, "%s", big));
+
+    char line[LOG_RECORD_MAX * 2];
+    LogEntry entry;
+    TEST_ASSERT_TRUE(ring->readNext(line, sizeof(line), entry));
+    size_t length = strlen(line);
+    TEST_ASSERT_LESS_THAN(LOG_RECORD_MAX, length);
+    TEST_ASSERT_GREATER_THAN(LOG_RECORD_MAX / 2, length);
+    TEST_ASSERT_EQUAL('x', line[0]);
+}
+
+void test_output_cut_to_buffer() {
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "%s", "0123456789");
+    char line[5];
+    LogEntry entry;
+    TEST_ASSERT_TRUE(ring->readNext(line, sizeof(line), entry));
+    TEST_ASSERT_EQUAL_STRING("0123", line);
+}
+
+// ============================================================================
+// Ring Tests
+// ============================================================================
+
+void test_wraps_around() {
+    // Far more data than the ring holds, read as it goes
+    for (int i = 0; i < 2000; i++) {
+        TEST_ASSERT_TRUE(logTo(*ring, LOG_LEVEL_INFO, "T", (uint32_t)i, "record %d %s", i, "padding text"));
+        char expected[64];
+        snprintf(expected, sizeof(expected), "record %d padding text", i);
+        expectLine(*ring, expected);
+    }
+    TEST_ASSERT_EQUAL(0, ring->getDroppedCount());
+}
+
+void test_drops_when_full() {
+    int written = 0;
+    while (logTo(*ring, LOG_LEVEL_INFO, "T", 0, "record %d", written)) {
+        written++;
+        TEST_ASSERT_LESS_THAN(LOG_RING_SIZE, written);
+    }
+    TEST_ASSERT_EQUAL(1, ring->getDroppedCount());
+
+    // Everything accepted comes back in order
+    for (int i = 0; i < written; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "record %d", i);
+        expectLine(*ring, expected);
+    }
+
+    // And the space is usable again
+    TEST_ASSERT_TRUE(logTo(*ring, LOG_LEVEL_INFO, "T", 0, "after"));
+    expectLine(*ring, "after");
+}
+
+// ============================================================================
+// Redaction Tests
+// ============================================================================
+
+void test_secret_redacted() {
+    TEST_ASSERT_TRUE(ring->addSecret("abc123secret"));
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "GET /x?api_key=%s&y=%s", "abc123secret", "abc123secret");
+    expectLine(*ring, "GET /x?api_key=" LOG_REDACTED "&y=" LOG_REDACTED);
+}
+
+void test_secret_redacted_before_cut() {
+    // A secret split by a short output buffer must not leak its first part
+    ring->addSecret("hunter2hunter2");
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "pw=%s tail", "hunter2hunter2");
+
+    char line[8];
+    LogEntry entry;
+    TEST_ASSERT_TRUE(ring->readNext(line, sizeof(line), entry));
+    TEST_ASSERT_EQUAL_STRING("pw=" LOG_REDACTED " ", line);
+}
+
+void test_short_secret_ignored() {
+    TEST_ASSERT_FALSE(ring->addSecret("ab"));
+    TEST_ASSERT_FALSE(ring->addSecret(nullptr));
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "tab");
+    expectLine(*ring, "tab");
+}
+
+void test_secret_changed_in_place() {
+    char secret[16] = "oldsecret";
+    TEST_ASSERT_TRUE(ring->addSecret(secret));
+    TEST_ASSERT_TRUE(ring->addSecret(secret));
+
+    strcpy(secret, "newsecret");
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "a oldsecret b newsecret");
+    expectLine(*ring, "a oldsecret b " LOG_REDACTED);
+
+    // Cleared: no longer matches anything
+    secret[0] = '\0';
+    logTo(*ring, LOG_LEVEL_INFO, "T", 0, "c");
+    expectLine(*ring, "c");
+}
+
+void test_level_letters() {
+    TEST_ASSERT_EQUAL('E', logLevelLetter(LOG_LEVEL_ERROR));
+    TEST_ASSERT_EQUAL('W', logLevelLetter(LOG_LEVEL_WARN));
+    TEST_ASSERT_EQUAL('I', logLevelLetter(LOG_LEVEL_INFO));
+    TEST_ASSERT_EQUAL('D', logLevelLetter(LOG_LEVEL_DEBUG));
+}
+
+void test_level_names_parsed() {
+    TEST_ASSERT_EQUAL(LOG_LEVEL_NONE, parseLogLevel("none"));
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, parseLogLevel("warn"));
+    TEST_ASSERT_EQUAL(LOG_LEVEL_DEBUG, parseLogLevel("debug"));
+    TEST_ASSERT_EQUAL(-1, parseLogLevel("DEBUG"));
+    TEST_ASSERT_EQUAL(-1, parseLogLevel(""));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    ring = new LogRing();
+}
+
+void tearDown(void) {
+    delete ring;
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Formatting tests
+    RUN_TEST(test_empty_ring);
+    RUN_TEST(test_metadata_round_trip);
+    RUN_TEST(test_integer_conversions);
+    RUN_TEST(test_float_and_percent);
+    RUN_TEST(test_star_width_and_precision);
+    RUN_TEST(test_null_string);
+    RUN_TEST(test_string_copied_at_write);
+    RUN_TEST(test_long_string_truncated);
+    RUN_TEST(test_output_cut_to_buffer);
+
+    // Ring tests
+    RUN_TEST(test_wraps_around);
+    RUN_TEST(test_drops_when_full);
+
+    // Redaction tests
+    RUN_TEST(test_secret_redacted);
+    RUN_TEST(test_secret_redacted_before_cut);
+    RUN_TEST(test_short_secret_ignored);
+    RUN_TEST(test_secret_changed_in_place);
+    RUN_TEST(test_level_letters);
+    RUN_TEST(test_level_names_parsed);
+
+    return UNITY_END();
+}
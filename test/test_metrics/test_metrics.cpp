@@ -0,0 +1,177 @@
+/**
+ * Unit tests for metrics export
+ *
+ * Tests the latency histogram (bucketing, percentile estimates) and the
+ * Prometheus text format writer.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "latency_histogram.h"
+#include "prometheus_writer.h"
+
+// ============================================================================
+// LatencyHistogram Tests
+// ============================================================================
+
+void test_histogram_empty() {
+    LatencyHistogram latency;
+    TEST_ASSERT_EQUAL(0, latency.getCount());
+    TEST_ASSERT_EQUAL(0, latency.estimatePercentile(50));
+    TEST_ASSERT_EQUAL(0, latency.getMaxMs());
+}
+
+void test_histogram_buckets_inclusive() {
+    LatencyHistogram latency;
+    latency.record(50);    // Bound itself belongs to the bucket
+    latency.record(51);
+    latency.record(0);
+
+    TEST_ASSERT_EQUAL(2, latency.getBucketCount(0));
+    TEST_ASSERT_EQUAL(1, latency.getBucketCount(1));
+    TEST_ASSERT_EQUAL(3, latency.getCount());
+    TEST_ASSERT_EQUAL(101, (unsigned long)latency.getSumMs());
+}
+
+void test_histogram_overflow_bucket() {
+    LatencyHistogram latency;
+    latency.record(25000);
+
+    TEST_ASSERT_EQUAL(1, latency.getBucketCount(LATENCY_BUCKET_COUNT));
+    TEST_ASSERT_EQUAL(25000, latency.getMaxMs());
+    TEST_ASSERT_EQUAL(25000, latency.estimatePercentile(100));
+    TEST_ASSERT_EQUAL(0, latency.getBucketCount(LATENCY_BUCKET_COUNT + 1));
+}
+
+void test_histogram_percentiles() {
+    LatencyHistogram latency;
+    // 90 fast fetches and 10 slow ones
+    for (int i = 0; i < 90; i++) latency.record(180);
+    for (int i = 0; i < 10; i++) latency.record(1800);
+
+    unsigned long p50 = latency.estimatePercentile(50);
+    unsigned long p95 = latency.estimatePercentile(95);
+    TEST_ASSERT_TRUE(p50 > 100 && p50 <= 200);
+    TEST_ASSERT_TRUE(p95 > 1000 && p95 <= 1800);
+    TEST_ASSERT_TRUE(latency.estimatePercentile(90) <= 200);
+}
+
+void test_histogram_estimate_capped_by_max() {
+    LatencyHistogram latency;
+    latency.record(120);
+
+    // A lone sample in the 100-200 bucket can't be estimated above what was seen
+    TEST_ASSERT_EQUAL(120, latency.estimatePercentile(100));
+}
+
+void test_histogram_reset() {
+    LatencyHistogram latency;
+    latency.record(300);
+    latency.reset();
+    TEST_ASSERT_EQUAL(0, latency.getCount());
+    TEST_ASSERT_EQUAL(0, latency.getBucketCount(3));
+}
+
+// ============================================================================
+// PrometheusWriter Tests
+// ============================================================================
+
+void test_prometheus_counter() {
+    char buffer[256];
+    BufferWriter out(buffer, sizeof(buffer));
+    PrometheusWriter metrics(out);
+    metrics.counter("wmata_requests_total", "API requests since boot", 1234567);
+
+    TEST_ASSERT_EQUAL_STRING("# HELP wmata_requests_total API requests since boot\n"
+                             "# TYPE wmata_requests_total counter\n"
+                             "wmata_requests_total 1234567\n", buffer);
+}
+
+void test_prometheus_gauge_values() {
+    char buffer[256];
+    BufferWriter out(buffer, sizeof(buffer));
+    PrometheusWriter metrics(out);
+    metrics.sample("a", -67);
+    metrics.sample("b", 0.25);
+    metrics.sample("c", 4294967295.0);
+
+    TEST_ASSERT_EQUAL_STRING("a -67\nb 0.25\nc 4294967295\n", buffer);
+}
+
+void test_prometheus_labels_escaped() {
+    char buffer[256];
+    BufferWriter out(buffer, sizeof(buffer));
+    PrometheusWriter metrics(out);
+    metrics.sample("x", "note", "a\"b\\c\nd", 1);
+
+    TEST_ASSERT_EQUAL_STRING("x{note=\"a\\\"b\\\\c\\nd\"} 1\n", buffer);
+}
+
+void test_prometheus_histogram() {
+    LatencyHistogram latency;
+    latency.record(40);
+    latency.record(150);
+    latency.record(150);
+    latency.record(20000);
+
+    char buffer[1024];
+    BufferWriter out(buffer, sizeof(buffer));
+    PrometheusWriter metrics(out);
+    metrics.histogram("fetch_seconds", "Fetch latency", latency);
+
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "# TYPE fetch_seconds histogram\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_bucket{le=\"0.050\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_bucket{le=\"0.100\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_bucket{le=\"0.200\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_bucket{le=\"10.000\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_bucket{le=\"+Inf\"} 4\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_sum 20.340\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "fetch_seconds_count 4\n"));
+    TEST_ASSERT_FALSE(out.overflowed());
+}
+
+void test_prometheus_overflow_flagged() {
+    char buffer[32];
+    BufferWriter out(buffer, sizeof(buffer));
+    PrometheusWriter metrics(out);
+    metrics.counter("a_long_metric_name_total", "Something", 1);
+
+    TEST_ASSERT_TRUE(out.overflowed());
+    TEST_ASSERT_EQUAL(sizeof(buffer) - 1, strlen(buffer));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // LatencyHistogram tests
+    RUN_TEST(test_histogram_empty);
+    RUN_TEST(test_histogram_buckets_inclusive);
+    RUN_TEST(test_histogram_overflow_bucket);
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_histogram_estimate_capped_by_max);
+    RUN_TEST(test_histogram_reset);
+
+    // PrometheusWriter tests
+    RUN_TEST(test_prometheus_counter);
+    RUN_TEST(test_prometheus_gauge_values);
+    RUN_TEST(test_prometheus_labels_escaped);
+    RUN_TEST(test_prometheus_histogram);
+    RUN_TEST(test_prometheus_overflow_flagged);
+
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+/**
+ * Unit tests for the monotonic clock
+ *
+ * Tests the fake clock, installing it as the time source, and modules
+ * running past the point where a 32-bit millis() count would wrap.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "mono_clock.h"
+#include "page_carousel.h"
+#include "dns_cache.h"
+
+static const uint64_t MILLIS_WRAP = 0x100000000ULL;  // Where a 32-bit millis() starts over
+static const uint64_t DAY_MS = 24ULL * 3600 * 1000;
+
+// ============================================================================
+// Fake Clock Tests
+// ============================================================================
+
+void test_fake_starts_where_told() {
+    FakeClock clock(1234);
+    TEST_ASSERT_EQUAL_UINT64(1234, clock.nowMs());
+    TEST_ASSERT_EQUAL_UINT64(1234000, clock.nowUs());
+}
+
+void test_fake_advances() {
+    FakeClock clock;
+    clock.advanceMs(1500);
+    clock.advanceUs(250);
+    TEST_ASSERT_EQUAL_UINT64(1500250, clock.nowUs());
+    TEST_ASSERT_EQUAL_UINT64(1500, clock.nowMs());
+}
+
+void test_fake_never_goes_backwards() {
+    FakeClock clock(10000);
+    clock.setMs(5000);
+    TEST_ASSERT_EQUAL_UINT64(10000, clock.nowMs());
+    clock.setMs(20000);
+    TEST_ASSERT_EQUAL_UINT64(20000, clock.nowMs());
+}
+
+// ============================================================================
+// Clock Source Tests
+// ============================================================================
+
+void test_installed_fake_drives_mono_millis() {
+    FakeClock clock(MILLIS_WRAP - 10);
+    clock.install();
+    TEST_ASSERT_EQUAL_UINT64(MILLIS_WRAP - 10, monoMillis());
+
+    clock.advanceMs(20);
+    TEST_ASSERT_EQUAL_UINT64(MILLIS_WRAP + 10, monoMillis());
+    TEST_ASSERT_EQUAL_UINT64((MILLIS_WRAP + 10) * 1000, monoMicros());
+}
+
+void test_uninstall_restores_system_clock() {
+    FakeClock clock(100 * DAY_MS);
+    clock.install();
+    clock.uninstall();
+
+    // The host has not been up for 100 days since this test started
+    TEST_ASSERT_TRUE(monoMillis() != 100 * DAY_MS);
+}
+
+void test_uninstall_of_other_clock_ignored() {
+    FakeClock installed(5000);
+    FakeClock other(9000);
+    installed.install();
+    other.uninstall();
+    TEST_ASSERT_EQUAL_UINT64(5000, monoMillis());
+}
+
+void test_system_clock_is_monotonic() {
+    uint64_t previous = monoMicros();
+    for (int i = 0; i < 1000; i++) {
+        uint64_t now = monoMicros();
+        TEST_ASSERT_TRUE(now >= previous);
+        previous = now;
+    }
+}
+
+// ============================================================================
+// Long Uptime Tests
+// ============================================================================
+
+void test_carousel_through_millis_wrap() {
+    static const CarouselPage PAGES[] = {
+        {PAGE_SUMMARY, 0, 10000},
+        {PAGE_CLOCK, 0, 3000},
+    };
+    FakeClock clock(MILLIS_WRAP - 5000);
+    clock.install();
+
+    PageCarousel carousel(PAGES, 2);
+    carousel.update(monoMillis(), 0x3);
+
+    // Cross the wrap in one-second ticks: the summary still gets its 10 s
+    for (int i = 0; i < 9; i++) {
+        clock.advanceMs(1000);
+        TEST_ASSERT_FALSE(carousel.update(monoMillis(), 0x3));
+    }
+    clock.advanceMs(1000);
+    TEST_ASSERT_TRUE(carousel.update(monoMillis(), 0x3));
+    TEST_ASSERT_EQUAL(PAGE_CLOCK, carousel.getPage().kind);
+}
+
+void test_weeks_of_rotation_in_simulated_time() {
+    static const CarouselPage PAGES[] = {
+        {PAGE_SUMMARY, 0, 10000},
+        {PAGE_GROUP, 1, 5000},
+        {PAGE_GROUP, 2, 5000},
+    };
+    FakeClock clock;
+    clock.install();
+    PageCarousel carousel(PAGES, 3);
+    carousel.update(monoMillis(), 0x7);
+
+    // 60 days of rotation, one page change at a time
+    unsigned long changes = 0;
+    while (monoMillis() < 60 * DAY_MS) {
+        clock.advanceMs(PAGES[carousel.getIndex()].durationMs);
+        if (carousel.update(monoMillis(), 0x7)) changes++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(60 * DAY_MS / 20000 * 3, changes);
+}
+
+static bool resolveFixed(const char* host, uint32_t& address, unsigned long& ttlMs, void* context) {
+    (*(int*)context)++;
+    address = 0x0A000001;
+    ttlMs = 60000;
+    return true;
+}
+
+void test_dns_ttl_through_millis_wrap() {
+    int calls = 0;
+    DnsCache cache(resolveFixed, &calls);
+    uint32_t address = 0;
+    uint64_t start = MILLIS_WRAP - 30000;
+
+    cache.lookup("api.wmata.com", start, address);
+    TEST_ASSERT_EQUAL(DNS_HIT, cache.lookup("api.wmata.com", start + 59999, address));
+    TEST_ASSERT_EQUAL(DNS_RESOLVED, cache.lookup("api.wmata.com", start + 60000, address));
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    setClockSource(nullptr);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Fake clock tests
+    RUN_TEST(test_fake_starts_where_told);
+    RUN_TEST(test_fake_advances);
+    RUN_TEST(test_fake_never_goes_backwards);
+
+    // Clock source tests
+    RUN_TEST(test_installed_fake_drives_mono_millis);
+    RUN_TEST(test_uninstall_restores_system_clock);
+    RUN_TEST(test_uninstall_of_other_clock_ignored);
+    RUN_TEST(test_system_clock_is_monotonic);
+
+    // Long uptime tests
+    RUN_TEST(test_carousel_through_millis_wrap);
+    RUN_TEST(test_weeks_of_rotation_in_simulated_time);
+    RUN_TEST(test_dns_ttl_through_millis_wrap);
+
+    return UNITY_END();
+}
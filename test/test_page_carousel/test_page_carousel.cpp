@@ -0,0 +1,201 @@
+/**
+ * Unit tests for the page carousel
+ *
+ * Tests page timing, skipping pages with nothing to show, leaving a page
+ * that runs out of content, and disabled pages.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "page_carousel.h"
+
+static const CarouselPage PAGES[] = {
+    {PAGE_SUMMARY, 0, 10000},
+    {PAGE_GROUP, 1, 5000},
+    {PAGE_GROUP, 2, 5000},
+    {PAGE_CLOCK, 0, 3000},
+    {PAGE_ADVISORY, 0, 5000},
+    {PAGE_HEADWAYS, 0, 0},     // Disabled
+};
+static const int PAGE_COUNT = sizeof(PAGES) / sizeof(PAGES[0]);
+static const uint32_t ALL = 0xFFFFFFFFUL;
+
+// ============================================================================
+// Rotation Tests
+// ============================================================================
+
+void test_first_update_shows_first_page() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    TEST_ASSERT_EQUAL(-1, carousel.getIndex());
+
+    TEST_ASSERT_TRUE(carousel.update(0, ALL));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+    TEST_ASSERT_EQUAL(PAGE_SUMMARY, carousel.getPage().kind);
+}
+
+void test_page_stays_for_its_duration() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+
+    TEST_ASSERT_FALSE(carousel.update(9999, ALL));
+    TEST_ASSERT_TRUE(carousel.update(10000, ALL));
+    TEST_ASSERT_EQUAL(PAGE_GROUP, carousel.getPage().kind);
+    TEST_ASSERT_EQUAL(1, carousel.getPage().group);
+
+    TEST_ASSERT_FALSE(carousel.update(14999, ALL));
+    TEST_ASSERT_TRUE(carousel.update(15000, ALL));
+    TEST_ASSERT_EQUAL(2, carousel.getPage().group);
+}
+
+void test_full_cycle_skips_disabled_page() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    unsigned long now = 0;
+    carousel.update(now, ALL);
+
+    int seen[PAGE_COUNT] = {0};
+    for (int i = 0; i < 10; i++) {
+        now += PAGES[carousel.getIndex()].durationMs;
+        TEST_ASSERT_TRUE(carousel.update(now, ALL));
+        seen[carousel.getIndex()]++;
+    }
+    TEST_ASSERT_EQUAL(0, seen[5]);
+    TEST_ASSERT_EQUAL(2, seen[0]);
+    TEST_ASSERT_EQUAL(2, seen[4]);
+}
+
+void test_timing_across_millis_wrap() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    unsigned long start = 0xFFFFFFFFUL - 2000;
+    carousel.update(start, ALL);
+
+    TEST_ASSERT_FALSE(carousel.update(start + 9000, ALL));
+    TEST_ASSERT_TRUE(carousel.update(start + 10000, ALL));
+}
+
+// ============================================================================
+// Availability Tests
+// ============================================================================
+
+void test_unavailable_pages_skipped() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    uint32_t available = (1UL << 0) | (1UL << 2);  // Summary and group 2
+    carousel.update(0, available);
+
+    TEST_ASSERT_TRUE(carousel.update(10000, available));
+    TEST_ASSERT_EQUAL(2, carousel.getIndex());
+    TEST_ASSERT_TRUE(carousel.update(15000, available));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+}
+
+void test_page_left_when_content_goes() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+    carousel.update(10000, ALL);
+    carousel.update(15000, ALL);
+    carousel.update(20000, ALL);
+    carousel.update(23000, ALL);
+    TEST_ASSERT_EQUAL(PAGE_ADVISORY, carousel.getPage().kind);
+
+    // The incidents cleared mid-page
+    TEST_ASSERT_TRUE(carousel.update(24000, ALL & ~(1UL << 4)));
+    TEST_ASSERT_EQUAL(PAGE_SUMMARY, carousel.getPage().kind);
+}
+
+void test_single_available_page_stays() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    uint32_t available = 1UL << 0;
+    carousel.update(0, available);
+
+    TEST_ASSERT_FALSE(carousel.update(10000, available));
+    TEST_ASSERT_FALSE(carousel.update(30000, available));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+}
+
+void test_nothing_available_keeps_last_page() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+    TEST_ASSERT_FALSE(carousel.update(1000, 0));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+}
+
+void test_reset_returns_to_first_available() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+    carousel.update(10000, ALL);
+    TEST_ASSERT_EQUAL(1, carousel.getIndex());
+
+    carousel.reset();
+    TEST_ASSERT_TRUE(carousel.update(11000, ALL));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+}
+
+void test_show_jumps_and_rotation_continues() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+
+    TEST_ASSERT_TRUE(carousel.show(3, 2000, ALL));
+    TEST_ASSERT_EQUAL(PAGE_CLOCK, carousel.getPage().kind);
+    TEST_ASSERT_FALSE(carousel.update(4999, ALL));
+    TEST_ASSERT_TRUE(carousel.update(5000, ALL));
+    TEST_ASSERT_EQUAL(4, carousel.getIndex());
+}
+
+void test_show_refuses_unshowable_page() {
+    PageCarousel carousel(PAGES, PAGE_COUNT);
+    carousel.update(0, ALL);
+
+    TEST_ASSERT_FALSE(carousel.show(5, 1000, ALL));              // Disabled
+    TEST_ASSERT_FALSE(carousel.show(4, 1000, ALL & ~(1UL << 4)));  // Nothing to show
+    TEST_ASSERT_FALSE(carousel.show(PAGE_COUNT, 1000, ALL));
+    TEST_ASSERT_FALSE(carousel.show(-1, 1000, ALL));
+    TEST_ASSERT_EQUAL(0, carousel.getIndex());
+}
+
+void test_extra_pages_ignored() {
+    CarouselPage many[CAROUSEL_MAX_PAGES + 2];
+    for (int i = 0; i < CAROUSEL_MAX_PAGES + 2; i++) {
+        many[i].kind = PAGE_CLOCK;
+        many[i].group = 0;
+        many[i].durationMs = 1000;
+    }
+    PageCarousel carousel(many, CAROUSEL_MAX_PAGES + 2);
+    TEST_ASSERT_EQUAL(CAROUSEL_MAX_PAGES, carousel.getCount());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Rotation tests
+    RUN_TEST(test_first_update_shows_first_page);
+    RUN_TEST(test_page_stays_for_its_duration);
+    RUN_TEST(test_full_cycle_skips_disabled_page);
+    RUN_TEST(test_timing_across_millis_wrap);
+
+    // Availability tests
+    RUN_TEST(test_unavailable_pages_skipped);
+    RUN_TEST(test_page_left_when_content_goes);
+    RUN_TEST(test_single_available_page_stays);
+    RUN_TEST(test_nothing_available_keeps_last_page);
+    RUN_TEST(test_reset_returns_to_first_available);
+    RUN_TEST(test_extra_pages_ignored);
+
+    // Manual page changes
+    RUN_TEST(test_show_jumps_and_rotation_continues);
+    RUN_TEST(test_show_refuses_unshowable_page);
+
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/**
+ * Unit tests for the compile-time panel configuration
+ *
+ * Tests the pin checks behind the static_asserts in panel_config.h (usable
+ * GPIOs, shared pins, the E line) and the row layout for both panel
+ * heights. These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "panel_config.h"
+
+// The default pinout from config.h, and the same with mistakes
+static constexpr PanelPins GOOD_PINS = {{13, 22, 21, 14, 23, 27, 26, 15, 25, 18, -1, 19, 32, 33}};
+static constexpr PanelPins SHARED_PINS = {{13, 22, 21, 14, 23, 27, 26, 15, 25, 18, -1, 19, 32, 13}};
+static constexpr PanelPins FLASH_PIN = {{13, 22, 21, 14, 23, 27, 26, 15, 25, 18, -1, 19, 32, 6}};
+static constexpr PanelPins INPUT_PIN = {{13, 22, 21, 14, 23, 27, 26, 15, 25, 18, -1, 19, 32, 34}};
+static constexpr PanelPins WITH_E = {{13, 22, 21, 14, 23, 27, 26, 15, 25, 18, 12, 19, 32, 33}};
+
+typedef PanelLayout<64, 32, 1> SmallLayout;
+typedef PanelLayout<64, 64, 2> LargeLayout;
+
+// Checked by the compiler as well as at run time
+static_assert(panelPinsDistinct(GOOD_PINS), "good pinout flagged");
+static_assert(!panelPinsDistinct(SHARED_PINS), "shared pin missed");
+static_assert(LargeLayout::WIDTH == 128, "chain not counted");
+
+// ============================================================================
+// Pin Tests
+// ============================================================================
+
+void test_output_pins() {
+    TEST_ASSERT_TRUE(isPanelOutputPin(0));
+    TEST_ASSERT_TRUE(isPanelOutputPin(33));
+    TEST_ASSERT_FALSE(isPanelOutputPin(-1));
+    TEST_ASSERT_FALSE(isPanelOutputPin(1));   // Serial TX
+    TEST_ASSERT_FALSE(isPanelOutputPin(3));   // Serial RX
+    TEST_ASSERT_FALSE(isPanelOutputPin(6));   // Flash
+    TEST_ASSERT_FALSE(isPanelOutputPin(11));
+    TEST_ASSERT_FALSE(isPanelOutputPin(34));  // Input only
+    TEST_ASSERT_FALSE(isPanelOutputPin(40));
+}
+
+void test_shared_pin_detected() {
+    TEST_ASSERT_TRUE(panelPinsDistinct(GOOD_PINS));
+    TEST_ASSERT_FALSE(panelPinsDistinct(SHARED_PINS));
+
+    // Unused lines may all be -1
+    PanelPins unused = GOOD_PINS;
+    unused.gpio[PIN_D] = -1;
+    TEST_ASSERT_TRUE(panelPinsDistinct(unused));
+}
+
+void test_unusable_pin_detected() {
+    TEST_ASSERT_TRUE(panelPinsUsable(GOOD_PINS, false));
+    TEST_ASSERT_FALSE(panelPinsUsable(FLASH_PIN, false));
+    TEST_ASSERT_FALSE(panelPinsUsable(INPUT_PIN, false));
+}
+
+void test_e_line_needed_for_tall_panels() {
+    TEST_ASSERT_FALSE(panelPinsUsable(GOOD_PINS, true));
+    TEST_ASSERT_TRUE(panelPinsUsable(WITH_E, true));
+    TEST_ASSERT_TRUE(panelPinsUsable(WITH_E, false));
+
+    // Only E may be left out
+    PanelPins noD = GOOD_PINS;
+    noD.gpio[PIN_D] = -1;
+    TEST_ASSERT_FALSE(panelPinsUsable(noD, false));
+}
+
+// ============================================================================
+// Layout Tests
+// ============================================================================
+
+void test_small_panel_layout() {
+    TEST_ASSERT_EQUAL(64, SmallLayout::WIDTH);
+    TEST_ASSERT_EQUAL(1, SmallLayout::TEXT_SIZE);
+    TEST_ASSERT_EQUAL(6, SmallLayout::CHAR_WIDTH);
+    TEST_ASSERT_EQUAL(10, SmallLayout::COLUMNS);
+    TEST_ASSERT_FALSE(SmallLayout::NEEDS_E);
+
+    TEST_ASSERT_EQUAL(0, SmallLayout::rowTop(0));
+    TEST_ASSERT_EQUAL(11, SmallLayout::rowTop(1));
+    TEST_ASSERT_EQUAL(22, SmallLayout::rowTop(2));
+    TEST_ASSERT_EQUAL(32, SmallLayout::rowTop(3));
+    TEST_ASSERT_EQUAL(2, SmallLayout::textY(0));
+    TEST_ASSERT_EQUAL(12, SmallLayout::textY(1));
+    TEST_ASSERT_EQUAL(24, SmallLayout::textY(2));
+}
+
+void test_tall_panel_doubles_layout() {
+    TEST_ASSERT_EQUAL(2, LargeLayout::TEXT_SIZE);
+    TEST_ASSERT_EQUAL(12, LargeLayout::CHAR_WIDTH);
+    TEST_ASSERT_EQUAL(10, LargeLayout::COLUMNS);
+    TEST_ASSERT_TRUE(LargeLayout::NEEDS_E);
+
+    TEST_ASSERT_EQUAL(44, LargeLayout::rowTop(2));
+    TEST_ASSERT_EQUAL(64, LargeLayout::rowTop(3));
+    TEST_ASSERT_EQUAL(48, LargeLayout::textY(2));
+}
+
+void test_rows_tile_panel() {
+    for (int row = 0; row < 3; row++) {
+        TEST_ASSERT_TRUE(SmallLayout::rowTop(row) <= SmallLayout::textY(row));
+        TEST_ASSERT_TRUE(SmallLayout::textY(row) + SmallLayout::CHAR_HEIGHT <= SmallLayout::rowTop(row + 1));
+        TEST_ASSERT_TRUE(LargeLayout::rowTop(row) <= LargeLayout::textY(row));
+        TEST_ASSERT_TRUE(LargeLayout::textY(row) + LargeLayout::CHAR_HEIGHT <= LargeLayout::rowTop(row + 1));
+    }
+}
+
+void test_build_config_passes() {
+    TEST_ASSERT_TRUE(panelPinsDistinct(PANEL_PINS));
+    TEST_ASSERT_TRUE(panelPinsUsable(PANEL_PINS, DisplayLayout::NEEDS_E));
+    TEST_ASSERT_EQUAL(PANEL_RES_X * PANEL_CHAIN, DisplayLayout::WIDTH);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Pins
+    RUN_TEST(test_output_pins);
+    RUN_TEST(test_shared_pin_detected);
+    RUN_TEST(test_unusable_pin_detected);
+    RUN_TEST(test_e_line_needed_for_tall_panels);
+
+    // Layout
+    RUN_TEST(test_small_panel_layout);
+    RUN_TEST(test_tall_panel_doubles_layout);
+    RUN_TEST(test_rows_tile_panel);
+    RUN_TEST(test_build_config_passes);
+
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+/**
+ * Unit tests for the phase-locked poll scheduler
+ * 
+ * Simulates an upstream feed that updates on a fixed period and checks
+ * that the scheduler learns the cadence and polls just after each update.
+ * These tests run natively on your computer without ESP32 hardware.
+ * 
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "poll_scheduler.h"
+
+#define MIN_INTERVAL_MS 30000
+
+/**
+ * Simulated upstream feed that refreshes every periodMs, starting at phaseMs
+ */
+struct FakeFeed {
+    unsigned long periodMs;
+    unsigned long phaseMs;
+    
+    long versionAt(unsigned long t) const {
+        if (t < phaseMs) return -1;
+        return (long)((t - phaseMs) / periodMs);
+    }
+    
+    unsigned long ageAt(unsigned long t) const {
+        return (t - phaseMs) % periodMs;
+    }
+};
+
+/**
+ * Run the scheduler against a feed for durationMs in 100 ms steps
+ * 
+ * Only polls after warmupMs count toward the returned statistics.
+ */
+struct SimResult {
+    int polls;
+    unsigned long totalAgeMs;
+    unsigned long maxAgeMs;
+};
+
+SimResult simulate(PollScheduler& scheduler, const FakeFeed& feed,
+                   unsigned long startMs, unsigned long durationMs, unsigned long warmupMs) {
+    SimResult result = {0, 0, 0};
+    long lastVersion = -2;
+    
+    for (unsigned long t = startMs; t < startMs + durationMs; t += 100) {
+        if (!scheduler.isDue(t)) continue;
+        
+        long version = feed.versionAt(t);
+        scheduler.onPollResult(t, version != lastVersion);
+        lastVersion = version;
+        
+        if (t - startMs >= warmupMs) {
+            unsigned long age = feed.ageAt(t);
+            result.polls++;
+            result.totalAgeMs += age;
+            if (age > result.maxAgeMs) result.maxAgeMs = age;
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// Initial State Tests
+// ============================================================================
+
+void test_first_poll_is_due_immediately() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    
+    TEST_ASSERT_TRUE(scheduler.isDue(0));
+    TEST_ASSERT_TRUE(scheduler.isDue(123456));
+    TEST_ASSERT_EQUAL(POLL_LEARNING, scheduler.getState());
+}
+
+void test_learning_polls_at_learn_interval() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    scheduler.onPollResult(1000, true);
+    
+    TEST_ASSERT_FALSE(scheduler.isDue(1000 + POLL_LEARN_INTERVAL_MS - 1));
+    TEST_ASSERT_TRUE(scheduler.isDue(1000 + POLL_LEARN_INTERVAL_MS));
+}
+
+// ============================================================================
+// Cadence Learning Tests
+// ============================================================================
+
+void test_locks_onto_20s_period() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {20000, 7300};
+    
+    simulate(scheduler, feed, 10000, 300000, 0);
+    
+    TEST_ASSERT_EQUAL(POLL_LOCKED, scheduler.getState());
+    TEST_ASSERT_UINT_WITHIN(1000, 20000, scheduler.getPeriodMs());
+}
+
+void test_locks_onto_period_longer_than_min_interval() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {45000, 2000};
+    
+    simulate(scheduler, feed, 5000, 600000, 0);
+    
+    TEST_ASSERT_EQUAL(POLL_LOCKED, scheduler.getState());
+    TEST_ASSERT_UINT_WITHIN(1500, 45000, scheduler.getPeriodMs());
+}
+
+void test_static_feed_falls_back_to_fixed_interval() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {100000000UL, 0};  // Never changes during the test
+    
+    simulate(scheduler, feed, 1000, POLL_LEARN_TIMEOUT_MS + 60000, 0);
+    
+    TEST_ASSERT_EQUAL(POLL_FREE_RUNNING, scheduler.getState());
+    TEST_ASSERT_EQUAL(0, scheduler.getPeriodMs());
+}
+
+// ============================================================================
+// Phase Alignment Tests
+// ============================================================================
+
+void test_locked_polls_respect_min_interval_on_average() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {20000, 7300};
+    
+    unsigned long duration = 3600000;  // 1 hour
+    SimResult result = simulate(scheduler, feed, 10000, duration, 600000);
+    
+    // Probes after a missed update cost a few extra calls, but aligning to
+    // the 20 s cadence stretches most gaps to 40 s, so we stay under the
+    // fixed-interval call count
+    unsigned long fixedIntervalPolls = (duration - 600000) / MIN_INTERVAL_MS;
+    TEST_ASSERT_LESS_OR_EQUAL(fixedIntervalPolls, (unsigned long)result.polls);
+}
+
+void test_locked_data_is_fresher_than_fixed_interval() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {20000, 7300};
+    
+    SimResult result = simulate(scheduler, feed, 10000, 3600000, 600000);
+    unsigned long meanAge = result.totalAgeMs / result.polls;
+    
+    // Phase-random polling averages half a period (10 s) of staleness. The
+    // occasional bracket poll just before an update is stale by design.
+    TEST_ASSERT_LESS_THAN(feed.periodMs / 4, meanAge);
+}
+
+void test_relearns_when_upstream_period_changes() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {20000, 7300};
+    simulate(scheduler, feed, 10000, 300000, 0);
+    TEST_ASSERT_EQUAL(POLL_LOCKED, scheduler.getState());
+    
+    // Upstream switches to a 25 s cadence
+    FakeFeed slower = {25000, 311000};
+    simulate(scheduler, slower, 310000, 900000, 0);
+    
+    TEST_ASSERT_EQUAL(POLL_LOCKED, scheduler.getState());
+    TEST_ASSERT_UINT_WITHIN(1500, 25000, scheduler.getPeriodMs());
+}
+
+// ============================================================================
+// Failure and Reset Tests
+// ============================================================================
+
+void test_failed_poll_retries_after_min_interval() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    scheduler.onPollFailed(5000);
+    
+    TEST_ASSERT_FALSE(scheduler.isDue(5000 + MIN_INTERVAL_MS - 1));
+    TEST_ASSERT_TRUE(scheduler.isDue(5000 + MIN_INTERVAL_MS));
+}
+
+void test_reset_makes_poll_due_and_relearns() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    FakeFeed feed = {20000, 7300};
+    simulate(scheduler, feed, 10000, 300000, 0);
+    
+    scheduler.reset();
+    
+    TEST_ASSERT_TRUE(scheduler.isDue(310000));
+    TEST_ASSERT_EQUAL(POLL_LEARNING, scheduler.getState());
+}
+
+void test_schedule_survives_millis_wraparound() {
+    PollScheduler scheduler(MIN_INTERVAL_MS);
+    unsigned long nearWrap = (unsigned long)-1 - 2000;
+    scheduler.onPollFailed(nearWrap);
+    
+    TEST_ASSERT_FALSE(scheduler.isDue(nearWrap + 1000));
+    TEST_ASSERT_TRUE(scheduler.isDue(nearWrap + MIN_INTERVAL_MS));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    
+    // Initial state
+    RUN_TEST(test_first_poll_is_due_immediately);
+    RUN_TEST(test_learning_polls_at_learn_interval);
+    
+    // Cadence learning
+    RUN_TEST(test_locks_onto_20s_period);
+    RUN_TEST(test_locks_onto_period_longer_than_min_interval);
+    RUN_TEST(test_static_feed_falls_back_to_fixed_interval);
+    
+    // Phase alignment
+    RUN_TEST(test_locked_polls_respect_min_interval_on_average);
+    RUN_TEST(test_locked_data_is_fresher_than_fixed_interval);
+    RUN_TEST(test_relearns_when_upstream_period_changes);
+    
+    // Failure and reset
+    RUN_TEST(test_failed_poll_retries_after_min_interval);
+    RUN_TEST(test_reset_makes_poll_due_and_relearns);
+    RUN_TEST(test_schedule_survives_millis_wraparound);
+    
+    return UNITY_END();
+}
@@ -0,0 +1,245 @@
+/**
+ * Unit tests for the reset-surviving postmortem log
+ *
+ * Tests cold and warm boots, recovery of the previous run's state, the
+ * record ring, and how torn or corrupted records are handled.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "postmortem.h"
+#include "fetch_phase.h"
+#include "log_ring.h"
+
+static PostmortemStore store;
+static char dump[8192];
+
+/**
+ * Format the dump of a log into the shared buffer
+ */
+static const char* formatDump(const PostmortemLog& log) {
+    BufferWriter out(dump, sizeof(dump));
+    log.formatDump(out);
+    return out.c_str();
+}
+
+/**
+ * Count lines of the dump containing a string
+ */
+static int countLines(const char* text, const char* needle) {
+    int count = 0;
+    const char* line = text;
+    while (*line) {
+        const char* end = strchr(line, '\n');
+        if (end == nullptr) end = line + strlen(line);
+        const char* found = strstr(line, needle);
+        if (found != nullptr && found < end) count++;
+        line = *end ? end + 1 : end;
+    }
+    return count;
+}
+
+// ============================================================================
+// Boot Tests
+// ============================================================================
+
+void test_cold_boot_initializes() {
+    memset(&store, 0xA5, sizeof(store));  // Power-on garbage
+    PostmortemLog log(&store);
+
+    TEST_ASSERT_FALSE(log.begin("power on", 100));
+    TEST_ASSERT_EQUAL_UINT32(1, log.getBootCount());
+    TEST_ASSERT_FALSE(log.hasPreviousState());
+    TEST_ASSERT_EQUAL(0, log.getCorruptCount());
+
+    const char* text = formatDump(log);
+    TEST_ASSERT_NOT_NULL(strstr(text, "no state (cold boot)"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "#1 b1 0.100 B [BOOT] boot 1, reset: power on"));
+}
+
+void test_warm_boot_keeps_records_and_state() {
+    memset(&store, 0, sizeof(store));
+    {
+        PostmortemLog log(&store);
+        log.begin("power on", 0);
+        log.addLog(LOG_LEVEL_INFO, "WMATA", "Fetching predictions", 5000);
+        log.addSample(120000, 90000, true, -61, 5100);
+        log.setPhase(FETCH_PHASE_BODY, 5200);
+    }
+
+    // Watchdog fires while reading the body; RTC memory survives
+    PostmortemLog log(&store);
+    TEST_ASSERT_TRUE(log.begin("task watchdog", 50));
+    TEST_ASSERT_EQUAL_UINT32(2, log.getBootCount());
+    TEST_ASSERT_TRUE(log.hasPreviousState());
+    TEST_ASSERT_EQUAL(FETCH_PHASE_BODY, log.getPreviousState().phase);
+    TEST_ASSERT_EQUAL_UINT32(5200, log.getPreviousState().phaseSinceMs);
+    TEST_ASSERT_EQUAL_UINT32(90000, log.getPreviousState().minFreeHeap);
+
+    const char* text = formatDump(log);
+    TEST_ASSERT_NOT_NULL(strstr(text, "previous run: phase body"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "#2 b1 5.000 I [WMATA] Fetching predictions"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "S [HEALTH] heap 120000 min 90000 wifi -61 dBm"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "#4 b2 0.050 B [BOOT] boot 2, reset: task watchdog"));
+}
+
+void test_new_boot_resets_state() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog first(&store);
+    first.begin("power on", 0);
+    first.setPhase(FETCH_PHASE_PARSE, 10);
+
+    PostmortemLog second(&store);
+    second.begin("panic", 0);
+    TEST_ASSERT_EQUAL(FETCH_PHASE_PARSE, second.getPreviousState().phase);
+
+    // What the second run reports about itself starts clean
+    PostmortemLog third(&store);
+    third.begin("software", 0);
+    TEST_ASSERT_EQUAL(FETCH_PHASE_IDLE, third.getPreviousState().phase);
+}
+
+// ============================================================================
+// Ring Tests
+// ============================================================================
+
+void test_ring_keeps_newest() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog log(&store);
+    log.begin("power on", 0);
+
+    for (int i = 0; i < POSTMORTEM_RECORDS * 3; i++) {
+        char text[16];
+        snprintf(text, sizeof(text), "line %d", i);
+        log.addLog(LOG_LEVEL_INFO, "T", text, (unsigned long)i);
+    }
+
+    const char* dumpText = formatDump(log);
+    TEST_ASSERT_EQUAL(POSTMORTEM_RECORDS, countLines(dumpText, "[T] line"));
+    TEST_ASSERT_NULL(strstr(dumpText, "line 63\n"));
+    TEST_ASSERT_NOT_NULL(strstr(dumpText, "line 64\n"));
+    TEST_ASSERT_NOT_NULL(strstr(dumpText, "line 95\n"));
+
+    // Oldest first
+    TEST_ASSERT_TRUE(strstr(dumpText, "line 64\n") < strstr(dumpText, "line 95\n"));
+}
+
+void test_sequence_continues_after_reboot() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog first(&store);
+    first.begin("power on", 0);
+    for (int i = 0; i < POSTMORTEM_RECORDS + 5; i++) {
+        first.addLog(LOG_LEVEL_INFO, "T", "old", 0);
+    }
+
+    PostmortemLog second(&store);
+    second.begin("brownout", 0);
+    second.addLog(LOG_LEVEL_INFO, "T", "new", 0);
+
+    const char* text = formatDump(second);
+    TEST_ASSERT_EQUAL(POSTMORTEM_RECORDS, countLines(text, "#"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "B [BOOT] boot 2, reset: brownout\n#"));
+    TEST_ASSERT_EQUAL(1, countLines(text, "[T] new"));
+}
+
+void test_long_text_cut() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog log(&store);
+    log.begin("power on", 0);
+
+    char longText[200];
+    memset(longText, 'z', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    log.addLog(LOG_LEVEL_ERROR, "A-VERY-LONG-TAG", longText, 0);
+
+    const char* text = formatDump(log);
+    TEST_ASSERT_NOT_NULL(strstr(text, "E [A-VERY-] "));
+    const char* line = strstr(text, "zzz");
+    TEST_ASSERT_NOT_NULL(line);
+    TEST_ASSERT_EQUAL(POSTMORTEM_TEXT_SIZE - 1, strchr(line, '\n') - line);
+}
+
+// ============================================================================
+// Integrity Tests
+// ============================================================================
+
+void test_torn_record_dropped() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog first(&store);
+    first.begin("power on", 0);
+    first.addLog(LOG_LEVEL_INFO, "T", "intact", 0);
+    first.addLog(LOG_LEVEL_INFO, "T", "torn", 0);
+
+    // Reset hit while the last record was being written
+    store.records[3].text[0] = 'X';
+
+    PostmortemLog second(&store);
+    TEST_ASSERT_TRUE(second.begin("task watchdog", 0));
+    TEST_ASSERT_EQUAL(1, second.getCorruptCount());
+
+    const char* text = formatDump(second);
+    TEST_ASSERT_NOT_NULL(strstr(text, "intact"));
+    TEST_ASSERT_NULL(strstr(text, "torn"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "1 corrupt records dropped"));
+}
+
+void test_torn_state_not_reported() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog first(&store);
+    first.begin("power on", 0);
+    first.setPhase(FETCH_PHASE_CONNECT, 10);
+    store.state.freeHeap ^= 1;
+
+    PostmortemLog second(&store);
+    TEST_ASSERT_TRUE(second.begin("panic", 0));
+    TEST_ASSERT_FALSE(second.hasPreviousState());
+}
+
+void test_corrupt_header_reinitializes() {
+    memset(&store, 0, sizeof(store));
+    PostmortemLog first(&store);
+    first.begin("power on", 0);
+    first.addLog(LOG_LEVEL_INFO, "T", "stale", 0);
+    store.bootCount = 1000;  // Checksum no longer matches
+
+    PostmortemLog second(&store);
+    TEST_ASSERT_FALSE(second.begin("panic", 0));
+    TEST_ASSERT_EQUAL_UINT32(1, second.getBootCount());
+    TEST_ASSERT_NULL(strstr(formatDump(second), "stale"));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Boot tests
+    RUN_TEST(test_cold_boot_initializes);
+    RUN_TEST(test_warm_boot_keeps_records_and_state);
+    RUN_TEST(test_new_boot_resets_state);
+
+    // Ring tests
+    RUN_TEST(test_ring_keeps_newest);
+    RUN_TEST(test_sequence_continues_after_reboot);
+    RUN_TEST(test_long_text_cut);
+
+    // Integrity tests
+    RUN_TEST(test_torn_record_dropped);
+    RUN_TEST(test_torn_state_not_reported);
+    RUN_TEST(test_corrupt_header_reinitializes);
+
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+/**
+ * Unit tests for the service-hours power schedule
+ *
+ * Tests when the panel counts as in service (lead and tail, service past
+ * midnight, closed days), the time until the next wakeup, the power
+ * estimate from the frame, and the daily energy and API call totals.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "power_schedule.h"
+
+#define HOUR 3600UL
+#define MINUTE 60UL
+
+// Sunday first: 7 AM - midnight, weekdays 5 AM - midnight, Friday and
+// Saturday until 1 AM
+static const ServiceHours HOURS[7] = {
+    {7 * HOUR, 24 * HOUR},
+    {5 * HOUR, 24 * HOUR},
+    {5 * HOUR, 24 * HOUR},
+    {5 * HOUR, 24 * HOUR},
+    {5 * HOUR, 24 * HOUR},
+    {5 * HOUR, 25 * HOUR},
+    {7 * HOUR, 25 * HOUR},
+};
+
+enum { SUN, MON, TUE, WED, THU, FRI, SAT };
+
+static const PowerModel MODEL = {500, 100, 300, 20000};
+
+static uint16_t pixels[64 * 32];
+
+// ============================================================================
+// Service Hour Tests
+// ============================================================================
+
+void test_in_service_with_lead_and_tail() {
+    ServiceSchedule schedule(HOURS, 15 * MINUTE, 30 * MINUTE);
+    TEST_ASSERT_TRUE(schedule.isInService(TUE, 12 * HOUR));
+    TEST_ASSERT_TRUE(schedule.isInService(TUE, 4 * HOUR + 45 * MINUTE));
+    TEST_ASSERT_FALSE(schedule.isInService(TUE, 4 * HOUR + 44 * MINUTE));
+    TEST_ASSERT_FALSE(schedule.isInService(TUE, 3 * HOUR));
+
+    // Tuesday's service ends at midnight, shown until 00:30 Wednesday
+    TEST_ASSERT_TRUE(schedule.isInService(WED, 29 * MINUTE));
+    TEST_ASSERT_FALSE(schedule.isInService(WED, 30 * MINUTE));
+}
+
+void test_service_past_midnight() {
+    ServiceSchedule schedule(HOURS, 15 * MINUTE, 30 * MINUTE);
+    // Friday runs to 1 AM Saturday, plus the tail
+    TEST_ASSERT_TRUE(schedule.isInService(SAT, HOUR + 29 * MINUTE));
+    TEST_ASSERT_FALSE(schedule.isInService(SAT, HOUR + 30 * MINUTE));
+    // Saturday runs to 1 AM Sunday
+    TEST_ASSERT_TRUE(schedule.isInService(SUN, HOUR));
+    TEST_ASSERT_FALSE(schedule.isInService(SUN, 2 * HOUR));
+}
+
+void test_lead_before_midnight() {
+    static const ServiceHours EARLY[7] = {
+        {10 * MINUTE, 20 * HOUR}, {10 * MINUTE, 20 * HOUR}, {10 * MINUTE, 20 * HOUR}, {10 * MINUTE, 20 * HOUR},
+        {10 * MINUTE, 20 * HOUR}, {10 * MINUTE, 20 * HOUR}, {10 * MINUTE, 20 * HOUR},
+    };
+    ServiceSchedule schedule(EARLY, 15 * MINUTE, 0);
+    TEST_ASSERT_TRUE(schedule.isInService(MON, 24 * HOUR - 5 * MINUTE));
+    TEST_ASSERT_FALSE(schedule.isInService(MON, 24 * HOUR - 6 * MINUTE));
+}
+
+void test_closed_day() {
+    ServiceHours hours[7];
+    for (int i = 0; i < 7; i++) hours[i] = HOURS[i];
+    hours[SUN].openSec = 0;
+    hours[SUN].closeSec = 0;
+
+    ServiceSchedule schedule(hours, 0, 0);
+    TEST_ASSERT_TRUE(schedule.isInService(SUN, 30 * MINUTE));  // Saturday's late service
+    TEST_ASSERT_FALSE(schedule.isInService(SUN, 12 * HOUR));
+    TEST_ASSERT_EQUAL_UINT32(5 * HOUR + 12 * HOUR, schedule.secondsUntilService(SUN, 12 * HOUR));
+}
+
+void test_seconds_until_service() {
+    ServiceSchedule schedule(HOURS, 15 * MINUTE, 30 * MINUTE);
+    TEST_ASSERT_EQUAL_UINT32(0, schedule.secondsUntilService(TUE, 12 * HOUR));
+    TEST_ASSERT_EQUAL_UINT32(HOUR + 45 * MINUTE, schedule.secondsUntilService(TUE, 3 * HOUR));
+    TEST_ASSERT_EQUAL_UINT32(1, schedule.secondsUntilService(TUE, 4 * HOUR + 45 * MINUTE - 1));
+
+    // Sunday 2 AM waits for 6:45
+    TEST_ASSERT_EQUAL_UINT32(4 * HOUR + 45 * MINUTE, schedule.secondsUntilService(SUN, 2 * HOUR));
+}
+
+void test_never_in_service() {
+    ServiceHours none[7] = {};
+    ServiceSchedule schedule(none, 0, 0);
+    TEST_ASSERT_FALSE(schedule.isInService(MON, 12 * HOUR));
+    TEST_ASSERT_EQUAL_UINT32(7 * POWER_DAY_SEC, schedule.secondsUntilService(MON, 12 * HOUR));
+}
+
+// ============================================================================
+// Power Estimate Tests
+// ============================================================================
+
+void test_frame_duty() {
+    FrameBuffer frame(pixels, 64, 32);
+    frame.fill(0);
+    TEST_ASSERT_EQUAL(0, frameDutyPermille(frame));
+
+    frame.fill(0xFFFF);
+    TEST_ASSERT_EQUAL(1000, frameDutyPermille(frame));
+
+    // Full red over half the frame: a sixth of full white
+    frame.fill(0);
+    frame.fillRect(0, 0, 64, 16, 0xF800);
+    TEST_ASSERT_EQUAL(166, frameDutyPermille(frame));
+}
+
+void test_power_estimate() {
+    TEST_ASSERT_EQUAL_UINT32(800, estimatePowerMw(MODEL, 0, false));
+    TEST_ASSERT_EQUAL_UINT32(400, estimatePowerMw(MODEL, 0, true));
+    TEST_ASSERT_EQUAL_UINT32(20800, estimatePowerMw(MODEL, 1000, false));
+    TEST_ASSERT_EQUAL_UINT32(2800, estimatePowerMw(MODEL, 100, false));
+}
+
+// ============================================================================
+// Ledger Tests
+// ============================================================================
+
+void test_ledger_sums_energy() {
+    PowerLedger ledger;
+    ledger.update(1000, 0, false, 0, 10);
+    // One hour at 1 W is 3600 J
+    ledger.update(1000 + HOUR * 1000, 1000, false, 0, 10);
+    TEST_ASSERT_EQUAL_UINT64(3600000, ledger.getToday().energyMj);
+
+    // Fractions of a millijoule carry over
+    for (int i = 0; i < 10; i++) {
+        ledger.update(1000 + HOUR * 1000 + (i + 1), 100, false, 0, 10);
+    }
+    TEST_ASSERT_EQUAL_UINT64(3600001, ledger.getToday().energyMj);
+    TEST_ASSERT_EQUAL_UINT64(3600001, ledger.getTotalEnergyMj());
+}
+
+void test_ledger_counts_calls_and_closed_time() {
+    PowerLedger ledger;
+    ledger.update(0, 500, false, 40, 10);
+    ledger.update(1500, 500, true, 45, 10);
+    ledger.update(2000, 500, true, 47, 10);
+    TEST_ASSERT_EQUAL_UINT32(7, ledger.getToday().apiCalls);
+    TEST_ASSERT_EQUAL_UINT32(2, ledger.getToday().closedSec);
+}
+
+void test_ledger_day_rollover() {
+    PowerLedger ledger;
+    ledger.update(0, 1000, false, 0, 10);
+    TEST_ASSERT_FALSE(ledger.update(10000, 1000, false, 12, 10));
+    TEST_ASSERT_TRUE(ledger.update(20000, 1000, false, 15, 11));
+
+    // The last interval was spent before midnight
+    TEST_ASSERT_EQUAL_UINT64(20000, ledger.getYesterday().energyMj);
+    TEST_ASSERT_EQUAL_UINT32(15, ledger.getYesterday().apiCalls);
+    TEST_ASSERT_EQUAL_UINT64(0, ledger.getToday().energyMj);
+
+    ledger.update(30000, 1000, false, 18, 11);
+    TEST_ASSERT_EQUAL_UINT32(3, ledger.getToday().apiCalls);
+    TEST_ASSERT_EQUAL_UINT64(30000, ledger.getTotalEnergyMj());
+}
+
+void test_ledger_clock_set_late() {
+    PowerLedger ledger;
+    ledger.update(0, 1000, false, 0, -1);
+    TEST_ASSERT_FALSE(ledger.update(5000, 1000, false, 3, -1));
+
+    // Setting the clock doesn't end a day
+    TEST_ASSERT_FALSE(ledger.update(6000, 1000, false, 3, 10));
+    TEST_ASSERT_EQUAL_UINT64(6000, ledger.getToday().energyMj);
+    TEST_ASSERT_EQUAL_UINT64(0, ledger.getYesterday().energyMj);
+    TEST_ASSERT_TRUE(ledger.update(7000, 1000, false, 3, 11));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Service hours
+    RUN_TEST(test_in_service_with_lead_and_tail);
+    RUN_TEST(test_service_past_midnight);
+    RUN_TEST(test_lead_before_midnight);
+    RUN_TEST(test_closed_day);
+    RUN_TEST(test_seconds_until_service);
+    RUN_TEST(test_never_in_service);
+
+    // Power estimate
+    RUN_TEST(test_frame_duty);
+    RUN_TEST(test_power_estimate);
+
+    // Ledger
+    RUN_TEST(test_ledger_sums_energy);
+    RUN_TEST(test_ledger_counts_calls_and_closed_time);
+    RUN_TEST(test_ledger_day_rollover);
+    RUN_TEST(test_ledger_clock_set_late);
+
+    return UNITY_END();
+}
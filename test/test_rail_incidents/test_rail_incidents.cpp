@@ -0,0 +1,218 @@
+/**
+ * Unit tests for rail incident parsing helpers
+ *
+ * Tests line list parsing, element-by-element JSON array scanning,
+ * and formatting of the scrolling advisory text.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "rail_incidents.h"
+
+/**
+ * Sample Incidents response in the shape WMATA returns
+ */
+static const char* SAMPLE_INCIDENTS =
+    "{\"Incidents\":["
+    "{\"IncidentID\":\"3754F8B2\",\"Description\":\"Red Line: Trains single tracking {between} NoMa & Union Station.\","
+    "\"IncidentType\":\"Delay\",\"LinesAffected\":\"RD;\",\"DateUpdated\":\"2024-01-01T10:00:00\"},"
+    " {\"IncidentID\":\"A1\",\"Description\":\"Say \\\"hi\\\" }\",\"IncidentType\":\"Alert\",\"LinesAffected\":\"BL; OR; SV;\"}"
+    "]}";
+
+// ============================================================================
+// Line Code Tests
+// ============================================================================
+
+void test_line_mask_from_code() {
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_RD, lineMaskFromCode("RD"));
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_SV, lineMaskFromCode("SV"));
+    TEST_ASSERT_EQUAL_UINT8(0, lineMaskFromCode("XX"));
+    TEST_ASSERT_EQUAL_UINT8(0, lineMaskFromCode("R"));
+    TEST_ASSERT_EQUAL_UINT8(0, lineMaskFromCode(""));
+    TEST_ASSERT_EQUAL_UINT8(0, lineMaskFromCode(nullptr));
+}
+
+void test_parse_line_list() {
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_RD, parseLineList("RD;"));
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_BL | LINE_MASK_OR | LINE_MASK_SV, parseLineList("BL; OR; SV;"));
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_GR | LINE_MASK_YL, parseLineList("GR;YL"));
+}
+
+void test_parse_line_list_ignores_unknown() {
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_RD, parseLineList("ZZ; RD; Q;"));
+    TEST_ASSERT_EQUAL_UINT8(0, parseLineList(""));
+    TEST_ASSERT_EQUAL_UINT8(0, parseLineList(nullptr));
+}
+
+void test_format_line_mask() {
+    char buffer[24];
+    formatLineMask(LINE_MASK_BL | LINE_MASK_OR, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("BL/OR", buffer);
+
+    formatLineMask(0, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("", buffer);
+}
+
+void test_format_line_mask_truncates() {
+    char buffer[4];
+    formatLineMask(LINE_MASK_RD | LINE_MASK_BL, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("RD/", buffer);
+}
+
+// ============================================================================
+// JSON Scanning Tests
+// ============================================================================
+
+void test_find_array() {
+    const char* p = jsonFindArray(SAMPLE_INCIDENTS, "Incidents");
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_INT('{', *p);
+}
+
+void test_find_array_missing_key() {
+    TEST_ASSERT_NULL(jsonFindArray(SAMPLE_INCIDENTS, "Trains"));
+    TEST_ASSERT_NULL(jsonFindArray("{\"Incidents\":null}", "Incidents"));
+}
+
+void test_next_object_walks_elements() {
+    const char* end = SAMPLE_INCIDENTS + strlen(SAMPLE_INCIDENTS);
+    const char* cursor = jsonFindArray(SAMPLE_INCIDENTS, "Incidents");
+    const char* start;
+    size_t len;
+
+    TEST_ASSERT_TRUE(jsonNextObject(cursor, end, start, len));
+    TEST_ASSERT_EQUAL_INT('{', start[0]);
+    TEST_ASSERT_EQUAL_INT('}', start[len - 1]);
+    TEST_ASSERT_NOT_NULL(strstr(start, "3754F8B2"));
+
+    // Braces and escaped quotes inside strings don't end the element
+    TEST_ASSERT_TRUE(jsonNextObject(cursor, end, start, len));
+    TEST_ASSERT_EQUAL(0, strncmp(start, "{\"IncidentID\":\"A1\"", 18));
+    TEST_ASSERT_EQUAL_INT('}', start[len - 1]);
+    TEST_ASSERT_EQUAL_INT(']', *cursor);
+
+    TEST_ASSERT_FALSE(jsonNextObject(cursor, end, start, len));
+}
+
+void test_next_object_empty_array() {
+    const char* json = "{\"Incidents\":[ ]}";
+    const char* end = json + strlen(json);
+    const char* cursor = jsonFindArray(json, "Incidents");
+    const char* start;
+    size_t len;
+
+    TEST_ASSERT_FALSE(jsonNextObject(cursor, end, start, len));
+}
+
+void test_next_object_truncated_element() {
+    // A response cut off mid-element still yields the complete ones
+    size_t cut = strstr(SAMPLE_INCIDENTS, "\"A1\"") - SAMPLE_INCIDENTS;
+    const char* end = SAMPLE_INCIDENTS + cut;
+    const char* cursor = jsonFindArray(SAMPLE_INCIDENTS, "Incidents");
+    const char* start;
+    size_t len;
+
+    TEST_ASSERT_TRUE(jsonNextObject(cursor, end, start, len));
+    TEST_ASSERT_FALSE(jsonNextObject(cursor, end, start, len));
+    TEST_ASSERT_TRUE(cursor == end);
+}
+
+// ============================================================================
+// Incident List Tests
+// ============================================================================
+
+void test_list_add_and_get() {
+    IncidentList incidents;
+    TEST_ASSERT_EQUAL(0, incidents.getCount());
+
+    TEST_ASSERT_TRUE(incidents.add(LINE_MASK_RD, "Delay", "Single tracking"));
+    TEST_ASSERT_EQUAL(1, incidents.getCount());
+    TEST_ASSERT_EQUAL_UINT8(LINE_MASK_RD, incidents.get(0).lines);
+    TEST_ASSERT_EQUAL_STRING("Delay", incidents.get(0).type);
+    TEST_ASSERT_EQUAL_STRING("Single tracking", incidents.get(0).description);
+}
+
+void test_list_is_bounded() {
+    IncidentList incidents;
+    for (int i = 0; i < MAX_INCIDENTS; i++) {
+        TEST_ASSERT_TRUE(incidents.add(LINE_MASK_RD, "Delay", "x"));
+    }
+    TEST_ASSERT_FALSE(incidents.add(LINE_MASK_RD, "Delay", "x"));
+    TEST_ASSERT_EQUAL(MAX_INCIDENTS, incidents.getCount());
+
+    incidents.reset();
+    TEST_ASSERT_EQUAL(0, incidents.getCount());
+}
+
+void test_list_truncates_long_text() {
+    char longText[INCIDENT_TEXT_MAX_LEN * 2];
+    memset(longText, 'a', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+
+    IncidentList incidents;
+    incidents.add(LINE_MASK_RD, "VeryLongIncidentType", longText);
+    TEST_ASSERT_EQUAL(INCIDENT_TEXT_MAX_LEN - 1, strlen(incidents.get(0).description));
+    TEST_ASSERT_EQUAL(INCIDENT_TYPE_MAX_LEN - 1, strlen(incidents.get(0).type));
+}
+
+void test_format_advisory() {
+    IncidentList incidents;
+    incidents.add(LINE_MASK_RD, "Delay", "Single tracking");
+    incidents.add(LINE_MASK_BL | LINE_MASK_SV, "Alert", "Shuttle buses");
+
+    char buffer[128];
+    incidents.formatAdvisory(buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("RD: Single tracking   BL/SV: Shuttle buses", buffer);
+}
+
+void test_format_advisory_truncates() {
+    IncidentList incidents;
+    incidents.add(LINE_MASK_RD, "Delay", "Single tracking");
+
+    char buffer[8];
+    size_t len = incidents.formatAdvisory(buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(7, len);
+    TEST_ASSERT_EQUAL_STRING("RD: Sin", buffer);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Line code tests
+    RUN_TEST(test_line_mask_from_code);
+    RUN_TEST(test_parse_line_list);
+    RUN_TEST(test_parse_line_list_ignores_unknown);
+    RUN_TEST(test_format_line_mask);
+    RUN_TEST(test_format_line_mask_truncates);
+
+    // JSON scanning tests
+    RUN_TEST(test_find_array);
+    RUN_TEST(test_find_array_missing_key);
+    RUN_TEST(test_next_object_walks_elements);
+    RUN_TEST(test_next_object_empty_array);
+    RUN_TEST(test_next_object_truncated_element);
+
+    // Incident list tests
+    RUN_TEST(test_list_add_and_get);
+    RUN_TEST(test_list_is_bounded);
+    RUN_TEST(test_list_truncates_long_text);
+    RUN_TEST(test_format_advisory);
+    RUN_TEST(test_format_advisory_truncates);
+
+    return UNITY_END();
+}
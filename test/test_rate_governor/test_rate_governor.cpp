@@ -0,0 +1,229 @@
+/**
+ * Unit tests for the request rate governor
+ *
+ * Tests the token bucket (burst, refill, priorities), the daily quota
+ * projection and interval stretching, and the throttled/deferred counters.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "rate_governor.h"
+
+/**
+ * Make a request every intervalMs from startMs until endMs
+ *
+ * :return unsigned long: Time of the last request
+ */
+unsigned long requestEvery(RateGovernor& governor, unsigned long startMs, unsigned long endMs,
+                           unsigned long intervalMs) {
+    unsigned long t = startMs;
+    for (; (long)(endMs - t) > 0; t += intervalMs) {
+        governor.tryAcquire(PRIORITY_HIGH, t);
+    }
+    return t - intervalMs;
+}
+
+// ============================================================================
+// Token Bucket Tests
+// ============================================================================
+
+void test_burst_then_throttle() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+
+    for (int i = 0; i < RATE_BURST; i++) {
+        TEST_ASSERT_TRUE(governor.tryAcquire(PRIORITY_HIGH, 1000));
+    }
+    TEST_ASSERT_FALSE(governor.tryAcquire(PRIORITY_HIGH, 1000));
+
+    TEST_ASSERT_EQUAL(RATE_BURST, governor.getAllowedCount());
+    TEST_ASSERT_EQUAL(1, governor.getThrottledCount());
+}
+
+void test_refill_rate() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    for (int i = 0; i < RATE_BURST; i++) {
+        governor.tryAcquire(PRIORITY_HIGH, 1000);
+    }
+
+    unsigned long tokenMs = 1000 / RATE_TOKENS_PER_SEC;
+    TEST_ASSERT_EQUAL(tokenMs, governor.getWaitMs(PRIORITY_HIGH, 1000));
+    TEST_ASSERT_FALSE(governor.tryAcquire(PRIORITY_HIGH, 1000 + tokenMs - 1));
+    TEST_ASSERT_TRUE(governor.tryAcquire(PRIORITY_HIGH, 1000 + 2 * tokenMs - 1));
+}
+
+void test_refill_caps_at_burst() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    governor.tryAcquire(PRIORITY_HIGH, 1000);
+
+    // A long idle period never gives more than a burst
+    unsigned long t = 1000 + 3600000;
+    int granted = 0;
+    while (governor.tryAcquire(PRIORITY_HIGH, t)) {
+        granted++;
+    }
+    TEST_ASSERT_EQUAL(RATE_BURST, granted);
+}
+
+void test_background_keeps_reserve() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+
+    int background = 0;
+    while (governor.tryAcquire(PRIORITY_BACKGROUND, 1000)) {
+        background++;
+    }
+    TEST_ASSERT_EQUAL(RATE_BURST - RATE_HIGH_PRIORITY_RESERVE, background);
+
+    // The reserve is still there for predictions
+    for (int i = 0; i < RATE_HIGH_PRIORITY_RESERVE; i++) {
+        TEST_ASSERT_TRUE(governor.tryAcquire(PRIORITY_HIGH, 1000));
+    }
+    TEST_ASSERT_FALSE(governor.tryAcquire(PRIORITY_HIGH, 1000));
+}
+
+void test_background_waits_longer() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    for (int i = 0; i < RATE_BURST; i++) {
+        governor.tryAcquire(PRIORITY_HIGH, 1000);
+    }
+
+    TEST_ASSERT_GREATER_THAN(governor.getWaitMs(PRIORITY_HIGH, 1000),
+                             governor.getWaitMs(PRIORITY_BACKGROUND, 1000));
+}
+
+void test_rate_limited_empties_bucket() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    governor.tryAcquire(PRIORITY_HIGH, 1000);
+    governor.onRateLimited(1000);
+
+    TEST_ASSERT_FALSE(governor.tryAcquire(PRIORITY_HIGH, 1000));
+    TEST_ASSERT_EQUAL(1, governor.getRateLimitedCount());
+}
+
+void test_bucket_survives_millis_wrap() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    unsigned long start = 0xFFFFFF00UL;
+    for (int i = 0; i < RATE_BURST; i++) {
+        governor.tryAcquire(PRIORITY_HIGH, start);
+    }
+
+    // 1 s later, across the wrap
+    TEST_ASSERT_TRUE(governor.tryAcquire(PRIORITY_HIGH, start + 1000));
+}
+
+// ============================================================================
+// Daily Quota Tests
+// ============================================================================
+
+void test_no_stretch_under_budget() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+
+    // One request every 30 s projects to 2880/day
+    unsigned long t = requestEvery(governor, 0, 3600000, 30000);
+    TEST_ASSERT_EQUAL(100, governor.getStretchPercent(t));
+    TEST_ASSERT_EQUAL(30000, governor.stretchInterval(30000, t));
+}
+
+void test_stretch_over_budget() {
+    // 2880/day at a 30 s interval against a 1440/day budget needs about 2x
+    RateGovernor governor(1440);
+    unsigned long t = requestEvery(governor, 0, 3600000, 30000);
+
+    unsigned int stretch = governor.getStretchPercent(t);
+    TEST_ASSERT_UINT_WITHIN(15, 205, stretch);
+}
+
+void test_stretch_capped() {
+    RateGovernor governor(100);
+    unsigned long t = requestEvery(governor, 0, 3600000, 5000);
+    TEST_ASSERT_EQUAL(RATE_MAX_STRETCH_PERCENT, governor.getStretchPercent(t));
+}
+
+void test_stretched_polling_stays_in_budget() {
+    // Poll every 30 s but let the governor stretch the interval for a full day
+    RateGovernor governor(1440);
+    unsigned long last = 0;
+    governor.tryAcquire(PRIORITY_HIGH, 0);
+
+    for (unsigned long t = 1000; t < RATE_DAY_MS - 1000; t += 1000) {
+        if (governor.shouldDefer(last, 30000, t)) continue;
+        if (t - last >= 30000) {
+            governor.tryAcquire(PRIORITY_HIGH, t);
+            last = t;
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(1440 + 60, governor.getDailyCount());
+    TEST_ASSERT_GREATER_THAN(1000, governor.getDailyCount());
+    TEST_ASSERT_GREATER_THAN(0, governor.getDeferredCount());
+}
+
+void test_day_rollover_resets_count() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    governor.tryAcquire(PRIORITY_HIGH, 0);
+    governor.tryAcquire(PRIORITY_HIGH, 1000);
+    TEST_ASSERT_EQUAL(2, governor.getDailyCount());
+
+    governor.tryAcquire(PRIORITY_HIGH, RATE_DAY_MS + 5);
+    TEST_ASSERT_EQUAL(1, governor.getDailyCount());
+    TEST_ASSERT_EQUAL(3, governor.getAllowedCount());
+}
+
+// ============================================================================
+// Deferral Tests
+// ============================================================================
+
+void test_no_defer_on_budget() {
+    RateGovernor governor(RATE_DAILY_QUOTA);
+    unsigned long t = requestEvery(governor, 0, 3600000, 30000);
+
+    TEST_ASSERT_FALSE(governor.shouldDefer(t, 30000, t + 30000));
+    TEST_ASSERT_EQUAL(0, governor.getDeferredCount());
+}
+
+void test_deferred_counted_once_per_poll() {
+    RateGovernor governor(1440);
+    unsigned long t = requestEvery(governor, 0, 3600000, 30000);
+
+    TEST_ASSERT_TRUE(governor.shouldDefer(t, 30000, t + 30000));
+    TEST_ASSERT_TRUE(governor.shouldDefer(t, 30000, t + 31000));
+    TEST_ASSERT_EQUAL(1, governor.getDeferredCount());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Token bucket tests
+    RUN_TEST(test_burst_then_throttle);
+    RUN_TEST(test_refill_rate);
+    RUN_TEST(test_refill_caps_at_burst);
+    RUN_TEST(test_background_keeps_reserve);
+    RUN_TEST(test_background_waits_longer);
+    RUN_TEST(test_rate_limited_empties_bucket);
+    RUN_TEST(test_bucket_survives_millis_wrap);
+
+    // Daily quota tests
+    RUN_TEST(test_no_stretch_under_budget);
+    RUN_TEST(test_stretch_over_budget);
+    RUN_TEST(test_stretch_capped);
+    RUN_TEST(test_stretched_polling_stays_in_budget);
+    RUN_TEST(test_day_rollover_resets_count);
+
+    // Deferral tests
+    RUN_TEST(test_no_defer_on_budget);
+    RUN_TEST(test_deferred_counted_once_per_poll);
+
+    return UNITY_END();
+}
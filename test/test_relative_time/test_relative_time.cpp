@@ -10,6 +10,7 @@
 #include <unity.h>
 #include <cstring>
 #include <cstdio>
+#include <cstdint>
 
 // Include the header (we'll need to replicate the declarations for native testing)
 // In a real setup, you'd have proper include paths set up
@@ -18,8 +19,8 @@
  * Pure C++ implementation of the relative time functions for testing
  * (These mirror the actual implementation in relative_time.cpp)
  */
-void getRelativeTimeComponents(unsigned long elapsedMs, int& value, char& unit) {
-    unsigned long elapsedSec = elapsedMs / 1000;
+void getRelativeTimeComponents(uint64_t elapsedMs, int& value, char& unit) {
+    uint64_t elapsedSec = elapsedMs / 1000;
     
     if (elapsedSec < 90) {
         value = (int)elapsedSec;
@@ -28,16 +29,13 @@ void getRelativeTimeComponents(unsigned long elapsedMs, int& value, char& unit)
             value = 99;
         }
     } else {
-        unsigned long elapsedMin = elapsedSec / 60;
-        value = (int)elapsedMin;
+        uint64_t elapsedMin = elapsedSec / 60;
         unit = 'm';
-        if (value > 99) {
-            value = 99;
-        }
+        value = elapsedMin > 99 ? 99 : (int)elapsedMin;
     }
 }
 
-void formatRelativeTime(unsigned long elapsedMs, char* buffer, size_t bufferSize) {
+void formatRelativeTime(uint64_t elapsedMs, char* buffer, size_t bufferSize) {
     if (buffer == nullptr || bufferSize < 2) {
         return;
     }
@@ -160,6 +158,16 @@ void test_1000_minutes_caps_at_99() {
     TEST_ASSERT_EQUAL('m', unit);
 }
 
+void test_past_32_bit_millis_caps_at_99() {
+    int value;
+    char unit;
+    // 60 days, beyond where a 32-bit millis() count wraps
+    getRelativeTimeComponents(60ULL * 24 * 3600 * 1000, value, unit);
+    
+    TEST_ASSERT_EQUAL(99, value);
+    TEST_ASSERT_EQUAL('m', unit);
+}
+
 // ============================================================================
 // Format String Tests
 // ============================================================================
@@ -223,6 +231,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_99_minutes);
     RUN_TEST(test_100_minutes_caps_at_99);
     RUN_TEST(test_1000_minutes_caps_at_99);
+    RUN_TEST(test_past_32_bit_millis_caps_at_99);
     
     // Format string tests
     RUN_TEST(test_format_1_second);
@@ -0,0 +1,258 @@
+/**
+ * Unit tests for the compiled timetable
+ *
+ * Tests block lookup, delta decoding, group filtering, and trips that run
+ * past midnight. Tables are encoded here the same way gtfs_schedule.py
+ * writes them. These tests run natively on your computer without ESP32
+ * hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "schedule_table.h"
+
+static const char DESTINATIONS[][DEST_MAX_LEN] = {"Glen", "Shad", "NewC"};
+static const char LINES[][LINE_MAX_LEN] = {"RD", "BL"};
+
+struct Trip {
+    uint32_t sec;
+    uint8_t destination;
+    uint8_t line;
+    uint8_t group;
+};
+
+struct EncodedDay {
+    ScheduleBlock blocks[32];
+    uint8_t data[2048];
+};
+
+static EncodedDay encoded[SCHEDULE_DAY_TYPES];
+static ScheduleTable table;
+
+static uint32_t hms(int hours, int minutes, int seconds = 0) {
+    return (uint32_t)(hours * 3600 + minutes * 60 + seconds);
+}
+
+// Encode sorted trips into one day of the table
+static void encodeDay(uint8_t dayType, const Trip* trips, int count) {
+    EncodedDay& day = encoded[dayType];
+    uint16_t offset = 0;
+    uint32_t previous = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t delta = trips[i].sec - previous;
+        if (i % SCHEDULE_BLOCK_SIZE == 0) {
+            day.blocks[i / SCHEDULE_BLOCK_SIZE] = {trips[i].sec, offset};
+            delta = 0;
+        }
+        do {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            day.data[offset++] = delta ? (byte | 0x80) : byte;
+        } while (delta);
+        day.data[offset++] = trips[i].destination;
+        day.data[offset++] = (uint8_t)(trips[i].line | (trips[i].group << 5));
+        previous = trips[i].sec;
+    }
+    table.days[dayType] = {day.blocks, day.data,
+                           (uint16_t)((count + SCHEDULE_BLOCK_SIZE - 1) / SCHEDULE_BLOCK_SIZE), (uint16_t)count};
+}
+
+// A weekday with a train every 10 minutes from 05:00, alternating tracks
+static void encodeWeekday() {
+    static Trip trips[120];
+    for (int i = 0; i < 120; i++) {
+        trips[i] = {hms(5, 0) + (uint32_t)i * 600, (uint8_t)(i % 2), 0, (uint8_t)(i % 2 + 1)};
+    }
+    encodeDay(SCHEDULE_WEEKDAY, trips, 120);
+}
+
+// ============================================================================
+// Day Type Tests
+// ============================================================================
+
+void test_day_types() {
+    TEST_ASSERT_EQUAL(SCHEDULE_SUNDAY, scheduleDayType(0));
+    TEST_ASSERT_EQUAL(SCHEDULE_WEEKDAY, scheduleDayType(1));
+    TEST_ASSERT_EQUAL(SCHEDULE_WEEKDAY, scheduleDayType(5));
+    TEST_ASSERT_EQUAL(SCHEDULE_SATURDAY, scheduleDayType(6));
+}
+
+// ============================================================================
+// Lookup Tests
+// ============================================================================
+
+void test_empty_table() {
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+    TEST_ASSERT_TRUE(schedule.isEmpty());
+    TEST_ASSERT_EQUAL(0, schedule.findNext(2, hms(12, 0), 0, next, 3));
+}
+
+void test_finds_next_in_later_block() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+    TEST_ASSERT_FALSE(schedule.isEmpty());
+
+    // 14:05 is well past the first block
+    int count = schedule.findNext(3, hms(14, 5), 0, next, 3);
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(hms(14, 10), next[0].departSec);
+    TEST_ASSERT_EQUAL(hms(14, 20), next[1].departSec);
+    TEST_ASSERT_EQUAL(hms(14, 30), next[2].departSec);
+    TEST_ASSERT_EQUAL_STRING("RD", next[0].line);
+}
+
+void test_exact_time_is_included() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[1];
+    TEST_ASSERT_EQUAL(1, schedule.findNext(3, hms(5, 0), 0, next, 1));
+    TEST_ASSERT_EQUAL(hms(5, 0), next[0].departSec);
+}
+
+void test_block_boundaries() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[2];
+
+    // Every departure is found from just before it, wherever it falls in its block
+    for (int i = 0; i < 120; i++) {
+        uint32_t sec = hms(5, 0) + (uint32_t)i * 600;
+        TEST_ASSERT_TRUE(schedule.findNext(3, sec - 1, 0, next, 2) >= 1);
+        TEST_ASSERT_EQUAL(sec, next[0].departSec);
+    }
+}
+
+void test_group_filter() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+
+    int count = schedule.findNext(3, hms(6, 0), 2, next, 3);
+    TEST_ASSERT_EQUAL(3, count);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(2, next[i].group);
+        TEST_ASSERT_EQUAL_STRING("Shad", next[i].destination);
+    }
+    TEST_ASSERT_EQUAL(hms(6, 10), next[0].departSec);
+    TEST_ASSERT_EQUAL(hms(6, 30), next[1].departSec);
+}
+
+void test_long_gaps_decode() {
+    // Gaps of a few seconds to several hours need one to three varint bytes
+    static const Trip trips[] = {
+        {hms(5, 0), 0, 1, 1},
+        {hms(5, 0, 45), 1, 1, 2},
+        {hms(5, 30), 2, 0, 1},
+        {hms(11, 0), 0, 0, 2},
+        {hms(23, 59), 1, 1, 1},
+    };
+    encodeDay(SCHEDULE_SATURDAY, trips, 5);
+    Schedule schedule(table);
+    ScheduledDeparture next[5];
+
+    TEST_ASSERT_EQUAL(5, schedule.findNext(6, hms(4, 0), 0, next, 5));
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(trips[i].sec, next[i].departSec);
+        TEST_ASSERT_EQUAL_STRING(DESTINATIONS[trips[i].destination], next[i].destination);
+        TEST_ASSERT_EQUAL_STRING(LINES[trips[i].line], next[i].line);
+    }
+}
+
+void test_end_of_day_returns_fewer() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+
+    // Friday's last train is 24:50, and Saturday has no trains at all
+    TEST_ASSERT_EQUAL(0, schedule.findNext(6, hms(0, 51), 0, next, 3));
+}
+
+// ============================================================================
+// After Midnight Tests
+// ============================================================================
+
+void test_previous_day_runs_past_midnight() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+
+    // Saturday 00:35: Friday's table still has trains at 24:40 and 24:50
+    int count = schedule.findNext(6, hms(0, 35), 0, next, 3);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(hms(0, 40), next[0].departSec);
+    TEST_ASSERT_EQUAL(hms(0, 50), next[1].departSec);
+}
+
+void test_late_trains_merge_with_early_ones() {
+    static const Trip late[] = {
+        {hms(25, 10), 0, 0, 1},
+        {hms(26, 0), 0, 0, 1},
+    };
+    static const Trip early[] = {
+        {hms(1, 30), 1, 1, 2},
+        {hms(5, 0), 1, 1, 2},
+    };
+    encodeDay(SCHEDULE_SATURDAY, late, 2);
+    encodeDay(SCHEDULE_SUNDAY, early, 2);
+    Schedule schedule(table);
+    ScheduledDeparture next[3];
+
+    // Sunday 01:00: yesterday's 25:10 and 26:00 interleave with today's 01:30
+    TEST_ASSERT_EQUAL(3, schedule.findNext(0, hms(1, 0), 0, next, 3));
+    TEST_ASSERT_EQUAL(hms(1, 10), next[0].departSec);
+    TEST_ASSERT_EQUAL(hms(1, 30), next[1].departSec);
+    TEST_ASSERT_EQUAL(hms(2, 0), next[2].departSec);
+}
+
+void test_max_count_respected() {
+    encodeWeekday();
+    Schedule schedule(table);
+    ScheduledDeparture next[2];
+    memset(next, 0x5A, sizeof(next));
+    TEST_ASSERT_EQUAL(1, schedule.findNext(3, hms(9, 0), 0, next, 1));
+    TEST_ASSERT_EQUAL(0x5A, ((uint8_t*)&next[1])[0]);
+    TEST_ASSERT_EQUAL(0, schedule.findNext(3, hms(9, 0), 0, next, 0));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    memset(&table, 0, sizeof(table));
+    table.destinations = DESTINATIONS;
+    table.lines = LINES;
+    table.destinationCount = 3;
+    table.lineCount = 2;
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Day type tests
+    RUN_TEST(test_day_types);
+
+    // Lookup tests
+    RUN_TEST(test_empty_table);
+    RUN_TEST(test_finds_next_in_later_block);
+    RUN_TEST(test_exact_time_is_included);
+    RUN_TEST(test_block_boundaries);
+    RUN_TEST(test_group_filter);
+    RUN_TEST(test_long_gaps_decode);
+    RUN_TEST(test_end_of_day_returns_fewer);
+
+    // After midnight tests
+    RUN_TEST(test_previous_day_runs_past_midnight);
+    RUN_TEST(test_late_trains_merge_with_early_ones);
+    RUN_TEST(test_max_count_respected);
+
+    return UNITY_END();
+}
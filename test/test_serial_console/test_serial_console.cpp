@@ -0,0 +1,228 @@
+/**
+ * Unit tests for the serial console
+ *
+ * Tests line assembly from single characters, command dispatch and
+ * arguments, sending answers piece by piece, overlong lines and output,
+ * and the hex helpers used for capture and replay.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "serial_console.h"
+
+static char lastArgs[64];
+static int calls = 0;
+
+static void echoArgs(char* args, BufferWriter& out, void* context) {
+    calls++;
+    strncpy(lastArgs, args, sizeof(lastArgs) - 1);
+    lastArgs[sizeof(lastArgs) - 1] = '\0';
+    out.printf("args=[%s]", args);
+}
+
+static void printLong(char* args, BufferWriter& out, void* context) {
+    for (int i = 0; i < 100; i++) {
+        out.print("0123456789");
+    }
+}
+
+static const ConsoleCommand COMMANDS[] = {
+    {"echo", "<text>", "Repeat the arguments", echoArgs},
+    {"long", "", "Print 1000 characters", printLong},
+};
+
+static char output[256];
+
+/**
+ * Feed a whole string, one character at a time
+ *
+ * :return bool: What the last feed() returned
+ */
+static bool feedText(SerialConsole& console, const char* text) {
+    bool ready = false;
+    for (const char* p = text; *p != '\0'; p++) {
+        ready = console.feed(*p);
+    }
+    return ready;
+}
+
+/**
+ * Take all pending output as a string
+ */
+static const char* takeOutput(SerialConsole& console) {
+    static char text[sizeof(output)];
+    size_t length;
+    const char* pending = console.getOutput(length);
+    memcpy(text, pending, length);
+    text[length] = '\0';
+    console.consumeOutput(length);
+    return text;
+}
+
+// ============================================================================
+// Line Tests
+// ============================================================================
+
+void test_command_runs_on_newline() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    TEST_ASSERT_FALSE(feedText(console, "echo hi"));
+    TEST_ASSERT_EQUAL(0, calls);
+
+    TEST_ASSERT_TRUE(console.feed('\n'));
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL_STRING("args=[hi]\n", takeOutput(console));
+    TEST_ASSERT_FALSE(console.hasOutput());
+}
+
+void test_crlf_runs_once() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "echo a\r\n");
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL(1, console.getCommandCount());
+}
+
+void test_args_trimmed() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "  echo   two words  \n");
+    TEST_ASSERT_EQUAL_STRING("two words", lastArgs);
+
+    feedText(console, "echo\n");
+    TEST_ASSERT_EQUAL_STRING("", lastArgs);
+}
+
+void test_backspace_edits_line() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "ecjo\b\bho x\x7f" "y\n");
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL_STRING("y", lastArgs);
+}
+
+void test_blank_line_ignored() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    TEST_ASSERT_FALSE(feedText(console, "\n   \n"));
+    TEST_ASSERT_FALSE(console.hasOutput());
+    TEST_ASSERT_EQUAL(0, console.getCommandCount());
+}
+
+void test_overlong_line_refused() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "echo ");
+    for (int i = 0; i < CONSOLE_LINE_MAX_LEN; i++) {
+        console.feed('x');
+    }
+    TEST_ASSERT_TRUE(console.feed('\n'));
+    TEST_ASSERT_EQUAL(0, calls);
+    TEST_ASSERT_NOT_NULL(strstr(takeOutput(console), "line too long"));
+
+    // The next line is read normally
+    feedText(console, "echo ok\n");
+    TEST_ASSERT_EQUAL_STRING("ok", lastArgs);
+}
+
+// ============================================================================
+// Dispatch Tests
+// ============================================================================
+
+void test_unknown_command() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    TEST_ASSERT_TRUE(feedText(console, "reboot now\n"));
+    TEST_ASSERT_EQUAL_STRING("unknown command 'reboot'; try help\n", takeOutput(console));
+}
+
+void test_help_lists_commands() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "help\n");
+    const char* text = takeOutput(console);
+    TEST_ASSERT_NOT_NULL(strstr(text, "  echo <text> - Repeat the arguments\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "  long - Print 1000 characters\n"));
+}
+
+void test_long_output_truncated_with_note() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "long\n");
+
+    size_t length;
+    const char* text = console.getOutput(length);
+    TEST_ASSERT_EQUAL(sizeof(output) - 1, length);
+    TEST_ASSERT_EQUAL_STRING("\n(output truncated)\n", text + length - 20);
+}
+
+void test_output_sent_in_pieces() {
+    SerialConsole console(COMMANDS, 2, output, sizeof(output), nullptr);
+    feedText(console, "echo abc\n");
+
+    size_t length;
+    console.consumeOutput(4);
+    TEST_ASSERT_TRUE(console.hasOutput());
+    TEST_ASSERT_EQUAL(0, memcmp("=[abc]\n", console.getOutput(length), 7));
+    TEST_ASSERT_EQUAL(7, length);
+
+    console.consumeOutput(7);
+    TEST_ASSERT_FALSE(console.hasOutput());
+    console.getOutput(length);
+    TEST_ASSERT_EQUAL(0, length);
+}
+
+// ============================================================================
+// Hex Tests
+// ============================================================================
+
+void test_hex_round_trip() {
+    const uint8_t data[] = {0x00, 0x7f, 0xa5, 0xff};
+    char text[16];
+    BufferWriter out(text, sizeof(text));
+    formatHex(data, sizeof(data), out);
+    TEST_ASSERT_EQUAL_STRING("007fa5ff", text);
+
+    uint8_t parsed[4];
+    TEST_ASSERT_EQUAL(4, parseHex("007FA5ff", parsed, sizeof(parsed)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, parsed, 4);
+}
+
+void test_hex_rejects_bad_input() {
+    uint8_t parsed[2];
+    TEST_ASSERT_EQUAL(-1, parseHex("abc", parsed, sizeof(parsed)));
+    TEST_ASSERT_EQUAL(-1, parseHex("zz", parsed, sizeof(parsed)));
+    TEST_ASSERT_EQUAL(-1, parseHex("000000", parsed, sizeof(parsed)));
+    TEST_ASSERT_EQUAL(0, parseHex("", parsed, sizeof(parsed)));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    calls = 0;
+    lastArgs[0] = '\0';
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Lines
+    RUN_TEST(test_command_runs_on_newline);
+    RUN_TEST(test_crlf_runs_once);
+    RUN_TEST(test_args_trimmed);
+    RUN_TEST(test_backspace_edits_line);
+    RUN_TEST(test_blank_line_ignored);
+    RUN_TEST(test_overlong_line_refused);
+
+    // Dispatch
+    RUN_TEST(test_unknown_command);
+    RUN_TEST(test_help_lists_commands);
+    RUN_TEST(test_long_output_truncated_with_note);
+    RUN_TEST(test_output_sent_in_pieces);
+
+    // Hex
+    RUN_TEST(test_hex_round_trip);
+    RUN_TEST(test_hex_rejects_bad_input);
+
+    return UNITY_END();
+}
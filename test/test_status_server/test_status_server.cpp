@@ -0,0 +1,710 @@
+/**
+ * Unit tests for the status HTTP server
+ *
+ * Runs the server on a loopback port and talks to it with plain sockets:
+ * routing, cached and live bodies, long polling, HEAD, error statuses, slow clients and counters. Also covers
+ * the BufferWriter used to pre-serialize bodies.
+ * These tests run natively on your computer without ESP32 hardware.
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "status_server.h"
+#include "buffer_writer.h"
+
+static char healthBody[64];
+static char bigBody[32768];
+static int buildCount = 0;
+
+/**
+ * Builder that counts its calls and writes a small JSON body
+ */
+static size_t buildHealth(char* buffer, size_t capacity, void* context) {
+    buildCount++;
+    return snprintf(buffer, capacity, "{\"ok\":true,\"build\":%d}", buildCount);
+}
+
+/**
+ * Builder that fills a body larger than one socket send
+ */
+static size_t buildBig(char* buffer, size_t capacity, void* context) {
+    memset(buffer, 'x', capacity - 1);
+    buffer[capacity - 1] = '\0';
+    return capacity - 1;
+}
+
+/**
+ * Send a raw request to the server, poll it until it has answered, and read
+ * the response
+ *
+ * :return int: Response length, or -1 on socket error
+ */
+static int exchange(StatusServer& server, const char* request, char* response, size_t size,
+                    unsigned long nowMs = 1000) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(server.getPort());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    send(fd, request, strlen(request), 0);
+
+    // The server sends what the socket takes on each poll; keep polling
+    // until it has closed the connection
+    size_t length = 0;
+    for (int polls = 0; polls < 1000 && length < size - 1; polls++) {
+        server.poll(nowMs);
+        ssize_t received = recv(fd, response + length, size - 1 - length, MSG_DONTWAIT);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) break;
+        if (received > 0) length += (size_t)received;
+    }
+    response[length] = '\0';
+    close(fd);
+    return (int)length;
+}
+
+/**
+ * Action that echoes the posted form, or answers 400 for "bad"
+ */
+static int echoForm(char* form, char* buffer, size_t capacity, size_t& length, void* context) {
+    length = snprintf(buffer, capacity, "got %s", form);
+    return strcmp(form, "bad") == 0 ? 400 : 200;
+}
+
+/**
+ * Content version for the long-poll endpoint
+ */
+static uint32_t frameVersion = 0x1234;
+
+static uint32_t getFrameVersion(void* context) {
+    return frameVersion;
+}
+
+/**
+ * Connect to the server and send a request without waiting for the answer
+ *
+ * :return int: Client socket, or -1 on error
+ */
+static int sendRequest(StatusServer& server, const char* request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(server.getPort());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    send(fd, request, strlen(request), 0);
+    return fd;
+}
+
+/**
+ * Read a response until the server closes the connection
+ */
+static void readResponse(int fd, char* response, size_t size) {
+    size_t length = 0;
+    ssize_t received;
+    while (length < size - 1 && (received = recv(fd, response + length, size - 1 - length, 0)) > 0) {
+        length += (size_t)received;
+    }
+    response[length] = '\0';
+    close(fd);
+}
+
+static StatusServer* server = nullptr;
+static int healthEndpoint = -1;
+
+// ============================================================================
+// Server Tests
+// ============================================================================
+
+void test_begin_picks_port() {
+    TEST_ASSERT_NOT_EQUAL(0, server->getPort());
+}
+
+void test_poll_without_clients_returns() {
+    TEST_ASSERT_EQUAL(0, server->poll(1000));
+}
+
+void test_get_serves_cached_body() {
+    server->rebuild(1000);
+    int builds = buildCount;
+
+    char response[512];
+    exchange(*server, "GET /health HTTP/1.1\r\nHost: x\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200 OK\r\n", 17));
+    TEST_ASSERT_NOT_NULL(strstr(response, "Content-Type: application/json\r\n"));
+
+    const char* body = strstr(response, "\r\n\r\n") + 4;
+    TEST_ASSERT_EQUAL_STRING(healthBody, body);
+
+    char contentLength[32];
+    snprintf(contentLength, sizeof(contentLength), "Content-Length: %u\r\n", (unsigned)strlen(healthBody));
+    TEST_ASSERT_NOT_NULL(strstr(response, contentLength));
+
+    // Requests never rebuild the body
+    exchange(*server, "GET /health HTTP/1.1\r\n\r\n", response, sizeof(response));
+    exchange(*server, "GET /health HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(builds, buildCount);
+}
+
+void test_rebuild_changes_body() {
+    server->rebuild(healthEndpoint, 1000);
+    char expected[64];
+    strcpy(expected, healthBody);
+
+    char response[512];
+    exchange(*server, "GET /health HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING(expected, strstr(response, "\r\n\r\n") + 4);
+}
+
+void test_age_header() {
+    server->rebuild(1000);
+
+    char response[512];
+    exchange(*server, "GET /health HTTP/1.1\r\n\r\n", response, sizeof(response), 13500);
+    TEST_ASSERT_NOT_NULL(strstr(response, "Age: 12\r\n"));
+}
+
+void test_query_string_ignored() {
+    char response[512];
+    exchange(*server, "GET /health?verbose=1 HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+}
+
+void test_head_has_no_body() {
+    char response[512];
+    exchange(*server, "HEAD /health HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_EQUAL_STRING("", strstr(response, "\r\n\r\n") + 4);
+}
+
+void test_unknown_path_404() {
+    unsigned long errors = server->getErrorCount();
+    char response[512];
+    exchange(*server, "GET /nope HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 404", 12));
+
+    // Prefix of a real path is not a match
+    exchange(*server, "GET /heal HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 404", 12));
+    TEST_ASSERT_EQUAL(errors + 2, server->getErrorCount());
+}
+
+void test_post_405() {
+    char response[512];
+    exchange(*server, "POST /health HTTP/1.1\r\nContent-Length: 0\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 405", 12));
+}
+
+void test_oversized_request_431() {
+    char request[STATUS_REQUEST_MAX_LEN + 64];
+    memset(request, 'a', sizeof(request) - 1);
+    request[sizeof(request) - 1] = '\0';
+    memcpy(request, "GET /", 5);
+
+    char response[512];
+    exchange(*server, request, response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 431", 12));
+}
+
+void test_unbuilt_endpoint_503() {
+    StatusServer fresh;
+    char body[16];
+    fresh.addEndpoint("/health", "application/json", body, sizeof(body), buildHealth, nullptr);
+    TEST_ASSERT_TRUE(fresh.begin(0));
+
+    char response[512];
+    exchange(fresh, "GET /health HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 503", 12));
+}
+
+void test_large_body_sent_completely() {
+    static char response[sizeof(bigBody) + 512];
+    int length = exchange(*server, "GET /big HTTP/1.1\r\n\r\n", response, sizeof(response));
+    const char* body = strstr(response, "\r\n\r\n") + 4;
+    TEST_ASSERT_EQUAL(sizeof(bigBody) - 1, (size_t)(response + length - body));
+}
+
+void test_live_endpoint_rebuilt_per_request() {
+    StatusServer live;
+    char body[64];
+    int endpoint = live.addEndpoint("/metrics", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    live.setLive(endpoint, true);
+    TEST_ASSERT_TRUE(live.begin(0));
+
+    // Served without an explicit rebuild, and fresh each time
+    char first[512];
+    char second[512];
+    exchange(live, "GET /metrics HTTP/1.1\r\n\r\n", first, sizeof(first), 5000);
+    exchange(live, "GET /metrics HTTP/1.1\r\n\r\n", second, sizeof(second), 5000);
+    TEST_ASSERT_EQUAL(0, strncmp(first, "HTTP/1.1 200", 12));
+    TEST_ASSERT_NOT_NULL(strstr(first, "Age: 0\r\n"));
+    TEST_ASSERT_TRUE(strcmp(strstr(first, "\r\n\r\n"), strstr(second, "\r\n\r\n")) != 0);
+    TEST_ASSERT_EQUAL(2, live.getRebuildCount());
+}
+
+void test_rebuild_all_skips_live_endpoints() {
+    StatusServer mixed;
+    char cached[64];
+    char live[64];
+    mixed.addEndpoint("/health", "application/json", cached, sizeof(cached), buildHealth, nullptr);
+    int endpoint = mixed.addEndpoint("/frame.png", "image/png", live, sizeof(live), buildBig, nullptr);
+    mixed.setLive(endpoint, true);
+    buildCount = 0;
+
+    // Only the cached body is built; the live one waits for a request
+    mixed.rebuild(1000);
+    TEST_ASSERT_EQUAL(1, buildCount);
+    TEST_ASSERT_EQUAL(1, mixed.getRebuildCount());
+}
+
+void test_long_poll_answers_on_change() {
+    StatusServer polled;
+    char body[64];
+    int endpoint = polled.addEndpoint("/frame", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    polled.setLive(endpoint, true);
+    polled.setLongPoll(endpoint, getFrameVersion);
+    TEST_ASSERT_TRUE(polled.begin(0));
+    frameVersion = 0x1234;
+
+    int fd = sendRequest(polled, "GET /frame?since=00001234 HTTP/1.1\r\n\r\n");
+    polled.poll(1000);
+    TEST_ASSERT_EQUAL(1, polled.getParkedCount());
+    polled.poll(2000);
+    TEST_ASSERT_EQUAL(1, polled.getParkedCount());
+
+    frameVersion = 0x5678;
+    polled.poll(3000);
+    TEST_ASSERT_EQUAL(0, polled.getParkedCount());
+
+    char response[512];
+    readResponse(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_NOT_NULL(strstr(response, "ETag: \"00005678\"\r\n"));
+}
+
+void test_long_poll_times_out_304() {
+    StatusServer polled;
+    char body[64];
+    int endpoint = polled.addEndpoint("/frame", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    polled.setLive(endpoint, true);
+    polled.setLongPoll(endpoint, getFrameVersion);
+    TEST_ASSERT_TRUE(polled.begin(0));
+    frameVersion = 0xabc;
+
+    int fd = sendRequest(polled, "GET /frame?since=abc HTTP/1.1\r\n\r\n");
+    polled.poll(1000);
+    TEST_ASSERT_EQUAL(1, polled.getParkedCount());
+    polled.poll(1000 + STATUS_LONG_POLL_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(0, polled.getParkedCount());
+
+    char response[512];
+    readResponse(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 304", 12));
+}
+
+void test_long_poll_stale_since_answers_now() {
+    StatusServer polled;
+    char body[64];
+    int endpoint = polled.addEndpoint("/frame", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    polled.setLive(endpoint, true);
+    polled.setLongPoll(endpoint, getFrameVersion);
+    TEST_ASSERT_TRUE(polled.begin(0));
+    frameVersion = 0x99;
+
+    // Old version, or none at all: answered right away
+    char response[512];
+    exchange(polled, "GET /frame?since=98 HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    exchange(polled, "GET /frame?x=1&since=zz HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_EQUAL(0, polled.getParkedCount());
+}
+
+void test_long_poll_client_hang_up() {
+    StatusServer polled;
+    char body[64];
+    int endpoint = polled.addEndpoint("/frame", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    polled.setLongPoll(endpoint, getFrameVersion);
+    TEST_ASSERT_TRUE(polled.begin(0));
+    frameVersion = 7;
+
+    int fd = sendRequest(polled, "GET /frame?since=7 HTTP/1.1\r\n\r\n");
+    polled.poll(1000);
+    TEST_ASSERT_EQUAL(1, polled.getParkedCount());
+
+    // The slot is freed as soon as the client goes away
+    close(fd);
+    usleep(10000);
+    polled.poll(1100);
+    TEST_ASSERT_EQUAL(0, polled.getParkedCount());
+}
+
+/**
+ * Milliseconds of wall time, to check that poll() doesn't wait
+ */
+static unsigned long wallMillis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void test_slow_client_never_blocks_poll() {
+    StatusServer slow;
+    char body[64];
+    slow.addEndpoint("/health", "application/json", body, sizeof(body), buildHealth, nullptr);
+    TEST_ASSERT_TRUE(slow.begin(0));
+    slow.rebuild(1000);
+
+    // Half a request: poll returns at once and keeps the connection
+    int fd = sendRequest(slow, "GET /health HTTP/1.1\r\n");
+    unsigned long started = wallMillis();
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(0, slow.poll(1000));
+    }
+    TEST_ASSERT_TRUE(wallMillis() - started < 50);
+
+    // The rest arrives later and is answered then
+    send(fd, "\r\n", 2, 0);
+    usleep(10000);
+    TEST_ASSERT_EQUAL(1, slow.poll(1100));
+    char response[512];
+    readResponse(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+}
+
+void test_slow_client_timed_out() {
+    StatusServer slow;
+    char body[64];
+    slow.addEndpoint("/health", "application/json", body, sizeof(body), buildHealth, nullptr);
+    TEST_ASSERT_TRUE(slow.begin(0));
+
+    int fd = sendRequest(slow, "GET /health");
+    slow.poll(1000);
+    slow.poll(1000 + STATUS_IO_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(1, slow.getErrorCount());
+
+    // Dropped without an answer
+    char response[64];
+    readResponse(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("", response);
+}
+
+void test_rebuild_waits_for_body_in_flight() {
+    StatusServer sending;
+    static char big[8 << 20];  // More than the kernel will buffer for the socket
+    int endpoint = sending.addEndpoint("/big", "text/plain", big, sizeof(big), buildBig, nullptr);
+    TEST_ASSERT_TRUE(sending.begin(0));
+    sending.rebuild(1000);
+
+    // A client that reads slowly: the body can't all go out at once
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int receiveBuffer = 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(sending.getPort());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr*)&addr, sizeof(addr)));
+    const char* request = "GET /big HTTP/1.1\r\n\r\n";
+    send(fd, request, strlen(request), 0);
+    usleep(10000);
+    TEST_ASSERT_EQUAL(1, sending.poll(1000));
+    TEST_ASSERT_EQUAL(0, sending.getRequestCount());
+
+    // The buffer being sent isn't rebuilt under the response
+    sending.rebuild(endpoint, 2000);
+    TEST_ASSERT_EQUAL(1, sending.getRebuildCount());
+
+    // Now read it all at full speed
+    receiveBuffer = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    static char response[sizeof(big) + 512];
+    size_t length = 0;
+    unsigned long started = wallMillis();
+    while (wallMillis() - started < 10000) {
+        sending.poll(2000);
+        ssize_t received = recv(fd, response + length, sizeof(response) - 1 - length, MSG_DONTWAIT);
+        if (received == 0) break;
+        if (received > 0) length += (size_t)received;
+    }
+    response[length] = '\0';
+    close(fd);
+    TEST_ASSERT_EQUAL(sizeof(big) - 1, strlen(strstr(response, "\r\n\r\n") + 4));
+    TEST_ASSERT_EQUAL(1, sending.getRequestCount());
+
+    // ...and is rebuilt once the response is out
+    TEST_ASSERT_EQUAL(2, sending.getRebuildCount());
+}
+
+void test_endpoint_table_bounded() {
+    StatusServer full;
+    char body[4];
+    for (int i = 0; i < STATUS_MAX_ENDPOINTS; i++) {
+        TEST_ASSERT_EQUAL(i, full.addEndpoint("/x", "text/plain", body, sizeof(body), buildHealth, nullptr));
+    }
+    TEST_ASSERT_EQUAL(-1, full.addEndpoint("/x", "text/plain", body, sizeof(body), buildHealth, nullptr));
+}
+
+void test_post_runs_action() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    TEST_ASSERT_TRUE(posted.begin(0));
+    posted.rebuild(1000);
+
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\ncontent-length: 9\r\n\r\nstation=A", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_EQUAL_STRING("got station=A", strstr(response, "\r\n\r\n") + 4);
+    TEST_ASSERT_EQUAL(1, posted.getRequestCount());
+
+    // The cached body the action wrote over is rebuilt for the next GET
+    exchange(posted, "GET /config HTTP/1.1\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_NOT_NULL(strstr(response, "\"ok\":true"));
+}
+
+void test_post_action_rejects_400() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    TEST_ASSERT_TRUE(posted.begin(0));
+
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 3\r\n\r\nbad", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 400", 12));
+    TEST_ASSERT_EQUAL(1, posted.getErrorCount());
+}
+
+void test_post_oversized_body_413() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    TEST_ASSERT_TRUE(posted.begin(0));
+
+    // Refused from the header alone, before the body is read
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 100000\r\n\r\n", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 413", 12));
+}
+
+void test_post_bad_content_length_refused() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    TEST_ASSERT_TRUE(posted.begin(0));
+
+    // Negative and non-numeric lengths are malformed; a length that would
+    // wrap size_t is too large, not small
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: -1\r\n\r\nstation=A", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 400", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 9x\r\n\r\nstation=A", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 400", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 18446744073709551615\r\n\r\n", response,
+             sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 413", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 36893488147419103232\r\n\r\n", response,
+             sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 413", 12));
+    TEST_ASSERT_EQUAL(0, posted.getRequestCount());
+}
+
+void test_post_needs_token() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    posted.setActionToken("s3cret");
+    TEST_ASSERT_TRUE(posted.begin(0));
+
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 9\r\n\r\nstation=A", response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 401", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nAuthorization: Bearer s3cre\r\nContent-Length: 9\r\n\r\nstation=A",
+             response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 401", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nAuthorization: Bearer s3cret!\r\nContent-Length: 9\r\n\r\nstation=A",
+             response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 401", 12));
+    TEST_ASSERT_EQUAL(0, posted.getRequestCount());
+
+    exchange(posted, "POST /config HTTP/1.1\r\nauthorization: Bearer s3cret\r\nContent-Length: 9\r\n\r\nstation=A",
+             response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_EQUAL_STRING("got station=A", strstr(response, "\r\n\r\n") + 4);
+}
+
+void test_post_headers_only_from_header_block() {
+    StatusServer posted;
+    char body[64];
+    int endpoint = posted.addEndpoint("/config", "text/plain", body, sizeof(body), buildHealth, nullptr);
+    posted.setAction(endpoint, echoForm);
+    posted.setActionToken("s3cret");
+    TEST_ASSERT_TRUE(posted.begin(0));
+
+    // A token in the body, or inside another header's value, isn't a header
+    char response[512];
+    exchange(posted, "POST /config HTTP/1.1\r\nContent-Length: 35\r\n\r\nx\r\nAuthorization: Bearer s3cret\r\n\r\n",
+             response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 401", 12));
+    exchange(posted, "POST /config HTTP/1.1\r\nX-Note: Authorization: Bearer s3cret\r\n\r\n", response,
+             sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 401", 12));
+
+    // Nor is a Content-Length that only appears in the body
+    exchange(posted, "POST /config HTTP/1.1\r\nAUTHORIZATION: Bearer s3cret\r\n\r\nx\r\nContent-Length: 3\r\n",
+             response, sizeof(response));
+    TEST_ASSERT_EQUAL(0, strncmp(response, "HTTP/1.1 200", 12));
+    TEST_ASSERT_EQUAL_STRING("got ", strstr(response, "\r\n\r\n") + 4);
+}
+
+// ============================================================================
+// BufferWriter Tests
+// ============================================================================
+
+void test_writer_appends() {
+    char buffer[32];
+    BufferWriter out(buffer, sizeof(buffer));
+    out.print("a=");
+    out.printf("%d,%s", 42, "b");
+    TEST_ASSERT_EQUAL_STRING("a=42,b", out.c_str());
+    TEST_ASSERT_EQUAL(6, out.length());
+    TEST_ASSERT_FALSE(out.overflowed());
+}
+
+void test_writer_truncates() {
+    char buffer[8];
+    BufferWriter out(buffer, sizeof(buffer));
+    out.print("abcd");
+    out.printf("%s", "efghij");
+    TEST_ASSERT_EQUAL_STRING("abcdefg", buffer);
+    TEST_ASSERT_EQUAL(7, out.length());
+    TEST_ASSERT_TRUE(out.overflowed());
+
+    // Nothing more fits, but the buffer stays terminated
+    out.print("z");
+    TEST_ASSERT_EQUAL_STRING("abcdefg", buffer);
+}
+
+void test_writer_json_string() {
+    char buffer[64];
+    BufferWriter out(buffer, sizeof(buffer));
+    out.printJsonString("Say \"hi\"\\\n");
+    out.print(",");
+    out.printJsonString(nullptr);
+    TEST_ASSERT_EQUAL_STRING("\"Say \\\"hi\\\"\\\\\\u000a\",null", buffer);
+}
+
+void test_writer_reset() {
+    char buffer[4];
+    BufferWriter out(buffer, sizeof(buffer));
+    out.print("abcdef");
+    out.reset();
+    TEST_ASSERT_EQUAL(0, out.length());
+    TEST_ASSERT_FALSE(out.overflowed());
+    TEST_ASSERT_EQUAL_STRING("", buffer);
+}
+
+void test_writer_truncate() {
+    char buffer[8];
+    BufferWriter out(buffer, sizeof(buffer));
+    out.print("[1");
+    size_t mark = out.length();
+    out.print(",22222222");
+    TEST_ASSERT_TRUE(out.overflowed());
+
+    // Back to the last whole item, with room to close the list
+    out.truncate(mark);
+    TEST_ASSERT_FALSE(out.overflowed());
+    out.print("]");
+    TEST_ASSERT_EQUAL_STRING("[1]", buffer);
+
+    // Can't grow past what was written
+    out.truncate(100);
+    TEST_ASSERT_EQUAL(3, out.length());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    static StatusServer shared;
+    server = &shared;
+    healthEndpoint = shared.addEndpoint("/health", "application/json", healthBody, sizeof(healthBody),
+                                        buildHealth, nullptr);
+    shared.addEndpoint("/big", "text/plain", bigBody, sizeof(bigBody), buildBig, nullptr);
+    shared.begin(0);
+    shared.rebuild(1000);
+
+    UNITY_BEGIN();
+
+    // Server tests
+    RUN_TEST(test_begin_picks_port);
+    RUN_TEST(test_poll_without_clients_returns);
+    RUN_TEST(test_get_serves_cached_body);
+    RUN_TEST(test_rebuild_changes_body);
+    RUN_TEST(test_age_header);
+    RUN_TEST(test_query_string_ignored);
+    RUN_TEST(test_head_has_no_body);
+    RUN_TEST(test_unknown_path_404);
+    RUN_TEST(test_post_405);
+    RUN_TEST(test_oversized_request_431);
+    RUN_TEST(test_unbuilt_endpoint_503);
+    RUN_TEST(test_large_body_sent_completely);
+    RUN_TEST(test_live_endpoint_rebuilt_per_request);
+    RUN_TEST(test_rebuild_all_skips_live_endpoints);
+    RUN_TEST(test_long_poll_answers_on_change);
+    RUN_TEST(test_long_poll_times_out_304);
+    RUN_TEST(test_long_poll_stale_since_answers_now);
+    RUN_TEST(test_long_poll_client_hang_up);
+    RUN_TEST(test_slow_client_never_blocks_poll);
+    RUN_TEST(test_slow_client_timed_out);
+    RUN_TEST(test_rebuild_waits_for_body_in_flight);
+    RUN_TEST(test_endpoint_table_bounded);
+    RUN_TEST(test_post_runs_action);
+    RUN_TEST(test_post_action_rejects_400);
+    RUN_TEST(test_post_oversized_body_413);
+    RUN_TEST(test_post_bad_content_length_refused);
+    RUN_TEST(test_post_needs_token);
+    RUN_TEST(test_post_headers_only_from_header_block);
+
+    // BufferWriter tests
+    RUN_TEST(test_writer_appends);
+    RUN_TEST(test_writer_truncates);
+    RUN_TEST(test_writer_json_string);
+    RUN_TEST(test_writer_reset);
+    RUN_TEST(test_writer_truncate);
+
+    return UNITY_END();
+}
@@ -8,6 +8,9 @@
  */
 
 #include <unity.h>
+#include <stdlib.h>
+#include <time.h>
+#include "config.h"
 
 /**
  * Helper function that mirrors the 12-hour conversion logic from TimeManager
@@ -102,6 +105,56 @@ void test_all_hours_in_valid_range() {
     }
 }
 
+// ============================================================================
+// Time Zone Rule Tests
+// ============================================================================
+
+/**
+ * Convert a UTC time to local time under TIMEZONE_RULE, as the device does
+ * after configTzTime()
+ */
+struct tm toLocal(time_t utc) {
+    setenv("TZ", TIMEZONE_RULE, 1);
+    tzset();
+    struct tm local;
+    localtime_r(&utc, &local);
+    return local;
+}
+
+void test_tz_rule_standard_time() {
+    struct tm local = toLocal(1768496400);  // 2026-01-15 17:00 UTC
+    TEST_ASSERT_EQUAL(12, local.tm_hour);
+    TEST_ASSERT_EQUAL(0, local.tm_isdst);
+}
+
+void test_tz_rule_daylight_time() {
+    struct tm local = toLocal(1783183260);  // 2026-07-04 16:41 UTC
+    TEST_ASSERT_EQUAL(12, local.tm_hour);
+    TEST_ASSERT_EQUAL(41, local.tm_min);
+    TEST_ASSERT_EQUAL(1, local.tm_isdst);
+}
+
+void test_tz_rule_spring_forward() {
+    // Second Sunday in March: 1:59:59 EST is followed by 3:00:00 EDT
+    struct tm before = toLocal(1772953199);
+    struct tm after = toLocal(1772953200);
+    TEST_ASSERT_EQUAL(1, before.tm_hour);
+    TEST_ASSERT_EQUAL(59, before.tm_min);
+    TEST_ASSERT_EQUAL(3, after.tm_hour);
+    TEST_ASSERT_EQUAL(0, after.tm_min);
+}
+
+void test_tz_rule_fall_back() {
+    // First Sunday in November: 1:59:59 EDT is followed by 1:00:00 EST
+    struct tm before = toLocal(1793512799);
+    struct tm after = toLocal(1793512800);
+    TEST_ASSERT_EQUAL(1, before.tm_hour);
+    TEST_ASSERT_EQUAL(1, before.tm_isdst);
+    TEST_ASSERT_EQUAL(1, after.tm_hour);
+    TEST_ASSERT_EQUAL(0, after.tm_min);
+    TEST_ASSERT_EQUAL(0, after.tm_isdst);
+}
+
 // ============================================================================
 // Test Runner
 // ============================================================================
@@ -135,5 +188,11 @@ int main(int argc, char **argv) {
     // Edge cases
     RUN_TEST(test_all_hours_in_valid_range);
     
+    // Time zone rule tests
+    RUN_TEST(test_tz_rule_standard_time);
+    RUN_TEST(test_tz_rule_daylight_time);
+    RUN_TEST(test_tz_rule_spring_forward);
+    RUN_TEST(test_tz_rule_fall_back);
+    
     return UNITY_END();
 }
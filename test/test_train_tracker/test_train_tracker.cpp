@@ -0,0 +1,345 @@
+/**
+ * Unit tests for train tracking across polls
+ * 
+ * Tests association of predictions between polls, ETA smoothing,
+ * coasting through missed polls, and departure detection.
+ * These tests run natively on your computer without ESP32 hardware.
+ * 
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include <cstring>
+#include "train_tracker.h"
+
+/**
+ * Build an observation the way WmataClient does from a JSON train object
+ */
+TrainObservation makeObservation(const char* line, const char* dest, uint8_t group,
+                                 uint8_t cars, const char* minutes) {
+    TrainObservation observation;
+    strncpy(observation.line, line, LINE_MAX_LEN - 1);
+    observation.line[LINE_MAX_LEN - 1] = '\0';
+    strncpy(observation.destination, dest, DEST_MAX_LEN - 1);
+    observation.destination[DEST_MAX_LEN - 1] = '\0';
+    observation.group = group;
+    observation.cars = cars;
+    parseTrainMinutes(minutes, observation.status, observation.etaMs);
+    return observation;
+}
+
+/**
+ * Format the next train in a group as shown on the panel
+ */
+void nextMinutes(const TrainTracker& tracker, uint8_t group, unsigned long nowMs, char* buffer) {
+    int index = tracker.findNext(group, nowMs);
+    TEST_ASSERT_TRUE(index >= 0);
+    tracker.formatMinutes(tracker.getTrain(index), nowMs, buffer, MIN_MAX_LEN);
+}
+
+// ============================================================================
+// Minutes Parsing Tests
+// ============================================================================
+
+void test_parse_numeric_minutes() {
+    uint8_t status;
+    long etaMs;
+    TEST_ASSERT_TRUE(parseTrainMinutes("5", status, etaMs));
+    
+    TEST_ASSERT_EQUAL(TRAIN_MOVING, status);
+    TEST_ASSERT_EQUAL(5 * 60000L + 30000L, etaMs);
+}
+
+void test_parse_brd_and_arr() {
+    uint8_t status;
+    long etaMs;
+    
+    TEST_ASSERT_TRUE(parseTrainMinutes("BRD", status, etaMs));
+    TEST_ASSERT_EQUAL(TRAIN_BOARDING, status);
+    TEST_ASSERT_EQUAL(0, etaMs);
+    
+    TEST_ASSERT_TRUE(parseTrainMinutes("ARR", status, etaMs));
+    TEST_ASSERT_EQUAL(TRAIN_ARRIVING, status);
+}
+
+void test_parse_rejects_placeholders() {
+    uint8_t status;
+    long etaMs;
+    
+    TEST_ASSERT_FALSE(parseTrainMinutes("---", status, etaMs));
+    TEST_ASSERT_FALSE(parseTrainMinutes("", status, etaMs));
+    TEST_ASSERT_FALSE(parseTrainMinutes(nullptr, status, etaMs));
+}
+
+// ============================================================================
+// Association Tests
+// ============================================================================
+
+void test_same_train_keeps_id_across_polls() {
+    TrainTracker tracker;
+    TrainObservation poll1[] = {makeObservation("RD", "Glenmont", 1, 8, "6")};
+    TrainObservation poll2[] = {makeObservation("RD", "Glenmont", 1, 8, "5")};
+    
+    tracker.update(poll1, 1, 0);
+    uint16_t id = tracker.getTrain(0).id;
+    tracker.update(poll2, 1, 30000);
+    
+    TEST_ASSERT_EQUAL(1, tracker.getCount());
+    TEST_ASSERT_EQUAL(id, tracker.getTrain(0).id);
+}
+
+void test_different_destinations_are_separate_trains() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {
+        makeObservation("RD", "Glenmont", 1, 8, "3"),
+        makeObservation("RD", "Silver Spring", 1, 6, "4"),
+    };
+    
+    tracker.update(poll, 2, 0);
+    tracker.update(poll, 2, 20000);
+    
+    TEST_ASSERT_EQUAL(2, tracker.getCount());
+}
+
+void test_car_count_mismatch_is_a_different_train() {
+    TrainTracker tracker;
+    TrainObservation poll1[] = {makeObservation("RD", "Glenmont", 1, 6, "4")};
+    TrainObservation poll2[] = {makeObservation("RD", "Glenmont", 1, 8, "4")};
+    
+    tracker.update(poll1, 1, 0);
+    tracker.update(poll2, 1, 20000);
+    
+    // The 6-car train is coasting (missed once), the 8-car train is new
+    TEST_ASSERT_EQUAL(2, tracker.getCount());
+}
+
+void test_following_trains_matched_by_closest_eta() {
+    TrainTracker tracker;
+    TrainObservation poll1[] = {
+        makeObservation("RD", "Glenmont", 1, 8, "2"),
+        makeObservation("RD", "Glenmont", 1, 8, "9"),
+    };
+    TrainObservation poll2[] = {
+        makeObservation("RD", "Glenmont", 1, 8, "1"),
+        makeObservation("RD", "Glenmont", 1, 8, "8"),
+    };
+    
+    tracker.update(poll1, 2, 0);
+    uint16_t firstId = tracker.getTrain(tracker.findNext(1, 0)).id;
+    tracker.update(poll2, 2, 60000);
+    
+    TEST_ASSERT_EQUAL(2, tracker.getCount());
+    TEST_ASSERT_EQUAL(firstId, tracker.getTrain(tracker.findNext(1, 60000)).id);
+}
+
+// ============================================================================
+// Smoothing Tests
+// ============================================================================
+
+void test_countdown_continues_between_polls() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {makeObservation("BL", "Largo", 2, 6, "5")};
+    tracker.update(poll, 1, 0);
+    
+    char minutes[MIN_MAX_LEN];
+    nextMinutes(tracker, 2, 0, minutes);
+    TEST_ASSERT_EQUAL_STRING("5", minutes);
+    
+    nextMinutes(tracker, 2, 90000, minutes);
+    TEST_ASSERT_EQUAL_STRING("4", minutes);
+}
+
+void test_jitter_is_damped() {
+    TrainTracker tracker;
+    TrainObservation poll1[] = {makeObservation("BL", "Largo", 2, 6, "4")};
+    TrainObservation poll2[] = {makeObservation("BL", "Largo", 2, 6, "5")};
+    
+    tracker.update(poll1, 1, 0);
+    tracker.update(poll2, 1, 20000);
+    
+    // Predicted 4:10, observed 5:30; the filter moves only halfway
+    char minutes[MIN_MAX_LEN];
+    nextMinutes(tracker, 2, 20000, minutes);
+    TEST_ASSERT_EQUAL_STRING("4", minutes);
+}
+
+void test_large_jump_resyncs() {
+    TrainTracker tracker;
+    TrainObservation poll1[] = {makeObservation("BL", "Largo", 2, 6, "3")};
+    TrainObservation poll2[] = {makeObservation("BL", "Largo", 2, 6, "5")};
+    
+    tracker.update(poll1, 1, 0);
+    tracker.update(poll2, 1, 10000);
+    
+    // Over two minutes off is a real delay, not jitter
+    char minutes[MIN_MAX_LEN];
+    nextMinutes(tracker, 2, 10000, minutes);
+    TEST_ASSERT_EQUAL(1, tracker.getCount());
+    TEST_ASSERT_EQUAL_STRING("5", minutes);
+}
+
+void test_countdown_bottoms_out_at_arr() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {makeObservation("OR", "Vienna", 1, 8, "1")};
+    tracker.update(poll, 1, 0);
+    
+    char minutes[MIN_MAX_LEN];
+    nextMinutes(tracker, 1, 300000, minutes);
+    TEST_ASSERT_EQUAL_STRING("ARR", minutes);
+}
+
+// ============================================================================
+// Missing Train and Departure Tests
+// ============================================================================
+
+void test_missing_train_coasts_then_drops() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {makeObservation("GR", "Branch Av", 2, 8, "9")};
+    tracker.update(poll, 1, 0);
+    
+    for (int i = 1; i <= TRACK_MISS_LIMIT; i++) {
+        tracker.update(nullptr, 0, i * 20000UL);
+        TEST_ASSERT_EQUAL(1, tracker.getCount());
+    }
+    
+    tracker.update(nullptr, 0, (TRACK_MISS_LIMIT + 1) * 20000UL);
+    TEST_ASSERT_EQUAL(0, tracker.getCount());
+}
+
+void test_boarding_train_that_vanishes_departs() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {makeObservation("YL", "Huntington", 1, 6, "BRD")};
+    tracker.update(poll, 1, 0);
+    tracker.update(nullptr, 0, 20000);
+    
+    DepartureEvent departure;
+    TEST_ASSERT_EQUAL(0, tracker.getCount());
+    TEST_ASSERT_TRUE(tracker.getRecentDeparture(1, 20000, departure));
+    TEST_ASSERT_EQUAL_STRING("Hunt", departure.destination);
+    TEST_ASSERT_EQUAL(20000UL, departure.departedMs);
+}
+
+void test_departure_expires() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {makeObservation("YL", "Huntington", 1, 6, "BRD")};
+    tracker.update(poll, 1, 0);
+    tracker.update(nullptr, 0, 20000);
+    
+    DepartureEvent departure;
+    TEST_ASSERT_FALSE(tracker.getRecentDeparture(1, 20001 + TRACK_DEPARTED_HOLD_MS, departure));
+    TEST_ASSERT_FALSE(tracker.getRecentDeparture(2, 20000, departure));
+    TEST_ASSERT_EQUAL(1, tracker.getDepartureCount());
+}
+
+void test_tracker_capacity_is_bounded() {
+    TrainTracker tracker;
+    TrainObservation poll[MAX_TRACKED_TRAINS + 4];
+    for (int i = 0; i < MAX_TRACKED_TRAINS + 4; i++) {
+        char minutes[4];
+        snprintf(minutes, sizeof(minutes), "%d", i * 4);
+        poll[i] = makeObservation("SV", "Ashburn", 1, 8, minutes);
+    }
+    
+    tracker.update(poll, MAX_TRACKED_TRAINS + 4, 0);
+    
+    TEST_ASSERT_EQUAL(MAX_TRACKED_TRAINS, tracker.getCount());
+}
+
+// ============================================================================
+// Upcoming Trains Tests
+// ============================================================================
+
+void test_upcoming_sorted_and_bounded() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {
+        makeObservation("RD", "Glenmont", 1, 8, "12"),
+        makeObservation("RD", "Shady Grove", 2, 8, "1"),
+        makeObservation("RD", "Glenmont", 1, 8, "3"),
+        makeObservation("RD", "Silver Spring", 1, 6, "20"),
+        makeObservation("RD", "Glenmont", 1, 8, "7"),
+    };
+    tracker.update(poll, 5, 0);
+    
+    TrackedTrain upcoming[3];
+    int count = tracker.findUpcoming(1, 0, upcoming, 3);
+    
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(3 * 60000L + 30000L, upcoming[0].etaMs);
+    TEST_ASSERT_EQUAL(7 * 60000L + 30000L, upcoming[1].etaMs);
+    TEST_ASSERT_EQUAL(12 * 60000L + 30000L, upcoming[2].etaMs);
+    TEST_ASSERT_EQUAL(tracker.getTrain(tracker.findNext(1, 0)).id, upcoming[0].id);
+}
+
+void test_upcoming_fewer_than_requested() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {
+        makeObservation("RD", "Shady Grove", 2, 8, "4"),
+        makeObservation("RD", "Glenmont", 1, 8, "2"),
+    };
+    tracker.update(poll, 2, 0);
+    
+    TrackedTrain upcoming[3];
+    TEST_ASSERT_EQUAL(1, tracker.findUpcoming(2, 0, upcoming, 3));
+    TEST_ASSERT_EQUAL_STRING("Shad", upcoming[0].destination);
+    TEST_ASSERT_EQUAL(0, tracker.findUpcoming(3, 0, upcoming, 3));
+}
+
+void test_upcoming_boarding_first_on_tie() {
+    TrainTracker tracker;
+    TrainObservation poll[] = {
+        makeObservation("RD", "Glenmont", 1, 8, "ARR"),
+        makeObservation("RD", "Glenmont", 1, 6, "BRD"),
+    };
+    tracker.update(poll, 2, 0);
+    
+    TrackedTrain upcoming[2];
+    TEST_ASSERT_EQUAL(2, tracker.findUpcoming(1, 0, upcoming, 2));
+    TEST_ASSERT_EQUAL(TRAIN_BOARDING, upcoming[0].status);
+    TEST_ASSERT_EQUAL(TRAIN_ARRIVING, upcoming[1].status);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp(void) {
+    // Called before each test
+}
+
+void tearDown(void) {
+    // Called after each test
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    
+    // Minutes parsing
+    RUN_TEST(test_parse_numeric_minutes);
+    RUN_TEST(test_parse_brd_and_arr);
+    RUN_TEST(test_parse_rejects_placeholders);
+    
+    // Association
+    RUN_TEST(test_same_train_keeps_id_across_polls);
+    RUN_TEST(test_different_destinations_are_separate_trains);
+    RUN_TEST(test_car_count_mismatch_is_a_different_train);
+    RUN_TEST(test_following_trains_matched_by_closest_eta);
+    
+    // Smoothing
+    RUN_TEST(test_countdown_continues_between_polls);
+    RUN_TEST(test_jitter_is_damped);
+    RUN_TEST(test_large_jump_resyncs);
+    RUN_TEST(test_countdown_bottoms_out_at_arr);
+    
+    // Missing trains and departures
+    RUN_TEST(test_missing_train_coasts_then_drops);
+    RUN_TEST(test_boarding_train_that_vanishes_departs);
+    RUN_TEST(test_departure_expires);
+    RUN_TEST(test_tracker_capacity_is_bounded);
+    
+    // Upcoming trains
+    RUN_TEST(test_upcoming_sorted_and_bounded);
+    RUN_TEST(test_upcoming_fewer_than_requested);
+    RUN_TEST(test_upcoming_boarding_first_on_tie);
+    
+    return UNITY_END();
+}
@@ -26,7 +26,7 @@ struct TrainPrediction {
 
 /**
  * Parse train data into a TrainPrediction struct
- * (Mirrors the logic in WmataClient::_parseTrainObject)
+ * (Mirrors the logic in WmataJsonProvider::_parseTrainObject)
  */
 void parseTrainObject(const char* destination, const char* minutes, const char* line, TrainPrediction& prediction) {
     strncpy(prediction.destination, destination, DEST_MAX_LEN - 1);